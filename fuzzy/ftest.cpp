@@ -25,10 +25,89 @@
 //   ./ftest 'ab_cd' 'ab-cd'
 //   ./ftest 'ab_cd' 'abCd' 2
 //   ./ftest 'ab_cd' 'ab_ab_cd' 2
+//
+// Run the tests of find() with the bit-parallel NFA and the pigeonhole filter:
+//   ./ftest
 
 // #define DEBUG_REFLEX // enable debugging to stderr
 
-#include "fuzzymatcher.h"
+#include <reflex/fuzzymatcher.h>
+
+// the matches of find() as "text@first/edits ", with a buffer of the given size or all input buffered when 0
+static std::string find_all(const char *regex, const std::string& text, uint8_t max, size_t size)
+{
+  reflex::Pattern pattern(reflex::Matcher::convert(regex, reflex::convert_flag::unicode), "mr");
+  reflex::FuzzyMatcher matcher(pattern, max, text);
+  if (size > 0)
+    matcher.buffer(size);
+  std::string matches;
+  while (matcher.find())
+    matches.append(matcher.text()).append("@").append(std::to_string(matcher.first())).append("/").append(std::to_string(matcher.edits())).append(" ");
+  return matches;
+}
+
+// test find() of string patterns, which uses the bit-parallel NFA and the pigeonhole filter when the string is long enough
+static bool test()
+{
+  struct { const char *regex; const char *text; uint8_t max; const char *found; } tests[] = {
+    // the leftmost match with the minimal edit distance
+    { "abcd", "xxabxd yy abcd", 1, "abxd@2/1 abcd@10/0 " },
+    { "abcd", "abxcd", 2, "abxcd@0/1 " },
+    { "abcd", "aabcd", 1, "abcd@1/0 " },
+    { "abcd", "abcxabcd", 2, "abcx@0/1 abcd@4/0 " },
+    { "abcd", "abd abcd", 1, "abd@0/1 abcd@4/0 " },
+    // the first char must match
+    { "abcd", "xbcd", 1, "" },
+    // matches at the end of the input
+    { "abcd", "zzzabc", 1, "abc@3/1 " },
+    { "abcd", "zzzab", 2, "ab@3/2 " },
+    // the pigeonhole filter with max + 1 pieces of the string
+    { "abcdefghij", "..abcdefghij..abcdexghij..abcefghij..abcdefghijk", 1, "abcdefghij@2/0 abcdexghij@14/1 abcefghij@26/1 abcdefghij@37/0 " },
+    { "abcdefghij", "..abcdefghij..abcdexghij..abcefghij..abcdefghijk", 2, "abcdefghij@2/0 abcdexghij@14/1 abcefghij@26/1 abcdefghij@37/0 " },
+    { "hello world", "say hello wrld and helo world, hello world", 2, "hello wrld@4/1 helo world@19/1 hello world@31/0 " },
+    // the pigeonhole filter allows for insertions before the pieces found, UTF-8 chars count as one error
+    { "abcdefghij", "..abcdefxyghij..ab12cdefghij", 2, "abcdefxyghij@2/2 ab12cdefghij@16/2 " },
+    { "abcdefghij", "..abcde\xc3\xa9" "fghij..", 1, "abcde\xc3\xa9" "fghij@2/1 " },
+    { "hello world", "hi, hell\xc3\xb6 world", 1, "hell\xc3\xb6 world@4/1 " },
+  };
+  bool ok = true;
+  for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i)
+  {
+    // the matches do not depend on the buffer size, as the buffer shifts the pigeonhole filter keeps the pieces found
+    for (size_t size = 0; size <= 40; ++size)
+    {
+      std::string found = find_all(tests[i].regex, tests[i].text, tests[i].max, size);
+      if (found != tests[i].found)
+      {
+        printf("FAILED: find() of '%s' in '%s' with max %u and buffer %zu: '%s' expected '%s'\n", tests[i].regex, tests[i].text, tests[i].max, size, found.c_str(), tests[i].found);
+        ok = false;
+        break;
+      }
+    }
+  }
+  // many matches with one error, the pigeonhole filter skips ahead over the gaps between them as the buffer shifts
+  std::string text;
+  std::string expected;
+  for (size_t i = 0; i < 200; ++i)
+  {
+    const char *match = i % 3 == 0 ? "abcdefghij" : i % 3 == 1 ? "abcdxfghij" : "abdefghij";
+    text.append(i % 37, '.');
+    expected.append(match).append("@").append(std::to_string(text.size())).append(i % 3 == 0 ? "/0 " : "/1 ");
+    text.append(match);
+  }
+  const size_t sizes[] = { 0, 7, 16, 31, 64, 100, 257 };
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+  {
+    if (find_all("abcdefghij", text, 1, sizes[i]) != expected)
+    {
+      printf("FAILED: find() of many matches with max 1 and buffer %zu\n", sizes[i]);
+      ok = false;
+    }
+  }
+  if (ok)
+    printf("find() tests passed\n\n");
+  return ok;
+}
 
 int main(int argc, char **argv)
 {
@@ -88,6 +167,8 @@ int main(int argc, char **argv)
   else
   {
     fprintf(stderr, "Usage: test regex text [max_error]\n\n");
+    if (!test())
+      return EXIT_FAILURE;
   }
   return 0;
 }
@@ -46,6 +46,15 @@
 /// This compile-time option adds span(), line(), wline(), speeds up buffer shifting and lineno().
 #define WITH_SPAN
 
+/// This compile-time option counts hot-path matcher events returned by stats(), define with -DWITH_MATCHER_STATS to enable.
+// #define WITH_MATCHER_STATS
+
+#if defined(WITH_MATCHER_STATS)
+# define REFLEX_STAT(x) (x)
+#else
+# define REFLEX_STAT(x) ((void)0)
+#endif
+
 #include<reflex/convert.h>
 #include<reflex/debug.h>
 #include<reflex/input.h>
@@ -54,6 +63,7 @@
 #include<cstdlib>
 #include<cctype>
 #include<iterator>
+#include<memory>
 
 namespace reflex {
 
@@ -124,8 +134,56 @@ class AbstractMatcher {
     size_t      len; ///< length of buffered context
     size_t      num; ///< number of bytes shifted out so far, when buffer shifted
   };
+  /// A caller-supplied buffer that a matcher borrows to read input into instead of allocating its own, the buffer must be persistent while the matcher uses it and is never deleted by the matcher.
+  struct Buffer {
+    Buffer(
+        char  *base, ///< base of the buffer
+        size_t size) ///< size of the buffer, at least 2 bytes, preferably 2*Const::BLOCK to never enlarge the buffer for short matches
+      :
+        base(base),
+        size(size)
+    { }
+    char  *base; ///< base of the buffer
+    size_t size; ///< size of the buffer
+  };
   /// Event handler functor base class to invoke when the buffer contents are shifted out, e.g. for logging the data searched.
   struct Handler { virtual void operator()(AbstractMatcher&, const char*, size_t, size_t) = 0; };
+  /// Event handler functor base class to invoke when a match or line does not fit in the buffer size limit set with limit(), the functor may throw an exception to stop matching.
+  struct OverflowHandler { virtual void operator()(AbstractMatcher&, size_t) = 0; };
+  /// Matcher statistics returned by stats() to tell whether matching is prefilter-bound, DFA-bound or I/O-bound.
+  struct Stats {
+    Stats()
+      :
+        read(0),
+        scanned(0),
+        advances(0),
+        skipped(0),
+        bm_hits(0),
+        bm_false(0),
+        pm_hits(0),
+        pm_false(0),
+        pm_rejects(0),
+        shifts(0),
+        moved(0),
+        reallocs(0),
+        redos(0),
+        lap_resets(0)
+    { }
+    size_t read;       ///< number of bytes read from the input into the buffer so far
+    size_t scanned;    ///< number of bytes examined by the pattern matching engine, including bytes examined again after backtracking
+    size_t advances;   ///< number of times advance() searched for the next possible match
+    size_t skipped;    ///< number of bytes skipped by advance()
+    size_t bm_hits;    ///< number of possible matches found by the (Boyer-Moore) pattern prefix string search
+    size_t bm_false;   ///< number of bm_hits that did not match the pattern, i.e. prefilter false positives
+    size_t pm_hits;    ///< number of possible matches found by predict-match for patterns without a prefix string
+    size_t pm_false;   ///< number of pm_hits that did not match the pattern, i.e. prefilter false positives
+    size_t pm_rejects; ///< number of pattern prefix string hits rejected by predict-match
+    size_t shifts;     ///< number of times the buffer was shifted or enlarged by grow()
+    size_t moved;      ///< number of bytes moved by grow()
+    size_t reallocs;   ///< number of buffer reallocations by grow()
+    size_t redos;      ///< number of REDO accepts that are ignored to continue matching
+    size_t lap_resets; ///< number of times lookahead head positions were discarded to retry matching
+  };
  protected:
   /// AbstractMatcher::Options for matcher engines.
   struct Option {
@@ -134,11 +192,13 @@ class AbstractMatcher {
         A(false),
         N(false),
         W(false),
+        S(false),
         T(8)
     { }
     bool A; ///< accept any/all (?^X) negative patterns as Const::REDO accept index codes
     bool N; ///< nullable, find may return empty match (N/A to scan, split, matches)
     bool W; ///< half-check for "whole words", check only left of \< and right of \> for non-word character
+    bool S; ///< suspend matching when the input runs dry, i.e. no input is available yet but the input is not at EOF
     char T; ///< tab size, must be a power of 2, default is 8, for column count and indent \i, \j, and \k
   };
   /// AbstractMatcher::Iterator class for scanning, searching, and splitting input character sequences.
@@ -277,7 +337,28 @@ class AbstractMatcher {
     :
       scan(this, Const::SCAN),
       find(this, Const::FIND),
-      split(this, Const::SPLIT)
+      split(this, Const::SPLIT),
+      brw_(nullptr),
+      bsz_(0),
+      lim_(0),
+      ovh_(nullptr)
+  {
+    in = input;
+    init(opt);
+  }
+  /// Construct a base abstract matcher that borrows a caller-supplied buffer to read input into, the buffer is enlarged only when a match does not fit, by allocating a new buffer.
+  AbstractMatcher(
+      const Input&  input,  ///< input character sequence for this matcher
+      const Buffer& buffer, ///< buffer borrowed by this matcher
+      const char   *opt)    ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*`
+    :
+      scan(this, Const::SCAN),
+      find(this, Const::FIND),
+      split(this, Const::SPLIT),
+      brw_(buffer.size >= 2 ? buffer.base : nullptr),
+      bsz_(buffer.size),
+      lim_(0),
+      ovh_(nullptr)
   {
     in = input;
     init(opt);
@@ -289,7 +370,11 @@ class AbstractMatcher {
     :
       scan(this, Const::SCAN),
       find(this, Const::FIND),
-      split(this, Const::SPLIT)
+      split(this, Const::SPLIT),
+      brw_(nullptr),
+      bsz_(0),
+      lim_(0),
+      ovh_(nullptr)
   {
     in = input;
     init();
@@ -300,17 +385,7 @@ class AbstractMatcher {
   {
     DBGLOG("AbstractMatcher::~AbstractMatcher()");
     if (own_)
-    {
-#if defined(WITH_REALLOC)
-#if (defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)) && !defined(__CYGWIN__)
-      _aligned_free(static_cast<void*>(buf_));
-#else
-      std::free(static_cast<void*>(buf_));
-#endif
-#else
-      delete[] buf_;
-#endif
-    }
+      delete_buffer();
   }
   /// Polymorphic cloning.
   virtual AbstractMatcher *clone() = 0;
@@ -323,6 +398,7 @@ class AbstractMatcher {
       opt_.A = false; // when true: accept any/all (?^X) negative patterns as Const::REDO accept index codes
       opt_.N = false; // when true: find may return empty match (N/A to scan, split, matches)
       opt_.W = false; // when true: half-check for "whole words", check only left of \< and right of \> for non-word character
+      opt_.S = false; // when true: suspend matching when the input runs dry, see dry()
       opt_.T = 8;     // tab size 1, 2, 4, or 8
       if (opt)
       {
@@ -339,6 +415,9 @@ class AbstractMatcher {
             case 'W':
               opt_.W = true;
               break;
+            case 'S':
+              opt_.S = true;
+              break;
             case 'T':
               opt_.T = isdigit(*(s += (s[1] == '=') + 1)) ? static_cast<char>(*s - '0') : 0;
               break;
@@ -346,22 +425,47 @@ class AbstractMatcher {
         }
       }
     }
+    if (in.mapped())
+    {
+      // scan memory-mapped input in place, no buffer allocation and no copying or growing of the buffer is needed
+      (void)buffer(in.mapped_data(), in.size() + 1);
+      return;
+    }
+    if (rdo_)
+    {
+      if (in.is_cstring())
+      {
+        // scan the string in place read-only, the string is not copied and not modified
+        size_t size = in.size();
+        (void)buffer(const_cast<char*>(size > 0 ? in.cstring() : ""), size + 1);
+        rdo_ = true;
+        return;
+      }
+      rdo_ = false;
+    }
+    if (own_ && buf_ != brw_ && (brw_ != nullptr || (max_ < 2 * Const::BLOCK && in.size_hint() + 2 > max_) || (lim_ > 0 && max_ > lim_)))
+    {
+      // release the buffer enlarged by grow() to return to the borrowed buffer, or release a short buffer too small for the new input or too large for the limit
+      delete_buffer();
+      own_ = false;
+    }
     if (!own_)
     {
-      max_ = 2 * Const::BLOCK;
-#if defined(WITH_REALLOC)
-#if (defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)) && !defined(__CYGWIN__)
-      buf_ = static_cast<char*>(_aligned_malloc(max_, 4096));
-      if (buf_ == nullptr)
-        throw std::bad_alloc();
-#else
-      buf_ = nullptr;
-      if (::posix_memalign(reinterpret_cast<void**>(&buf_), 4096, max_) != 0)
-        throw std::bad_alloc();
-#endif
-#else
-      buf_ = new char[max_];
-#endif
+      if (brw_ != nullptr)
+      {
+        // read input into the borrowed buffer, no allocation is needed
+        buf_ = brw_;
+        max_ = bsz_;
+      }
+      else
+      {
+        // size the buffer to fit short input of known size with a final \0 and one spare byte to detect EOF without growing the buffer
+        size_t size = in.size_hint();
+        max_ = size > 0 && size + 2 < 2 * Const::BLOCK ? size + 2 : 2 * Const::BLOCK;
+        if (lim_ > 0 && max_ > lim_)
+          max_ = lim_;
+        buf_ = new_buffer(max_);
+      }
     }
     buf_[0] = '\0';
     txt_ = buf_;
@@ -384,8 +488,12 @@ class AbstractMatcher {
     cno_ = 0;
 #endif
     num_ = 0;
+    shf_ = 0;
+    sts_ = Stats();
     own_ = true;
+    ovf_ = false;
     eof_ = false;
+    dry_ = false;
     mat_ = false;
   }
   /// Set buffer block size for reading: use 0 (or omit argument) to buffer all input in which case returns true if all the data could be read and false if a read error occurred.
@@ -398,21 +506,44 @@ class AbstractMatcher {
     blk_ = blk;
     if (blk > 0 || eof_ || in.eof())
       return true;
-    size_t n = in.size(); // get the (rest of the) data size, which is 0 if unknown (e.g. reading input from a TTY or a pipe)
+    size_t n = in.size_hint(); // get a lower bound of the (rest of the) data size without reading it, which is 0 if unknown (e.g. reading input from a TTY or a pipe)
     if (n > 0)
     {
       (void)grow(n + 1); // now attempt to fetch all (remaining) data to store in the buffer, +1 for a final \0
-      end_ += get(buf_, n);
+      end_ += get(buf_ + end_, n < room() ? n : room());
     }
-    while (in.good()) // there is more to get while good(), e.g. via wrap()
+    while (in.good() && !ovf_) // there is more to get while good(), e.g. via wrap()
     {
       (void)grow();
-      end_ += get(buf_ + end_, max_ - end_);
+      end_ += get(buf_ + end_, room());
     }
-    if (end_ == max_)
-      (void)grow(1); // make sure we have room for a final \0
     return in.eof();
   }
+  /// Set a hard limit on the buffer size in bytes to bound memory use, or 0 for no limit (default), reset/restart the matcher.
+  void limit(size_t max) ///< maximum buffer size in bytes, at least 2 or 0 for no limit
+    /// @note When a match or line does not fit in the buffer at the limit, the matcher stops reading input, overflow() returns true, and the overflow handler set with set_overflow_handler() is invoked.  The last match is truncated to the input buffered, which may cause a mismatch.  Use this method before any matching is done.
+  {
+    DBGLOG("AbstractMatcher::limit(%zu)", max);
+    lim_ = max > 0 && max < 2 ? 2 : max;
+    reset();
+  }
+  /// Returns the buffer size limit set with limit(), or 0 for no limit.
+  size_t limit() const
+    /// @returns buffer size limit in bytes or 0
+  {
+    return lim_;
+  }
+  /// Returns true if the matcher stopped reading input because a match or line did not fit in the buffer at the limit set with limit().
+  bool overflow() const
+    /// @returns true if the buffer limit was reached
+  {
+    return ovf_;
+  }
+  /// Set event handler functor to invoke when a match or line does not fit in the buffer at the limit set with limit(), e.g. to log the input or to throw an exception to stop matching.
+  void set_overflow_handler(OverflowHandler *handler)
+  {
+    ovh_ = handler;
+  }
 #if defined(WITH_SPAN)
   /// Set event handler functor to invoke when the buffer contents are shifted out, e.g. for logging the data searched.
   void set_handler(Handler *handler)
@@ -472,9 +603,26 @@ class AbstractMatcher {
   {
     DBGLOG("AbstractMatcher::input()");
     in = input;
+    rdo_ = false;
     reset();
     return *this;
   }
+  /// Scan a string, std::string, or std::string_view input in place read-only without copying it to a buffer, reset/restart the matcher, the string is not modified by text(), unput(), and wunput(), see in_place() for details.
+  AbstractMatcher& in_place(const Input& input) ///< string input to scan in place
+    /// @returns this matcher
+  {
+    DBGLOG("AbstractMatcher::in_place()");
+    in = input;
+    rdo_ = true;
+    reset();
+    return *this;
+  }
+  /// Returns true if this matcher scans a string in place read-only, see in_place().
+  bool in_place() const
+    /// @returns true if scanning in place read-only
+  {
+    return rdo_;
+  }
   /// Set the buffer base containing 0-terminated character data to scan in place (data may be modified), reset/restart the matcher.
   AbstractMatcher& buffer(
       char *base,  ///< base of the buffer containing 0-terminated character data
@@ -484,17 +632,7 @@ class AbstractMatcher {
     if (size > 0)
     {
       if (own_)
-      {
-#if defined(WITH_REALLOC)
-#if (defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)) && !defined(__CYGWIN__)
-        _aligned_free(static_cast<void*>(buf_));
-#else
-        std::free(static_cast<void*>(buf_));
-#endif
-#else
-        delete[] buf_;
-#endif
-      }
+        delete_buffer();
       buf_ = base;
       txt_ = buf_;
       len_ = 0;
@@ -517,8 +655,13 @@ class AbstractMatcher {
       cno_ = 0;
 #endif
       num_ = 0;
+      shf_ = 0;
+      sts_ = Stats();
       own_ = false;
+      rdo_ = false;
+      ovf_ = false;
       eof_ = true;
+      dry_ = false;
       mat_ = false;
     }
     return *this;
@@ -556,6 +699,8 @@ class AbstractMatcher {
   {
     if (chr_ == '\0')
     {
+      if (rdo_)
+        return text_copy();
       chr_ = txt_[len_];
       txt_[len_] = '\0';
     }
@@ -589,21 +734,13 @@ class AbstractMatcher {
   size_t wsize() const
     /// @returns the length of the match in number of wide (multibyte UTF-8) characters
   {
-    size_t n = 0;
-    const char *e = txt_ + len_;
-    for (const char *s = txt_; s < e; ++s)
-      n += (*s & 0xC0) != 0x80;
-    return n;
+    return wchars(txt_, txt_ + len_);
   }
   /// Returns the length of the matched text in number of u32 characters. This is the same as `wsize()`.
   size_t u32size() const
     /// @returns the length of the match in number of u32 (multibyte UTF-8) characters
   {
-    size_t n = 0;
-    const char *e = txt_ + len_;
-    for (const char *s = txt_; s < e; ++s)
-      n += (*s & 0xC0) != 0x80;
-    return n;
+    return wchars(txt_, txt_ + len_);
   }
   /// Returns the first 8-bit character of the text matched.
   char chr() const
@@ -653,137 +790,29 @@ class AbstractMatcher {
             --t;
       bol_ = t + 1;
       lpb_ = txt_;
-      size_t n = lno_;
-#if defined(HAVE_AVX512BW) && (!defined(_MSC_VER) || defined(_WIN64))
-      if (have_HW_AVX512BW())
-      {
-        __m512i vlcn = _mm512_set1_epi8('\n');
-        while (s + 63 <= t)
-        {
-          __m512i vlcm = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(s));
-          uint64_t mask = _mm512_cmpeq_epi8_mask(vlcm, vlcn);
-          n += popcountl(mask);
-          s += 64;
-        }
-      }
-      else if (have_HW_AVX2())
-      {
-        __m256i vlcn = _mm256_set1_epi8('\n');
-        while (s + 31 <= t)
-        {
-          __m256i vlcm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
-          __m256i vlceq = _mm256_cmpeq_epi8(vlcm, vlcn);
-          uint32_t mask = _mm256_movemask_epi8(vlceq);
-          n += popcount(mask);
-          s += 32;
-        }
-      }
-      else if (have_HW_SSE2())
-      {
-        __m128i vlcn = _mm_set1_epi8('\n');
-        while (s + 15 <= t)
-        {
-          __m128i vlcm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
-          __m128i vlceq = _mm_cmpeq_epi8(vlcm, vlcn);
-          uint32_t mask = _mm_movemask_epi8(vlceq);
-          n += popcount(mask);
-          s += 16;
-        }
-      }
-#elif defined(HAVE_AVX2)
-      if (have_HW_AVX2())
-      {
-        __m256i vlcn = _mm256_set1_epi8('\n');
-        while (s + 31 <= t)
-        {
-          __m256i vlcm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
-          __m256i vlceq = _mm256_cmpeq_epi8(vlcm, vlcn);
-          uint32_t mask = _mm256_movemask_epi8(vlceq);
-          n += popcount(mask);
-          s += 32;
-        }
-      }
-      else if (have_HW_SSE2())
-      {
-        __m128i vlcn = _mm_set1_epi8('\n');
-        while (s + 15 <= t)
-        {
-          __m128i vlcm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
-          __m128i vlceq = _mm_cmpeq_epi8(vlcm, vlcn);
-          uint32_t mask = _mm_movemask_epi8(vlceq);
-          n += popcount(mask);
-          s += 16;
-        }
-      }
-#elif defined(HAVE_SSE2)
-      if (have_HW_SSE2())
-      {
-        __m128i vlcn = _mm_set1_epi8('\n');
-        while (s + 15 <= t)
-        {
-          __m128i vlcm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
-          __m128i vlceq = _mm_cmpeq_epi8(vlcm, vlcn);
-          uint32_t mask = _mm_movemask_epi8(vlceq);
-          n += popcount(mask);
-          s += 16;
-        }
-      }
-#elif defined(HAVE_NEON)
-      {
-        // ARM AArch64/NEON SIMD optimized loop? - no code found yet that runs faster than the code below
-      }
-#endif
-      uint32_t n0 = 0, n1 = 0, n2 = 0, n3 = 0;
-      // clang/gcc 4-way vectorizable loop
-      while (s + 3 <= t)
-      {
-        n0 += s[0] == '\n';
-        n1 += s[1] == '\n';
-        n2 += s[2] == '\n';
-        n3 += s[3] == '\n';
-        s += 4;
-      }
-      n += n0 + n1 + n2 + n3;
-      // epilogue
-      if (s <= t)
-      {
-        n += *s == '\n';
-        if (++s <= t)
-        {
-          n += *s == '\n';
-          if (++s <= t)
-            n += *s == '\n';
-        }
-      }
-      lno_ = n;
+      lno_ += newlines(s, bol_);
     }
 #else
-    size_t n = lno_;
-    size_t k = cno_;
     char *s = lpb_;
     char *e = txt_;
-    while (s < e)
+    if (s < e)
     {
-      if (*s == '\n')
+      size_t n = newlines(s, e);
+      size_t k = cno_;
+      if (n > 0)
       {
-        ++n;
+        // count columns from the last \n only
+        lno_ += n;
         k = 0;
+        s = e;
+        while (s[-1] != '\n')
+          --s;
       }
-      else if (*s == '\t')
-      {
-        // count tab spacing
-        k += 1 + (~k & (opt_.T - 1));
-      }
-      else
-      {
-        // count column offset in UTF-8 chars
-        k += ((*s & 0xC0) != 0x80);
-      }
-      ++s;
+      // count column offset in tab spacing and UTF-8 chars
+      k = wcolumns(s, e, k, opt_.T);
+      lpb_ = e;
+      cno_ = k;
     }
-    lpb_ = e;
-    lno_ = n;
-    cno_ = k;
 #endif
     return lno_;
   }
@@ -791,11 +820,7 @@ class AbstractMatcher {
   size_t lines()
     /// @returns number of lines
   {
-    size_t n = 1;
-    const char *e = txt_ + len_;
-    for (const char *s = txt_; s < e; ++s)
-      n += (*s == '\n');
-    return n;
+    return newlines(txt_, txt_ + len_) + 1;
   }
   /// Returns the inclusive ending line number of the match in the input character sequence.
   size_t lineno_end()
@@ -809,18 +834,7 @@ class AbstractMatcher {
   {
     (void)lineno();
 #if defined(WITH_SPAN)
-    const char *s = bol_;
-    const char *e = txt_;
-    size_t k = 0;
-    while (s < e)
-    {
-      if (*s == '\t')
-        k += 1 + (~k & (opt_.T - 1)); // count tab spacing
-      else
-        k += ((*s & 0xC0) != 0x80); // count column offset in UTF-8 chars
-      ++s;
-    }
-    return k;
+    return wcolumns(bol_, txt_, 0, opt_.T);
 #else
     return cno_;
 #endif
@@ -831,19 +845,14 @@ class AbstractMatcher {
   {
     // count columns in tabs and UTF-8 chars
 #if defined(WITH_SPAN)
-    const char *s = txt_;
     const char *e = txt_ + len_;
+    const char *t = static_cast<const char*>(std::memchr(txt_, '\t', len_));
+    // no tabs in the match: the number of columns does not depend on columno()
+    if (t == nullptr)
+      return wcolumns(txt_, e, 0, opt_.T, true);
+    size_t k = wcolumns(txt_, t, 0, opt_.T, true);
     size_t n = columno();
-    size_t k = n;
-    while (s < e)
-    {
-      if (*s == '\t')
-        k += 1 + (~k & (opt_.T - 1)); // count tab spacing
-      else if (*s != '\r' && *s != '\n')
-        k += ((*s & 0xC0) != 0x80); // count column offset in UTF-8 chars
-      ++s;
-    }
-    return k - n;
+    return wcolumns(t, e, n + k, opt_.T, true) - n;
 #else
     size_t n = cno_;
     size_t m = 0;
@@ -858,17 +867,14 @@ class AbstractMatcher {
       }
     }
     t = txt_;
-    const char *e = txt_ + len_;
-    for (++s; s < e; ++s)
+    if (++s <= t)
     {
-      if (s == t)
-        m = n;
-      if (*s == '\t')
-        n += 1 + (~n & (opt_.T - 1));
-      else
-        n += (*s & 0xC0) != 0x80;
+      // count columns from the last \n before the match
+      m = wcolumns(s, t, n, opt_.T);
+      n = m;
+      s = t;
     }
-    return n - m;
+    return wcolumns(s, txt_ + len_, n, opt_.T) - m;
 #endif
   }
 #if defined(WITH_SPAN)
@@ -885,14 +891,7 @@ class AbstractMatcher {
     while (--s >= b)
       if (*s == '\n')
         break;
-    size_t k = 0;
-    while (++s < e)
-    {
-      if (*s == '\t')
-        k += 1 + (~k & (opt_.T - 1));
-      else
-        k += (*s & 0xC0) != 0x80;
-    }
+    size_t k = wcolumns(s + 1, e, 0, opt_.T);
     return k > 0 ? k - 1 : 0;
   }
 #endif
@@ -914,6 +913,21 @@ class AbstractMatcher {
   {
     return num_ + txt_ - buf_;
   }
+  /// Returns the number of times the buffer was shifted or enlarged to make room for more input, e.g. for performance reports.
+  size_t shifts() const
+    /// @returns number of buffer shifts
+  {
+    return shf_;
+  }
+  /// Returns the matcher statistics collected since the last reset, counters other than `read` and `shifts` stay zero unless compiled with -DWITH_MATCHER_STATS.
+  Stats stats() const
+    /// @returns matcher statistics
+  {
+    Stats stats = sts_;
+    stats.read = num_ + end_;
+    stats.shifts = shf_;
+    return stats;
+  }
   /// Returns the exclusive position of the last character of the match in the input character sequence, a constant-time operation.
   size_t last() const
     /// @returns position in the input character sequence
@@ -946,6 +960,12 @@ class AbstractMatcher {
   {
     return pos_ >= end_ && eof_;
   }
+  /// Returns true if the input ran dry with option "S", i.e. no input is available yet but the input is not at EOF, the match is suspended and should be retried when more input is available.
+  bool dry() const
+    /// @returns true if the last match was suspended because the input ran dry
+  {
+    return dry_;
+  }
   /// Set and force the end of input state.
   void set_end(bool eof)
   {
@@ -1026,6 +1046,14 @@ class AbstractMatcher {
   {
     DBGLOG("AbstractMatcher::unput()");
     reset_text();
+    if (rdo_)
+    {
+      // read-only input is not modified, only honor putting back the character that was read
+      if (pos_ > 0 && buf_[pos_ - 1] == c)
+        --pos_;
+      cur_ = pos_;
+      return;
+    }
     if (pos_ > 0)
     {
       --pos_;
@@ -1036,6 +1064,8 @@ class AbstractMatcher {
       len_ = 0;
       if (end_ + 1 >= max_)
         (void)grow();
+      if (end_ + 1 >= max_)
+        return; // the buffer is full at the limit
       std::memmove(buf_ + 1, buf_, end_);
       ++end_;
     }
@@ -1053,6 +1083,14 @@ class AbstractMatcher {
     DBGLOG("AbstractMatcher::wunput()");
     char tmp[8];
     size_t n = utf8(c, tmp);
+    if (rdo_)
+    {
+      // read-only input is not modified, only honor putting back the character that was read
+      if (pos_ >= n && std::memcmp(&buf_[pos_ - n], tmp, n) == 0)
+        pos_ -= n;
+      cur_ = pos_;
+      return;
+    }
     if (pos_ >= n)
     {
       pos_ -= n;
@@ -1063,6 +1101,8 @@ class AbstractMatcher {
       len_ = 0;
       if (end_ + n >= max_)
         (void)grow();
+      if (end_ + n >= max_)
+        return; // the buffer is full at the limit
       std::memmove(buf_ + n, buf_, end_);
       end_ += n;
     }
@@ -1080,6 +1120,14 @@ class AbstractMatcher {
     DBGLOG("AbstractMatcher::u32unput()");
     char tmp[8];
     size_t n = toutf8(c, tmp);
+    if (rdo_)
+    {
+      // read-only input is not modified, only honor putting back the character that was read
+      if (pos_ >= n && std::memcmp(&buf_[pos_ - n], tmp, n) == 0)
+        pos_ -= n;
+      cur_ = pos_;
+      return;
+    }
     if (pos_ >= n)
     {
       pos_ -= n;
@@ -1090,6 +1138,8 @@ class AbstractMatcher {
       len_ = 0;
       if (end_ + n >= max_)
         (void)grow();
+      if (end_ + n >= max_)
+        return; // the buffer is full at the limit
       std::memmove(buf_ + n, buf_, end_);
       end_ += n;
     }
@@ -1117,10 +1167,12 @@ class AbstractMatcher {
     {
       if (end_ + blk_ + 1 >= max_)
         (void)grow();
-      end_ += get(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
+      end_ += get(buf_ + end_, room());
       if (pos_ < end_)
         return static_cast<unsigned char>(buf_[pos_]);
       DBGLOGN("peek(): EOF");
+      if (suspend())
+        return EOF;
       if (!wrap())
       {
         eof_ = true;
@@ -1156,10 +1208,10 @@ class AbstractMatcher {
         break;
       (void)grow();
       loc = end_;
-      end_ += get(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
-      if (loc >= end_ && !wrap())
+      end_ += get(buf_ + end_, room());
+      if (loc >= end_ && (suspend() || !wrap()))
       {
-        eof_ = true;
+        eof_ = !dry_;
         break;
       }
     }
@@ -1172,6 +1224,12 @@ class AbstractMatcher {
       return 0;
     return end_ - (txt_ - buf_);
   }
+  /// Returns the size of the buffer that this matcher reads input into, which is initially sized to fit short input of known size and grows when a match does not fit.
+  size_t capacity() const
+    /// @returns buffer size in bytes
+  {
+    return max_;
+  }
   /// Returns the byte offset of the match from the start of the line.
   size_t border()
     /// @returns border offset
@@ -1238,10 +1296,10 @@ class AbstractMatcher {
       pos_ = cur_ = end_;
       txt_ = buf_ + end_;
       (void)grow();
-      end_ += get(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
-      if (pos_ >= end_ && !wrap())
+      end_ += get(buf_ + end_, room());
+      if (pos_ >= end_ && (suspend() || !wrap()))
       {
-        eof_ = true;
+        eof_ = !dry_;
         break;
       }
     }
@@ -1274,25 +1332,37 @@ class AbstractMatcher {
       return true;
     if (s[1] == '\0')
       return skip(s[0]);
-    while (skip(s[0]))
+    DBGLOG("AbstractMatcher::skip(%s)", s);
+    reset_text();
+    len_ = 0;
+    size_t n = std::strlen(s);
+    while (true)
     {
-      const char *t = s + 1;
-      while (true)
+      if (pos_ + n <= end_)
       {
-        if (*t == '\0')
+        txt_ = const_cast<char*>(find_string(buf_ + pos_, buf_ + end_, s, n));
+        if (txt_ != nullptr)
         {
-          set_current(pos_);
+          txt_ += n;
+          set_current(txt_ - buf_);
           return true;
         }
-        int c = get();
-        if (c == EOF)
-          return false;
-        if (c != static_cast<unsigned char>(*t))
-          break;
-        ++t;
+        pos_ = end_ - n + 1; // keep the last n-1 bytes that may begin with a part of s
+      }
+      if (eof_)
+        break;
+      cur_ = pos_;
+      txt_ = buf_ + pos_;
+      (void)grow();
+      size_t k = get(buf_ + end_, room());
+      end_ += k;
+      if (k == 0 && (suspend() || !wrap()))
+      {
+        eof_ = !dry_;
+        break;
       }
-      pos_ = txt_ - buf_;
     }
+    set_current(end_);
     return false;
   }
   /// Fetch the rest of the input as text, useful for searching/splitting up to n times after which the rest is needed.
@@ -1307,9 +1377,12 @@ class AbstractMatcher {
     {
       (void)grow();
       pos_ = end_;
-      end_ += get(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
-      if (pos_ >= end_ && !wrap())
-        eof_ = true;
+      end_ += get(buf_ + end_, room());
+      if (pos_ >= end_ && (suspend() || !wrap()))
+      {
+        eof_ = !dry_;
+        break;
+      }
     }
     len_ = end_ - cur_;
     pos_ = cur_ = end_;
@@ -1446,18 +1519,54 @@ class AbstractMatcher {
   {
     DBGLOG("AbstractMatcher::init(%s)", opt ? opt : "");
     own_ = false; // require allocation of a buffer
+    rdo_ = false;
     reset(opt);
   }
   /// The abstract match operation implemented by pattern matching engines derived from AbstractMatcher.
   virtual size_t match(Method method)
     /// @returns nonzero when input matched the pattern using method Const::SCAN, Const::FIND, Const::SPLIT, or Const::MATCH
     = 0;
+  /// Allocate a new buffer of the given size.
+  static char *new_buffer(size_t size) ///< buffer size
+    /// @returns new buffer
+  {
+#if defined(WITH_REALLOC)
+#if (defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)) && !defined(__CYGWIN__)
+    char *buf = static_cast<char*>(_aligned_malloc(size, 4096));
+    if (buf == nullptr)
+      throw std::bad_alloc();
+#else
+    char *buf = nullptr;
+    if (::posix_memalign(reinterpret_cast<void**>(&buf), 4096, size) != 0)
+      throw std::bad_alloc();
+#endif
+    return buf;
+#else
+    return new char[size];
+#endif
+  }
+  /// Delete the buffer AbstractMatcher::buf_ allocated by new_buffer() or reallocated by grow(), but not when the buffer is borrowed.
+  void delete_buffer()
+  {
+    if (buf_ == brw_)
+      return;
+#if defined(WITH_REALLOC)
+#if (defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)) && !defined(__CYGWIN__)
+    _aligned_free(static_cast<void*>(buf_));
+#else
+    std::free(static_cast<void*>(buf_));
+#endif
+#else
+    delete[] buf_;
+#endif
+  }
   /// Shift or expand the internal buffer when it is too small to accommodate more input, where the buffer size is doubled when needed, change cur_, pos_, end_, max_, ind_, buf_, bol_, lpb_, and txt_.
   bool grow(size_t need = Const::BLOCK) ///< optional needed space = Const::BLOCK size by default
     /// @returns true if buffer was shifted or enlarged
   {
     if (max_ - end_ >= need + 1)
       return false;
+    ++shf_;
 #if defined(WITH_SPAN)
     (void)lineno();
     if (bol_ + Const::BLOCK < txt_ && evh_ == nullptr)
@@ -1466,6 +1575,11 @@ class AbstractMatcher {
       DBGLOG("Line in buffer to long to shift, moving bol position to text match position minus %zu", Const::BLOCK);
       bol_ = txt_ - Const::BLOCK;
     }
+    if (lim_ > 0 && bol_ < txt_ && end_ - (bol_ - buf_) + 1 >= lim_)
+    {
+      // the line does not fit in the buffer limit, shift the line away up to the match
+      bol_ = txt_;
+    }
     size_t gap = bol_ - buf_;
     if (gap > 0 && evh_ != nullptr)
       (*evh_)(*this, buf_, gap, num_);
@@ -1478,29 +1592,47 @@ class AbstractMatcher {
     lpb_ -= gap;
     num_ += gap;
     std::memmove(buf_, buf_ + gap, end_);
+    REFLEX_STAT(sts_.moved += end_);
     if (max_ - end_ >= need)
     {
       DBGLOG("Shift buffer to close gap of %zu bytes", gap);
     }
+    else if (lim_ > 0 && max_ >= lim_)
+    {
+      DBGLOG("Shift buffer to close gap of %zu bytes, buffer is at the limit of %zu bytes", gap, lim_);
+    }
     else
     {
       size_t newmax = end_ + need;
       while (max_ < newmax)
         max_ *= 2;
+      if (lim_ > 0 && max_ > lim_)
+        max_ = lim_;
       DBGLOG("Expand buffer to %zu bytes", max_);
+      REFLEX_STAT(++sts_.reallocs);
+      char *newbuf;
+      if (buf_ == brw_)
+      {
+        // do not reallocate or delete the borrowed buffer, copy its contents to a new buffer
+        newbuf = new_buffer(max_);
+        std::memcpy(newbuf, buf_, end_);
+      }
+      else
+      {
 #if defined(WITH_REALLOC)
 #if (defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)) && !defined(__CYGWIN__)
-      char *newbuf = static_cast<char*>(_aligned_realloc(static_cast<void*>(buf_), max_, 4096));
+        newbuf = static_cast<char*>(_aligned_realloc(static_cast<void*>(buf_), max_, 4096));
 #else
-      char *newbuf = static_cast<char*>(std::realloc(static_cast<void*>(buf_), max_));
+        newbuf = static_cast<char*>(std::realloc(static_cast<void*>(buf_), max_));
 #endif
-      if (newbuf == nullptr)
-        throw std::bad_alloc();
+        if (newbuf == nullptr)
+          throw std::bad_alloc();
 #else
-      char *newbuf = new char[max_];
-      std::memcpy(newbuf, buf_, end_);
-      delete[] buf_;
+        newbuf = new char[max_];
+        std::memcpy(newbuf, buf_, end_);
+        delete[] buf_;
 #endif
+      }
       txt_ = newbuf + (txt_ - buf_);
       lpb_ = newbuf + (lpb_ - buf_);
       buf_ = newbuf;
@@ -1508,7 +1640,7 @@ class AbstractMatcher {
     bol_ = buf_;
 #else
     size_t gap = txt_ - buf_;
-    if (max_ - end_ + gap >= need)
+    if (max_ - end_ + gap >= need || (lim_ > 0 && max_ >= lim_))
     {
       DBGLOG("Shift buffer to close gap of %zu bytes", gap);
       (void)lineno();
@@ -1519,6 +1651,7 @@ class AbstractMatcher {
       num_ += gap;
       if (end_ > 0)
         std::memmove(buf_, txt_, end_);
+      REFLEX_STAT(sts_.moved += end_);
       txt_ = buf_;
       lpb_ = buf_;
     }
@@ -1528,37 +1661,71 @@ class AbstractMatcher {
       size_t oldmax = max_;
       while (max_ < newmax)
         max_ *= 2;
+      if (lim_ > 0 && max_ > lim_)
+        max_ = lim_;
       if (oldmax < max_)
       {
         DBGLOG("Expand buffer from %zu to %zu bytes", oldmax, max_);
+        REFLEX_STAT(++sts_.reallocs);
+        REFLEX_STAT(sts_.moved += end_);
         (void)lineno();
         cur_ -= gap;
         ind_ -= gap;
         pos_ -= gap;
         end_ -= gap;
         num_ += gap;
+        char *newbuf;
+        if (buf_ == brw_)
+        {
+          // do not reallocate or delete the borrowed buffer, copy its contents to a new buffer
+          newbuf = new_buffer(max_);
+          std::memcpy(newbuf, txt_, end_);
+        }
+        else
+        {
 #if defined(WITH_REALLOC)
-        std::memmove(buf_, txt_, end_);
+          std::memmove(buf_, txt_, end_);
 #if (defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)) && !defined(__CYGWIN__)
-        char *newbuf = static_cast<char*>(_aligned_realloc(static_cast<void*>(buf_), max_, 4096));
+          newbuf = static_cast<char*>(_aligned_realloc(static_cast<void*>(buf_), max_, 4096));
 #else
-        char *newbuf = static_cast<char*>(std::realloc(static_cast<void*>(buf_), max_));
+          newbuf = static_cast<char*>(std::realloc(static_cast<void*>(buf_), max_));
 #endif
-        if (newbuf == nullptr)
-          throw std::bad_alloc();
+          if (newbuf == nullptr)
+            throw std::bad_alloc();
 #else
-        char *newbuf = new char[max_];
-        std::memcpy(newbuf, txt_, end_);
-        delete[] buf_;
+          newbuf = new char[max_];
+          std::memcpy(newbuf, txt_, end_);
+          delete[] buf_;
 #endif
+        }
         buf_ = newbuf;
         txt_ = buf_;
         lpb_ = buf_;
       }
     }
 #endif
+    if (lim_ > 0 && end_ + 1 >= max_)
+      overflow_limit();
     return true;
   }
+  /// Stop reading input when the buffer is full at the limit set with limit(), invokes the overflow handler, the last match is truncated to the buffered input.
+  void overflow_limit()
+  {
+    DBGLOG("Buffer overflow at the limit of %zu bytes", lim_);
+    if (!ovf_)
+    {
+      ovf_ = true;
+      if (ovh_ != nullptr)
+        (*ovh_)(*this, end_);
+    }
+  }
+  /// Returns the number of bytes to read into the buffer, which is the block size set with buffer(n) when nonzero but never more than the free space left for a final \0.
+  size_t room() const
+    /// @returns number of bytes to read
+  {
+    size_t n = max_ - end_ - 1;
+    return blk_ > 0 && blk_ < n ? blk_ : n;
+  }
   /// Returns the next character read from the current input source.
   int get()
     /// @returns the character read (unsigned char 0..255) or EOF (-1)
@@ -1575,10 +1742,12 @@ class AbstractMatcher {
     {
       if (end_ + blk_ + 1 >= max_)
         (void)grow();
-      end_ += get(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
+      end_ += get(buf_ + end_, room());
       if (pos_ < end_)
         return static_cast<unsigned char>(buf_[pos_++]);
       DBGLOGN("get(): EOF");
+      if (suspend())
+        return EOF;
       if (!wrap())
       {
         eof_ = true;
@@ -1587,6 +1756,372 @@ class AbstractMatcher {
     }
 #endif
   }
+  /// Returns the number of \n in the string s up to e, counted with SIMD instructions when available.
+  static size_t newlines(
+      const char *s, ///< start of the string
+      const char *e) ///< end of the string
+    /// @returns number of \n
+  {
+    size_t n = 0;
+#if defined(HAVE_AVX512BW) && (!defined(_MSC_VER) || defined(_WIN64))
+    if (have_HW_AVX512BW())
+    {
+      __m512i vlcn = _mm512_set1_epi8('\n');
+      while (s + 64 <= e)
+      {
+        __m512i vlcm = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(s));
+        uint64_t mask = _mm512_cmpeq_epi8_mask(vlcm, vlcn);
+        n += popcountl(mask);
+        s += 64;
+      }
+    }
+    else if (have_HW_AVX2())
+    {
+      __m256i vlcn = _mm256_set1_epi8('\n');
+      while (s + 32 <= e)
+      {
+        __m256i vlcm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+        __m256i vlceq = _mm256_cmpeq_epi8(vlcm, vlcn);
+        uint32_t mask = _mm256_movemask_epi8(vlceq);
+        n += popcount(mask);
+        s += 32;
+      }
+    }
+    else if (have_HW_SSE2())
+    {
+      __m128i vlcn = _mm_set1_epi8('\n');
+      while (s + 16 <= e)
+      {
+        __m128i vlcm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        __m128i vlceq = _mm_cmpeq_epi8(vlcm, vlcn);
+        uint32_t mask = _mm_movemask_epi8(vlceq);
+        n += popcount(mask);
+        s += 16;
+      }
+    }
+#elif defined(HAVE_AVX2)
+    if (have_HW_AVX2())
+    {
+      __m256i vlcn = _mm256_set1_epi8('\n');
+      while (s + 32 <= e)
+      {
+        __m256i vlcm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+        __m256i vlceq = _mm256_cmpeq_epi8(vlcm, vlcn);
+        uint32_t mask = _mm256_movemask_epi8(vlceq);
+        n += popcount(mask);
+        s += 32;
+      }
+    }
+    else if (have_HW_SSE2())
+    {
+      __m128i vlcn = _mm_set1_epi8('\n');
+      while (s + 16 <= e)
+      {
+        __m128i vlcm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        __m128i vlceq = _mm_cmpeq_epi8(vlcm, vlcn);
+        uint32_t mask = _mm_movemask_epi8(vlceq);
+        n += popcount(mask);
+        s += 16;
+      }
+    }
+#elif defined(HAVE_SSE2)
+    if (have_HW_SSE2())
+    {
+      __m128i vlcn = _mm_set1_epi8('\n');
+      while (s + 16 <= e)
+      {
+        __m128i vlcm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        __m128i vlceq = _mm_cmpeq_epi8(vlcm, vlcn);
+        uint32_t mask = _mm_movemask_epi8(vlceq);
+        n += popcount(mask);
+        s += 16;
+      }
+    }
+#elif defined(HAVE_NEON)
+    {
+      // ARM AArch64/NEON SIMD optimized loop? - no code found yet that runs faster than the code below
+    }
+#endif
+    uint32_t n0 = 0, n1 = 0, n2 = 0, n3 = 0;
+    // clang/gcc 4-way vectorizable loop
+    while (s + 4 <= e)
+    {
+      n0 += s[0] == '\n';
+      n1 += s[1] == '\n';
+      n2 += s[2] == '\n';
+      n3 += s[3] == '\n';
+      s += 4;
+    }
+    n += n0 + n1 + n2 + n3;
+    // epilogue
+    while (s < e)
+      n += *s++ == '\n';
+    return n;
+  }
+  /// Returns the number of UTF-8 characters in the string s up to e, counted with SIMD instructions when available.
+  static size_t wchars(
+      const char *s, ///< start of the string
+      const char *e) ///< end of the string
+    /// @returns number of UTF-8 lead bytes and ASCII chars
+  {
+    // count UTF-8 continuation bytes 0x80 to 0xBF, which are less than -64 as signed chars
+    size_t n = e - s;
+    if (n < 16)
+    {
+      while (s < e)
+        n -= (*s++ & 0xC0) == 0x80;
+      return n;
+    }
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2)
+    if (have_HW_AVX2())
+    {
+      __m256i vc = _mm256_set1_epi8(-64);
+      while (s + 32 <= e)
+      {
+        __m256i vs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+        // ASCII chars only?
+        if (_mm256_movemask_epi8(vs) != 0)
+          n -= popcount(_mm256_movemask_epi8(_mm256_cmpgt_epi8(vc, vs)));
+        s += 32;
+      }
+    }
+    else if (have_HW_SSE2())
+    {
+      __m128i vc = _mm_set1_epi8(-64);
+      while (s + 16 <= e)
+      {
+        __m128i vs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        // ASCII chars only?
+        if (_mm_movemask_epi8(vs) != 0)
+          n -= popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(vc, vs)));
+        s += 16;
+      }
+    }
+#elif defined(HAVE_SSE2)
+    if (have_HW_SSE2())
+    {
+      __m128i vc = _mm_set1_epi8(-64);
+      while (s + 16 <= e)
+      {
+        __m128i vs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        // ASCII chars only?
+        if (_mm_movemask_epi8(vs) != 0)
+          n -= popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(vc, vs)));
+        s += 16;
+      }
+    }
+#endif
+    while (s < e)
+      n -= (*s++ & 0xC0) == 0x80;
+    return n;
+  }
+  /// Returns column k advanced over the string s up to e, taking tab spacing into account and counting UTF-8 characters as one column each, counted with SIMD instructions for parts of the string without tabs (and without \r and \n when nl is true) when available.
+  static size_t wcolumns(
+      const char *s,          ///< start of the string
+      const char *e,          ///< end of the string
+      size_t      k,          ///< column at s
+      size_t      T,          ///< tab size, a power of two
+      bool        nl = false) ///< true: do not count \r and \n
+    /// @returns column at e
+  {
+    if (s + 16 > e)
+      return wcolumns_bytes(s, e, k, T, nl);
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2)
+    if (have_HW_AVX2())
+    {
+      __m256i vc = _mm256_set1_epi8(-64);
+      __m256i vt = _mm256_set1_epi8('\t');
+      __m256i vr = _mm256_set1_epi8(nl ? '\r' : '\t');
+      __m256i vn = _mm256_set1_epi8(nl ? '\n' : '\t');
+      while (s + 32 <= e)
+      {
+        __m256i vs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
+        __m256i veq = _mm256_or_si256(_mm256_cmpeq_epi8(vs, vt), _mm256_or_si256(_mm256_cmpeq_epi8(vs, vr), _mm256_cmpeq_epi8(vs, vn)));
+        if (_mm256_movemask_epi8(veq) != 0)
+        {
+          // count the columns of this block with tabs one char at a time
+          k = wcolumns_bytes(s, s + 32, k, T, nl);
+        }
+        else
+        {
+          k += 32;
+          // ASCII chars only?
+          if (_mm256_movemask_epi8(vs) != 0)
+            k -= popcount(_mm256_movemask_epi8(_mm256_cmpgt_epi8(vc, vs)));
+        }
+        s += 32;
+      }
+    }
+    else if (have_HW_SSE2())
+    {
+      __m128i vc = _mm_set1_epi8(-64);
+      __m128i vt = _mm_set1_epi8('\t');
+      __m128i vr = _mm_set1_epi8(nl ? '\r' : '\t');
+      __m128i vn = _mm_set1_epi8(nl ? '\n' : '\t');
+      while (s + 16 <= e)
+      {
+        __m128i vs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        __m128i veq = _mm_or_si128(_mm_cmpeq_epi8(vs, vt), _mm_or_si128(_mm_cmpeq_epi8(vs, vr), _mm_cmpeq_epi8(vs, vn)));
+        if (_mm_movemask_epi8(veq) != 0)
+        {
+          // count the columns of this block with tabs one char at a time
+          k = wcolumns_bytes(s, s + 16, k, T, nl);
+        }
+        else
+        {
+          k += 16;
+          // ASCII chars only?
+          if (_mm_movemask_epi8(vs) != 0)
+            k -= popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(vc, vs)));
+        }
+        s += 16;
+      }
+    }
+#elif defined(HAVE_SSE2)
+    if (have_HW_SSE2())
+    {
+      __m128i vc = _mm_set1_epi8(-64);
+      __m128i vt = _mm_set1_epi8('\t');
+      __m128i vr = _mm_set1_epi8(nl ? '\r' : '\t');
+      __m128i vn = _mm_set1_epi8(nl ? '\n' : '\t');
+      while (s + 16 <= e)
+      {
+        __m128i vs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+        __m128i veq = _mm_or_si128(_mm_cmpeq_epi8(vs, vt), _mm_or_si128(_mm_cmpeq_epi8(vs, vr), _mm_cmpeq_epi8(vs, vn)));
+        if (_mm_movemask_epi8(veq) != 0)
+        {
+          // count the columns of this block with tabs one char at a time
+          k = wcolumns_bytes(s, s + 16, k, T, nl);
+        }
+        else
+        {
+          k += 16;
+          // ASCII chars only?
+          if (_mm_movemask_epi8(vs) != 0)
+            k -= popcount(_mm_movemask_epi8(_mm_cmpgt_epi8(vc, vs)));
+        }
+        s += 16;
+      }
+    }
+#endif
+    return wcolumns_bytes(s, e, k, T, nl);
+  }
+  /// Returns column k advanced over the string s up to e one char at a time, taking tab spacing into account and counting UTF-8 characters as one column each.
+  static size_t wcolumns_bytes(
+      const char *s, ///< start of the string
+      const char *e, ///< end of the string
+      size_t      k, ///< column at s
+      size_t      T, ///< tab size, a power of two
+      bool        nl) ///< true: do not count \r and \n
+    /// @returns column at e
+  {
+    while (s < e)
+    {
+      if (*s == '\t')
+        k += 1 + (~k & (T - 1)); // count tab spacing
+      else if (!nl || (*s != '\r' && *s != '\n'))
+        k += (*s & 0xC0) != 0x80; // count column offset in UTF-8 chars
+      ++s;
+    }
+    return k;
+  }
+  /// Returns a pointer to the first occurrence of the string s of length n > 1 in the string b up to e, or nullptr if not found, filtered on the first two bytes of s with SIMD instructions when available.
+  static const char *find_string(
+      const char *b, ///< start of the string to search
+      const char *e, ///< end of the string to search
+      const char *s, ///< string to find
+      size_t      n) ///< length of s, at least 2
+    /// @returns pointer to s in b or nullptr
+  {
+    const char *t = e - n + 1; // last position + 1 where s may begin
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2)
+    if (have_HW_AVX2())
+    {
+      __m256i vc0 = _mm256_set1_epi8(s[0]);
+      __m256i vc1 = _mm256_set1_epi8(s[1]);
+      while (b + 32 <= t)
+      {
+        __m256i vb0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+        __m256i vb1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + 1));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(vb0, vc0), _mm256_cmpeq_epi8(vb1, vc1)));
+        while (mask != 0)
+        {
+          uint32_t offset = ctz(mask);
+          if (std::memcmp(b + offset + 2, s + 2, n - 2) == 0)
+            return b + offset;
+          mask &= mask - 1;
+        }
+        b += 32;
+      }
+    }
+    else if (have_HW_SSE2())
+    {
+      __m128i vc0 = _mm_set1_epi8(s[0]);
+      __m128i vc1 = _mm_set1_epi8(s[1]);
+      while (b + 16 <= t)
+      {
+        __m128i vb0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+        __m128i vb1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 1));
+        uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(vb0, vc0), _mm_cmpeq_epi8(vb1, vc1)));
+        while (mask != 0)
+        {
+          uint32_t offset = ctz(mask);
+          if (std::memcmp(b + offset + 2, s + 2, n - 2) == 0)
+            return b + offset;
+          mask &= mask - 1;
+        }
+        b += 16;
+      }
+    }
+#elif defined(HAVE_SSE2)
+    if (have_HW_SSE2())
+    {
+      __m128i vc0 = _mm_set1_epi8(s[0]);
+      __m128i vc1 = _mm_set1_epi8(s[1]);
+      while (b + 16 <= t)
+      {
+        __m128i vb0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+        __m128i vb1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 1));
+        uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(vb0, vc0), _mm_cmpeq_epi8(vb1, vc1)));
+        while (mask != 0)
+        {
+          uint32_t offset = ctz(mask);
+          if (std::memcmp(b + offset + 2, s + 2, n - 2) == 0)
+            return b + offset;
+          mask &= mask - 1;
+        }
+        b += 16;
+      }
+    }
+#endif
+    while (b < t)
+    {
+      b = static_cast<const char*>(std::memchr(b, s[0], t - b));
+      if (b == nullptr)
+        return nullptr;
+      if (b[1] == s[1] && std::memcmp(b + 2, s + 2, n - 2) == 0)
+        return b;
+      ++b;
+    }
+    return nullptr;
+  }
+  /// Returns a 0-terminated copy of the text matched in read-only input scanned in place, or the text itself when it is followed by a \0.
+  const char *text_copy()
+    /// @returns 0-terminated const char* string with text matched
+  {
+    if (txt_ + len_ < buf_ + end_ && txt_[len_] == '\0')
+      return txt_;
+    cpy_.assign(txt_, len_);
+    return cpy_.c_str();
+  }
+  /// Returns the character that follows the matched text, which is \0 at the end of read-only input scanned in place, used when matching word boundaries.
+  int end_char() const
+    /// @returns unsigned char 0..255
+  {
+    if (rdo_ && txt_ + len_ >= buf_ + end_)
+      return '\0';
+    return static_cast<unsigned char>(txt_[len_]);
+  }
   /// Reset the matched text by removing the terminating \0, which is needed to search for a new match.
   void reset_text()
   {
@@ -1613,6 +2148,14 @@ class AbstractMatcher {
     set_current(loc);
     txt_ = buf_ + cur_;
   }
+  /// Returns true and sets AbstractMatcher::dry_ with option "S" when no input was read but the input is not at EOF, to suspend matching instead of reaching EOF.
+  bool suspend()
+    /// @returns true if the input ran dry
+  {
+    dry_ = opt_.S && !in.eof();
+    DBGLOGN("suspend(): %d", (int)dry_);
+    return dry_;
+  }
   /// Get the next character and grow the buffer to make more room if necessary.
   int get_more()
     /// @returns the character read (unsigned char 0..255) or EOF (-1)
@@ -1624,10 +2167,12 @@ class AbstractMatcher {
     {
       if (end_ + blk_ + 1 >= max_)
         (void)grow();
-      end_ += get(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
+      end_ += get(buf_ + end_, room());
       if (pos_ < end_)
         return static_cast<unsigned char>(buf_[pos_++]);
       DBGLOGN("get_more(): EOF");
+      if (suspend())
+        return EOF;
       if (!wrap())
       {
         eof_ = true;
@@ -1646,10 +2191,12 @@ class AbstractMatcher {
     {
       if (end_ + blk_ + 1 >= max_)
         (void)grow();
-      end_ += get(buf_ + end_, blk_ > 0 ? blk_ : max_ - end_ - 1);
+      end_ += get(buf_ + end_, room());
       if (pos_ < end_)
         return static_cast<unsigned char>(buf_[pos_]);
       DBGLOGN("peek_more(): EOF");
+      if (suspend())
+        return EOF;
       if (!wrap())
       {
         eof_ = true;
@@ -1680,8 +2227,18 @@ class AbstractMatcher {
   size_t    cno_; ///< column number count (cached)
 #endif
   size_t    num_; ///< character count of the input till bol_
-  bool      own_; ///< true if AbstractMatcher::buf_ was allocated and should be deleted
+  size_t    shf_; ///< number of times the buffer was shifted or enlarged by grow()
+  Stats     sts_; ///< matcher statistics counted when compiled with -DWITH_MATCHER_STATS
+  char     *brw_; ///< caller-supplied buffer borrowed by this matcher or nullptr, AbstractMatcher::buf_ is not deleted when it points to this buffer
+  size_t    bsz_; ///< size of the borrowed buffer AbstractMatcher::brw_
+  size_t    lim_; ///< buffer size limit set with limit() or 0 for no limit
+  OverflowHandler *ovh_; ///< event handler functor to invoke when the buffer is full at the limit
+  std::string cpy_; ///< copy of the text matched in read-only input, returned by text()
+  bool      rdo_; ///< true if AbstractMatcher::buf_ is a read-only string scanned in place, see in_place()
+  bool      ovf_; ///< true if the buffer is full at the limit AbstractMatcher::lim_ and no more input is read
+  bool      own_; ///< true if AbstractMatcher::buf_ was allocated or borrowed to read input into, deleted when not borrowed
   bool      eof_; ///< input has reached EOF
+  bool      dry_; ///< input ran dry with option S, no input is available yet but the input is not at EOF
   bool      mat_; ///< true if AbstractMatcher::matches() was successful
 };
 
@@ -1694,6 +2251,7 @@ class PatternMatcher : public AbstractMatcher {
   PatternMatcher(const PatternMatcher& matcher) ///< matcher with pattern to use (pattern may be shared)
     :
       AbstractMatcher(matcher.in, matcher.opt_),
+      ref_(matcher.ref_),
       pat_(matcher.pat_),
       own_(false)
   {
@@ -1703,8 +2261,7 @@ class PatternMatcher : public AbstractMatcher {
   virtual ~PatternMatcher()
   {
     DBGLOG("PatternMatcher::~PatternMatcher()");
-    if (own_ && pat_ != nullptr)
-      delete pat_;
+    release();
   }
   /// Assign a matcher, the underlying pattern object is shared (not deep copied).
   PatternMatcher& operator=(const PatternMatcher& matcher) ///< matcher with pattern to use (pattern may be shared)
@@ -1715,8 +2272,12 @@ class PatternMatcher : public AbstractMatcher {
     in = matcher.in;
     reset();
     opt_ = matcher.opt_;
-    pat_ = matcher.pat_,
-    own_ = false;
+    if (pat_ != matcher.pat_)
+    {
+      release();
+      ref_ = matcher.ref_;
+      pat_ = matcher.pat_;
+    }
     return *this;
   }
   /// Set the pattern to use with this matcher as a shared pointer to another matcher pattern.
@@ -1733,10 +2294,8 @@ class PatternMatcher : public AbstractMatcher {
     DBGLOG("PatternMatcher::pattern()");
     if (pat_ != &pattern)
     {
-      if (own_ && pat_ != nullptr)
-        delete pat_;
+      release();
       pat_ = &pattern;
-      own_ = false;
     }
     return *this;
   }
@@ -1747,10 +2306,21 @@ class PatternMatcher : public AbstractMatcher {
     DBGLOG("PatternMatcher::pattern()");
     if (pat_ != pattern)
     {
-      if (own_ && pat_ != nullptr)
-        delete pat_;
+      release();
       pat_ = pattern;
-      own_ = false;
+    }
+    return *this;
+  }
+  /// Set the reference-counted pattern to use with this matcher, the pattern is kept alive while this matcher and its clones use it.
+  virtual PatternMatcher& pattern(const std::shared_ptr<const Pattern>& pattern) ///< shared pattern object for this matcher
+    /// @returns this matcher
+  {
+    DBGLOG("PatternMatcher::pattern()");
+    if (pat_ != pattern.get())
+    {
+      release();
+      ref_ = pattern;
+      pat_ = pattern.get();
     }
     return *this;
   }
@@ -1759,9 +2329,9 @@ class PatternMatcher : public AbstractMatcher {
     /// @returns this matcher
   {
     DBGLOG("PatternMatcher::pattern(\"%s\")", pattern);
-    if (own_ && pat_ != nullptr)
-      delete pat_;
-    pat_ = new Pattern(pattern);
+    release();
+    ref_ = std::make_shared<Pattern>(pattern);
+    pat_ = ref_.get();
     own_ = true;
     return *this;
   }
@@ -1770,9 +2340,9 @@ class PatternMatcher : public AbstractMatcher {
     /// @returns this matcher
   {
     DBGLOG("PatternMatcher::pattern(\"%s\")", pattern.c_str());
-    if (own_ && pat_ != nullptr)
-      delete pat_;
-    pat_ = new Pattern(pattern);
+    release();
+    ref_ = std::make_shared<Pattern>(pattern);
+    pat_ = ref_.get();
     own_ = true;
     return *this;
   }
@@ -1795,6 +2365,12 @@ class PatternMatcher : public AbstractMatcher {
     assert(pat_ != nullptr);
     return *pat_;
   }
+  /// Returns the reference-counted pattern of this matcher, which is empty when the pattern is not reference counted (i.e. a persistent pattern object was given).
+  const std::shared_ptr<const Pattern>& shared_pattern() const
+    /// @returns shared pointer to pattern object or empty shared pointer
+  {
+    return ref_;
+  }
  protected:
   /// Construct a base abstract matcher from a pointer to a persistent pattern object (that is shared with this class) and an input character sequence.
   PatternMatcher(
@@ -1816,6 +2392,40 @@ class PatternMatcher : public AbstractMatcher {
       pat_(&pattern),
       own_(false)
   { }
+  /// Construct a base abstract matcher from a reference-counted pattern object and an input character sequence.
+  PatternMatcher(
+      const std::shared_ptr<const Pattern>& pattern,         ///< shared pattern object for this matcher
+      const Input&                          input = Input(), ///< input character sequence for this matcher
+      const char                           *opt = nullptr)      ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*`
+    :
+      AbstractMatcher(input, opt),
+      ref_(pattern),
+      pat_(pattern.get()),
+      own_(false)
+  { }
+  /// Construct a base abstract matcher from a persistent pattern object (that is shared with this class) and an input character sequence, borrows the given buffer to read input into.
+  PatternMatcher(
+      const Pattern& pattern, ///< pattern object for this matcher
+      const Input&   input,   ///< input character sequence for this matcher
+      const Buffer&  buffer,  ///< buffer borrowed by this matcher
+      const char    *opt)     ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*`
+    :
+      AbstractMatcher(input, buffer, opt),
+      pat_(&pattern),
+      own_(false)
+  { }
+  /// Construct a base abstract matcher from a reference-counted pattern object and an input character sequence, borrows the given buffer to read input into.
+  PatternMatcher(
+      const std::shared_ptr<const Pattern>& pattern, ///< shared pattern object for this matcher
+      const Input&                          input,   ///< input character sequence for this matcher
+      const Buffer&                         buffer,  ///< buffer borrowed by this matcher
+      const char                           *opt)     ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*`
+    :
+      AbstractMatcher(input, buffer, opt),
+      ref_(pattern),
+      pat_(pattern.get()),
+      own_(false)
+  { }
   /// Construct a base abstract matcher from a regex pattern string and an input character sequence.
   PatternMatcher(
       const char  *pattern,         ///< regex string instantiates pattern object for this matcher
@@ -1823,7 +2433,8 @@ class PatternMatcher : public AbstractMatcher {
       const char  *opt = nullptr)      ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*`
     :
       AbstractMatcher(input, opt),
-      pat_(new Pattern(pattern)),
+      ref_(std::make_shared<Pattern>(pattern)),
+      pat_(ref_.get()),
       own_(true)
   { }
   /// Construct a base abstract matcher from a regex pattern string and an input character sequence.
@@ -1833,11 +2444,22 @@ class PatternMatcher : public AbstractMatcher {
       const char        *opt = nullptr)      ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*`
     :
       AbstractMatcher(input, opt),
-      pat_(new Pattern(pattern)),
+      ref_(std::make_shared<Pattern>(pattern)),
+      pat_(ref_.get()),
       own_(true)
   { }
-  const Pattern *pat_; ///< points to the pattern object used by the matcher
-  bool           own_; ///< true if PatternMatcher::pat_ was allocated and should be deleted
+  /// Release the pattern, deletes the pattern when owned and not reference counted.
+  void release()
+  {
+    if (own_ && pat_ != nullptr && !ref_)
+      delete pat_;
+    ref_.reset();
+    pat_ = nullptr;
+    own_ = false;
+  }
+  std::shared_ptr<const Pattern> ref_; ///< reference-counted pattern object shared with other matchers, or empty
+  const Pattern                 *pat_; ///< points to the pattern object used by the matcher
+  bool                           own_; ///< true if PatternMatcher::pat_ was allocated and should be deleted, or when reference counted was instantiated from a regex string
 };
 
 /// A specialization of the pattern matcher class template for std::string, extends abstract matcher base class.
@@ -192,6 +192,8 @@ class BoostMatcher : public PatternMatcher<boost::regex> {
     reset_text();
     txt_ = buf_ + cur_; // set first of text(), cur_ was last pos_, or cur_ was set with more()
     cur_ = pos_;
+    size_t skp = 0; // FIND and SPLIT: no match starts in txt_[0..skp-1], to resume the search at txt_ + skp after reading more input
+    bool grown = false; // the iterator was invalidated by shifting or growing the buffer
     if (itr_ != fin_) // if regex iterator is still valid then
     {
       if ((*itr_)[0].second == buf_ + pos_) // if last of regex iterator is still valid in buf_[] then
@@ -210,8 +212,12 @@ class BoostMatcher : public PatternMatcher<boost::regex> {
     {
       if (pos_ == end_ && !eof_)
       {
-        if (end_ + blk_ + 1 >= max_ && grow()) // make sure we have enough storage to read input
+        size_t n = blk_ == 0 ? in.size_hint() : 0; // when the size of the rest of the input is known then read it all at once
+        if ((end_ + blk_ + 1 >= max_ || end_ + n + 1 >= max_) && grow(n < Const::BLOCK ? Const::BLOCK : n + 1)) // make sure we have enough storage to read input
+        {
+          grown = itr_ != fin_;
           itr_ = fin_; // buffer shifting/growing invalidates iterator
+        }
         (void)peek_more();
         DBGLOGN("Got more input pos = %zu end = %zu max = %zu", pos_, end_, max_);
       }
@@ -228,7 +234,16 @@ class BoostMatcher : public PatternMatcher<boost::regex> {
           else
           {
             if (!eof_ && itr_ == fin_)
-              new_itr(method);
+            {
+              new_itr(method, skp);
+            }
+            else if (grown && itr_ == fin_)
+            {
+              // at EOF, find the separator again that the invalidated iterator found, after the separator that ended at cur_
+              new_itr(method, skp);
+              if (itr_ != fin_ && (*itr_)[0].second == buf_ + cur_ && !at_bob())
+                ++itr_;
+            }
             if (itr_ != fin_ && (*itr_)[0].matched && cur_ != pos_)
             {
               size_t n = (*itr_).size();
@@ -260,7 +275,7 @@ class BoostMatcher : public PatternMatcher<boost::regex> {
         if (itr_ != fin_)
           break; // OK if iterator is still valid
       }
-      new_itr(method); // need new iterator
+      new_itr(method, skp); // need new iterator
       if (itr_ != fin_)
       {
         DBGLOGN("Possible (partial) match, pos = %zu", pos_);
@@ -273,6 +288,8 @@ class BoostMatcher : public PatternMatcher<boost::regex> {
           else
             pos_ = end_;
         }
+        if (itr_ != fin_ && pos_ == end_ && (method == Const::FIND || method == Const::SPLIT))
+          skp = (*itr_)[0].first - txt_; // the (partial) match may extend with more input, but no match starts before it
       }
       else // no (partial) match
       {
@@ -286,6 +303,7 @@ class BoostMatcher : public PatternMatcher<boost::regex> {
           return 0;
         }
         pos_ = end_;
+        skp = end_ - (txt_ - buf_); // no (partial) match starts before end_
         if (eof_)
         {
           if (method == Const::SPLIT)
@@ -334,25 +352,36 @@ class BoostMatcher : public PatternMatcher<boost::regex> {
     DBGLOG("END BoostMatcher::match()");
     return cap_;
   }
-  /// Create a new boost::regex iterator to (continue to) advance over input.
-  inline void new_itr(Method method)
+  /// Create a new boost::regex iterator to (continue to) advance over input, searching from txt_ + skp when no match starts before.
+  inline void new_itr(
+      Method method, ///< match method Const::SCAN, Const::FIND, Const::SPLIT, or Const::MATCH
+      size_t skp = 0) ///< FIND and SPLIT: number of bytes after txt_ to skip, that do not start a match
   {
-    DBGLOGN("New iterator");
+    DBGLOGN("New iterator skp = %zu", skp);
+    assert(pat_ != nullptr);
     boost::match_flag_type flg = flg_;
-    if (!at_bob())
-      flg |= boost::regex_constants::match_not_bob;
-    if (!at_bol())
-      flg |= boost::regex_constants::match_not_bol;
-    if (isword(got_))
-      flg |= boost::regex_constants::match_not_bow;
+    if (skp > 0 && pat_->str().find("(?<") != std::string::npos)
+      skp = 0; // a lookbehind does not look back before the start of the search, search from txt_
+    if (skp > 0)
+    {
+      flg |= boost::regex_constants::match_not_bob | boost::regex_constants::match_prev_avail; // anchors and word boundaries check txt_[skp-1]
+    }
+    else
+    {
+      if (!at_bob())
+        flg |= boost::regex_constants::match_not_bob;
+      if (!at_bol())
+        flg |= boost::regex_constants::match_not_bol;
+      if (isword(got_))
+        flg |= boost::regex_constants::match_not_bow;
+    }
     if (method == Const::SCAN)
       flg |= boost::regex_constants::match_continuous | boost::regex_constants::match_not_null;
     else if (method == Const::FIND && !opt_.N)
       flg |= boost::regex_constants::match_not_null;
     else if (method == Const::MATCH)
       flg |= boost::regex_constants::match_continuous;
-    assert(pat_ != nullptr);
-    itr_ = boost::cregex_iterator(txt_, buf_ + end_, *pat_, flg);
+    itr_ = boost::cregex_iterator(txt_ + skp, buf_ + end_, *pat_, flg);
   }
   boost::match_flag_type flg_; ///< boost::regex match flags
   boost::cregex_iterator itr_; ///< const boost::regex iterator
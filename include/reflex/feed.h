@@ -0,0 +1,154 @@
+/******************************************************************************\
+* Copyright (c) 2016, Robert van Engelen, Genivia Inc. All rights reserved.    *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+*   (1) Redistributions of source code must retain the above copyright notice, *
+*       this list of conditions and the following disclaimer.                  *
+*                                                                              *
+*   (2) Redistributions in binary form must reproduce the above copyright      *
+*       notice, this list of conditions and the following disclaimer in the    *
+*       documentation and/or other materials provided with the distribution.   *
+*                                                                              *
+*   (3) The name of the author may not be used to endorse or promote products  *
+*       derived from this software without specific prior written permission.  *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF         *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO   *
+* EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       *
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;  *
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,     *
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR      *
+* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF       *
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                                   *
+\******************************************************************************/
+
+/**
+@file      feed.h
+@brief     RE/flex input fed in chunks by an event loop, to suspend and resume matching without blocking
+@author    Robert van Engelen - engelen@genivia.com
+@copyright (c) 2016-2020, Robert van Engelen, Genivia Inc. All rights reserved.
+@copyright (c) BSD-3 License - see LICENSE.txt
+*/
+
+
+#ifndef REFLEX_FEED_H
+#define REFLEX_FEED_H
+
+#include <reflex/input.h>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace reflex {
+
+/// Input source fed with chunks of data by the caller, e.g. by an event loop that receives data from a non-blocking socket.
+/**
+Description
+-----------
+
+A feed holds the data appended with `Feed::append()` until a matcher reads it.
+When all data was read but `Feed::close()` was not called yet, the feed is
+dry: it returns no data but is not at EOF.  A matcher constructed with option
+`"S"` suspends matching when the input runs dry, instead of reaching EOF.  The
+scan, find, and split methods then return zero and `AbstractMatcher::dry()`
+returns true.  The matcher rewinds to the start of the pending match, so the
+match is retried from the same position when the method is called again after
+more data was appended.  A lexer generated by reflex returns the EOF token
+when the input ran dry, after which `matcher().dry()` is checked to tell the
+two apart, and `lex()` is called again when more data was appended.
+
+This makes the matcher a continuation that is resumed by the event loop: no
+thread blocks on the input and a few threads can scan many connections, each
+with its own feed and matcher.
+
+A feed is not thread safe, data should be appended by the thread that runs
+the matcher.
+
+Example
+-------
+
+~~~{.cpp}
+    std::shared_ptr<reflex::Feed> feed(new reflex::Feed);
+    reflex::Matcher matcher("\\w+", reflex::Input(feed), "S");
+    // each time data is received:
+    feed->append(data, size);
+    while (matcher.find())
+      std::cout << matcher.text() << std::endl;
+    // matcher.dry() is true: wait for more data or feed->close() at the end
+~~~
+*/
+class Feed : public Input::Source {
+ public:
+  /// Construct an empty feed.
+  Feed()
+    :
+      pos_(0),
+      end_(false)
+  { }
+  /// Append data to the feed, to be read by the matcher.
+  void append(
+      const char *s, ///< points to the data to append
+      size_t      n) ///< length of the data
+  {
+    if (pos_ > 0 && pos_ >= buf_.size() / 2)
+    {
+      // discard the data read by the matcher
+      buf_.erase(0, pos_);
+      pos_ = 0;
+    }
+    buf_.append(s, n);
+  }
+  /// Append a string to the feed, to be read by the matcher.
+  void append(const std::string& s) ///< string to append
+  {
+    append(s.data(), s.size());
+  }
+  /// Close the feed, the matcher reaches EOF after reading the data appended.
+  void close()
+  {
+    end_ = true;
+  }
+  /// Returns the number of bytes appended that were not read yet.
+  size_t size() const
+    /// @returns number of bytes available
+  {
+    return buf_.size() - pos_;
+  }
+  /// Copy the data appended into buffer.
+  size_t get(
+      char  *s, ///< points to the string buffer to fill with input
+      size_t n) ///< size of buffer pointed to by s
+    /// @returns the nonzero number of (less or equal to n) bytes added to buffer s, or zero when EOF or no data is available yet
+    override
+  {
+    if (n > buf_.size() - pos_)
+      n = buf_.size() - pos_;
+    std::memcpy(s, buf_.data() + pos_, n);
+    pos_ += n;
+    return n;
+  }
+  /// Check if input is available.
+  bool good() const override
+    /// @returns true if data is available or the feed is not closed
+  {
+    return pos_ < buf_.size() || !end_;
+  }
+  /// Check if input reached EOF.
+  bool eof() const override
+    /// @returns true if the feed is closed and all data was read
+  {
+    return pos_ >= buf_.size() && end_;
+  }
+ protected:
+  std::string buf_; ///< the data appended
+  size_t      pos_; ///< position of the data not read yet
+  bool        end_; ///< true when closed
+};
+
+} // namespace reflex
+
+#endif
@@ -0,0 +1,336 @@
+/******************************************************************************\
+* Copyright (c) 2016, Robert van Engelen, Genivia Inc. All rights reserved.    *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+*   (1) Redistributions of source code must retain the above copyright notice, *
+*       this list of conditions and the following disclaimer.                  *
+*                                                                              *
+*   (2) Redistributions in binary form must reproduce the above copyright      *
+*       notice, this list of conditions and the following disclaimer in the    *
+*       documentation and/or other materials provided with the distribution.   *
+*                                                                              *
+*   (3) The name of the author may not be used to endorse or promote products  *
+*       derived from this software without specific prior written permission.  *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF         *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO   *
+* EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       *
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;  *
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,     *
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR      *
+* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF       *
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                                   *
+\******************************************************************************/
+
+/**
+@file      fixed.h
+@brief     RE/flex FSM code for fixed patterns constructed at compile time
+@author    Robert van Engelen - engelen@genivia.com
+@copyright (c) 2016-2020, Robert van Engelen, Genivia Inc. All rights reserved.
+@copyright (c) BSD-3 License - see LICENSE.txt
+*/
+
+#ifndef REFLEX_FIXED_H
+#define REFLEX_FIXED_H
+
+#include <reflex/matcher.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace reflex {
+
+/// Fixed patterns expressed as C++ types that are compiled to FSM code for reflex::Pattern at compile time.
+/**
+Description
+-----------
+
+A pattern known at build time is expressed as a type composed of the class
+templates in this namespace.  The function template `reflex::fixed::fsm<R...>`
+is FSM code for the `reflex::Pattern(FSM)` constructor that matches the token
+patterns `R...` with accept indexes 1, 2, 3, ... in that order, like the FSM
+code that `reflex --fsm` generates.  No regex is parsed and no DFA is
+constructed at run time: the position automaton (Glushkov automaton) of the
+patterns and its transition tables are computed by the compiler.
+
+  Template          | Matches
+  ----------------- | ----------------------------------------------------------
+  `chr<c>`          | the byte `c`
+  `range<lo, hi>`   | a byte `lo` to `hi`
+  `any`             | any byte except `\n`
+  `cls<R...>`       | a byte matching one of the bytes or ranges `R...`
+  `not_cls<R...>`   | a byte not matching any of the bytes or ranges `R...`
+  `lit<c...>`       | the string of bytes `c...`
+  `seq<R...>`       | the concatenation of `R...`
+  `alt<R...>`       | one of the alternatives `R...`
+  `opt<R>`          | `R` optionally
+  `star<R>`         | `R` zero or more times
+  `plus<R>`         | `R` one or more times
+
+The patterns match bytes, a UTF-8 multibyte character is matched with `lit`.
+A pattern has at most 64 byte positions, i.e. 64 `chr`, `range`, `any`, `cls`,
+and `not_cls` leaves in total.  Anchors, lookaheads, and lazy quantifiers are
+not supported.  The FSM code does not define predict match tables, so
+`find()` tries each position in the input.
+
+Example
+-------
+
+~~~{.cpp}
+    #include <reflex/fixed.h>
+
+    using namespace reflex::fixed;
+
+    typedef cls<range<'a','z'>, range<'A','Z'>, chr<'_'> > Alpha;
+    typedef seq<Alpha, star<alt<Alpha, range<'0','9'> > > > Name;
+    typedef plus<range<'0','9'> > Number;
+    typedef plus<cls<chr<' '>, chr<'\t'>, chr<'\n'> > > Space;
+
+    static const reflex::Pattern pattern(fsm<Name, Number, Space>);
+
+    reflex::Matcher matcher(pattern, "x1 = 42");
+    while (matcher.scan())
+      std::cout << matcher.accept() << ": " << matcher.text() << std::endl;
+~~~
+*/
+namespace fixed {
+
+/// A byte in the range lo to hi, the leaf of a pattern with one position.
+template<int lo, int hi = lo>
+struct range {
+  static constexpr size_t size() { return 1; }
+  static constexpr bool nullable() { return false; }
+  static constexpr uint64_t first() { return 1; }
+  static constexpr uint64_t last() { return 1; }
+  static constexpr uint64_t follow(size_t) { return 0; }
+  static constexpr bool member(int c) { return lo <= c && c <= hi; }
+  static constexpr uint64_t accepts(int c) { return member(c); }
+};
+
+/// The byte c.
+template<char c>
+struct chr : range<static_cast<unsigned char>(c)> { };
+
+/// Any byte except \n.
+struct any : range<0, 255> {
+  static constexpr bool member(int c) { return c != '\n'; }
+  static constexpr uint64_t accepts(int c) { return member(c); }
+};
+
+/// A byte matching one of the bytes or ranges R..., the leaf of a pattern with one position.
+template<typename... R>
+struct cls;
+
+template<typename A>
+struct cls<A> : range<0, 255> {
+  static constexpr bool member(int c) { return A::member(c); }
+  static constexpr uint64_t accepts(int c) { return member(c); }
+};
+
+template<typename A, typename... R>
+struct cls<A, R...> : range<0, 255> {
+  static constexpr bool member(int c) { return A::member(c) || cls<R...>::member(c); }
+  static constexpr uint64_t accepts(int c) { return member(c); }
+};
+
+/// A byte not matching any of the bytes or ranges R..., the leaf of a pattern with one position.
+template<typename... R>
+struct not_cls : range<0, 255> {
+  static constexpr bool member(int c) { return !cls<R...>::member(c); }
+  static constexpr uint64_t accepts(int c) { return member(c); }
+};
+
+/// The concatenation of A and B, positions of B follow the positions of A.
+template<typename A, typename B>
+struct seq2 {
+  static constexpr size_t size() { return A::size() + B::size(); }
+  static constexpr bool nullable() { return A::nullable() && B::nullable(); }
+  static constexpr uint64_t first() { return A::nullable() ? A::first() | (B::first() << A::size()) : A::first(); }
+  static constexpr uint64_t last() { return B::nullable() ? A::last() | (B::last() << A::size()) : B::last() << A::size(); }
+  static constexpr uint64_t follow(size_t p)
+  {
+    return p < A::size()
+      ? A::follow(p) | (((A::last() >> p) & 1) != 0 ? B::first() << A::size() : 0)
+      : B::follow(p - A::size()) << A::size();
+  }
+  static constexpr uint64_t accepts(int c) { return A::accepts(c) | (B::accepts(c) << A::size()); }
+};
+
+/// The alternation of A and B, positions of B follow the positions of A.
+template<typename A, typename B>
+struct alt2 {
+  static constexpr size_t size() { return A::size() + B::size(); }
+  static constexpr bool nullable() { return A::nullable() || B::nullable(); }
+  static constexpr uint64_t first() { return A::first() | (B::first() << A::size()); }
+  static constexpr uint64_t last() { return A::last() | (B::last() << A::size()); }
+  static constexpr uint64_t follow(size_t p) { return p < A::size() ? A::follow(p) : B::follow(p - A::size()) << A::size(); }
+  static constexpr uint64_t accepts(int c) { return A::accepts(c) | (B::accepts(c) << A::size()); }
+};
+
+/// The concatenation of R....
+template<typename... R>
+struct seq;
+
+template<typename A>
+struct seq<A> : A { };
+
+template<typename A, typename... R>
+struct seq<A, R...> : seq2<A, seq<R...> > { };
+
+/// One of the alternatives R....
+template<typename... R>
+struct alt;
+
+template<typename A>
+struct alt<A> : A { };
+
+template<typename A, typename... R>
+struct alt<A, R...> : alt2<A, alt<R...> > { };
+
+/// The string of bytes c....
+template<char... c>
+struct lit : seq<chr<c>...> { };
+
+/// R optionally.
+template<typename R>
+struct opt : R {
+  static constexpr bool nullable() { return true; }
+};
+
+/// R one or more times.
+template<typename R>
+struct plus : R {
+  static constexpr uint64_t follow(size_t p) { return R::follow(p) | (((R::last() >> p) & 1) != 0 ? R::first() : 0); }
+};
+
+/// R zero or more times.
+template<typename R>
+struct star : plus<R> {
+  static constexpr bool nullable() { return true; }
+};
+
+/// The token patterns R... with accept indexes 1, 2, 3, ...
+template<typename... R>
+struct tokens;
+
+template<typename A>
+struct tokens<A> : A {
+  /// Returns the accept index of the first token accepted by the positions in state, or 0.
+  static constexpr Pattern::Accept accept(uint64_t state, Pattern::Accept index = 1) { return (state & A::last()) != 0 ? index : 0; }
+  /// Returns the accept index of the first token that matches the empty string, or 0.
+  static constexpr Pattern::Accept accept_empty(Pattern::Accept index = 1) { return A::nullable() ? index : 0; }
+};
+
+template<typename A, typename... R>
+struct tokens<A, R...> : alt2<A, tokens<R...> > {
+  static constexpr Pattern::Accept accept(uint64_t state, Pattern::Accept index = 1) { return (state & A::last()) != 0 ? index : tokens<R...>::accept(state >> A::size(), index + 1); }
+  static constexpr Pattern::Accept accept_empty(Pattern::Accept index = 1) { return A::nullable() ? index : tokens<R...>::accept_empty(index + 1); }
+};
+
+/// A compile-time sequence of indexes 0, 1, 2, ..., to expand the tables of a pattern.
+template<size_t... I>
+struct indexes { };
+
+template<typename A, typename B>
+struct concat;
+
+template<size_t... I, size_t... J>
+struct concat<indexes<I...>, indexes<J...> > {
+  typedef indexes<I..., (sizeof...(I) + J)...> type;
+};
+
+template<size_t N>
+struct make_indexes {
+  typedef typename concat<typename make_indexes<N / 2>::type, typename make_indexes<N - N / 2>::type>::type type;
+};
+
+template<>
+struct make_indexes<0> {
+  typedef indexes<> type;
+};
+
+template<>
+struct make_indexes<1> {
+  typedef indexes<0> type;
+};
+
+/// The follow sets of the positions of pattern R, computed at compile time.
+template<typename R, typename I = typename make_indexes<R::size()>::type>
+struct follow_table;
+
+template<typename R, size_t... I>
+struct follow_table<R, indexes<I...> > {
+  static constexpr uint64_t table[sizeof...(I)] = { R::follow(I)... };
+};
+
+template<typename R, size_t... I>
+constexpr uint64_t follow_table<R, indexes<I...> >::table[sizeof...(I)];
+
+/// The positions of pattern R that accept a byte, for each byte value, computed at compile time.
+template<typename R, typename I = typename make_indexes<256>::type>
+struct accepts_table;
+
+template<typename R, size_t... I>
+struct accepts_table<R, indexes<I...> > {
+  static constexpr uint64_t table[256] = { R::accepts(static_cast<int>(I))... };
+};
+
+template<typename R, size_t... I>
+constexpr uint64_t accepts_table<R, indexes<I...> >::table[256];
+
+/// Returns the index of the lowest bit set in a nonzero state.
+inline size_t lowest(uint64_t state)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll(state);
+#else
+  size_t p = 0;
+  while ((state & 1) == 0)
+  {
+    state >>= 1;
+    ++p;
+  }
+  return p;
+#endif
+}
+
+/// FSM code for reflex::Pattern to match the token patterns R... with accept indexes 1, 2, 3, ...
+template<typename... R>
+void fsm(Matcher& m)
+{
+  typedef tokens<R...> T;
+  static_assert(T::size() <= 64, "reflex::fixed::fsm: a pattern has at most 64 positions");
+  const uint64_t *follow = follow_table<T>::table;
+  const uint64_t *accepts = accepts_table<T>::table;
+  int c1 = 0;
+  m.FSM_INIT(c1);
+  m.FSM_FIND();
+  Pattern::Accept cap = T::accept_empty();
+  if (cap != 0)
+    m.FSM_TAKE(cap);
+  c1 = m.FSM_CHAR();
+  uint64_t state = c1 != EOF ? T::first() & accepts[c1] : 0;
+  while (state != 0)
+  {
+    cap = T::accept(state);
+    if (cap != 0)
+      m.FSM_TAKE(cap);
+    c1 = m.FSM_CHAR();
+    if (c1 == EOF)
+      break;
+    uint64_t next = 0;
+    for (uint64_t s = state; s != 0; s &= s - 1)
+      next |= follow[lowest(s)];
+    state = next & accepts[c1];
+  }
+  m.FSM_HALT(c1);
+}
+
+} // namespace fixed
+
+} // namespace reflex
+
+#endif
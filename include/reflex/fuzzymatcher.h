@@ -0,0 +1,1493 @@
+/******************************************************************************\
+* Copyright (c) 2016, Robert van Engelen, Genivia Inc. All rights reserved.    *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+*   (1) Redistributions of source code must retain the above copyright notice, *
+*       this list of conditions and the following disclaimer.                  *
+*                                                                              *
+*   (2) Redistributions in binary form must reproduce the above copyright      *
+*       notice, this list of conditions and the following disclaimer in the    *
+*       documentation and/or other materials provided with the distribution.   *
+*                                                                              *
+*   (3) The name of the author may not be used to endorse or promote products  *
+*       derived from this software without specific prior written permission.  *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF         *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO   *
+* EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       *
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;  *
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,     *
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR      *
+* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF       *
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                                   *
+\******************************************************************************/
+
+/**
+@file      fuzzymatcher.h
+@brief     RE/flex fuzzy matcher engine, reflex -m fuzzy
+@author    Robert van Engelen - engelen@genivia.com
+@copyright (c) 2016-2020, Robert van Engelen, Genivia Inc. All rights reserved.
+@copyright (c) BSD-3 License - see LICENSE.txt
+*/
+
+#ifndef REFLEX_FUZZYMATCHER_H
+#define REFLEX_FUZZYMATCHER_H
+
+#include <reflex/matcher.h>
+#include <reflex/pattern.h>
+#include <cstring>
+
+namespace reflex {
+
+/// RE/flex fuzzy matcher engine class, implements reflex::Matcher fuzzy pattern matching interface with scan, find, split functors and iterators.
+/** More info TODO */
+class FuzzyMatcher : public Matcher {
+ public:
+  /// Optional flags for the max parameter to constrain fuzzy matching, otherwise no constraints
+  static const uint16_t INS = 0x1000; ///< fuzzy match allows character insertions
+  static const uint16_t DEL = 0x2000; ///< fuzzy match allows character deletions
+  static const uint16_t SUB = 0x4000; ///< character substitutions count as one edit, not two (insert+delete)
+  /// Default constructor.
+  FuzzyMatcher()
+    :
+      Matcher(),
+      max_(1),
+      err_(0),
+      ins_(true),
+      del_(true),
+      sub_(true)
+  {
+    bpt_.resize(max_);
+  }
+  /// Construct matcher engine from a pattern or a string regex, and an input character sequence.
+  template<typename P> /// @tparam <P> a reflex::Pattern or a string regex
+  FuzzyMatcher(
+      const P     *pattern,         ///< points to a reflex::Pattern or a string regex for this matcher
+      const Input& input = Input(), ///< input character sequence for this matcher
+      const char  *opt = nullptr)      ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*`
+    :
+      Matcher(pattern, input, opt),
+      max_(1),
+      err_(0),
+      ins_(true),
+      del_(true),
+      sub_(true)
+  {
+    bpt_.resize(max_);
+  }
+  /// Construct matcher engine from a pattern or a string regex, and an input character sequence.
+  template<typename P> /// @tparam <P> a reflex::Pattern or a string regex
+  FuzzyMatcher(
+      const P     *pattern,         ///< points to a reflex::Pattern or a string regex for this matcher
+      uint16_t     max,             ///< max errors
+      const Input& input = Input(), ///< input character sequence for this matcher
+      const char  *opt = nullptr)      ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*`
+    :
+      Matcher(pattern, input, opt),
+      max_(static_cast<uint8_t>(max)),
+      err_(0),
+      ins_(max <= 0xFF || (max & INS)),
+      del_(max <= 0xFF || (max & DEL)),
+      sub_(max <= 0xFF || (max & SUB))
+  {
+    bpt_.resize(max_);
+  }
+  /// Construct matcher engine from a pattern or a string regex, and an input character sequence.
+  template<typename P> /// @tparam <P> a reflex::Pattern or a string regex
+  FuzzyMatcher(
+      const P&     pattern,         ///< a reflex::Pattern or a string regex for this matcher
+      const Input& input = Input(), ///< input character sequence for this matcher
+      const char  *opt = nullptr)      ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*`
+    :
+      Matcher(pattern, input, opt),
+      max_(1),
+      err_(0),
+      ins_(true),
+      del_(true),
+      sub_(true)
+  {
+    bpt_.resize(max_);
+  }
+  /// Construct matcher engine from a pattern or a string regex, and an input character sequence.
+  template<typename P> /// @tparam <P> a reflex::Pattern or a string regex
+  FuzzyMatcher(
+      const P&     pattern,         ///< a reflex::Pattern or a string regex for this matcher
+      uint16_t     max,             ///< max errors
+      const Input& input = Input(), ///< input character sequence for this matcher
+      const char  *opt = nullptr)      ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*`
+    :
+      Matcher(pattern, input, opt),
+      max_(static_cast<uint8_t>(max)),
+      err_(0),
+      ins_(max <= 0xFF || (max & INS)),
+      del_(max <= 0xFF || (max & DEL)),
+      sub_(max <= 0xFF || (max & SUB))
+  {
+    bpt_.resize(max_);
+  }
+  /// Copy constructor.
+  FuzzyMatcher(const FuzzyMatcher& matcher) ///< matcher to copy with pattern (pattern may be shared)
+    :
+      Matcher(matcher),
+      max_(matcher.max_),
+      err_(0),
+      ins_(matcher.ins_),
+      del_(matcher.del_),
+      sub_(matcher.sub_),
+      rmx_(matcher.rmx_)
+  {
+    DBGLOG("FuzzyMatcher::FuzzyMatcher(matcher)");
+    bpt_.resize(max_);
+  }
+  /// Assign a matcher.
+  FuzzyMatcher& operator=(const FuzzyMatcher& matcher) ///< matcher to copy
+  {
+    Matcher::operator=(matcher);
+    max_ = matcher.max_;
+    err_ = 0;
+    ins_ = matcher.ins_;
+    del_ = matcher.del_;
+    sub_ = matcher.sub_;
+    rmx_ = matcher.rmx_;
+    bpt_.resize(max_);
+    return *this;
+  }
+  /// Polymorphic cloning.
+  virtual FuzzyMatcher *clone()
+  {
+    return new FuzzyMatcher(*this);
+  }
+  /// Set the max edit distance, optionally combined with INS, DEL and SUB as the constructor max parameter, preallocates the backtracking stack of this size.
+  void distance(uint16_t max) ///< max errors
+  {
+    max_ = static_cast<uint8_t>(max);
+    ins_ = max <= 0xFF || (max & INS);
+    del_ = max <= 0xFF || (max & DEL);
+    sub_ = max <= 0xFF || (max & SUB);
+    bpt_.resize(max_);
+  }
+  /// Set the max edit distance of the matches of a rule, i.e. pattern accept index, up to the max edit distance of the matcher, e.g. 0 to match a keyword exactly.
+  void distance(
+      size_t  rule, ///< rule (accept) index 1, 2, ...
+      uint8_t max)  ///< max errors of this rule
+  {
+    if (rmx_.size() <= rule)
+      rmx_.resize(rule + 1, 0xFF);
+    rmx_[rule] = max;
+  }
+  /// Returns the max edit distance.
+  uint8_t distance()
+    /// @returns 0 to 255
+    const
+  {
+    return max_;
+  }
+  /// Returns the number of edits made for the match, edits() <= max, not guaranteed to be the minimum edit distance.
+  uint8_t edits()
+    /// @returns 0 to max edit distance
+    const
+  {
+    return err_;
+  }
+ protected:
+  /// Save state to restore fuzzy matcher state after a second pass
+  struct SaveState {
+    SaveState(size_t ded)
+      :
+        use(false),
+        loc(0),
+        cap(0),
+        txt(0),
+        cur(0),
+        pos(0),
+        ded(ded),
+        mrk(false),
+        err(0)
+    { }
+    bool    use;
+    size_t  loc;
+    size_t  cap;
+    size_t  txt;
+    size_t  cur;
+    size_t  pos;
+    size_t  ded;
+    bool    mrk;
+    uint8_t err;
+  };
+  /// Returns true if a match of the rule with the edits made so far is within the max edit distance of the rule.
+  bool permit(size_t rule) const
+  {
+    return rule >= rmx_.size() || err_ <= rmx_[rule];
+  }
+  /// Backtrack point.
+  struct BacktrackPoint {
+    BacktrackPoint()
+      :
+        pc0(nullptr),
+        pc1(nullptr),
+        len(0),
+        err(0),
+        alt(true),
+        sub(true)
+    { }
+    const Pattern::Opcode *pc0; ///< start of opcode
+    const Pattern::Opcode *pc1; ///< pointer to opcode to rerun on backtracking
+    size_t                 len; ///< length of string matched so far
+    uint8_t                err; ///< to restore errors
+    bool                   alt; ///< true if alternating between pattern char substitution and insertion, otherwise insertion only
+    bool                   sub; ///< flag alternates between pattern char substitution (true) and insertion (false)
+  };
+  /// Set backtrack point.
+  void point(BacktrackPoint& bpt, const Pattern::Opcode *pc, bool alternate = true, bool eof = false)
+  {
+    // advance to the first goto opcode
+    while (!Pattern::is_opcode_goto(*pc))
+      ++pc;
+    bpt.pc0 = pc;
+    bpt.pc1 = pc;
+    bpt.len = pos_ - (txt_ - buf_) - !eof;
+    bpt.err = err_;
+    bpt.alt = sub_ && alternate;
+    bpt.sub = bpt.alt;
+  }
+  /// backtrack on a backtrack point to insert or substitute a pattern char, restoring current text char matched and errors.
+  const Pattern::Opcode *backtrack(BacktrackPoint& bpt, int& c1)
+  {
+    // no more alternatives
+    if (bpt.pc1 == nullptr)
+      return nullptr;
+    // done when no more goto opcodes on characters remain
+    if (!Pattern::is_opcode_goto(*bpt.pc1) || Pattern::is_meta(Pattern::lo_of(*bpt.pc1)))
+      return bpt.pc1 = nullptr;
+    Pattern::Index jump = Pattern::index_of(*bpt.pc1);
+    // last opcode is a HALT?
+    if (jump == Pattern::Const::HALT)
+    {
+      if (!Pattern::is_opcode_goto(*bpt.pc0) || (Pattern::lo_of(*bpt.pc0) & 0xC0) != 0xC0)
+        return bpt.pc1 = nullptr;
+      // loop over UTF-8 multibytes, checking linear case only (i.e. one wide char or a short range)
+      for (int i = 0; i < 3; ++i)
+      {
+        jump = Pattern::index_of(*bpt.pc0);
+        if (jump == Pattern::Const::HALT)
+          return bpt.pc1 = nullptr;
+        if (jump == Pattern::Const::LONG)
+          jump = Pattern::long_index_of(bpt.pc0[1]);
+        const Pattern::Opcode *pc0 = pat_->opc_ + jump;
+        const Pattern::Opcode *pc1 = pc0;
+        while (!Pattern::is_opcode_goto(*pc1))
+          ++pc1;
+        if (!Pattern::is_opcode_goto(*pc1) || Pattern::is_meta(Pattern::lo_of(*pc1)) || (Pattern::lo_of(*pc1) & 0x80) != 0x80)
+          break;
+        bpt.pc0 = pc0;
+        bpt.pc1 = pc1;
+      }
+      jump = Pattern::index_of(*bpt.pc1);
+      bpt.sub = bpt.alt;
+      DBGLOG("Multibyte jump to %u", jump);
+    }
+    if (jump == Pattern::Const::LONG)
+      jump = Pattern::long_index_of(bpt.pc1[1]);
+    // restore errors
+    err_ = bpt.err;
+    // restore pos in the input
+    pos_ = (txt_ - buf_) + bpt.len;
+    // set c1 to previous char before pos, to eventually set c0 in match(method)
+    if (pos_ > 0)
+      c1 = static_cast<unsigned char>(buf_[pos_ - 1]);
+    else
+      c1 = got_;
+    // substitute or insert a pattern char in the text?
+    if (bpt.sub)
+    {
+      DBGLOG("Substitute, jump to %u at pos %zu", jump, pos_);
+      // skip UTF-8 multibytes
+      int c = get();
+      if (c >= 0xC0)
+      {
+        int n = (c >= 0xE0) + (c >= 0xF0);
+        while (n-- >= 0)
+          if ((c = get()) == EOF)
+            break;
+      }
+      bpt.sub = false;
+      bpt.pc1 += !bpt.alt;
+    }
+    else
+    {
+      DBGLOG("Insert, jump to %u at pos %zu", jump, pos_);
+      bpt.sub = bpt.alt;
+      ++bpt.pc1;
+    }
+    return pat_->opc_ + jump;
+  }
+  /// Bit-parallel NFA of a string pattern of up to 64 chars for fuzzy search with find(), after Wu and Manber, "Fast text searching allowing errors", CACM 35(10), 1992.
+  struct BitParallel {
+    BitParallel()
+      :
+        hard(0)
+    {
+      std::memset(asc, 0, sizeof(asc));
+    }
+    /// Returns the bit vector of the pattern positions of char c, where c is a byte or a UTF-8 multibyte sequence packed into 32 bits.
+    uint64_t mask(uint32_t c) const
+    {
+      if (c < 256)
+        return asc[c];
+      for (std::vector<std::pair<uint32_t,uint64_t> >::const_iterator i = uni.begin(); i != uni.end(); ++i)
+        if (i->first == c)
+          return i->second;
+      return 0;
+    }
+    std::string                              str;      ///< the string pattern
+    std::vector<uint32_t>                    chr;      ///< the pattern chars, UTF-8 multibyte sequences are packed into 32 bits
+    uint64_t                                 asc[256]; ///< bit vectors of the pattern positions of single byte chars
+    std::vector<std::pair<uint32_t,uint64_t> > uni;    ///< bit vectors of the pattern positions of multibyte chars
+    uint64_t                                 hard;     ///< pattern positions of \n and \0, which are never deleted or substituted
+    std::vector<uint64_t>                    vec;      ///< bit vectors of the NFA states reached with 0 up to max errors
+    std::vector<std::pair<size_t,uint32_t> > win;      ///< ring of the last chars scanned with their offsets from txt_
+    std::vector<uint16_t>                    tab;      ///< edit distance table to locate the start of a match
+  };
+  /// Pigeonhole filter to search with find(): a match with up to max errors has at least one of max + 1 pieces of the pattern prefix without errors.
+  struct Pigeonhole {
+    Pigeonhole()
+      :
+        max(0),
+        last(0)
+    { }
+    std::string         str;  ///< the pattern prefix
+    size_t              max;  ///< max errors
+    std::vector<size_t> off;  ///< offsets of the max + 1 pieces in str, followed by the length of str, empty when the filter is not used
+    std::vector<size_t> hit;  ///< input offsets of the next pieces found, or (size_t)-1
+    std::vector<size_t> from; ///< input offsets to continue searching for the pieces not found
+    size_t              last; ///< input offset of the last seek()
+  };
+  /// Returns true if the pattern prefix splits into max + 1 pieces of at least three bytes to search with the pigeonhole filter, updates the filter when the pattern changed.
+  bool pigeonhole()
+    /// @returns true if the pigeonhole filter can be used
+  {
+    if (pat_ == nullptr || pat_->len_ == 0)
+      return false;
+    if (phf_.max == max_ && phf_.str.size() == pat_->len_ && phf_.str.compare(0, pat_->len_, pat_->pre_, pat_->len_) == 0)
+      return !phf_.off.empty();
+    phf_.str.assign(pat_->pre_, pat_->len_);
+    phf_.max = max_;
+    phf_.off.clear();
+    phf_.last = 0;
+    // split the prefix into max + 1 pieces of UTF-8 chars
+    std::vector<size_t> chars;
+    for (size_t i = 0; i < phf_.str.size(); ++i)
+      if ((phf_.str[i] & 0xC0) != 0x80)
+        chars.push_back(i);
+    size_t n = phf_.max + 1;
+    if (chars.size() < 3 * n)
+      return false;
+    for (size_t j = 0; j < n; ++j)
+      phf_.off.push_back(chars[j * chars.size() / n]);
+    phf_.off.push_back(phf_.str.size());
+    for (size_t j = 0; j < n; ++j)
+    {
+      if (phf_.off[j + 1] - phf_.off[j] < 3)
+      {
+        phf_.off.clear();
+        return false;
+      }
+    }
+    phf_.hit.assign(n, static_cast<size_t>(-1));
+    phf_.from.assign(n, 0);
+    return true;
+  }
+  /// Returns a location in the buffer at or after loc where a match may start, based on the next pieces of the pigeonhole filter found in the buffer.
+  size_t seek(size_t loc) ///< location in the buffer to start searching
+    /// @returns location in the buffer at or after loc, at most end_
+  {
+    const size_t NONE = static_cast<size_t>(-1);
+    size_t n = phf_.off.size() - 1;
+    size_t abs = num_ + loc;
+    if (abs < phf_.last)
+    {
+      // input was reset
+      phf_.hit.assign(n, NONE);
+      phf_.from.assign(n, 0);
+    }
+    phf_.last = abs;
+    // a piece at offset off[j] in the prefix is found at most off[j] + 4 * max bytes after the start of a match, as UTF-8 chars are up to 4 bytes
+    size_t slack = 4 * phf_.max;
+    size_t next = NONE;
+    for (size_t j = 0; j < n; ++j)
+    {
+      size_t len = phf_.off[j + 1] - phf_.off[j];
+      if (phf_.hit[j] == NONE || phf_.hit[j] < abs)
+      {
+        size_t start = phf_.hit[j] == NONE && phf_.from[j] > abs ? phf_.from[j] : abs;
+        const char *s = find_string(buf_ + (start - num_), buf_ + end_, phf_.str.c_str() + phf_.off[j], len);
+        if (s != nullptr)
+        {
+          phf_.hit[j] = num_ + (s - buf_);
+        }
+        else
+        {
+          // the piece may be found later spanning the end of the buffer
+          phf_.hit[j] = NONE;
+          phf_.from[j] = end_ + 1 > len ? num_ + end_ + 1 - len : num_;
+        }
+      }
+      size_t h = phf_.hit[j] != NONE ? phf_.hit[j] : phf_.from[j];
+      h = h > phf_.off[j] + slack ? h - phf_.off[j] - slack : 0;
+      if (h < next)
+        next = h;
+    }
+    if (next > abs)
+    {
+      DBGLOG("Pigeonhole filter skips %zu bytes", next - abs);
+      loc = next - num_;
+      if (loc > end_)
+        loc = end_;
+    }
+    return loc;
+  }
+  /// Returns true if the pattern is a string of up to 64 chars to search with the bit-parallel NFA, updates the NFA when the pattern changed.
+  bool bitap()
+    /// @returns true if the bit-parallel NFA can be used
+  {
+    if (pat_ == nullptr || !pat_->one_ || pat_->len_ == 0)
+      return false;
+    if (bpn_.str.size() == pat_->len_ && bpn_.str.compare(0, pat_->len_, pat_->pre_, pat_->len_) == 0)
+      return !bpn_.chr.empty();
+    bpn_.str.assign(pat_->pre_, pat_->len_);
+    bpn_.chr.clear();
+    bpn_.uni.clear();
+    bpn_.hard = 0;
+    std::memset(bpn_.asc, 0, sizeof(bpn_.asc));
+    const char *s = bpn_.str.c_str();
+    const char *e = s + bpn_.str.size();
+    while (s < e)
+    {
+      if (bpn_.chr.size() >= 64)
+      {
+        bpn_.chr.clear();
+        return false;
+      }
+      uint32_t c = static_cast<unsigned char>(*s++);
+      if (c >= 0xC0)
+      {
+        int n = 1 + (c >= 0xE0) + (c >= 0xF0);
+        for (int i = 1; i <= n && s < e; ++i)
+          c |= static_cast<uint32_t>(static_cast<unsigned char>(*s++)) << (8 * i);
+      }
+      uint64_t bit = 1ULL << bpn_.chr.size();
+      if (c < 256)
+      {
+        bpn_.asc[c] |= bit;
+      }
+      else
+      {
+        std::vector<std::pair<uint32_t,uint64_t> >::iterator i = bpn_.uni.begin();
+        while (i != bpn_.uni.end() && i->first != c)
+          ++i;
+        if (i == bpn_.uni.end())
+          bpn_.uni.push_back(std::pair<uint32_t,uint64_t>(c, bit));
+        else
+          i->second |= bit;
+      }
+      if (c == '\n' || c == '\0')
+        bpn_.hard |= bit;
+      bpn_.chr.push_back(c);
+    }
+    return true;
+  }
+  /// Read the next char into the ring of the bit-parallel NFA, move txt_ ahead to let the buffer shift when the ring is full.
+  bool bitap_next(
+      size_t    count, ///< number of chars read
+      size_t    w,     ///< ring size
+      uint32_t& c)     ///< the char read
+    /// @returns false when EOF
+  {
+    if (count >= w && count % w == 0)
+    {
+      // the oldest char in the ring is overwritten next, move txt_ to the char after it
+      size_t shift = bpn_.win[(count + 1) % w].first;
+      txt_ += shift;
+      cur_ = txt_ - buf_;
+      ind_ = cur_;
+      for (size_t i = 0; i < w; ++i)
+        bpn_.win[i].first -= shift;
+    }
+    size_t off = pos_ - cur_;
+    int ch = get();
+    if (ch == EOF)
+      return false;
+    c = static_cast<uint32_t>(ch);
+    if (c >= 0xC0)
+    {
+      // pack UTF-8 multibytes into 32 bits
+      int n = 1 + (c >= 0xE0) + (c >= 0xF0);
+      for (int i = 1; i <= n; ++i)
+      {
+        if ((ch = get()) == EOF)
+          break;
+        c |= static_cast<uint32_t>(ch) << (8 * i);
+      }
+    }
+    bpn_.win[count % w] = std::pair<size_t,uint32_t>(off, c);
+    return true;
+  }
+  /// Fuzzy search with the bit-parallel NFA for the match with the fewest errors, then the longest match from the leftmost start.
+  size_t bitap_find()
+    /// @returns nonzero if a match was found
+  {
+    DBGLOG("BEGIN FuzzyMatcher::bitap_find()");
+    const uint16_t INF = 0xFFFF;
+    const size_t m = bpn_.chr.size();
+    const size_t k = rmx_.size() > 1 && rmx_[1] < max_ ? rmx_[1] : max_;
+    const size_t w = m + 2 * k + 1; // ring size to hold the chars of a match and the chars read ahead
+    const uint64_t last = 1ULL << (m - 1);
+    bpn_.vec.assign(k + 1, 0);
+    bpn_.win.resize(w);
+    uint64_t *r = &bpn_.vec[0];
+    txt_ = buf_ + cur_;
+    pos_ = cur_;
+    size_t count = 0;    // number of chars read
+    size_t best = k + 1; // fewest errors of a match found
+    size_t stop = 0;     // number of chars read up to the end of the first match with the fewest errors
+    const int lead = static_cast<unsigned char>(bpn_.str[0]);
+    const bool seeds = pigeonhole();
+    uint32_t c;
+    while (true)
+    {
+      if (r[k] == 0 && best > k)
+      {
+        // no pattern prefix matched, skip ahead with the pigeonhole filter and to the first byte of the pattern, which must match exactly
+        if (seeds)
+          pos_ = seek(pos_);
+        const char *s;
+        while ((s = static_cast<const char*>(std::memchr(buf_ + pos_, lead, end_ - pos_))) == nullptr)
+        {
+          pos_ = cur_ = end_;
+          txt_ = buf_ + end_;
+          if (peek_more() == EOF)
+            break;
+        }
+        if (s != nullptr)
+        {
+          pos_ = cur_ = s - buf_;
+          txt_ = buf_ + cur_;
+        }
+        count = 0;
+      }
+      if (!bitap_next(count, w, c))
+        break;
+      ++count;
+      // bit i of r[d] is set when the pattern prefix of length i + 1 matches the text read with up to d errors
+      uint64_t b = bpn_.mask(c);
+      bool hard = c == '\n' || c == '\0';
+      uint64_t prev = r[0];
+      r[0] = ((r[0] << 1) | 1) & b;
+      for (size_t d = 1; d <= k; ++d)
+      {
+        uint64_t next = (((r[d] << 1) | 1) & b) | r[d - 1];
+        if (!hard)
+        {
+          if (ins_)
+            next |= prev;
+          if (sub_)
+            next |= (prev << 1) & ~bpn_.hard;
+        }
+        if (del_)
+          next |= (r[d - 1] << 1) & ~bpn_.hard;
+        prev = r[d];
+        r[d] = next;
+      }
+      for (size_t d = 0; d < best; ++d)
+      {
+        if ((r[d] & last) != 0)
+        {
+          DBGLOG("Bitap match with %zu errors at %zu", d, pos_);
+          best = d;
+          stop = count;
+          break;
+        }
+      }
+      // a match with fewer errors may end up to best chars after the match found
+      if (best <= k && count - stop >= best)
+        break;
+    }
+    if (best > k)
+    {
+      set_current_match(pos_);
+      len_ = 0;
+      err_ = 0;
+      DBGLOG("END FuzzyMatcher::bitap_find()");
+      return cap_ = 0;
+    }
+    // locate the leftmost start of the match with the edit distances of pattern suffixes i..m to the text suffixes j..n
+    size_t n = stop < m + best ? stop : m + best;
+    size_t cols = n + 1;
+    size_t base = stop - n;
+    bpn_.tab.assign((m + 1) * cols, INF);
+    uint16_t *t = &bpn_.tab[0];
+    t[m * cols + n] = 0;
+    for (size_t j = n; j > 0; --j)
+    {
+      uint32_t a = bpn_.win[(base + j - 1) % w].second;
+      if (ins_ && a != '\n' && a != '\0' && t[m * cols + j] < INF)
+        t[m * cols + j - 1] = t[m * cols + j] + 1;
+    }
+    for (size_t i = m - 1; i > 0; --i)
+    {
+      bool keep = (bpn_.hard >> i & 1) != 0;
+      uint16_t *row = t + i * cols;
+      uint16_t *below = row + cols;
+      if (del_ && !keep && below[n] < INF)
+        row[n] = below[n] + 1;
+      for (size_t j = n; j > 0; --j)
+      {
+        uint32_t a = bpn_.win[(base + j - 1) % w].second;
+        bool hard = a == '\n' || a == '\0';
+        uint16_t v = INF;
+        if (a == bpn_.chr[i])
+          v = below[j];
+        else if (sub_ && !hard && !keep && below[j] < INF)
+          v = below[j] + 1;
+        if (ins_ && !hard && row[j] < INF && row[j] + 1 < v)
+          v = row[j] + 1;
+        if (del_ && !keep && below[j - 1] < INF && below[j - 1] + 1 < v)
+          v = below[j - 1] + 1;
+        row[j - 1] = v;
+      }
+    }
+    size_t from = base;
+    uint16_t cost = INF;
+    for (size_t j = 0; j < n; ++j)
+    {
+      if (bpn_.win[(base + j) % w].second == bpn_.chr[0] && t[cols + j + 1] < cost)
+      {
+        cost = t[cols + j + 1];
+        from = base + j;
+      }
+    }
+    // read ahead up to the longest match from the start, which has at most m + best chars
+    size_t ahead = from + m + best;
+    while (count < ahead && bitap_next(count, w, c))
+      ++count;
+    if (count < ahead)
+      ahead = count;
+    // pick the longest match with the fewest errors from the start, the edit distances of pattern prefixes 1..m are in tab[1..m]
+    bpn_.tab.assign(m + 1, INF);
+    t = &bpn_.tab[0];
+    t[1] = 0;
+    for (size_t i = 2; i <= m; ++i)
+      if (del_ && (bpn_.hard >> (i - 1) & 1) == 0 && t[i - 1] < INF)
+        t[i] = t[i - 1] + 1;
+    size_t to = from + 1;
+    cost = t[m];
+    for (size_t j = from + 1; j < ahead; ++j)
+    {
+      uint32_t a = bpn_.win[j % w].second;
+      bool hard = a == '\n' || a == '\0';
+      uint16_t diag = t[1];
+      t[1] = ins_ && !hard && t[1] < INF ? t[1] + 1 : INF;
+      for (size_t i = 2; i <= m; ++i)
+      {
+        bool keep = (bpn_.hard >> (i - 1) & 1) != 0;
+        uint16_t v = INF;
+        if (a == bpn_.chr[i - 1])
+          v = diag;
+        else if (sub_ && !hard && !keep && diag < INF)
+          v = diag + 1;
+        if (ins_ && !hard && t[i] < INF && t[i] + 1 < v)
+          v = t[i] + 1;
+        if (del_ && !keep && t[i - 1] < INF && t[i - 1] + 1 < v)
+          v = t[i - 1] + 1;
+        diag = t[i];
+        t[i] = v;
+      }
+      if (t[m] <= cost)
+      {
+        cost = t[m];
+        to = j + 1;
+      }
+    }
+    size_t first = bpn_.win[from % w].first;
+    size_t end = to < count ? bpn_.win[to % w].first : pos_ - cur_;
+    txt_ = buf_ + cur_ + first;
+    len_ = end - first;
+    err_ = static_cast<uint8_t>(cost);
+    set_current(cur_ + end);
+    DBGLOG("END FuzzyMatcher::bitap_find()");
+    return cap_ = pat_->one_;
+  }
+  /// Returns true if input fuzzy-matched the pattern using method Const::SCAN, Const::FIND, Const::SPLIT, or Const::MATCH.
+  virtual size_t match(Method method) ///< Const::SCAN, Const::FIND, Const::SPLIT, or Const::MATCH
+    /// @returns nonzero if input matched the pattern
+  {
+    DBGLOG("BEGIN FuzzyMatcher::match()");
+    reset_text();
+    // search for a string pattern of up to 64 chars with the bit-parallel NFA instead of backtracking
+    if (method == Const::FIND && bitap())
+      return bitap_find();
+    SaveState sst(ded_);
+    bool seeds = method == Const::FIND && pigeonhole(); // skip ahead with the pigeonhole filter to find a match
+    len_ = 0; // split text length starts with 0
+    anc_ = false; // no word boundary anchor found and applied
+scan:
+    txt_ = buf_ + cur_;
+#if !defined(WITH_NO_INDENT)
+    mrk_ = false;
+    ind_ = pos_; // ind scans input in buf[] in newline() up to pos - 1
+    col_ = 0; // count columns for indent matching
+#endif
+find:
+    int c1 = got_;
+    bool bol = at_bol(); // at begin of line?
+#if !defined(WITH_NO_INDENT)
+redo:
+#endif
+    lap_.resize(0);
+    cap_ = 0;
+    bool nul = method == Const::MATCH;
+    if (pat_->opc_ != nullptr)
+    {
+      err_ = 0;
+      uint8_t stack = 0;
+      const Pattern::Opcode *pc = pat_->opc_;
+      while (true)
+      {
+        const Pattern::Opcode *pc0;
+        while (true)
+        {
+          Pattern::Opcode opcode = *pc;
+          Pattern::Index jump;
+          DBGLOG("Fetch: code[%zu] = 0x%08X", pc - pat_->opc_, opcode);
+          pc0 = pc;
+          if (!Pattern::is_opcode_goto(opcode))
+          {
+            switch (opcode >> 24)
+            {
+              case 0xFE: // TAKE
+                if (permit(Pattern::long_index_of(opcode)))
+                {
+                  cap_ = Pattern::long_index_of(opcode);
+                  cur_ = pos_;
+                  DBGLOG("Take: cap = %zu", cap_);
+                }
+                ++pc;
+                continue;
+              case 0xFD: // REDO
+                cap_ = Const::REDO;
+                DBGLOG("Redo");
+                cur_ = pos_;
+                ++pc;
+                continue;
+              case 0xFC: // TAIL
+                {
+                  Pattern::Lookahead la = Pattern::lookahead_of(opcode);
+                  DBGLOG("Tail: %u", la);
+                  if (lap_.size() > la && lap_[la] >= 0)
+                    cur_ = txt_ - buf_ + static_cast<size_t>(lap_[la]); // mind the (new) gap
+                  ++pc;
+                  continue;
+                }
+              case 0xFB: // HEAD
+                {
+                  Pattern::Lookahead la = Pattern::lookahead_of(opcode);
+                  DBGLOG("Head: lookahead[%u] = %zu", la, pos_ - (txt_ - buf_));
+                  if (lap_.size() <= la)
+                    lap_.resize(la + 1, -1);
+                  lap_[la] = static_cast<int>(pos_ - (txt_ - buf_)); // mind the gap
+                  ++pc;
+                  continue;
+                }
+#if !defined(WITH_NO_INDENT)
+              case Pattern::META_DED - Pattern::META_MIN:
+                if (ded_ > 0)
+                {
+                  jump = Pattern::index_of(opcode);
+                  if (jump == Pattern::Const::LONG)
+                    jump = Pattern::long_index_of(pc[1]);
+                  DBGLOG("Dedent ded = %zu", ded_); // unconditional dedent matching \j
+                  nul = true;
+                  pc = pat_->opc_ + jump;
+                  continue;
+                }
+#endif
+            }
+            if (c1 == EOF)
+              break;
+            int c0 = c1;
+            c1 = get();
+            DBGLOG("Get: c1 = %d", c1);
+            // where to jump back to (backtrack on meta transitions)
+            Pattern::Index back = Pattern::Const::IMAX;
+            // to jump to longest sequence of matching metas
+            jump = Pattern::Const::IMAX;
+            while (true)
+            {
+              if ((jump == Pattern::Const::IMAX || back == Pattern::Const::IMAX) && !Pattern::is_opcode_goto(opcode))
+              {
+                // we no longer have to pass through all if jump and back are set
+                switch (opcode >> 24)
+                {
+                  case 0xFE: // TAKE
+                    if (permit(Pattern::long_index_of(opcode)))
+                    {
+                      cap_ = Pattern::long_index_of(opcode);
+                      cur_ = pos_;
+                      if (c1 != EOF)
+                        --cur_; // must unget one char
+                      DBGLOG("Take: cap = %zu", cap_);
+                    }
+                    opcode = *++pc;
+                    continue;
+                  case 0xFD: // REDO
+                    cap_ = Const::REDO;
+                    DBGLOG("Redo");
+                    cur_ = pos_;
+                    if (c1 != EOF)
+                      --cur_; // must unget one char
+                    opcode = *++pc;
+                    continue;
+                  case 0xFC: // TAIL
+                    {
+                      Pattern::Lookahead la = Pattern::lookahead_of(opcode);
+                      DBGLOG("Tail: %u", la);
+                      if (lap_.size() > la && lap_[la] >= 0)
+                        cur_ = txt_ - buf_ + static_cast<size_t>(lap_[la]); // mind the (new) gap
+                      opcode = *++pc;
+                      continue;
+                    }
+                  case 0xFB: // HEAD
+                    opcode = *++pc;
+                    continue;
+#if !defined(WITH_NO_INDENT)
+                  case Pattern::META_DED - Pattern::META_MIN:
+                    DBGLOG("DED? %d", c1);
+                    if (jump == Pattern::Const::IMAX && back == Pattern::Const::IMAX && bol && dedent())
+                    {
+                      jump = Pattern::index_of(opcode);
+                      if (jump == Pattern::Const::LONG)
+                        jump = Pattern::long_index_of(*++pc);
+                    }
+                    opcode = *++pc;
+                    continue;
+                  case Pattern::META_IND - Pattern::META_MIN:
+                    DBGLOG("IND? %d", c1);
+                    if (jump == Pattern::Const::IMAX && back == Pattern::Const::IMAX && bol && indent())
+                    {
+                      jump = Pattern::index_of(opcode);
+                      if (jump == Pattern::Const::LONG)
+                        jump = Pattern::long_index_of(*++pc);
+                    }
+                    opcode = *++pc;
+                    continue;
+                  case Pattern::META_UND - Pattern::META_MIN:
+                    DBGLOG("UND");
+                    if (mrk_)
+                    {
+                      jump = Pattern::index_of(opcode);
+                      if (jump == Pattern::Const::LONG)
+                        jump = Pattern::long_index_of(*++pc);
+                    }
+                    mrk_ = false;
+                    ded_ = 0;
+                    opcode = *++pc;
+                    continue;
+#endif
+                  case Pattern::META_EOB - Pattern::META_MIN:
+                    DBGLOG("EOB? %d", c1);
+                    if (jump == Pattern::Const::IMAX && c1 == EOF)
+                    {
+                      jump = Pattern::index_of(opcode);
+                      if (jump == Pattern::Const::LONG)
+                        jump = Pattern::long_index_of(*++pc);
+                    }
+                    opcode = *++pc;
+                    continue;
+                  case Pattern::META_BOB - Pattern::META_MIN:
+                    DBGLOG("BOB? %d", at_bob());
+                    if (jump == Pattern::Const::IMAX && at_bob())
+                    {
+                      jump = Pattern::index_of(opcode);
+                      if (jump == Pattern::Const::LONG)
+                        jump = Pattern::long_index_of(*++pc);
+                    }
+                    opcode = *++pc;
+                    continue;
+                  case Pattern::META_EOL - Pattern::META_MIN:
+                    DBGLOG("EOL? %d", c1);
+                    anc_ = true;
+                    if (jump == Pattern::Const::IMAX && (c1 == EOF || c1 == '\n' || (c1 == '\r' && peek() == '\n')))
+                    {
+                      jump = Pattern::index_of(opcode);
+                      if (jump == Pattern::Const::LONG)
+                        jump = Pattern::long_index_of(*++pc);
+                    }
+                    opcode = *++pc;
+                    continue;
+                  case Pattern::META_BOL - Pattern::META_MIN:
+                    DBGLOG("BOL? %d", bol);
+                    anc_ = true;
+                    if (jump == Pattern::Const::IMAX && bol)
+                    {
+                      jump = Pattern::index_of(opcode);
+                      if (jump == Pattern::Const::LONG)
+                        jump = Pattern::long_index_of(*++pc);
+                    }
+                    opcode = *++pc;
+                    continue;
+                  case Pattern::META_EWE - Pattern::META_MIN:
+                    DBGLOG("EWE? %d %d %d", c0, c1, isword(c0) && !isword(c1));
+                    anc_ = true;
+                    if (jump == Pattern::Const::IMAX && (isword(c0) || opt_.W) && !isword(c1))
+                    {
+                      jump = Pattern::index_of(opcode);
+                      if (jump == Pattern::Const::LONG)
+                        jump = Pattern::long_index_of(*++pc);
+                    }
+                    opcode = *++pc;
+                    continue;
+                  case Pattern::META_BWE - Pattern::META_MIN:
+                    DBGLOG("BWE? %d %d %d", c0, c1, !isword(c0) && isword(c1));
+                    anc_ = true;
+                    if (jump == Pattern::Const::IMAX && !isword(c0) && isword(c1))
+                    {
+                      jump = Pattern::index_of(opcode);
+                      if (jump == Pattern::Const::LONG)
+                        jump = Pattern::long_index_of(*++pc);
+                    }
+                    opcode = *++pc;
+                    continue;
+                  case Pattern::META_EWB - Pattern::META_MIN:
+                    DBGLOG("EWB? %d", at_eow());
+                    anc_ = true;
+                    if (jump == Pattern::Const::IMAX && isword(got_) &&
+                        !isword(static_cast<unsigned char>(method == Const::SPLIT ? txt_[len_] : *txt_)))
+                    {
+                      jump = Pattern::index_of(opcode);
+                      if (jump == Pattern::Const::LONG)
+                        jump = Pattern::long_index_of(*++pc);
+                    }
+                    opcode = *++pc;
+                    continue;
+                  case Pattern::META_BWB - Pattern::META_MIN:
+                    DBGLOG("BWB? %d", at_bow());
+                    anc_ = true;
+                    if (jump == Pattern::Const::IMAX && !isword(got_) &&
+                        (opt_.W || isword(static_cast<unsigned char>(method == Const::SPLIT ? txt_[len_] : *txt_))))
+                    {
+                      jump = Pattern::index_of(opcode);
+                      if (jump == Pattern::Const::LONG)
+                        jump = Pattern::long_index_of(*++pc);
+                    }
+                    opcode = *++pc;
+                    continue;
+                  case Pattern::META_NWE - Pattern::META_MIN:
+                    DBGLOG("NWE? %d %d %d", c0, c1, isword(c0) == isword(c1));
+                    anc_ = true;
+                    if (jump == Pattern::Const::IMAX && isword(c0) == isword(c1))
+                    {
+                      jump = Pattern::index_of(opcode);
+                      if (jump == Pattern::Const::LONG)
+                        jump = Pattern::long_index_of(*++pc);
+                    }
+                    opcode = *++pc;
+                    continue;
+                  case Pattern::META_NWB - Pattern::META_MIN:
+                    DBGLOG("NWB? %d %d", at_bow(), at_eow());
+                    anc_ = true;
+                    if (jump == Pattern::Const::IMAX &&
+                        isword(got_) == isword(static_cast<unsigned char>(txt_[len_])))
+                    {
+                      jump = Pattern::index_of(opcode);
+                      if (jump == Pattern::Const::LONG)
+                        jump = Pattern::long_index_of(*++pc);
+                    }
+                    opcode = *++pc;
+                    continue;
+                  case 0xFF: // LONG
+                    opcode = *++pc;
+                    continue;
+                }
+              }
+              if (jump == Pattern::Const::IMAX)
+              {
+                if (back != Pattern::Const::IMAX)
+                {
+                  pc = pat_->opc_ + back;
+                  opcode = *pc;
+                }
+                break;
+              }
+              DBGLOG("Backtrack: pc = %u", jump);
+              if (back == Pattern::Const::IMAX)
+                back = static_cast<Pattern::Index>(pc - pat_->opc_);
+              pc = pat_->opc_ + jump;
+              opcode = *pc;
+              jump = Pattern::Const::IMAX;
+            }
+            if (c1 == EOF)
+              break;
+          }
+          else
+          {
+            if (Pattern::is_opcode_halt(opcode))
+              break;
+            if (c1 == EOF)
+              break;
+            c1 = get();
+            DBGLOG("Get: c1 = %d", c1);
+            if (c1 == EOF)
+              break;
+          }
+          {
+            Pattern::Opcode lo = c1 << 24;
+            Pattern::Opcode hi = lo | 0x00FFFFFF;
+unrolled:
+            if (hi < opcode || lo > (opcode << 8))
+            {
+              opcode = *++pc;
+              if (hi < opcode || lo > (opcode << 8))
+              {
+                opcode = *++pc;
+                if (hi < opcode || lo > (opcode << 8))
+                {
+                  opcode = *++pc;
+                  if (hi < opcode || lo > (opcode << 8))
+                  {
+                    opcode = *++pc;
+                    if (hi < opcode || lo > (opcode << 8))
+                    {
+                      opcode = *++pc;
+                      if (hi < opcode || lo > (opcode << 8))
+                      {
+                        opcode = *++pc;
+                        if (hi < opcode || lo > (opcode << 8))
+                        {
+                          opcode = *++pc;
+                          if (hi < opcode || lo > (opcode << 8))
+                          {
+                            opcode = *++pc;
+                            goto unrolled;
+                          }
+                        }
+                      }
+                    }
+                  }
+                }
+              }
+            }
+          }
+          jump = Pattern::index_of(opcode);
+          if (jump == 0)
+          {
+            // loop back to start state after only one char matched (one transition) but w/o full match, then optimize
+            if (cap_ == 0 && pos_ == cur_ + 1 && method == Const::FIND)
+              cur_ = pos_; // set cur_ to move forward from cur_ + 1 with FIND advance()
+          }
+          else if (jump >= Pattern::Const::LONG)
+          {
+            if (jump == Pattern::Const::HALT)
+              break;
+            jump = Pattern::long_index_of(pc[1]);
+          }
+          pc = pat_->opc_ + jump;
+        }
+        // exit fuzzy loop if nothing consumed
+        if (pos_ == static_cast<size_t>(txt_ + len_ - buf_))
+          break;
+        // match, i.e. cap_ > 0?
+        if (method == Const::MATCH)
+        {
+          // exit fuzzy loop if fuzzy match succeeds till end of input
+          if (cap_ > 0)
+          {
+            if (c1 == EOF)
+              break;
+            while (err_ < max_)
+            {
+              c1 = get();
+              if (c1 == EOF)
+                break;
+              // skip one (multibyte) char
+              if (c1 >= 0xC0)
+              {
+                int n = (c1 >= 0xE0) + (c1 >= 0xF0);
+                while (n-- >= 0)
+                  if ((c1 = get()) == EOF)
+                    break;
+              }
+              ++err_;
+            }
+            if (at_end())
+            {
+              DBGLOG("match pos = %zu", pos_);
+              set_current(pos_);
+              break;
+            }
+          }
+        }
+        else
+        {
+          // exit fuzzy loop if match or first char mismatched
+          if (cap_ > 0 || pos_ == static_cast<size_t>(txt_ + len_ - buf_ + 1))
+            break;
+        }
+        // no match, use fuzzy matching with max error
+        if (c1 == '\0' || c1 == '\n' || c1 == EOF)
+        {
+          // do not try to fuzzy match NUL, LF, or EOF
+          if (err_ < max_ && del_)
+          {
+            ++err_;
+            // set backtrack point to insert pattern char only, not substitute, if pc0 os a different point than the last
+            if (stack == 0 || bpt_[stack - 1].pc0 != pc0)
+            {
+              point(bpt_[stack++], pc0, false, c1 == EOF);
+              DBGLOG("point[%u] at %zu EOF", stack - 1, pc0 - pat_->opc_);
+            }
+          }
+          pc = nullptr;
+          while (stack > 0 && pc == nullptr)
+          {
+            pc = backtrack(bpt_[stack - 1], c1);
+            if (pc == nullptr)
+              --stack;
+          }
+          // exhausted all backtracking points?
+          if (pc == nullptr)
+            break;
+        }
+        else
+        {
+          if (err_ < max_)
+          {
+            ++err_;
+            if (del_ || sub_)
+            {
+              // set backtrack point if pc0 is a different point than the last
+              if (stack == 0 || bpt_[stack - 1].pc0 != pc0)
+              {
+                point(bpt_[stack++], pc0);
+                DBGLOG("point[%u] at %zu pos %zu", stack - 1, pc0 - pat_->opc_, pos_ - 1);
+              }
+            }
+            if (ins_)
+            {
+              // try pattern char deletion (text insertion): skip one (multibyte) char then rerun opcode at pc0
+              if (c1 >= 0xC0)
+              {
+                int n = (c1 >= 0xE0) + (c1 >= 0xF0);
+                while (n-- >= 0)
+                  if ((c1 = get()) == EOF)
+                    break;
+              }
+              pc = pc0;
+              DBGLOG("delete %c at pos %zu", c1, pos_ - 1);
+            }
+          }
+          else
+          {
+            // try insertion or substitution of pattern char
+            pc = nullptr;
+            while (stack > 0 && pc == nullptr)
+            {
+              pc = backtrack(bpt_[stack - 1], c1);
+              if (pc == nullptr)
+                --stack;
+            }
+            // exhausted all backtracking points?
+            if (pc == nullptr)
+              break;
+          }
+        }
+      }
+    }
+    // if fuzzy matched with errors then perform a second pass ahead of this match to check for an exact match
+    if (cap_ > 0 && err_ > 0 && !sst.use && (method == Const::FIND || method == Const::SPLIT))
+    {
+      // this part is based on advance() in matcher.cpp, limited to advancing ahead till the one of the first pattern char(s) match excluding \n
+      size_t loc = txt_ - buf_ + 1;
+      const char *s = buf_ + loc;
+      const char *e = static_cast<const char*>(std::memchr(s, '\n', cur_ - loc));
+      if (e == nullptr)
+        e = buf_ + cur_;
+      if (pat_->len_ == 0)
+      {
+        if (pat_->min_ > 0)
+        {
+          const Pattern::Pred *pma = pat_->pma_;
+          while (s < e && (pma[static_cast<uint8_t>(*s)] & 0xc0) == 0xc0)
+            ++s;
+          if (s < e)
+          {
+            loc = s - buf_;
+            sst.use = true;
+            sst.loc = loc;
+            sst.cap = cap_;
+            sst.txt = txt_ - buf_;
+            sst.cur = cur_;
+            sst.pos = pos_;
+            size_t tmp = ded_;
+            ded_ = sst.ded;
+            sst.ded = tmp;
+            sst.mrk = mrk_;
+            sst.err = err_;
+            set_current(loc);
+            goto scan;
+          }
+        }
+      }
+      else if (s < e)
+      {
+        s = static_cast<const char*>(std::memchr(s, *pat_->pre_, e - s));
+        if (s != nullptr)
+        {
+          loc = s - buf_;
+          sst.use = true;
+          sst.loc = loc;
+          sst.cap = cap_;
+          sst.txt = txt_ - buf_;
+          sst.cur = cur_;
+          sst.pos = pos_;
+          size_t tmp = ded_;
+          ded_ = sst.ded;
+          sst.ded = tmp;
+          sst.mrk = mrk_;
+          sst.err = err_;
+          set_current(loc);
+          goto scan;
+        }
+      }
+    }
+    else if (sst.use && (cap_ == 0 || err_ >= sst.err))
+    {
+      // if the buffer was shifted then cur_, pos_ and txt_ are no longer at the same location in the buffer, we must adjust for this
+      size_t loc = txt_ - buf_;
+      size_t shift = sst.loc - loc;
+      cap_ = sst.cap;
+      cur_ = sst.cur - shift;
+      pos_ = sst.pos - shift;
+      ded_ = sst.ded;
+      mrk_ = sst.mrk;
+      err_ = sst.err;
+      txt_ = buf_ + sst.txt - shift;
+    }
+    else if (sst.use && cap_ > 0 && method == Const::SPLIT)
+    {
+      size_t loc = txt_ - buf_;
+      size_t shift = sst.loc - loc;
+      len_ = loc - sst.txt + shift;
+    }
+#if !defined(WITH_NO_INDENT)
+    if (mrk_ && cap_ != Const::REDO)
+    {
+      if (col_ > 0 && (tab_.empty() || tab_.back() < col_))
+      {
+        DBGLOG("Set new stop: tab_[%zu] = %zu", tab_.size(), col_);
+        tab_.push_back(col_);
+      }
+      else if (!tab_.empty() && tab_.back() > col_)
+      {
+        size_t n;
+        for (n = tab_.size() - 1; n > 0; --n)
+          if (tab_.at(n - 1) <= col_)
+            break;
+        ded_ += tab_.size() - n;
+        DBGLOG("Dedents: ded = %zu tab_ = %zu", ded_, tab_.size());
+        tab_.resize(n);
+        // adjust stop when indents are not aligned (Python would give an error)
+        if (n > 0)
+          tab_.back() = col_;
+      }
+    }
+    if (ded_ > 0)
+    {
+      DBGLOG("Dedents: ded = %zu", ded_);
+      if (col_ == 0 && bol)
+      {
+        ded_ += tab_.size();
+        tab_.resize(0);
+        DBGLOG("Rescan for pending dedents: ded = %zu", ded_);
+        pos_ = ind_;
+        // avoid looping, match \j exactly
+        bol = false;
+        goto redo;
+      }
+      --ded_;
+    }
+#endif
+    if (method == Const::SPLIT)
+    {
+      DBGLOG("Split: len = %zu cap = %zu cur = %zu pos = %zu end = %zu txt-buf = %zu eob = %d got = %d", len_, cap_, cur_, pos_, end_, txt_-buf_, (int)eof_, got_);
+      if (cap_ == 0 || (cur_ == static_cast<size_t>(txt_ - buf_) && !at_bob()))
+      {
+        if (!hit_end() && (txt_ + len_ < buf_ + end_ || peek() != EOF))
+        {
+          ++len_;
+          DBGLOG("Split continue: len = %zu", len_);
+          set_current(++cur_);
+          goto find;
+        }
+        if (got_ != Const::EOB)
+          cap_ = Const::EMPTY;
+        else
+          cap_ = 0;
+        set_current(end_);
+        got_ = Const::EOB;
+        DBGLOG("Split at eof: cap = %zu txt = '%s' len = %zu", cap_, std::string(txt_, len_).c_str(), len_);
+        DBGLOG("END FuzzyMatcher::match()");
+        return cap_;
+      }
+      if (cur_ == 0 && at_bob() && at_end())
+      {
+        cap_ = Const::EMPTY;
+        got_ = Const::EOB;
+      }
+      else
+      {
+        set_current(cur_);
+      }
+      DBGLOG("Split: txt = '%s' len = %zu", std::string(txt_, len_).c_str(), len_);
+      DBGLOG("END FuzzyMatcher::match()");
+      return cap_;
+    }
+    if (cap_ == 0)
+    {
+      if (method == Const::FIND && !at_end())
+      {
+        if (anc_)
+        {
+          cur_ = txt_ - buf_; // reset current to pattern start when a word boundary was encountered
+          anc_ = false;
+        }
+        // fuzzy search with find() can safely advance on a single prefix char of the regex
+        if (pos_ > cur_)
+        {
+          // this part is based on advance() in matcher.cpp, limited to advancing ahead till the one of the first pattern char(s) match
+          size_t loc = cur_ + 1;
+          if (pat_->len_ == 0)
+          {
+            if (pat_->min_ > 0)
+            {
+              const Pattern::Pred *pma = pat_->pma_;
+              while (true)
+              {
+                const char *s = buf_ + loc;
+                const char *e = buf_ + end_;
+                while (s < e && (pma[static_cast<uint8_t>(*s)] & 0xc0) == 0xc0)
+                  ++s;
+                if (s < e)
+                {
+                  loc = s - buf_;
+                  set_current(loc);
+                  goto scan;
+                }
+                loc = e - buf_;
+                set_current_match(loc - 1);
+                peek_more();
+                loc = cur_ + 1;
+                if (loc >= end_)
+                  break;
+              }
+            }
+          }
+          else
+          {
+            while (true)
+            {
+              if (seeds)
+                loc = seek(loc);
+              const char *s = buf_ + loc;
+              const char *e = buf_ + end_;
+              s = static_cast<const char*>(std::memchr(s, *pat_->pre_, e - s));
+              if (s != nullptr)
+              {
+                loc = s - buf_;
+                set_current(loc);
+                goto scan;
+              }
+              loc = e - buf_;
+              set_current_match(loc - 1);
+              peek_more();
+              loc = cur_ + 1;
+              if (loc + pat_->len_ > end_)
+                break;
+            }
+          }
+        }
+        txt_ = buf_ + cur_;
+      }
+      else
+      {
+        // no match: backup to begin of unmatched text
+        cur_ = txt_ - buf_;
+      }
+    }
+    len_ = cur_ - (txt_ - buf_);
+    if (len_ == 0 && !nul)
+    {
+      DBGLOG("Empty or no match cur = %zu pos = %zu end = %zu", cur_, pos_, end_);
+      pos_ = cur_;
+      if (at_end())
+      {
+        set_current(cur_);
+        DBGLOG("Reject empty match at EOF");
+        cap_ = 0;
+      }
+      else if (method == Const::FIND)
+      {
+        DBGLOG("Reject empty match and continue?");
+        // skip one char to keep searching
+        set_current(++cur_);
+        // allow FIND with "N" to match an empty line, with ^$ etc.
+        if (cap_ == 0 || !opt_.N || (!bol && (c1 == '\n' || (c1 == '\r' && peek() == '\n'))))
+          goto scan;
+        DBGLOG("Accept empty match");
+      }
+      else
+      {
+        set_current(cur_);
+        DBGLOG("Reject empty match");
+        cap_ = 0;
+      }
+    }
+    else if (len_ == 0 && cur_ == end_)
+    {
+      DBGLOG("Hit end: got = %d", got_);
+      if (cap_ == Const::REDO && !opt_.A)
+        cap_ = 0;
+    }
+    else
+    {
+      set_current(cur_);
+      if (len_ > 0 && cap_ == Const::REDO && !opt_.A)
+      {
+        DBGLOG("Ignore accept and continue: len = %zu", len_);
+        len_ = 0;
+        if (method != Const::MATCH)
+          goto scan;
+        cap_ = 0;
+      }
+    }
+    DBGLOG("Return: cap = %zu txt = '%s' len = %zu pos = %zu got = %d", cap_, std::string(txt_, len_).c_str(), len_, pos_, got_);
+    DBGLOG("END match()");
+    return cap_;
+  }
+  std::vector<BacktrackPoint> bpt_; ///< vector of backtrack points, max_ size
+  uint8_t max_;                     ///< max errors
+  uint8_t err_;                     ///< accumulated edit distance (not guaranteed minimal)
+  bool ins_;                        ///< fuzzy match inserted chars (extra chars)
+  bool del_;                        ///< fuzzy match deleted chars (missing chars)
+  bool sub_;                        ///< fuzzy match substituted chars
+  BitParallel bpn_;                 ///< bit-parallel NFA to search for a string pattern
+  Pigeonhole phf_;                  ///< pigeonhole filter to search for the pattern prefix
+  std::vector<uint8_t> rmx_;        ///< max errors per rule (accept index), 0xFF when not limited
+};
+
+} // namespace reflex
+
+#endif
@@ -44,7 +44,14 @@
 #include <cwchar>
 #include <cassert>
 #include <iostream>
+#include <memory>
 #include <string>
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view>
+#ifndef HAVE_STRING_VIEW
+#define HAVE_STRING_VIEW
+#endif
+#endif
 
 #if defined(HAVE_AVX512BW)
 # include <immintrin.h>
@@ -89,6 +96,19 @@ sequence of characters:
   automatically to an UTF-8 character sequence when reading the file with
   get(). Also, size() gives the content size in the number of UTF-8 bytes.
 
+- `bool Input::map();` memory-maps a `FILE*` source that is a regular file
+  with plain or UTF-8 content. A matcher scans a memory-mapped input in place
+  without copying the content into its buffer and without growing the buffer.
+  The mapping is private copy-on-write, so matchers may modify the mapped data
+  (e.g. to 0-terminate text()) without changing the file. The mapping is
+  released when the last copy of the input object is destroyed or cleared.
+  Returns false and keeps reading the `FILE*` on systems without POSIX `mmap()`.
+
+- An input object may be constructed from a `std::shared_ptr<Input::Source>`
+  to read input provided by another object.  For example, `ReadAhead::input()`
+  in reflex/readahead.h reads a `FILE*` or `std::istream` source ahead in a
+  background thread while a matcher consumes the input.
+
 - An input object can be reassigned a new source of input for reading at any
   time.
 
@@ -105,7 +125,12 @@ sequence of characters:
   not determinable). Use this function only before reading input with get().
   Wide character strings and UTF-16 `FILE*` content is counted as the total
   number of UTF-8 bytes that will be produced by get(). The size of a
-  `std::istream` cannot be determined.
+  `std::istream` cannot be determined.  The size is computed on demand when
+  size() is called.
+
+- `size_t Input::size_hint();` returns a lower bound of size() without reading
+  the source input, e.g. the number of code units of a UTF-16/32 or code page
+  `FILE*`.  AbstractMatcher::buffer() uses the hint to size its buffer.
 
 - `bool Input::good();` returns true if the input is readable and has no
   EOF or error state.  Returns false on EOF or if an error condition is
@@ -290,7 +315,7 @@ With reflex::BufferedInput::streambuf to create a buffered std::istream:
 class Input {
  public:
   /// Input type
-  enum struct input_type_enum : unsigned char {NIL,FILE_P,STD_ISTREAM_P,CCHAR_P,CWCHAR_P};
+  enum struct input_type_enum : unsigned char {NIL,FILE_P,STD_ISTREAM_P,CCHAR_P,CWCHAR_P,MMAP_P,SOURCE_P};
   /// Common file_encoding constants.
   enum struct file_encoding : unsigned char  {
     plain, ///< plain octets: 7-bit ASCII, 8-bit binary or UTF-8 without BOM detected
@@ -335,6 +360,16 @@ class Input {
   };
   /// FILE* handler functor base class to handle FILE* errors and non-blocking FILE* reads
   struct Handler { virtual int operator()() = 0; };
+  /// Source base class to read input provided by another object, e.g. reflex::ReadAhead in reflex/readahead.h.
+  struct Source {
+    virtual ~Source() { }
+    /// Copy input data into buffer, returns the nonzero number of (less or equal to n) bytes added or zero when EOF, an error occurred, or no data is available yet.
+    virtual size_t get(char *s, size_t n) = 0;
+    /// Check if input is available, i.e. no EOF or error state.
+    virtual bool good() const = 0;
+    /// Check if input reached EOF.
+    virtual bool eof() const = 0;
+  };
   /// Stream buffer for reflex::Input, derived from std::streambuf.
   class streambuf;
   /// Stream buffer for reflex::Input to read DOS files, replaces CRLF by LF, derived from std::streambuf.
@@ -354,7 +389,9 @@ class Input {
       ulen_(input.ulen_),
       utfx_(input.utfx_),
       page_(input.page_),
-      handler_(input.handler_)
+      handler_(input.handler_),
+      map_(input.map_),
+      src_(input.src_)
   {
     std::memcpy(utf8_, input.utf8_, sizeof(utf8_));
   }
@@ -383,6 +420,15 @@ class Input {
   {
     init();
   }
+#if defined(HAVE_STRING_VIEW)
+  /// Construct input character sequence from a std::string_view.
+  Input(std::string_view view) ///< input string view
+    :
+      Input(view.data(),view.size())
+  {
+    init();
+  }
+#endif
   /// Construct input character sequence from a wchar_t* string
   Input(
       const wchar_t *wstring, ///< wchar_t string
@@ -423,7 +469,9 @@ class Input {
       file_encoding         enc,         ///< file_encoding (when UTF BOM is not present)
       const unsigned short *page = nullptr) ///< code page for file_encoding::custom
     :
-      Input(file)
+      input_type_(input_type_enum::FILE_P),
+      underlying_input_(file),
+      size_(0)
   {
     init(enc);
     if (get_file_encoding() == file_encoding::plain)
@@ -438,6 +486,15 @@ class Input {
   {
     init();
   }
+  /// Construct input character sequence read from a source object shared by copies of this Input.
+  Input(const std::shared_ptr<Source>& source) ///< input source
+    :
+      input_type_(source ? input_type_enum::SOURCE_P : input_type_enum::NIL),
+      size_(0),
+      src_(source)
+  {
+    init();
+  }
   /// Copy assignment operator.
   Input& operator=(const Input& input)
   {
@@ -449,6 +506,8 @@ class Input {
     utfx_ = input.utfx_;
     page_ = input.page_;
     handler_ = input.handler_;
+    map_ = input.map_;
+    src_ = input.src_;
     std::memcpy(utf8_, input.utf8_, sizeof(utf8_));
     return *this;
   }
@@ -514,12 +573,37 @@ class Input {
     assert(input_type_==input_type_enum::STD_ISTREAM_P);
     return underlying_input_.istream_;
   }
+  /// Memory-map the remaining FILE* input to read it without copying, when the FILE* is a regular file with plain or UTF-8 content (the FILE* may be closed afterwards).
+  bool map()
+    /// @returns true if the FILE* input was mapped and this Input object is now a memory-mapped input
+    ;
+  /// Check if this Input object is a memory-mapped input, see Input::map().
+  bool mapped() const
+    /// @returns true if this Input object is a memory-mapped input
+  {
+    return input_type_==input_type_enum::MMAP_P;
+  }
+  /// Get the remaining memory-mapped input of size() bytes, followed by a writable zero byte, returns nullptr when this Input is not memory-mapped.
+  char *mapped_data() const
+    /// @returns pointer to the remaining memory-mapped data (private copy-on-write pages that may be modified in place) or nullptr
+  {
+    if (input_type_ != input_type_enum::MMAP_P)
+      return nullptr;
+    return const_cast<char*>(underlying_input_.cstring_);
+  }
+  /// Check if this Input object is a char* string, a std::string, or a std::string_view.
+  bool is_cstring() const
+    /// @returns true if this Input object is a string
+  {
+    return input_type_==input_type_enum::CCHAR_P;
+  }
   /// Get the size of the input character sequence in number of ASCII/UTF-8 bytes (zero if size is not determinable from a `FILE*` or `std::istream` source).
   size_t size()
     /// @returns the nonzero number of ASCII/UTF-8 bytes available to read, or zero when source is empty or if size is not determinable e.g. when reading from standard input
   {
     switch(input_type_){
       case input_type_enum::CCHAR_P :
+      case input_type_enum::MMAP_P :
         return size_;
       case input_type_enum::CWCHAR_P :
         if (size_ == 0)
@@ -537,6 +621,14 @@ class Input {
         return size_;
     }
   }
+  /// Get a lower bound of the size of the input character sequence in number of ASCII/UTF-8 bytes without reading the input, unlike size() that reads a `FILE*` with a UTF-16/32 or code page encoding to count the UTF-8 bytes.
+  size_t size_hint()
+    /// @returns the number of ASCII/UTF-8 bytes that are at least available to read, or zero when source is empty or the size is not cheaply determinable
+  {
+    if (input_type_ == input_type_enum::FILE_P && size_ == 0 && utfx_ != file_encoding::plain && utfx_ != file_encoding::utf8)
+      return file_size_hint();
+    return size();
+  }
   /// Check if this Input object was assigned a character sequence.
   bool assigned() const
     /// @returns true if this Input object was assigned (not default constructed or cleared)
@@ -548,6 +640,8 @@ class Input {
   {
     input_type_=input_type_enum::NIL;
     size_ = 0;
+    map_.reset();
+    src_.reset();
   }
   /// Check if input is available.
   bool good() const
@@ -555,6 +649,7 @@ class Input {
   {
     switch(input_type_){
       case input_type_enum::CCHAR_P :
+      case input_type_enum::MMAP_P :
         return size_ > 0;
       case input_type_enum::CWCHAR_P :
         return *(underlying_input_.wstring_) != L'\0';
@@ -562,6 +657,8 @@ class Input {
         return !::feof(underlying_input_.file_) && !::ferror(underlying_input_.file_);
       case input_type_enum::STD_ISTREAM_P :
         return (underlying_input_.istream_)->good();
+      case input_type_enum::SOURCE_P :
+        return src_->good();
       default :
         return false;
     }
@@ -572,6 +669,7 @@ class Input {
   {
     switch(input_type_){
       case input_type_enum::CCHAR_P :
+      case input_type_enum::MMAP_P :
         return size_ == 0;
       case input_type_enum::CWCHAR_P :
         return *(underlying_input_.wstring_) == L'\0';
@@ -579,6 +677,8 @@ class Input {
         return ::feof(underlying_input_.file_) != 0;
       case input_type_enum::STD_ISTREAM_P :
         return (underlying_input_.istream_)->eof();
+      case input_type_enum::SOURCE_P :
+        return src_->eof();
       default :
         return true;
     }
@@ -598,7 +698,8 @@ class Input {
     /// @returns the nonzero number of (less or equal to n) 8-bit characters added to buffer s from the current input, or zero when EOF
   {
     switch(input_type_){
-      case input_type_enum::CCHAR_P : {
+      case input_type_enum::CCHAR_P :
+      case input_type_enum::MMAP_P : {
         size_t k = size_;
         if (k > n)
           k = n;
@@ -653,7 +754,7 @@ class Input {
             if (k < l)
             {
               uidx_ = static_cast<unsigned short>(k);
-              ulen_ = static_cast<unsigned short>(l);
+              ulen_ = static_cast<unsigned short>(l - k);
               std::memcpy(s, utf8_, k);
               s += k;
               k = 0;
@@ -685,6 +786,8 @@ class Input {
           size_ -= k;
         return k;
       }
+      case input_type_enum::SOURCE_P :
+        return src_->get(s, n);
       default :
         return 0;
     }
@@ -716,6 +819,8 @@ class Input {
   void wstring_size();
   /// Called by size() for a FILE*.
   void file_size();
+  /// Called by size_hint() for a FILE* with a UTF-16/32 or code page encoding.
+  size_t file_size_hint();
   /// Called by size() for a std::istream.
   void istream_size();
   /// Implements get() on a FILE*.
@@ -728,6 +833,12 @@ class Input {
   {
     handler_ = handler;
   }
+  /// Get FILE* handler
+  Handler *get_handler() const
+    /// @returns the FILE* handler or nullptr
+  {
+    return handler_;
+  }
  protected:
   input_type_enum         input_type_ = input_type_enum::NIL;
   union underlying_input_union_{
@@ -748,6 +859,8 @@ class Input {
   file_encoding    utfx_=file_encoding::plain;    ///< file_encoding
   const unsigned short *page_=nullptr;    ///< custom code page
   Handler              *handler_=nullptr; ///< to handle FILE* errors and non-blocking FILE* reads
+  std::shared_ptr<void> map_;       ///< memory-mapped file region shared by copies of this Input, unmapped when the last copy is destroyed
+  std::shared_ptr<Source> src_;     ///< input source shared by copies of this Input
 };
 
 /// Stream buffer for reflex::Input, derived from std::streambuf.
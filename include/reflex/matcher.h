@@ -39,7 +39,11 @@
 
 #include <reflex/absmatcher.h>
 #include <reflex/pattern.h>
-#include <stack>
+
+#if defined(__GNUC__) && !defined(WITH_NO_COMPUTED_GOTO)
+// dispatch opcodes in Matcher::match() with computed goto (GCC and Clang "labels as values")
+# define REFLEX_COMPUTED_GOTO
+#endif
 
 namespace reflex {
 
@@ -87,6 +91,38 @@ class Matcher : public PatternMatcher<reflex::Pattern> {
   {
     reset(opt);
   }
+  /// Construct matcher engine from a reference-counted pattern shared by matchers, and an input character sequence.
+  Matcher(
+      const std::shared_ptr<const Pattern>& pattern,         ///< shared reflex::Pattern
+      const Input&                          input = Input(), ///< input character sequence for this matcher
+      const char                           *opt = nullptr)      ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*`
+    :
+      PatternMatcher<reflex::Pattern>(pattern, input, opt)
+  {
+    reset(opt);
+  }
+  /// Construct matcher engine from a pattern, and an input character sequence, borrows the given buffer to read input into instead of allocating a buffer.
+  Matcher(
+      const Pattern& pattern,        ///< a reflex::Pattern
+      const Input&   input,          ///< input character sequence for this matcher
+      const Buffer&  buffer,         ///< buffer borrowed by this matcher
+      const char    *opt = nullptr)  ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*`
+    :
+      PatternMatcher<reflex::Pattern>(pattern, input, buffer, opt)
+  {
+    reset(opt);
+  }
+  /// Construct matcher engine from a reference-counted pattern shared by matchers, and an input character sequence, borrows the given buffer to read input into instead of allocating a buffer.
+  Matcher(
+      const std::shared_ptr<const Pattern>& pattern,        ///< shared reflex::Pattern
+      const Input&                          input,          ///< input character sequence for this matcher
+      const Buffer&                         buffer,         ///< buffer borrowed by this matcher
+      const char                           *opt = nullptr)  ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*`
+    :
+      PatternMatcher<reflex::Pattern>(pattern, input, buffer, opt)
+  {
+    reset(opt);
+  }
   /// Construct matcher engine from a string regex, and an input character sequence.
   Matcher(
       const std::string& pattern,         ///< a reflex::Pattern or a string regex for this matcher
@@ -105,9 +141,7 @@ class Matcher : public PatternMatcher<reflex::Pattern> {
       tab_(matcher.tab_)
   {
     DBGLOG("Matcher::Matcher(matcher)");
-    bmd_ = matcher.bmd_;
-    if (bmd_ != 0)
-      std::memcpy(bms_, matcher.bms_, sizeof(bms_));
+    cnd_ = 0;
   }
   /// Assign a matcher.
   Matcher& operator=(const Matcher& matcher) ///< matcher to copy
@@ -115,9 +149,7 @@ class Matcher : public PatternMatcher<reflex::Pattern> {
     PatternMatcher<reflex::Pattern>::operator=(matcher);
     ded_ = matcher.ded_;
     tab_ = matcher.tab_;
-    bmd_ = matcher.bmd_;
-    if (bmd_ != 0)
-      std::memcpy(bms_, matcher.bms_, sizeof(bms_));
+    cnd_ = 0;
     return *this;
   }
   /// Polymorphic cloning.
@@ -132,7 +164,7 @@ class Matcher : public PatternMatcher<reflex::Pattern> {
     PatternMatcher<reflex::Pattern>::reset(opt);
     ded_ = 0;
     tab_.resize(0);
-    bmd_ = 0;
+    cnd_ = 0;
   }
   /// Returns captured text as a std::pair<const char*,size_t> with string pointer (non-0-terminated) and length.
   virtual std::pair<const char*,size_t> operator[](size_t n) const
@@ -153,6 +185,35 @@ class Matcher : public PatternMatcher<reflex::Pattern> {
   {
     return std::pair<size_t,const char*>(0, nullptr);
   }
+  /// A token record stored by scan_batch().
+  struct Token {
+    size_t accept; ///< the accept() value of the token
+    size_t offset; ///< position of the token in the input, the same as first()
+    size_t size;   ///< length of the token in bytes
+    size_t lineno; ///< line number of the token when requested, or zero
+  };
+  typedef std::vector<Token> TokenBuffer; ///< caller-owned buffer of token records
+  /// Scan input for up to max tokens without returning to the caller for each token, appending the token records to the token buffer.
+  size_t scan_batch(
+      TokenBuffer& tokens,         ///< token buffer to append the token records to
+      size_t       max,            ///< maximum number of tokens to scan
+      bool         lines = false)  ///< also store the line number of each token
+    /// @returns the number of tokens appended, which is less than max when the end of the input is reached or when no token matches
+    /// @note with FILE* or stream input the buffer may shift while scanning a batch, use buffer() to buffer all input first when the text of the tokens is needed, or obtain the text from the input data with the token offsets
+  {
+    size_t n = 0;
+    while (n < max)
+    {
+      // call this Matcher's match() directly instead of the virtual AbstractMatcher::match() so the DFA loop is inlined
+      size_t cap = Matcher::match(Const::SCAN);
+      if (cap == 0)
+        break;
+      Token token = { cap, first(), size(), lines ? lineno() : 0 };
+      tokens.push_back(token);
+      ++n;
+    }
+    return n;
+  }
   /// Returns the position of the last indent stop.
   size_t last_stop()
   {
@@ -215,14 +276,12 @@ class Matcher : public PatternMatcher<reflex::Pattern> {
   /// Push current indent stops and clear current indent stops.
   void push_stops()
   {
-    stk_.push(std::vector<size_t>());
-    stk_.top().swap(tab_);
+    stk_.push(tab_);
   }
   /// Pop indent stops.
   void pop_stops()
   {
-    stk_.top().swap(tab_);
-    stk_.pop();
+    stk_.pop(tab_);
   }
   /// FSM code INIT.
   inline void FSM_INIT(int& c1)
@@ -262,12 +321,14 @@ class Matcher : public PatternMatcher<reflex::Pattern> {
   /// FSM code REDO.
   inline void FSM_REDO()
   {
+    REFLEX_STAT(++sts_.redos);
     cap_ = Const::REDO;
     cur_ = pos_;
   }
   /// FSM code REDO.
   inline void FSM_REDO(int c1)
   {
+    REFLEX_STAT(++sts_.redos);
     cap_ = Const::REDO;
     cur_ = pos_;
     if (c1 != EOF)
@@ -364,13 +425,13 @@ class Matcher : public PatternMatcher<reflex::Pattern> {
   inline bool FSM_META_EWB()
   {
     anc_ = true;
-    return isword(got_) && !isword(static_cast<unsigned char>(txt_[len_]));
+    return isword(got_) && !isword(end_char());
   }
   /// FSM code META BWB.
   inline bool FSM_META_BWB()
   {
     anc_ = true;
-    return !isword(got_) && (opt_.W || isword(static_cast<unsigned char>(txt_[len_])));
+    return !isword(got_) && (opt_.W || isword(end_char()));
   }
   /// FSM code META NWE.
   inline bool FSM_META_NWE(int c0, int c1)
@@ -382,10 +443,29 @@ class Matcher : public PatternMatcher<reflex::Pattern> {
   inline bool FSM_META_NWB()
   {
     anc_ = true;
-    return isword(got_) == isword(static_cast<unsigned char>(txt_[len_]));
+    return isword(got_) == isword(end_char());
   }
  protected:
   typedef std::vector<size_t> Stops; ///< indent margin/tab stops
+  /// Stack of indent margin/tab stops, does not allocate until used and keeps the stops popped to reuse their storage when pushing again.
+  struct StopsStack {
+    StopsStack() : len(0) { }
+    /// Push stops and clear them.
+    void push(Stops& tab)
+    {
+      if (len == stops.size())
+        stops.push_back(Stops());
+      stops[len++].swap(tab);
+      tab.clear();
+    }
+    /// Pop stops.
+    void pop(Stops& tab)
+    {
+      stops[--len].swap(tab);
+    }
+    std::vector<Stops> stops; ///< pushed stops, followed by stops popped to reuse
+    size_t             len;   ///< number of stops pushed
+  };
   /// FSM data for FSM code
   struct FSM {
     FSM() : bol(), nul(), c1() { }
@@ -398,12 +478,15 @@ class Matcher : public PatternMatcher<reflex::Pattern> {
     /// @returns nonzero if input matched the pattern
   {
     DBGLOG("BEGIN Matcher::match()");
-    bool tail_=false;
     reset_text();
     len_ = 0; // split text length starts with 0
     anc_ = false; // no word boundary anchor found and applied
+    dry_ = false; // no input ran dry with option S
+    if (pat_->one_ && pat_->len_ > 0 && (method == Const::FIND || method == Const::SPLIT) && !opt_.S)
+      return match_one(method);
 scan:
     txt_ = buf_ + cur_;
+    int got = got_; // last char before this match, to rewind to when the input runs dry
 #if !defined(WITH_NO_INDENT)
     mrk_ = false;
     ind_ = pos_; // ind scans input in buf[] in newline() up to pos - 1
@@ -417,6 +500,7 @@ find:
 #if !defined(WITH_NO_INDENT)
 redo:
 #endif
+    REFLEX_STAT(sts_.lap_resets += !lap_.empty());
     lap_.resize(0);
     cap_ = 0;
     bool nul = method == Const::MATCH;
@@ -429,65 +513,203 @@ redo:
       nul = fsm_.nul;
       c1 = fsm_.c1;
     }
+    else if (!pat_->dtt_.empty() || pat_->nfa_)
+    {
+      // dense transition table or lazy DFA with the same row layout: one table lookup per input byte
+      const Pattern::Index *dtt = pat_->nfa_ ? lzy_.start(pat_) : &pat_->dtt_[0];
+      const uint8_t *dcl = pat_->nfa_ ? lzy_.classes() : pat_->dcl_;
+      Pattern::Index row = 0;
+      while (true)
+      {
+        Pattern::Index info = dtt[row];
+        if ((info & Pattern::Const::DNEW) != 0)
+        {
+          // lazy DFA: construct the transitions of this state when first reached
+          row = lzy_.expand(row);
+          dtt = lzy_.rows();
+          info = dtt[row];
+        }
+        DBGLOG("Dense: row = %u info = 0x%08X", row, info);
+        if ((info & Pattern::Const::DRDO) != 0)
+        {
+          REFLEX_STAT(++sts_.redos);
+          cap_ = Const::REDO;
+          cur_ = pos_;
+          DBGLOG("Redo");
+        }
+        else if ((info & Pattern::Const::DACC) != 0)
+        {
+          cap_ = info & Pattern::Const::DACC;
+          cur_ = pos_;
+          DBGLOG("Take: cap = %zu", cap_);
+        }
+        if ((info & Pattern::Const::DEND) != 0 || c1 == EOF)
+          break;
+        c1 = get();
+        DBGLOG("Get: c1 = %d", c1);
+        if (c1 == EOF)
+          break;
+        row = dtt[row + 1 + dcl[c1]];
+        if (row == 0)
+        {
+          // loop back to start state after only one char matched (one transition) but w/o full match, then optimize
+          if (cap_ == 0 && pos_ == cur_ + 1 && method == Const::FIND)
+            cur_ = pos_; // set cur_ to move forward from cur_ + 1 with FIND advance()
+        }
+        else if (row == Pattern::Const::IMAX)
+        {
+          break;
+        }
+      }
+    }
+    else if (!pat_->opn_.empty())
+    {
+      // narrow opcode table: one byte class lookup per input byte to select the transition of the state, transitions are in descending class order
+      const Pattern::Opcode16 *opn = &pat_->opn_[0];
+      const Pattern::Opcode16 *off = opn + 5 + opn[4];
+      const uint8_t *dcl = pat_->dcl_;
+      Pattern::Index shift = 16 - opn[0];
+      Pattern::Index halt = (1U << shift) - 1;
+      Pattern::Index start = opn[1];
+      Pattern::Index finals = opn[2];
+      Pattern::Index state = start;
+      while (true)
+      {
+        const Pattern::Opcode16 *pc = opn + off[state];
+        DBGLOG("Narrow: state = %u", state);
+        if (state < finals)
+        {
+          Pattern::Index info = *pc++;
+          if (info == Pattern::Const::NRDO)
+          {
+            REFLEX_STAT(++sts_.redos);
+            cap_ = Const::REDO;
+            cur_ = pos_;
+            DBGLOG("Redo");
+          }
+          else
+          {
+            cap_ = info;
+            cur_ = pos_;
+            DBGLOG("Take: cap = %zu", cap_);
+          }
+        }
+        // a dead end state halts on all bytes with one transition
+        if (*pc == halt || c1 == EOF)
+          break;
+        c1 = get();
+        DBGLOG("Get: c1 = %d", c1);
+        if (c1 == EOF)
+          break;
+        Pattern::Index k = static_cast<Pattern::Index>(dcl[c1]) << shift | halt;
+        while (*pc > k)
+          ++pc;
+        state = *pc & halt;
+        if (state == start)
+        {
+          // loop back to start state after only one char matched (one transition) but w/o full match, then optimize
+          if (cap_ == 0 && pos_ == cur_ + 1 && method == Const::FIND)
+            cur_ = pos_; // set cur_ to move forward from cur_ + 1 with FIND advance()
+        }
+        else if (state == halt)
+        {
+          break;
+        }
+      }
+    }
     else if (pat_->opc_ != nullptr)
     {
       const Pattern::Opcode *pc = pat_->opc_;
+      // opcodes pre-decoded by the pattern into dispatch kinds, or decoded when fetched from an opcode table without size
+      const uint8_t *dsp = pat_->dsp_.empty() ? nullptr : &pat_->dsp_[0];
+#if defined(REFLEX_COMPUTED_GOTO)
+      static const void *const dispatch[] = {
+        &&code_goto,
+        &&code_halt,
+        &&code_take,
+        &&code_take_goto,
+        &&code_redo,
+        &&code_tail,
+        &&code_head,
+        &&code_dent,
+        &&code_meta
+      };
+#endif
       while (true)
       {
         Pattern::Opcode opcode = *pc;
         DBGLOG("Fetch: code[%zu] = 0x%08X", pc - pat_->opc_, opcode);
-        if (!Pattern::is_opcode_goto(opcode))
+#if defined(REFLEX_COMPUTED_GOTO)
+        goto *dispatch[dsp != nullptr ? dsp[pc - pat_->opc_] : Pattern::dispatch_of(opcode)];
+#else
+        switch (dsp != nullptr ? dsp[pc - pat_->opc_] : Pattern::dispatch_of(opcode))
         {
-          switch (opcode >> 24)
-          {
-            case 0xFE: // TAKE
-              cap_ = Pattern::long_index_of(opcode);
-              cur_ = pos_;
-              ++pc;
-              DBGLOG("Take: cap = %zu", cap_);
-              continue;
-            case 0xFD: // REDO
-              cap_ = Const::REDO;
-              DBGLOG("Redo");
-              cur_ = pos_;
-              ++pc;
-              continue;
-            case 0xFC: // TAIL
-            {
-              Pattern::Lookahead la = Pattern::lookahead_of(opcode);
-              DBGLOG("Tail: %u", la);
-              if (lap_.size() > la && lap_[la] >= 0)
-                cur_ = txt_ - buf_ + static_cast<size_t>(lap_[la]); // mind the (new) gap
-              ++pc;
-              tail_=true;
-              continue;
-            }
-            case 0xFB: // HEAD
-            {
-              Pattern::Lookahead la = Pattern::lookahead_of(opcode);
-              DBGLOG("Head: lookahead[%u] = %zu", la, pos_ - (txt_ - buf_));
-              if (lap_.size() <= la)
-                lap_.resize(la + 1, -1);
-              lap_[la] = static_cast<int>(pos_ - (txt_ - buf_)); // mind the gap
-              ++pc;
-              continue;
-            }
+          case Pattern::DISPATCH_GOTO:      goto code_goto;
+          case Pattern::DISPATCH_HALT:      goto code_halt;
+          case Pattern::DISPATCH_TAKE:      goto code_take;
+          case Pattern::DISPATCH_TAKE_GOTO: goto code_take_goto;
+          case Pattern::DISPATCH_REDO:      goto code_redo;
+          case Pattern::DISPATCH_TAIL:      goto code_tail;
+          case Pattern::DISPATCH_HEAD:      goto code_head;
+          case Pattern::DISPATCH_DENT:      goto code_dent;
+          default:                          goto code_meta;
+        }
+#endif
+code_take:
+        cap_ = Pattern::long_index_of(opcode);
+        cur_ = pos_;
+        ++pc;
+        DBGLOG("Take: cap = %zu", cap_);
+        continue;
+code_take_goto:
+        cap_ = Pattern::long_index_of(opcode);
+        cur_ = pos_;
+        opcode = *++pc;
+        DBGLOG("Take: cap = %zu", cap_);
+        goto code_goto;
+code_redo:
+        REFLEX_STAT(++sts_.redos);
+        cap_ = Const::REDO;
+        DBGLOG("Redo");
+        cur_ = pos_;
+        ++pc;
+        continue;
+code_tail:
+        {
+          Pattern::Lookahead la = Pattern::lookahead_of(opcode);
+          DBGLOG("Tail: %u", la);
+          if (lap_.size() > la && lap_[la] >= 0)
+            cur_ = txt_ - buf_ + static_cast<size_t>(lap_[la]); // mind the (new) gap
+          ++pc;
+          continue;
+        }
+code_head:
+        {
+          Pattern::Lookahead la = Pattern::lookahead_of(opcode);
+          DBGLOG("Head: lookahead[%u] = %zu", la, pos_ - (txt_ - buf_));
+          if (lap_.size() <= la)
+            lap_.resize(la + 1, -1);
+          lap_[la] = static_cast<int>(pos_ - (txt_ - buf_)); // mind the gap
+          ++pc;
+          continue;
+        }
+code_dent:
 #if !defined(WITH_NO_INDENT)
-            case Pattern::META_DED - Pattern::META_MIN:
-              if (ded_ > 0)
-              {
-                Pattern::Index jump = Pattern::index_of(opcode);
-                if (jump == Pattern::Const::LONG)
-                  jump = Pattern::long_index_of(pc[1]);
-                DBGLOG("Dedent ded = %zu", ded_); // unconditional dedent matching \j
-                nul = true;
-                pc = pat_->opc_ + jump;
-                continue;
-              }
+        if (ded_ > 0)
+        {
+          Pattern::Index jump = Pattern::index_of(opcode);
+          if (jump == Pattern::Const::LONG)
+            jump = Pattern::long_index_of(pc[1]);
+          DBGLOG("Dedent ded = %zu", ded_); // unconditional dedent matching \j
+          nul = true;
+          pc = pat_->opc_ + jump;
+          continue;
+        }
 #endif
-          }
-          if (c1 == EOF)
-            break;
+code_meta:
+        if (c1 == EOF)
+          break;
+        {
           int c0 = c1;
           c1 = get();
           DBGLOG("Get: c1 = %d", c1);
@@ -509,6 +731,7 @@ redo:
                   DBGLOG("Take: cap = %zu", cap_);
                   continue;
                 case 0xFD: // REDO
+                  REFLEX_STAT(++sts_.redos);
                   cap_ = Const::REDO;
                   DBGLOG("Redo");
                   cur_ = pos_;
@@ -523,7 +746,6 @@ redo:
                   if (lap_.size() > la && lap_[la] >= 0)
                     cur_ = txt_ - buf_ + static_cast<size_t>(lap_[la]); // mind the (new) gap
                   opcode = *++pc;
-                  tail_=true;
                   continue;
                 }
                 case 0xFB: // HEAD
@@ -631,7 +853,7 @@ redo:
                   DBGLOG("EWB? %d", at_eow());
                   anc_ = true;
                   if (jump == Pattern::Const::IMAX && isword(got_) &&
-                      !isword(static_cast<unsigned char>(txt_[len_])))
+                      !isword(end_char()))
                   {
                     jump = Pattern::index_of(opcode);
                     if (jump == Pattern::Const::LONG)
@@ -643,7 +865,7 @@ redo:
                   DBGLOG("BWB? %d", at_bow());
                   anc_ = true;
                   if (jump == Pattern::Const::IMAX && !isword(got_) &&
-                      (opt_.W || isword(static_cast<unsigned char>(txt_[len_]))))
+                      (opt_.W || isword(end_char())))
                   {
                     jump = Pattern::index_of(opcode);
                     if (jump == Pattern::Const::LONG)
@@ -666,7 +888,7 @@ redo:
                   DBGLOG("NWB? %d %d", at_bow(), at_eow());
                   anc_ = true;
                   if (jump == Pattern::Const::IMAX &&
-                      isword(got_) == isword(static_cast<unsigned char>(txt_[len_])))
+                      isword(got_) == isword(end_char()))
                   {
                     jump = Pattern::index_of(opcode);
                     if (jump == Pattern::Const::LONG)
@@ -695,20 +917,20 @@ redo:
             opcode = *pc;
             jump = Pattern::Const::IMAX;
           }
-          if (c1 == EOF)
-            break;
-        }
-        else
-        {
-          if (Pattern::is_opcode_halt(opcode))
-            break;
-          if (c1 == EOF)
-            break;
-          c1 = get();
-          DBGLOG("Get: c1 = %d", c1);
-          if (c1 == EOF)
-            break;
         }
+        if (c1 == EOF)
+          break;
+        goto code_scan;
+code_halt:
+        break;
+code_goto:
+        if (c1 == EOF)
+          break;
+        c1 = get();
+        DBGLOG("Get: c1 = %d", c1);
+        if (c1 == EOF)
+          break;
+code_scan:
         Pattern::Opcode lo = c1 << 24;
         Pattern::Opcode hi = lo | 0x00FFFFFF;
 unrolled:
@@ -761,6 +983,18 @@ unrolled:
         pc = pat_->opc_ + jump;
       }
     }
+    REFLEX_STAT(sts_.scanned += pos_ - (txt_ - buf_));
+rewind:
+    if (dry_)
+    {
+      // option S: the input ran dry, rewind to the start of this match to retry when more input is available
+      DBGLOG("Suspend at txt-buf = %zu", txt_ - buf_);
+      pos_ = cur_ = txt_ - buf_;
+      got_ = got;
+      len_ = 0;
+      DBGLOG("END Matcher::match()");
+      return cap_ = 0;
+    }
 #if !defined(WITH_NO_INDENT)
     if (mrk_ && cap_ != Const::REDO)
     {
@@ -811,10 +1045,13 @@ unrolled:
           set_current(++cur_);
           goto find;
         }
+        if (dry_)
+          goto rewind;
         if (got_ != Const::EOB)
           cap_ = Const::EMPTY;
         else
           cap_ = 0;
+        len_ = end_ - (txt_ - buf_); // include a partial match at the end, e.g. split "ab abc" by "abcd"
         set_current(end_);
         got_ = Const::EOB;
         DBGLOG("Split at eof: cap = %zu txt = '%s' len = %zu", cap_, std::string(txt_, len_).c_str(), len_);
@@ -823,6 +1060,8 @@ unrolled:
       }
       if (cur_ == 0 && at_bob() && at_end())
       {
+        if (dry_)
+          goto rewind; // option S: not at the end, the input ran dry
         cap_ = Const::EMPTY;
         got_ = Const::EOB;
       }
@@ -834,6 +1073,11 @@ unrolled:
       DBGLOG("END Matcher::match()");
       return cap_;
     }
+#if defined(WITH_MATCHER_STATS)
+    if (cnd_ != 0 && cap_ == 0)
+      ++(cnd_ == 1 ? sts_.bm_false : sts_.pm_false);
+    cnd_ = 0;
+#endif
     if (cap_ == 0)
     {
       if (method == Const::FIND && !at_end())
@@ -846,14 +1090,18 @@ unrolled:
         if (pos_ > cur_)
         {
           // we didn't fail on META alone
+#if defined(WITH_MATCHER_STATS)
+          if (advance_counted())
+#else
           if (advance())
+#endif
           {
             if (!pat_->one_)
               goto scan;
             len_ = pat_->len_;
             txt_ = buf_ + cur_;
             set_current(cur_ + len_);
-            return cap_ = 1;
+            return cap_ = pat_->one_;
           }
         }
         txt_ = buf_ + cur_;
@@ -865,57 +1113,50 @@ unrolled:
       }
     }
     len_ = cur_ - (txt_ - buf_);
-    if(!tail_)
+    if (len_ == 0 && !nul)
     {
-      if (len_ == 0 && !nul)
+      DBGLOG("Empty or no match cur = %zu pos = %zu end = %zu", cur_, pos_, end_);
+      pos_ = cur_;
+      if (at_end())
       {
-        DBGLOG("Empty or no match cur = %zu pos = %zu end = %zu", cur_, pos_, end_);
-        pos_ = cur_;
-        if (at_end())
-        {
-          set_current(cur_);
-          DBGLOG("Reject empty match at EOF");
-          cap_ = 0;
-        }
-        else if (method == Const::FIND)
-        {
-          DBGLOG("Reject empty match and continue?");
-          // skip one char to keep searching
-          set_current(++cur_);
-          // allow FIND with "N" to match an empty line, with ^$ etc.
-          if (cap_ == 0 || !opt_.N)
-            goto scan;
-          DBGLOG("Accept empty match");
-        }
-        else
-        {
-          set_current(cur_);
-          DBGLOG("Reject empty match");
-          cap_ = 0;
-        }
+        set_current(cur_);
+        DBGLOG("Reject empty match at EOF");
+        cap_ = 0;
       }
-      else if (len_ == 0 && cur_ == end_)
+      else if (method == Const::FIND)
       {
-        DBGLOG("Hit end: got = %d", got_);
-        if (cap_ == Const::REDO && !opt_.A)
-          cap_ = 0;
+        DBGLOG("Reject empty match and continue?");
+        // skip one char to keep searching
+        set_current(++cur_);
+        // allow FIND with "N" to match an empty line, with ^$ etc.
+        if (cap_ == 0 || !opt_.N)
+          goto scan;
+        DBGLOG("Accept empty match");
       }
       else
       {
         set_current(cur_);
-        if (len_ > 0 && cap_ == Const::REDO && !opt_.A)
-        {
-          DBGLOG("Ignore accept and continue: len = %zu", len_);
-          len_ = 0;
-          if (method != Const::MATCH)
-            goto scan;
-          cap_ = 0;
-        }
+        DBGLOG("Reject empty match");
+        cap_ = 0;
       }
     }
+    else if (len_ == 0 && cur_ == end_)
+    {
+      DBGLOG("Hit end: got = %d", got_);
+      if (cap_ == Const::REDO && !opt_.A)
+        cap_ = 0;
+    }
     else
     {
-      pos_=cur_;
+      set_current(cur_);
+      if (len_ > 0 && cap_ == Const::REDO && !opt_.A)
+      {
+        DBGLOG("Ignore accept and continue: len = %zu", len_);
+        len_ = 0;
+        if (method != Const::MATCH)
+          goto scan;
+        cap_ = 0;
+      }
     }
     DBGLOG("Return: cap = %zu txt = '%s' len = %zu pos = %zu got = %d", cap_, std::string(txt_, len_).c_str(), len_, pos_, got_);
     DBGLOG("END match()");
@@ -925,15 +1166,60 @@ unrolled:
   bool advance()
     /// @returns true if possible match found
     ;
+  /// FIND and SPLIT with a pattern that matches one string without meta chars and anchors, searches the string in the input without running the DFA.
+  size_t match_one(Method method) ///< Const::FIND or Const::SPLIT
+    /// @returns nonzero if the string was found or when SPLIT returns the text at the end of the input
+    ;
+#if defined(WITH_MATCHER_STATS)
+  /// Returns true if able to advance to next possible match, counts advance() calls, bytes skipped and prefilter hits.
+  inline bool advance_counted()
+    /// @returns true if possible match found
+  {
+    size_t loc = num_ + cur_;
+    bool found = advance();
+    ++sts_.advances;
+    sts_.skipped += num_ + cur_ - loc;
+    if (found)
+    {
+      ++(pat_->len_ > 0 ? sts_.bm_hits : sts_.pm_hits);
+      if (!pat_->one_)
+        cnd_ = pat_->len_ > 0 ? 1 : 2;
+    }
+    return found;
+  }
+#endif
+  /// Returns true if the input after the prefix of length len found at loc may match the rest of the pattern with min > 0 predicted chars.
+  inline bool predicted(
+      size_t loc, ///< location of the prefix found in the buffer
+      size_t len, ///< length of the prefix
+      size_t min) ///< minimum number of chars to predict after the prefix, or 0
+    /// @returns true if possible match predicted
+  {
+    if (min == 0)
+      return true;
+    bool ok;
+    if (min >= 4)
+      ok = loc + len + min > end_ || Pattern::predict_match(pat_->pmh_, &buf_[loc + len], min);
+    else
+      ok = loc + len + 4 > end_ || Pattern::predict_match(pat_->pma_, &buf_[loc + len]) == 0;
+    REFLEX_STAT(sts_.pm_rejects += !ok);
+    return ok;
+  }
 #if !defined(WITH_NO_INDENT)
   /// Update indentation column counter for indent() and dedent().
   inline void newline()
   {
     mrk_ = true;
+    if (ind_ + 9 <= pos_)
+      skip_indent();
     while (ind_ + 1 < pos_)
+    {
       col_ += buf_[ind_++] == '\t' ? 1 + (~col_ & (opt_.T - 1)) : 1;
+    }
     DBGLOG("Newline with indent/dedent? col = %zu", col_);
   }
+  /// Advance the indentation column counter eight columns at a time over indent spans without tabs.
+  void skip_indent();
   /// Returns true if looking at indent.
   inline bool indent()
     /// @returns true if indent
@@ -956,23 +1242,16 @@ unrolled:
     return (col_ <= 0 || (!tab_.empty() && tab_.back() >= col_)) && (tab_.empty() || tab_.back() <= col_);
   }
 #endif
-  /// Boyer-Moore preprocessing of the given pattern pat of length len, generates bmd_ > 0 and bms_[] shifts.
-  void boyer_moore_init(
-      const char *pat, ///< pattern string
-      size_t      len) ///< nonzero length of the pattern string, should be less than 256
-    ;
   size_t            ded_;      ///< dedent count
   size_t            col_;      ///< column counter for indent matching, updated by newline(), indent(), and dedent()
   Stops             tab_;      ///< tab stops set by detecting indent margins
   std::vector<int>  lap_;      ///< lookahead position in input that heads a lookahead match (indexed by lookahead number)
-  std::stack<Stops> stk_;      ///< stack to push/pop stops
+  StopsStack        stk_;      ///< stack to push/pop stops
   FSM               fsm_;      ///< local state for FSM code
-  uint16_t          lcp_;      ///< primary least common character position in the pattern prefix or 0xffff for pure Boyer-Moore
-  uint16_t          lcs_;      ///< secondary least common character position in the pattern prefix or 0xffff for pure Boyer-Moore
-  size_t            bmd_;      ///< Boyer-Moore jump distance on mismatch, B-M is enabled when bmd_ > 0
-  uint8_t           bms_[256]; ///< Boyer-Moore skip array
+  Pattern::LazyDFA  lzy_;      ///< lazy DFA states constructed on demand for patterns compiled with option l
   bool              mrk_;      ///< indent \i or dedent \j in pattern found: should check and update indent stops
   bool              anc_;      ///< match is anchored, advance slowly to retry when searching
+  uint8_t           cnd_;      ///< possible match found by advance() is pending for stats(): 0 none, 1 prefix string search, 2 predict-match
 };
 
 } // namespace reflex
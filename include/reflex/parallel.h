@@ -0,0 +1,300 @@
+/******************************************************************************\
+* Copyright (c) 2016, Robert van Engelen, Genivia Inc. All rights reserved.    *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+*   (1) Redistributions of source code must retain the above copyright notice, *
+*       this list of conditions and the following disclaimer.                  *
+*                                                                              *
+*   (2) Redistributions in binary form must reproduce the above copyright      *
+*       notice, this list of conditions and the following disclaimer in the    *
+*       documentation and/or other materials provided with the distribution.   *
+*                                                                              *
+*   (3) The name of the author may not be used to endorse or promote products  *
+*       derived from this software without specific prior written permission.  *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF         *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO   *
+* EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       *
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;  *
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,     *
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR      *
+* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF       *
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                                   *
+\******************************************************************************/
+
+/**
+@file      parallel.h
+@brief     RE/flex parallel chunked matching of large inputs with multiple threads
+@author    Robert van Engelen - engelen@genivia.com
+@copyright (c) 2016-2020, Robert van Engelen, Genivia Inc. All rights reserved.
+@copyright (c) BSD-3 License - see LICENSE.txt
+*/
+
+#ifndef REFLEX_PARALLEL_H
+#define REFLEX_PARALLEL_H
+
+#include <reflex/matcher.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace reflex {
+
+/// Parallel matcher that splits a large buffer into chunks at synchronization points to scan, search, or split the chunks concurrently with clones of a matcher.
+/**
+Description
+-----------
+
+The buffer is divided into chunks of about the specified chunk size that end
+at a synchronization point, by default after a newline.  A synchronization
+regex may be specified instead, in which case chunks end after a match of the
+synchronization regex.  Each chunk is matched by a clone of the given matcher
+(see `AbstractMatcher::clone()`) by one of the worker threads.  The matches
+are merged in order with positions, line numbers and column numbers relative
+to the whole buffer.
+
+Matches that span a synchronization point are not found, i.e. the results are
+the same as matching the buffer sequentially only when no match and no split
+separator spans a synchronization point.  Also the start of a chunk is
+considered the begin of a line by anchors, since it is the begin of a line
+with the default newline synchronization.  When splitting, the last field of
+a chunk and the first field of the next chunk are merged into one field.
+
+Example
+-------
+
+~~~{.cpp}
+    reflex::Matcher matcher("\\w+");
+    reflex::ParallelMatcher parallel(matcher);
+    reflex::ParallelMatcher::Matches matches = parallel.find(data, size);
+    for (auto& match : matches)
+      std::cout << match.lineno << ":" << match.columno << ": " << std::string(data + match.offset, match.size) << std::endl;
+~~~
+
+Link with `-pthread` where threads are not part of the C library.
+*/
+class ParallelMatcher {
+ public:
+  typedef int Method; ///< a method is one of AbstractMatcher::Const::SCAN, Const::FIND, Const::SPLIT
+  /// A match found by the parallel matcher.
+  struct Match {
+    size_t accept;  ///< the matcher's accept() value of the match
+    size_t offset;  ///< position of the match in the buffer
+    size_t size;    ///< length of the match in bytes
+    size_t lineno;  ///< line number of the match in the buffer
+    size_t columno; ///< column number of the match in the buffer
+  };
+  typedef std::vector<Match> Matches; ///< the matches found in order
+  /// Construct a parallel matcher from a prototype matcher that is cloned for each chunk, the prototype should not be used while matching.
+  ParallelMatcher(
+      AbstractMatcher& matcher,     ///< prototype matcher with a pattern and options
+      size_t           threads = 0, ///< number of threads or 0 for the number of hardware threads
+      size_t           chunk = 0)   ///< approximate chunk size in bytes, 0 to pick a size based on the input and the number of threads
+    :
+      mat_(matcher),
+      syn_(nullptr),
+      thr_(threads > 0 ? threads : std::max<size_t>(std::thread::hardware_concurrency(), 1)),
+      chk_(chunk)
+  { }
+  /// Set a synchronization pattern, chunks end after a match of this pattern, or set nullptr to synchronize at newlines (default).
+  ParallelMatcher& sync(const Pattern *pattern) ///< persistent synchronization pattern or nullptr
+    /// @returns this parallel matcher
+  {
+    syn_ = pattern;
+    return *this;
+  }
+  /// Scan the buffer in parallel, each chunk is scanned until it is exhausted or until no token matches.
+  Matches scan(
+      const char *base, ///< base of the buffer
+      size_t      size) ///< size of the buffer
+    /// @returns the matches
+  {
+    return match(AbstractMatcher::Const::SCAN, base, size);
+  }
+  /// Search the buffer in parallel.
+  Matches find(
+      const char *base, ///< base of the buffer
+      size_t      size) ///< size of the buffer
+    /// @returns the matches
+  {
+    return match(AbstractMatcher::Const::FIND, base, size);
+  }
+  /// Split the buffer in parallel.
+  Matches split(
+      const char *base, ///< base of the buffer
+      size_t      size) ///< size of the buffer
+    /// @returns the fields split from the buffer, where accept() is the separator's accept() value or AbstractMatcher::Const::EMPTY for the last field
+  {
+    return match(AbstractMatcher::Const::SPLIT, base, size);
+  }
+  /// Match the buffer in parallel using method Const::SCAN, Const::FIND, or Const::SPLIT.
+  Matches match(
+      Method      method, ///< Const::SCAN, Const::FIND, or Const::SPLIT
+      const char *base,   ///< base of the buffer
+      size_t      size)   ///< size of the buffer
+    /// @returns the matches
+  {
+    std::vector<size_t> bounds;
+    chunks(base, size, bounds);
+    size_t n = bounds.size() - 1;
+    std::vector<Matches> results(n);
+    std::vector<size_t> lines(n);
+    std::vector<std::exception_ptr> errors(n);
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    size_t k = std::min(thr_, n);
+    for (size_t i = 1; i < k; ++i)
+      workers.push_back(std::thread(&ParallelMatcher::work, this, method, base, std::cref(bounds), std::ref(results), std::ref(lines), std::ref(errors), std::ref(next)));
+    work(method, base, bounds, results, lines, errors, next);
+    for (std::vector<std::thread>::iterator i = workers.begin(); i != workers.end(); ++i)
+      i->join();
+    for (size_t i = 0; i < n; ++i)
+      if (errors[i])
+        std::rethrow_exception(errors[i]);
+    return merge(method, base, bounds, results, lines);
+  }
+ protected:
+  /// Determine the chunk boundaries, the first is zero and the last is the buffer size.
+  void chunks(
+      const char          *base,
+      size_t               size,
+      std::vector<size_t>& bounds)
+  {
+    const size_t block = AbstractMatcher::Const::BLOCK;
+    size_t chunk = chk_;
+    if (chunk == 0)
+      chunk = std::max<size_t>(size / (4 * thr_) + 1, block);
+    bounds.push_back(0);
+    size_t loc = chunk;
+    while (loc < size)
+    {
+      if (syn_ == nullptr)
+      {
+        const char *s = static_cast<const char*>(std::memchr(base + loc, '\n', size - loc));
+        if (s == nullptr)
+          break;
+        loc = s - base + 1;
+      }
+      else
+      {
+        Matcher sync(syn_, Input(base + loc, size - loc));
+        if (!sync.find() || sync.size() == 0)
+          break;
+        loc += sync.last();
+      }
+      if (loc >= size)
+        break;
+      bounds.push_back(loc);
+      loc += chunk;
+    }
+    bounds.push_back(size);
+  }
+  /// Worker thread to match chunks until all chunks are done.
+  void work(
+      Method                            method,
+      const char                       *base,
+      const std::vector<size_t>&        bounds,
+      std::vector<Matches>&             results,
+      std::vector<size_t>&              lines,
+      std::vector<std::exception_ptr>&  errors,
+      std::atomic<size_t>&              next)
+  {
+    size_t n = bounds.size() - 1;
+    size_t i;
+    while ((i = next++) < n)
+    {
+      try
+      {
+        size_t beg = bounds[i];
+        size_t end = bounds[i + 1];
+        std::unique_ptr<AbstractMatcher> matcher(mat_.clone());
+        matcher->input(Input(base + beg, end - beg));
+        Matches& matches = results[i];
+        while (true)
+        {
+          size_t accept;
+          if (method == AbstractMatcher::Const::SCAN)
+            accept = matcher->scan();
+          else if (method == AbstractMatcher::Const::FIND)
+            accept = matcher->find();
+          else
+            accept = matcher->split();
+          if (accept == 0)
+            break;
+          Match match = { accept, beg + matcher->first(), matcher->size(), matcher->lineno(), matcher->columno() };
+          matches.push_back(match);
+        }
+        lines[i] = static_cast<size_t>(std::count(base + beg, base + end, '\n'));
+      }
+      catch (...)
+      {
+        errors[i] = std::current_exception();
+      }
+    }
+  }
+  /// Merge the chunk results in order, adjusting line and column numbers.
+  Matches merge(
+      Method                     method,
+      const char                *base,
+      const std::vector<size_t>& bounds,
+      std::vector<Matches>&      results,
+      const std::vector<size_t>& lines)
+  {
+    Matches matches;
+    size_t lineno = 0;
+    char tabs = mat_.tabs();
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+      // the column of the chunk's first line, counted from the begin of the line when a chunk does not start at a line
+      const char *bol = base + bounds[i];
+      while (bol > base && bol[-1] != '\n')
+        --bol;
+      const char *cur = bol;
+      size_t col = 0;
+      for (Matches::iterator match = results[i].begin(); match != results[i].end(); ++match)
+      {
+        if (match->lineno == 1 && bol < base + bounds[i])
+        {
+          for (const char *s = base + match->offset; cur < s; ++cur)
+          {
+            if (*cur == '\t')
+              col += 1 + (~col & (tabs - 1));
+            else
+              col += ((*cur & 0xC0) != 0x80);
+          }
+          match->columno = col;
+        }
+        match->lineno += lineno;
+        if (method == AbstractMatcher::Const::SPLIT && !matches.empty() && matches.back().accept == AbstractMatcher::Const::EMPTY && i > 0 && match == results[i].begin())
+        {
+          // join the last field of the previous chunk with the first field of this chunk
+          Match& last = matches.back();
+          last.size = match->offset + match->size - last.offset;
+          last.accept = match->accept;
+        }
+        else
+        {
+          matches.push_back(*match);
+        }
+      }
+      lineno += lines[i];
+    }
+    return matches;
+  }
+  AbstractMatcher&  mat_; ///< the prototype matcher cloned for each chunk
+  const Pattern    *syn_; ///< synchronization pattern or nullptr to synchronize at newlines
+  size_t            thr_; ///< number of threads
+  size_t            chk_; ///< approximate chunk size or 0
+};
+
+} // namespace reflex
+
+#endif
@@ -43,13 +43,17 @@
 #include <reflex/input.h>
 #include <reflex/ranges.h>
 #include <reflex/setop.h>
+#include <algorithm>
 #include <cctype>
 #include <cstring>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <list>
 #include <map>
+#include <memory>
 #include <set>
+#include <type_traits>
 #include <vector>
 
 #if (defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)) && !defined(__CYGWIN__) && !defined(__MINGW32__) && !defined(__MINGW64__)
@@ -62,12 +66,14 @@ namespace reflex {
 class Pattern {
   friend class Matcher;      ///< permit access by the reflex::Matcher engine
   friend class FuzzyMatcher; ///< permit access by the reflex::FuzzyMatcher engine
+  friend class PatternSet;   ///< permit access by the reflex::PatternSet engine
  public:
   typedef uint8_t  Pred;   ///< predict match bits
   typedef uint16_t Hash;   ///< hash value type, max value is Const::HASH
   typedef uint32_t Index;  ///< index into opcodes array Pattern::opc_ and subpattern indexing
   typedef uint32_t Accept; ///< group capture index
   typedef uint32_t Opcode; ///< 32 bit opcode word
+  typedef uint16_t Opcode16; ///< 16 bit opcode word of a narrow opcode table
   typedef void (*FSM)(class Matcher&); ///< function pointer to FSM code
   /// Common constants.
   struct Const {
@@ -78,7 +84,16 @@ class Pattern {
     static const Index  LONG = 0xFFFE;     ///< LONG marker for 64 bit opcodes, must be HALT-1
     static const Index  HALT = 0xFFFF;     ///< HALT marker for GOTO opcodes, must be 16 bit max
     static const Hash   HASH = 0x1000;     ///< size of the predict match array
+    static const Index  DTBL = 0x1000000;  ///< max number of dense transition table entries
+    static const Index  DACC = 0x00FFFFFF; ///< dense transition table row info mask of the accept index
+    static const Index  DRDO = 0x01000000; ///< dense transition table row info flag of a redo state
+    static const Index  DEND = 0x02000000; ///< dense transition table row info flag of a dead end state
+    static const Index  DNEW = 0x04000000; ///< lazy DFA row info flag of a state with transitions not constructed yet
+    static const Index  LAZY = 4096;       ///< default max number of lazy DFA states cached by a matcher with option l
+    static const Opcode NTBL = 0xFD010000; ///< first word of a narrow opcode table, with the number of 16 bit words of the table in the low 16 bits, no opcode has these high 16 bits
+    static const Index  NRDO = 0xFFFF;     ///< narrow opcode table row info of a redo state
   };
+  class LazyDFA;
   /// Construct an unset pattern.
   Pattern()
     :
@@ -154,6 +169,10 @@ class Pattern {
   }
   /// Copy constructor.
   Pattern(const Pattern& pattern) ///< pattern to copy
+    :
+      opc_(nullptr),
+      nop_(0),
+      fsm_(nullptr)
   {
     operator=(pattern);
   }
@@ -171,6 +190,19 @@ class Pattern {
     opc_ = nullptr;
     nop_ = 0;
     fsm_ = nullptr;
+    dtt_.clear();
+    dsp_.clear();
+    opn_.clear();
+    acs_.clear();
+    aci_.clear();
+    nfa_.reset();
+    if (upd_)
+    {
+      // the parsed NFA was allocated on the heap
+      Arena::Scope scope(nullptr);
+      upd_.reset();
+      tfa_.clear();
+    }
   }
   /// Assign a (new) pattern.
   Pattern& assign(
@@ -237,6 +269,27 @@ class Pattern {
     vms_ = pattern.vms_;
     ems_ = pattern.ems_;
     wms_ = pattern.wms_;
+    len_ = pattern.len_;
+    min_ = pattern.min_;
+    one_ = pattern.one_;
+    tsz_ = pattern.tsz_;
+    lcp_ = pattern.lcp_;
+    lcs_ = pattern.lcs_;
+    bmd_ = pattern.bmd_;
+    std::memcpy(bms_, pattern.bms_, sizeof(bms_));
+    std::memcpy(pre_, pattern.pre_, sizeof(pre_));
+    std::memcpy(bit_, pattern.bit_, sizeof(bit_));
+    std::memcpy(pmh_, pattern.pmh_, sizeof(pmh_));
+    std::memcpy(pma_, pattern.pma_, sizeof(pma_));
+    std::memcpy(tlo_, pattern.tlo_, sizeof(tlo_));
+    std::memcpy(thi_, pattern.thi_, sizeof(thi_));
+    std::memcpy(dcl_, pattern.dcl_, sizeof(dcl_));
+    dtt_ = pattern.dtt_;
+    dsp_ = pattern.dsp_;
+    opn_ = pattern.opn_;
+    acs_ = pattern.acs_;
+    aci_ = pattern.aci_;
+    nfa_ = pattern.nfa_;
     if (pattern.nop_ > 0 && pattern.opc_ != nullptr)
     {
       nop_ = pattern.nop_;
@@ -247,6 +300,7 @@ class Pattern {
     }
     else
     {
+      opc_ = pattern.opc_;
       fsm_ = pattern.fsm_;
     }
     return *this;
@@ -281,7 +335,7 @@ class Pattern {
   bool empty() const
     /// @return true if this pattern is not assigned
   {
-    return opc_ == nullptr && fsm_ == nullptr;
+    return opc_ == nullptr && fsm_ == nullptr && opn_.empty() && !nfa_;
   }
   /// Get subpattern regex of this pattern object or the whole regex with index 0.
   const std::string operator[](Accept choice) const
@@ -293,6 +347,27 @@ class Pattern {
   {
     return choice >= 1 && choice <= size() && acc_.at(choice - 1);
   }
+  /// Add subpatterns to a pattern constructed with option u, parses only the regex added while the parsed subpatterns and the tree DFA of strings are kept, call update() to recompile the DFA.
+  Accept add(const char *regex)
+    /// @returns index of the first subpattern added, or 0 when the pattern was not constructed with option u
+    ;
+  /// Add subpatterns to a pattern constructed with option u, parses only the regex added while the parsed subpatterns and the tree DFA of strings are kept, call update() to recompile the DFA.
+  Accept add(const std::string& regex)
+    /// @returns index of the first subpattern added, or 0 when the pattern was not constructed with option u
+  {
+    return add(regex.c_str());
+  }
+  /// Remove a subpattern from a pattern constructed with option u, the other subpatterns keep their index and the regex string is not changed, call update() to recompile the DFA.
+  void remove(Accept choice);
+  /// Recompile the DFA of a pattern constructed with option u after subpatterns were added or removed.
+  void update();
+  /// Get the subpatterns accepted by the DFA state at opcode index pc of a pattern compiled with option a.
+  const Accept *accepts(Index pc) const
+    /// @returns pointer to a 0-terminated list of subpattern indices in increasing order, or nullptr when the state accepts no more than the subpattern of its TAKE opcode
+  {
+    std::vector<std::pair<Index,Index> >::const_iterator i = std::lower_bound(aci_.begin(), aci_.end(), std::pair<Index,Index>(pc, 0));
+    return i != aci_.end() && i->first == pc ? &acs_[i->second] : nullptr;
+  }
   /// Get the number of finite state machine nodes (vertices).
   size_t nodes() const
     /// @returns number of nodes or 0 when no finite state machine was constructed by this pattern
@@ -390,14 +465,232 @@ class Pattern {
       size_t           pos = 0) ///< optional location of the error in regex string Pattern::rex_
     const;
  private:
-  typedef uint16_t                Char; // 8 bit char and meta chars up to META_MAX-1
-  typedef uint8_t                 Lazy;
-  typedef uint16_t                Iter;
-  typedef uint16_t                Lookahead;
-  typedef std::set<Lookahead>     Lookaheads;
-  typedef uint32_t                Location;
-  typedef ORanges<Location>       Locations;
-  typedef std::map<int,Locations> Map;
+  /// Arena of memory chunks for the containers of the pattern compiler, with a free list per block size for reuse, all memory is released at once by the destructor.
+  class Arena {
+   public:
+    static const size_t MIN      = 16;       ///< smallest block size, block sizes are powers of two
+    static const size_t LARGE    = 0x10000;  ///< blocks of this size and larger are allocated in a chunk of their own
+    static const size_t CHUNK    = 0x10000;  ///< initial chunk size, doubled for each new chunk up to MAXCHUNK
+    static const size_t MAXCHUNK = 0x400000; ///< max chunk size
+    /// Scope of an arena as the current arena of this thread used by Pattern::Allocator, restores the previous arena at the end of the scope.
+    struct Scope {
+      Scope(Arena& arena)
+        :
+          prev(current)
+      {
+        current = &arena;
+      }
+      /// Scope without an arena to allocate from the heap.
+      Scope(Arena *arena)
+        :
+          prev(current)
+      {
+        current = arena;
+      }
+      ~Scope()
+      {
+        current = prev;
+      }
+      Arena *prev; ///< the previous arena of this thread
+    };
+    Arena()
+      :
+        owner_(nullptr),
+        adopted_(nullptr),
+        sibling_(nullptr),
+        chunks_(nullptr),
+        next_(nullptr),
+        last_(nullptr),
+        size_(CHUNK)
+    {
+      for (size_t i = 0; i < sizeof(free_) / sizeof(free_[0]); ++i)
+        free_[i] = nullptr;
+    }
+    ~Arena()
+    {
+      while (adopted_ != nullptr)
+      {
+        Arena *next = adopted_->sibling_;
+        delete adopted_;
+        adopted_ = next;
+      }
+      while (chunks_ != nullptr)
+      {
+        Block *next = chunks_->next;
+        ::operator delete(chunks_);
+        chunks_ = next;
+      }
+    }
+    /// allocate a block of at least size bytes.
+    void *allocate(size_t size)
+    {
+      if (owner_ != nullptr)
+        return owner_->allocate(size);
+      size_t k = 0;
+      while ((MIN << k) < size)
+        ++k;
+      Block *block = free_[k];
+      if (block != nullptr)
+      {
+        free_[k] = block->next;
+        return block;
+      }
+      size = MIN << k;
+      if (size >= LARGE)
+        return chunk(size);
+      if (size > static_cast<size_t>(last_ - next_))
+      {
+        next_ = static_cast<char*>(chunk(size_));
+        last_ = next_ + size_;
+        if (size_ < MAXCHUNK)
+          size_ *= 2;
+      }
+      void *ptr = next_;
+      next_ += size;
+      return ptr;
+    }
+    /// take ownership of another arena allocated with new and of its chunks, the other arena forwards to this arena and is deleted when this arena is destroyed.
+    void adopt(Arena *arena)
+    {
+      while (arena->chunks_ != nullptr)
+      {
+        Block *next = arena->chunks_->next;
+        arena->chunks_->next = chunks_;
+        chunks_ = arena->chunks_;
+        arena->chunks_ = next;
+      }
+      arena->next_ = nullptr;
+      arena->last_ = nullptr;
+      for (size_t i = 0; i < sizeof(arena->free_) / sizeof(arena->free_[0]); ++i)
+        arena->free_[i] = nullptr;
+      arena->owner_ = this;
+      arena->sibling_ = adopted_;
+      adopted_ = arena;
+    }
+    /// return a block of size bytes to its free list.
+    void deallocate(void *ptr, size_t size)
+    {
+      if (owner_ != nullptr)
+      {
+        owner_->deallocate(ptr, size);
+        return;
+      }
+      size_t k = 0;
+      while ((MIN << k) < size)
+        ++k;
+      Block *block = static_cast<Block*>(ptr);
+      block->next = free_[k];
+      free_[k] = block;
+    }
+    static thread_local Arena *current; ///< the current arena of this thread or nullptr
+   private:
+    /// free list block and chunk header, the header is padded to MIN bytes to align chunk data.
+    union Block {
+      Block *next;
+      char   pad[MIN];
+    };
+    /// allocate a chunk of size bytes and link it into the list of chunks.
+    void *chunk(size_t size)
+    {
+      Block *block = static_cast<Block*>(::operator new(sizeof(Block) + size));
+      block->next = chunks_;
+      chunks_ = block;
+      return block + 1;
+    }
+    Arena *owner_;    ///< the arena that adopted this arena, or nullptr
+    Arena *adopted_;  ///< list of arenas adopted by this arena
+    Arena *sibling_;  ///< next arena in the list of arenas adopted by the owner
+    Block *chunks_;   ///< list of chunks allocated
+    char  *next_;     ///< next free byte in the current chunk
+    char  *last_;     ///< end of the current chunk
+    size_t size_;     ///< size of the next chunk
+    Block *free_[64]; ///< free lists of blocks of size MIN << k
+  };
+  /// Allocator for the containers of the pattern compiler, allocates from and frees to the arena that was current in this thread when the container was constructed, or the heap.
+  template<typename T>
+  struct Allocator {
+    typedef T              value_type;
+    typedef T             *pointer;
+    typedef const T       *const_pointer;
+    typedef T&             reference;
+    typedef const T&       const_reference;
+    typedef size_t         size_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    template<typename U>
+    struct rebind {
+      typedef Allocator<U> other;
+    };
+    Allocator()
+      :
+        arena(Arena::current)
+    { }
+    template<typename U>
+    Allocator(const Allocator<U>& allocator)
+      :
+        arena(allocator.arena)
+    { }
+    /// a copy of a container allocates from the current arena of this thread, like a container constructed in its place.
+    Allocator select_on_container_copy_construction() const
+    {
+      return Allocator();
+    }
+    pointer allocate(size_type n, const void* = nullptr)
+    {
+      if (arena != nullptr)
+        return static_cast<pointer>(arena->allocate(n * sizeof(T)));
+      return static_cast<pointer>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(pointer ptr, size_type n)
+    {
+      if (arena != nullptr)
+        arena->deallocate(ptr, n * sizeof(T));
+      else
+        ::operator delete(ptr);
+    }
+    template<typename U,typename... Args>
+    void construct(U *ptr, Args&&... args)
+    {
+      ::new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+    }
+    template<typename U>
+    void destroy(U *ptr)
+    {
+      ptr->~U();
+    }
+    pointer address(reference x) const
+    {
+      return &x;
+    }
+    const_pointer address(const_reference x) const
+    {
+      return &x;
+    }
+    size_type max_size() const
+    {
+      return static_cast<size_type>(-1) / sizeof(T);
+    }
+    template<typename U>
+    bool operator==(const Allocator<U>& allocator) const
+    {
+      return arena == allocator.arena;
+    }
+    template<typename U>
+    bool operator!=(const Allocator<U>& allocator) const
+    {
+      return arena != allocator.arena;
+    }
+    Arena *arena; ///< the arena to allocate from and to free to, or nullptr for the heap
+  };
+  typedef uint16_t Char; // 8 bit char and meta chars up to META_MAX-1
+  typedef uint8_t  Lazy;
+  typedef uint16_t Iter;
+  typedef uint16_t Lookahead;
+  typedef uint32_t Location;
+  typedef std::set<Lookahead,std::less<Lookahead>,Allocator<Lookahead> >                Lookaheads;
+  typedef FlatORanges<Location,Allocator<std::pair<Location,Location> > >               Locations;
+  typedef std::map<int,Locations,std::less<int>,Allocator<std::pair<const int,Locations> > > Map;
   /// Set of chars and meta chars
   struct Chars {
     Chars()                                 { clear(); }
@@ -473,27 +766,71 @@ class Pattern {
     Lazy     lazy()                  const { return static_cast<Lazy>(k >> 56); }
     value_type k;
   };
-  typedef std::set<Lazy>               Lazyset;
-  typedef std::set<Position>           Positions;
-  typedef std::map<Position,Positions> Follow;
-  typedef std::pair<Chars,Positions>   Move;
-  typedef std::list<Move>              Moves;
-  /// Tree DFA constructed from string patterns.
+  /// Set of positions stored in a sorted vector, replaces std::set<Position> to avoid node allocations and pointer chasing.
+  struct Positions : std::vector<Position,Allocator<Position> > {
+    typedef std::vector<Position,Allocator<Position> > Vector;
+    typedef std::less<Position> key_compare;
+    key_compare key_comp() const
+    {
+      return key_compare();
+    }
+    /// insert a position, appending is fast when positions are inserted in order, returns an iterator to the position.
+    iterator insert(const Position& p)
+    {
+      if (empty() || back() < p)
+        return Vector::insert(end(), p);
+      iterator i = std::lower_bound(begin(), end(), p);
+      if (i != end() && !(p < *i))
+        return i;
+      return Vector::insert(i, p);
+    }
+    /// insert a sorted range of positions by merging.
+    template<typename I>
+    void insert(I first, I last)
+    {
+      if (first == last)
+        return;
+      if (empty() || back() < *first)
+      {
+        Vector::insert(end(), first, last);
+        return;
+      }
+      Vector merged(get_allocator());
+      merged.reserve(size() + std::distance(first, last));
+      std::set_union(begin(), end(), first, last, std::back_inserter(merged));
+      Vector::swap(merged);
+    }
+    /// find a position, returns end() if not found.
+    const_iterator find(const Position& p) const
+    {
+      const_iterator i = std::lower_bound(begin(), end(), p);
+      return i != end() && !(p < *i) ? i : end();
+    }
+    using Vector::erase;
+  };
+  typedef std::set<Lazy,std::less<Lazy>,Allocator<Lazy> >                                        Lazyset;
+  typedef std::map<Position,Positions,std::less<Position>,Allocator<std::pair<const Position,Positions> > > Follow;
+  typedef std::pair<Chars,Positions>                                                             Move;
+  typedef std::vector<Move,Allocator<Move> >                                                     Moves;
+  typedef FlatORanges<Hash,Allocator<std::pair<Hash,Hash> > >                                    Hashes;
+  /// Tree DFA constructed from string patterns, a trie with compact nodes that link their children in sorted order.
   struct Tree
   {
     struct Node {
       Node()
         :
-          accept(0)
-      {
-        for (int i = 0; i < 256; ++i)
-          edge[i] = nullptr;
-      }
-      Node  *edge[256]; ///< 256 edges, one per 8-bit char
-      Accept accept;    ///< nonzero if final state, the index of an accepted/captured subpattern
+          child(nullptr),
+          sibling(nullptr),
+          accept(0),
+          chr(0)
+      { }
+      Node  *child;   ///< first child node, the children are sorted by their char
+      Node  *sibling; ///< next sibling node with a larger char
+      Accept accept;  ///< nonzero if final state, the index of an accepted/captured subpattern
+      Char   chr;     ///< the 8-bit char of the edge from the parent node to this node
     };
     typedef std::list<Node*> List;
-    static const uint16_t ALLOC = 64; ///< allocate 64 nodes at a time, to improve performance
+    static const uint16_t ALLOC = 1024; ///< allocate 1024 nodes at a time, to improve performance
     Tree()
       :
         tree(nullptr),
@@ -509,16 +846,36 @@ class Pattern {
       for (List::iterator i = list.begin(); i != list.end(); ++i)
         delete[] *i;
       list.clear();
+      tree = nullptr;
+      next = ALLOC;
     }
     /// return the root of the tree.
     Node *root()
     {
       return tree != nullptr ? tree : (tree = leaf());
     }
+    /// return the target tree node of the edge from a tree node on char c, or nullptr when there is no such edge.
+    static Node *target(const Node *node, Char c)
+    {
+      Node *t = node->child;
+      while (t != nullptr && t->chr < c)
+        t = t->sibling;
+      return t != nullptr && t->chr == c ? t : nullptr;
+    }
     /// create an edge from a tree node to a target tree node, return the target tree node.
     Node *edge(Node *node, Char c)
     {
-      return node->edge[c] != nullptr ? node->edge[c] : (node->edge[c] = leaf());
+      Node **t = &node->child;
+      while (*t != nullptr && (*t)->chr < c)
+        t = &(*t)->sibling;
+      if (*t == nullptr || (*t)->chr != c)
+      {
+        Node *n = leaf();
+        n->chr = c;
+        n->sibling = *t;
+        *t = n;
+      }
+      return *t;
     }
     /// create a new leaf node.
     Node *leaf()
@@ -537,7 +894,24 @@ class Pattern {
   /// DFA created by subset construction from regex patterns.
   struct DFA {
     struct State : Positions {
-      typedef std::map<Char,std::pair<Char,State*> > Edges;
+      /// Transitions stored in a vector sorted by char, replaces std::map<Char,std::pair<Char,State*> > to avoid node allocations.
+      struct Edges : std::vector<std::pair<Char,std::pair<Char,State*> >,Allocator<std::pair<Char,std::pair<Char,State*> > > > {
+        /// get the edge on char c, inserts a new edge when none exists, appending is fast when edges are added in order.
+        std::pair<Char,State*>& operator[](Char c)
+        {
+          if (empty() || back().first < c)
+          {
+            push_back(value_type(c, std::pair<Char,State*>(0, nullptr)));
+            return back().second;
+          }
+          iterator i = begin();
+          while (i->first < c)
+            ++i;
+          if (i->first != c)
+            i = insert(i, value_type(c, std::pair<Char,State*>(0, nullptr)));
+          return i->second;
+        }
+      };
       State()
         :
           next(nullptr),
@@ -588,6 +962,7 @@ class Pattern {
       for (List::iterator i = list.begin(); i != list.end(); ++i)
         delete[] *i;
       list.clear();
+      next = ALLOC;
     }
     /// new DFA state with optional tree DFA node.
     State *state(Tree::Node *node)
@@ -612,13 +987,42 @@ class Pattern {
     List     list; ///< block allocation list
     uint16_t next; ///< block allocation, next available slot in last block
   };
+  typedef std::map<DFA::State*,Hashes,std::less<DFA::State*>,Allocator<std::pair<DFA::State* const,Hashes> > > StateHashes;
+  /// Profile of a DFA run on sample input: per state the number of visits followed by the number of transitions taken on each byte 0 to 255.
+  typedef std::map<const DFA::State*,std::vector<size_t>,std::less<const DFA::State*>,Allocator<std::pair<const DFA::State* const,std::vector<size_t> > > > Profile;
+  /// NFA kept by a pattern compiled with option l to construct DFA states on demand, allocated on the heap and shared by copies of the pattern.
+  struct NFA {
+    Tree           tree;      ///< tree DFA constructed from strings
+    Positions      startpos;  ///< positions of the start state
+    mutable Follow followpos; ///< followpos NFA, not modified by compile_transition() for the patterns accepted by option l
+    Map            modifiers; ///< modifier modes of the regex locations
+    Map            lookahead; ///< lookahead locations, empty for the patterns accepted by option l
+  };
+  /// Parsed NFA kept by a pattern compiled with option u to add and remove subpatterns, allocated on the heap and not shared by copies of the pattern.
+  struct Parsed {
+    Positions                startpos;  ///< positions of the start state
+    Follow                   followpos; ///< followpos NFA, copied to compile the DFA because compile_transition() modifies it
+    Map                      modifiers; ///< modifier modes of the regex locations
+    Map                      lookahead; ///< lookahead locations
+    Lazy                     lazyidx;   ///< next lazy quantifier index
+    std::vector<Positions>   firstpos;  ///< per subpattern the positions it added to startpos, empty for strings
+    std::vector<Tree::Node*> nodes;     ///< per subpattern the tree DFA node of its string, or nullptr
+    std::vector<bool>        removed;   ///< per subpattern true when removed
+  };
   /// Global modifier modes, syntax flags, and compiler options.
   struct Option {
-    Option() : b(), e(), f(), i(), m(), n(), o(), p(), q(), r(), s(), w(), x(), z() { }
+    Option() : a(), b(), c(), d(), e(), f(), g(), i(), j(), k(), l(), m(), n(), o(), p(), q(), r(), s(), t(), u(), w(), x(), z() { }
+    bool                     a; ///< record all subpatterns accepted by each DFA state, for reflex::PatternSet
     bool                     b; ///< disable escapes in bracket lists
+    std::string              c; ///< directory of the cache of compiled patterns
+    bool                     d; ///< minimize the DFA
     Char                     e; ///< escape character, or > 255 for none, '\\' default
     std::vector<std::string> f; ///< output to files
+    std::string              g; ///< sample input file to profile the DFA with to order the FSM code generated with option o
     bool                     i; ///< case insensitive mode, also `(?i:X)`
+    size_t                   j; ///< number of threads to construct the DFA with, 0 or 1 for one thread
+    bool                     k; ///< with option f keep the opcode table instead of a narrow opcode table, for reflex::FuzzyMatcher
+    size_t                   l; ///< lazy DFA with at most l states cached by a matcher, 0 to construct the DFA
     bool                     m; ///< multi-line mode, also `(?m:X)`
     std::string              n; ///< pattern name (for use in generated code)
     bool                     o; ///< generate optimized FSM code for option f
@@ -626,6 +1030,8 @@ class Pattern {
     bool                     q; ///< enable "X" quotation of verbatim content, also `(?q:X)`
     bool                     r; ///< raise syntax errors
     bool                     s; ///< single-line mode (dotall mode), also `(?s:X)`
+    bool                     t; ///< construct a dense transition table for matching
+    bool                     u; ///< keep the parsed NFA to add and remove subpatterns with Pattern::add() and Pattern::remove()
     bool                     w; ///< write error message to stderr
     bool                     x; ///< free-spacing mode, also `(?x:X)`
     std::string              z; ///< namespace (NAME1.NAME2.NAME3)
@@ -653,11 +1059,22 @@ class Pattern {
       const char    *options,
       const uint8_t *pred = nullptr);
   void init_options(const char *options);
+  std::string cache_key() const;
+  bool load_cache(const std::string& file);
+  void save_cache(const std::string& file) const;
   void parse(
       Positions& startpos,
       Follow&    followpos,
       Map&       modifiers,
       Map&       lookahead);
+  Tree::Node *parse_choice(
+      Location&  loc,
+      Accept     choice,
+      Positions& startpos,
+      Follow&    followpos,
+      Lazy&      lazyidx,
+      Map&       modifiers,
+      Map&       lookahead);
   void parse1(
       bool       begin,
       Location&  loc,
@@ -714,6 +1131,21 @@ class Pattern {
       Follow&     followpos,
       const Map&  modifiers,
       const Map&  lookahead);
+  void compile_parsed();
+  struct Job;
+  void compile_frontier(
+      const std::vector<DFA::State*>& frontier,
+      Follow&                         followpos,
+      const Map&                      modifiers,
+      const Map&                      lookahead,
+      std::vector<Job*>&              jobs,
+      std::vector<Moves>&             moves) const;
+  void compile_job(
+      Job                            *job,
+      const std::vector<DFA::State*> *frontier,
+      const Map                      *modifiers,
+      const Map                      *lookahead,
+      std::vector<Moves>             *moves) const;
   void lazy(
       const Lazyset& lazyset,
       Positions&     pos) const;
@@ -742,10 +1174,25 @@ class Pattern {
       size_t index,
       Chars& chars) const;
   void flip(Chars& chars) const;
+  bool keep_nfa(
+      const Positions& startpos,
+      const Follow&    followpos,
+      const Map&       modifiers,
+      const Map&       lookahead);
+  bool plain(
+      const Positions& pos,
+      const Map&       modifiers) const;
   void assemble(DFA::State *start);
+  void minimize_dfa(DFA::State *start);
   void compact_dfa(DFA::State *start);
   void encode_dfa(DFA::State *start);
+  void encode_accepts(const DFA::State *start);
+  void encode_narrow(const DFA::State *start);
+  void decode_narrow();
   void gencode_dfa(const DFA::State *start) const;
+  void profile_dfa(
+      const DFA::State *start,
+      Profile&          profile) const;
   void check_dfa_closure(
       const DFA::State *state,
       int               nest,
@@ -760,8 +1207,13 @@ class Pattern {
   void export_code() const;
   void predict_match_dfa(DFA::State *start);
   void gen_predict_match(DFA::State *state);
-  void gen_predict_match_transitions(DFA::State *state, std::map<DFA::State*,ORanges<Hash> >& states);
-  void gen_predict_match_transitions(size_t level, DFA::State *state, ORanges<Hash>& labels, std::map<DFA::State*,ORanges<Hash> >& states);
+  void gen_predict_nibbles();
+  void gen_boyer_moore();
+  void gen_dense_table();
+  void gen_dispatch();
+  void gen_predict_match_transitions(DFA::State *state, StateHashes& states);
+  void gen_predict_match_transitions(size_t level, DFA::State *state, Hashes& labels, StateHashes& states);
+  void export_narrow(FILE *fd) const;
   void write_predictor(FILE *fd) const;
   void write_namespace_open(FILE* fd) const;
   void write_namespace_close(FILE* fd) const;
@@ -844,6 +1296,32 @@ class Pattern {
   {
     return c > META_MIN;
   }
+  /// Kinds of opcodes dispatched by Matcher::match(), pre-decoded in dsp_[].
+  enum Dispatch {
+    DISPATCH_GOTO,      ///< GOTO on a char range
+    DISPATCH_HALT,      ///< HALT
+    DISPATCH_TAKE,      ///< TAKE
+    DISPATCH_TAKE_GOTO, ///< TAKE followed by a GOTO on a char range, fused to dispatch once
+    DISPATCH_REDO,      ///< REDO
+    DISPATCH_TAIL,      ///< TAIL
+    DISPATCH_HEAD,      ///< HEAD
+    DISPATCH_DENT,      ///< GOTO on dedent `\j`
+    DISPATCH_META       ///< GOTO on another meta char
+  };
+  static inline uint8_t dispatch_of(Opcode opcode)
+  {
+    if (is_opcode_goto(opcode))
+      return is_opcode_halt(opcode) ? DISPATCH_HALT : DISPATCH_GOTO;
+    switch (opcode >> 24)
+    {
+      case 0xFE: return DISPATCH_TAKE;
+      case 0xFD: return DISPATCH_REDO;
+      case 0xFC: return DISPATCH_TAIL;
+      case 0xFB: return DISPATCH_HEAD;
+      case META_DED - META_MIN: return DISPATCH_DENT;
+    }
+    return DISPATCH_META;
+  }
   static inline Opcode opcode_long(Index index)
   {
     return 0xFF000000 | (index & 0xFFFFFF); // index <= Const::GMAX (0xFEFFFF max)
@@ -974,11 +1452,121 @@ class Pattern {
   Pred                  bit_[256];         ///< bitap array
   Pred                  pmh_[Const::HASH]; ///< predict-match hash array
   Pred                  pma_[Const::HASH]; ///< predict-match array
+  uint8_t               tlo_[4][16];       ///< predict-match low nibble bucket masks of the chars at the first four positions of a match when len_ == 0
+  uint8_t               thi_[4][16];       ///< predict-match high nibble bucket masks of the chars at the first four positions of a match when len_ == 0
+  size_t                tsz_;              ///< number of positions in tlo_[] and thi_[] checked by the SIMD filter, zero when not used
+  uint16_t              lcp_;              ///< primary least common character position in the prefix pre_[] or 0xffff for pure Boyer-Moore
+  uint16_t              lcs_;              ///< secondary least common character position in the prefix pre_[] or 0xffff for pure Boyer-Moore
+  size_t                bmd_;              ///< Boyer-Moore jump distance on mismatch of the prefix pre_[], zero when len_ == 0
+  uint8_t               bms_[256];         ///< Boyer-Moore skip array of the prefix pre_[]
+  uint8_t               dcl_[256];         ///< byte classes of the dense transition table dtt_[]
+  std::vector<Index>    dtt_;              ///< dense transition table rows of row info followed by the target rows per byte class, empty when not used
+  std::vector<uint8_t>  dsp_;              ///< Dispatch kind of each opcode in opc_[] pre-decoded for Matcher::match(), empty when not used
+  std::vector<Opcode16> opn_;              ///< narrow opcode table assembled for option f or decoded from a narrow code table, byte classes in dcl_[], empty when not used
+  std::vector<Accept>   acs_;              ///< 0-terminated lists of the subpatterns accepted by the DFA states with option a
+  std::vector<std::pair<Index,Index> > aci_; ///< opcode index of a DFA state paired with the offset of its list in acs_[] with option a, sorted
+  std::shared_ptr<const NFA> nfa_;         ///< NFA to construct DFA states on demand with option l, or null
+  std::unique_ptr<Parsed>    upd_;         ///< parsed NFA kept with option u to add and remove subpatterns, or null
   float                 pms_; ///< ms elapsed time to parse regex
   float                 vms_; ///< ms elapsed time to compile DFA vertices
   float                 ems_; ///< ms elapsed time to compile DFA edges
   float                 wms_; ///< ms elapsed time to assemble code words
-  bool                  one_; ///< true if matching one string in pre_[] without meta/anchors
+  Accept                one_; ///< nonzero if matching one string in pre_[] without meta/anchors/lookaheads, the subpattern it accepts
+};
+
+/// Lazy DFA of a matcher that constructs the DFA states of a pattern compiled with option l when first reached, caching at most Pattern::Option::l states.
+/**
+The rows of the DFA states have the layout of the pattern's dense transition
+table with a column per byte value: the row info followed by the row offsets
+of the target states, or Pattern::Const::IMAX for no transition.  The row info
+of a state has the Pattern::Const::DNEW flag until its transitions are
+constructed by expand().  When the cache is full, all states are flushed and
+the cache restarts from the start state.  When the matcher switches patterns,
+for example to change start conditions, the states of the previous pattern are
+put aside and restored when the matcher switches back to that pattern.
+*/
+class Pattern::LazyDFA {
+ public:
+  static const size_t WIDTH = 257; ///< row width, the row info and one column per byte value
+  LazyDFA()
+    :
+      pat_(nullptr)
+  {
+    init();
+  }
+  /// Copy constructor, the copy starts with an empty cache.
+  LazyDFA(const LazyDFA&)
+    :
+      pat_(nullptr)
+  {
+    init();
+  }
+  /// Assign, the cache is emptied.
+  LazyDFA& operator=(const LazyDFA&)
+  {
+    clear();
+    return *this;
+  }
+  /// Start matching with the given pattern, puts the cached states aside when the pattern changed to restore them when switching back.
+  const Index *start(const Pattern *pattern)
+    /// @returns the rows of the DFA states with the start state at row 0
+    ;
+  /// Construct the transitions of the state at the given row.
+  Index expand(Index row)
+    /// @returns row of the state, which differs from the given row when the cache was flushed
+    ;
+  /// Return the rows of the DFA states, invalidated by expand().
+  const Index *rows() const
+  {
+    return &rows_[0];
+  }
+  /// Return the byte classes of the columns, which are the byte values.
+  const uint8_t *classes() const
+  {
+    return cls_;
+  }
+  /// Return the number of states cached.
+  size_t size() const
+  {
+    return keys_.size();
+  }
+  /// Delete all cached states.
+  void clear()
+  {
+    pat_ = nullptr;
+    nfa_.reset();
+    states_.clear();
+    keys_.clear();
+    rows_.clear();
+    saved_.clear();
+  }
+ private:
+  typedef std::pair<const Tree::Node*,Positions> Key;
+  typedef std::map<Key,Index>                   States;
+  /// Cached states of a pattern put aside when switching to another pattern.
+  struct Saved {
+    std::shared_ptr<const NFA> nfa;  ///< the NFA of the pattern
+    States                     states; ///< the cached states and their rows
+    std::vector<const Key*>    keys; ///< the state of each row
+    std::vector<Index>         rows; ///< the rows of the states
+  };
+  /// Initialize the byte classes.
+  void init()
+  {
+    for (size_t i = 0; i < 256; ++i)
+      cls_[i] = static_cast<uint8_t>(i);
+  }
+  /// Flush the cache and add the start state.
+  void flush();
+  /// Find or add a state, returns its row.
+  Index insert(const Key& key);
+  const Pattern             *pat_;   ///< the pattern matched
+  std::shared_ptr<const NFA> nfa_;   ///< the NFA of the pattern
+  States                     states_; ///< the cached states and their rows
+  std::vector<const Key*>    keys_;  ///< the state of each row
+  std::vector<Index>         rows_;  ///< the rows of the states
+  std::vector<Saved>         saved_; ///< the cached states of the other patterns matched
+  uint8_t                    cls_[256]; ///< the identity byte classes
 };
 
 } // namespace reflex
@@ -0,0 +1,451 @@
+/******************************************************************************\
+* Copyright (c) 2016, Robert van Engelen, Genivia Inc. All rights reserved.    *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+*   (1) Redistributions of source code must retain the above copyright notice, *
+*       this list of conditions and the following disclaimer.                  *
+*                                                                              *
+*   (2) Redistributions in binary form must reproduce the above copyright      *
+*       notice, this list of conditions and the following disclaimer in the    *
+*       documentation and/or other materials provided with the distribution.   *
+*                                                                              *
+*   (3) The name of the author may not be used to endorse or promote products  *
+*       derived from this software without specific prior written permission.  *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF         *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO   *
+* EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       *
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;  *
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,     *
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR      *
+* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF       *
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                                   *
+\******************************************************************************/
+
+/**
+@file      patternset.h
+@brief     RE/flex pattern set to search text for all patterns of a set at once
+@author    Robert van Engelen - engelen@genivia.com
+@copyright (c) 2016-2020, Robert van Engelen, Genivia Inc. All rights reserved.
+@copyright (c) BSD-3 License - see LICENSE.txt
+*/
+
+#ifndef REFLEX_PATTERNSET_H
+#define REFLEX_PATTERNSET_H
+
+#include <reflex/absmatcher.h>
+#include <reflex/bits.h>
+#include <reflex/pattern.h>
+#include <string>
+#include <vector>
+
+namespace reflex {
+
+/// RE/flex PatternSet class to search text for all patterns of a set in one pass.
+/**
+The regex patterns of a set are compiled into one DFA with Pattern option `a`,
+which records all subpatterns accepted by each DFA state instead of only the
+first, i.e. the one returned by reflex::Matcher::accept().  The find() method
+runs this DFA from every position of the text at once, with one DFA thread per
+distinct state, and reports every pattern that matches somewhere in the text as
+a bit in a reflex::Bits bit vector.  Pattern `i` of the set corresponds to bit
+`i` numbered from 1, like the subpattern indices returned by
+reflex::Matcher::accept().
+
+Example:
+
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~{.cpp}
+    std::vector<std::string> rules;
+    rules.push_back("error");             // bit 1
+    rules.push_back("disk [0-9]+");       // bit 2
+    rules.push_back("\\btimeout\\b");     // bit 3
+    reflex::PatternSet set(rules);
+    reflex::Bits ids;
+    if (set.find("disk 3 timeout", ids))
+      for (size_t i = ids.find_first(); i != reflex::Bits::npos; i = ids.find_next(i))
+        std::cout << "rule " << i << " matches\n"; // rule 2 matches, rule 3 matches
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+A stream of text is searched in chunks with feed() and finish(), which report
+each pattern match by the offset in the stream where the match ends, including
+matches that span chunks.  The chunks are not copied and not retained: only the
+DFA threads and the last char fed are kept between chunks.
+
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~{.cpp}
+    struct Report : public reflex::PatternSet::Handler {
+      bool operator()(reflex::PatternSet::Accept id, size_t end)
+      {
+        std::cout << "rule " << id << " matches up to offset " << end << '\n';
+        return true; // continue, or false to stop
+      }
+    } report;
+    set.reset();
+    while (recv(sock, packet, sizeof(packet), 0) > 0)
+      set.feed(packet, len, report);
+    set.finish(report);
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+Lookaheads `X(?=Y)` match when `XY` matches.  Anchors `^`, `$`, `\A`, `\Z` and
+word boundaries are supported, but not indent and dedent anchors `\i`, `\j`,
+`\k`.  A PatternSet object keeps the state of find() and feed() and should not
+be shared by threads that search at the same time, copy it instead.
+*/
+class PatternSet {
+ public:
+  typedef Pattern::Accept Accept; ///< pattern index type
+  /// Handler of the pattern matches reported by feed() and finish().
+  struct Handler {
+    virtual ~Handler() { }
+    /// Report a match of pattern id that ends at offset end in the stream, return false to stop.
+    virtual bool operator()(
+        Accept id,  ///< the pattern that matches, numbered from 1
+        size_t end) ///< offset in the stream of the end of the match
+      /// @returns true to continue searching, false to stop
+      = 0;
+  };
+  /// Construct an empty pattern set.
+  PatternSet()
+    :
+      gen_(0)
+  {
+    reset();
+  }
+  /// Construct a pattern set from regex strings, compiled into one DFA.
+  explicit PatternSet(
+      const std::vector<std::string>& regexes,         ///< regex patterns of the set
+      const char                     *options = nullptr) ///< reflex::Pattern options, option a is implied
+    :
+      gen_(0)
+  {
+    assign(regexes, options);
+  }
+  /// Construct a pattern set from a regex string with alternations, each top-level alternation is a pattern of the set.
+  explicit PatternSet(
+      const std::string& regex,             ///< regex patterns of the set separated by `|`
+      const char        *options = nullptr) ///< reflex::Pattern options, option a is implied
+    :
+      gen_(0)
+  {
+    assign(regex, options);
+  }
+  /// Assign regex strings to this pattern set, compiled into one DFA.
+  PatternSet& assign(
+      const std::vector<std::string>& regexes,         ///< regex patterns of the set
+      const char                     *options = nullptr) ///< reflex::Pattern options, option a is implied
+  {
+    std::string regex;
+    for (std::vector<std::string>::const_iterator i = regexes.begin(); i != regexes.end(); ++i)
+    {
+      if (i != regexes.begin())
+        regex.push_back('|');
+      regex.append("(?:").append(*i).push_back(')');
+    }
+    return assign(regex, options);
+  }
+  /// Assign a regex string with alternations to this pattern set, each top-level alternation is a pattern of the set.
+  PatternSet& assign(
+      const std::string& regex,             ///< regex patterns of the set separated by `|`
+      const char        *options = nullptr) ///< reflex::Pattern options, option a is implied
+  {
+    std::string opt("a");
+    if (options != nullptr)
+      opt.append(options);
+    pat_.clear();
+    if (!regex.empty())
+      pat_.assign(regex, opt);
+    mrk_.assign(pat_.nop_, 0);
+    msk_.assign(pat_.nop_, 0);
+    rep_.assign(pat_.size() + 1, 0);
+    gen_ = 0;
+    reset();
+    return *this;
+  }
+  /// Get the number of patterns in this set.
+  Accept size() const
+    /// @returns number of patterns
+  {
+    return pat_.size();
+  }
+  /// Get the pattern compiled from the patterns of this set.
+  const Pattern& pattern() const
+    /// @returns reference to reflex::Pattern
+  {
+    return pat_;
+  }
+  /// Search text for all patterns of this set, resets the stream.
+  bool find(
+      const char *text, ///< text to search
+      size_t      size, ///< length of the text
+      Bits&       ids)  ///< set to the patterns that match, numbered from 1
+    /// @returns true if one or more patterns match
+  {
+    struct Found : public Handler {
+      Found(Bits& ids, Accept all) : ids(ids), all(all), num(0) { }
+      bool operator()(Accept id, size_t)
+      {
+        if (!ids[id])
+        {
+          ids.insert(id);
+          ++num;
+        }
+        return num < all;
+      }
+      Bits&  ids;
+      Accept all;
+      Accept num;
+    } found(ids, pat_.size());
+    ids.clear();
+    reset();
+    for (size_t i = 0; i < size; ++i)
+      if (!step(i > 0 ? static_cast<unsigned char>(text[i - 1]) : EOF, static_cast<unsigned char>(text[i]), i + 1 < size ? static_cast<unsigned char>(text[i + 1]) : EOF, found))
+        break;
+    if (found.num < found.all)
+      (void)step(size > 0 ? static_cast<unsigned char>(text[size - 1]) : EOF, EOF, EOF, found);
+    reset();
+    return found.num > 0;
+  }
+  /// Search a string for all patterns of this set, resets the stream.
+  bool find(
+      const std::string& text, ///< text to search
+      Bits&              ids)  ///< set to the patterns that match, numbered from 1
+    /// @returns true if one or more patterns match
+  {
+    return find(text.data(), text.size(), ids);
+  }
+  /// Start a new stream to search with feed() and finish().
+  void reset()
+  {
+    nxt_.clear();
+    pos_ = 0;
+    c0_ = EOF;
+    c1_ = EOF;
+  }
+  /// Search the next chunk of the stream for all patterns of this set, reports the matches that end in the stream before the last char fed.
+  bool feed(
+      const char *chunk,   ///< chunk of the stream
+      size_t      size,    ///< length of the chunk
+      Handler&    handler) ///< called for each match
+    /// @returns false if the handler stopped the search
+  {
+    for (size_t i = 0; i < size; ++i)
+    {
+      int c = static_cast<unsigned char>(chunk[i]);
+      // the char after the pending char c1_ is needed to check $ before \r\n
+      if (c1_ != EOF && !step(c0_, c1_, c, handler))
+        return false;
+      if (c1_ != EOF)
+        c0_ = c1_;
+      c1_ = c;
+    }
+    return true;
+  }
+  /// End the stream, reports the remaining matches, including those that end at the end of the stream.
+  bool finish(Handler& handler) ///< called for each match
+    /// @returns false if the handler stopped the search
+  {
+    if (c1_ != EOF)
+    {
+      if (!step(c0_, c1_, EOF, handler))
+        return false;
+      c0_ = c1_;
+      c1_ = EOF;
+    }
+    bool ok = step(c0_, EOF, EOF, handler);
+    reset();
+    return ok;
+  }
+  /// Get the number of chars of the stream searched so far.
+  size_t offset() const
+    /// @returns offset in the stream
+  {
+    return pos_;
+  }
+ protected:
+  /// Context of the start of a match, which the DFA checks for begin anchors and word boundaries at the begin of a pattern after the first char.
+  enum Context {
+    CTX_BOB = 0x01, ///< the match starts at the begin of the text
+    CTX_BOL = 0x02, ///< the match starts at the begin of a line
+    CTX_WB  = 0x04, ///< the char before the match is a word char
+    CTX_WF  = 0x08  ///< the first char of the match is a word char
+  };
+  /// A DFA thread: the opcode index of the DFA state paired with the context of the start of its match.
+  typedef std::pair<Pattern::Index,uint8_t> Thread;
+  /// Run the DFA threads at the current position pos_ and advance them on the char c1 at this position.
+  bool step(
+      int      c0,      ///< char before this position or EOF
+      int      c1,      ///< char at this position or EOF
+      int      c2,      ///< char after c1 or EOF
+      Handler& handler) ///< called for each match
+    /// @returns false if the handler stopped the search
+    ;
+  /// Add a DFA thread at the current position, unless already present.
+  void add(
+      Pattern::Index pc,  ///< opcode index of the DFA state
+      uint8_t        ctx) ///< context of the start of the match
+  {
+    if (mrk_[pc] != gen_)
+    {
+      mrk_[pc] = gen_;
+      msk_[pc] = 0;
+    }
+    if ((msk_[pc] & (1 << ctx)) == 0)
+    {
+      msk_[pc] |= 1 << ctx;
+      run_.push_back(Thread(pc, ctx));
+    }
+  }
+  /// Report the patterns accepted by the DFA state at opcode index pc, once per position.
+  bool take(
+      Pattern::Index pc,      ///< opcode index of the state
+      Accept         accept,  ///< the pattern of the state's TAKE opcode, or 0 for REDO
+      Handler&       handler) ///< called for each match
+    /// @returns false if the handler stopped the search
+  {
+    const Accept *list = pat_.accepts(pc);
+    if (list == nullptr)
+    {
+      if (accept > 0 && rep_[accept] != gen_)
+      {
+        rep_[accept] = gen_;
+        return handler(accept, pos_);
+      }
+    }
+    else
+    {
+      for (; *list != 0; ++list)
+      {
+        if (rep_[*list] != gen_)
+        {
+          rep_[*list] = gen_;
+          if (!handler(*list, pos_))
+            return false;
+        }
+      }
+    }
+    return true;
+  }
+  Pattern               pat_; ///< pattern compiled from the set with option a
+  std::vector<Thread>   run_; ///< DFA threads at the current position
+  std::vector<Thread>   nxt_; ///< DFA threads at the next position
+  std::vector<size_t>   mrk_; ///< generation of the last position a DFA state was added at, per opcode index
+  std::vector<uint16_t> msk_; ///< contexts of the threads of a DFA state added at generation mrk_[], per opcode index
+  std::vector<size_t>   rep_; ///< generation of the last position a pattern was reported at, per pattern
+  size_t                gen_; ///< generation of the current position
+  size_t                pos_; ///< offset in the stream of the current position
+  int                   c0_;  ///< char before the pending char c1_ or EOF
+  int                   c1_;  ///< pending char fed but not yet searched, or EOF
+};
+
+inline bool PatternSet::step(
+    int      c0,
+    int      c1,
+    int      c2,
+    Handler& handler)
+{
+  const Pattern::Opcode *opc = pat_.opc_;
+  if (opc == nullptr)
+  {
+    pos_ += c1 != EOF;
+    return true;
+  }
+  if (++gen_ == 0)
+  {
+    // generation counter wrapped around: reset the marks
+    std::fill(mrk_.begin(), mrk_.end(), 0);
+    std::fill(rep_.begin(), rep_.end(), 0);
+    gen_ = 1;
+  }
+  // the threads that reached this position and a new thread that starts a match here
+  run_.clear();
+  for (std::vector<Thread>::const_iterator i = nxt_.begin(); i != nxt_.end(); ++i)
+    add(i->first, i->second);
+  add(0, (pos_ == 0 ? CTX_BOB : 0) | (c0 == EOF || c0 == '\n' ? CTX_BOL : 0) | (isword(c0) ? CTX_WB : 0) | (isword(c1) ? CTX_WF : 0));
+  // take accepting states and the meta transitions that hold, which add threads to run_
+  for (size_t j = 0; j < run_.size(); ++j)
+  {
+    Pattern::Index pc = run_[j].first;
+    uint8_t ctx = run_[j].second;
+    const Pattern::Opcode *code = opc + pc;
+    while (!Pattern::is_opcode_goto(*code))
+    {
+      Pattern::Opcode opcode = *code++;
+      bool jump = false;
+      switch (opcode >> 24)
+      {
+        case 0xFE: // TAKE
+          if (!take(pc, Pattern::long_index_of(opcode), handler))
+            return false;
+          continue;
+        case 0xFD: // REDO
+          if (!take(pc, 0, handler))
+            return false;
+          continue;
+        case 0xFC: // TAIL
+        case 0xFB: // HEAD
+          continue;
+        case Pattern::META_EOB - Pattern::META_MIN:
+          jump = c1 == EOF;
+          break;
+        case Pattern::META_BOB - Pattern::META_MIN:
+          jump = (ctx & CTX_BOB) != 0;
+          break;
+        case Pattern::META_EOL - Pattern::META_MIN:
+          jump = c1 == EOF || c1 == '\n' || (c1 == '\r' && c2 == '\n');
+          break;
+        case Pattern::META_BOL - Pattern::META_MIN:
+          jump = (ctx & CTX_BOL) != 0;
+          break;
+        case Pattern::META_EWE - Pattern::META_MIN:
+          jump = isword(c0) && !isword(c1);
+          break;
+        case Pattern::META_BWE - Pattern::META_MIN:
+          jump = !isword(c0) && isword(c1);
+          break;
+        case Pattern::META_EWB - Pattern::META_MIN:
+          jump = (ctx & (CTX_WB | CTX_WF)) == CTX_WB;
+          break;
+        case Pattern::META_BWB - Pattern::META_MIN:
+          jump = (ctx & (CTX_WB | CTX_WF)) == CTX_WF;
+          break;
+        case Pattern::META_NWE - Pattern::META_MIN:
+          jump = (isword(c0) != 0) == (isword(c1) != 0);
+          break;
+        case Pattern::META_NWB - Pattern::META_MIN:
+          jump = ((ctx & CTX_WB) != 0) == ((ctx & CTX_WF) != 0);
+          break;
+      }
+      Pattern::Index index = Pattern::index_of(opcode);
+      if (index == Pattern::Const::LONG)
+        index = Pattern::long_index_of(*code++);
+      if (jump && index != Pattern::Const::HALT)
+        add(index, ctx);
+    }
+  }
+  // advance the threads on the char at this position
+  nxt_.clear();
+  if (c1 == EOF)
+    return true;
+  for (std::vector<Thread>::const_iterator i = run_.begin(); i != run_.end(); ++i)
+  {
+    const Pattern::Opcode *code = opc + i->first;
+    while (!Pattern::is_opcode_goto(*code))
+      ++code;
+    while (!Pattern::is_opcode_goto(*code, static_cast<unsigned char>(c1)))
+      code += 1 + (Pattern::index_of(*code) == Pattern::Const::LONG);
+    Pattern::Index index = Pattern::index_of(*code);
+    if (index == Pattern::Const::LONG)
+      index = Pattern::long_index_of(code[1]);
+    if (index != Pattern::Const::HALT)
+      nxt_.push_back(Thread(index, i->second));
+  }
+  ++pos_;
+  return true;
+}
+
+} // namespace reflex
+
+#endif
@@ -59,8 +59,7 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
       PatternMatcher<std::string>(),
       opc_(nullptr),
       dat_(nullptr),
-      ctx_(nullptr),
-      stk_(nullptr)
+      ctx_(nullptr)
   {
     reset();
   }
@@ -76,8 +75,7 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
       cop_(options),
       opc_(nullptr),
       dat_(nullptr),
-      ctx_(nullptr),
-      stk_(nullptr)
+      ctx_(nullptr)
   {
     reset();
     compile();
@@ -94,8 +92,7 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
       cop_(options),
       opc_(nullptr),
       dat_(nullptr),
-      ctx_(nullptr),
-      stk_(nullptr)
+      ctx_(nullptr)
   {
     reset();
     compile();
@@ -108,8 +105,7 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
       flg_(matcher.flg_),
       opc_(nullptr),
       dat_(nullptr),
-      ctx_(nullptr),
-      stk_(nullptr)
+      ctx_(nullptr)
   {
     reset();
     cop_ = matcher.cop_;
@@ -117,7 +113,7 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
 #ifdef pcre2_code_copy_with_tables
     opc_ = pcre2_code_copy_with_tables(matcher.opc_);
     dat_ = pcre2_match_data_create_from_pattern(opc_, nullptr);
-    jit_ = matcher.jit_ && pcre2_jit_compile(opc_, PCRE2_JIT_PARTIAL_HARD) == 0 && pcre2_pattern_info(opc_, PCRE2_INFO_JITSIZE, nullptr) != 0;
+    jit_ = matcher.jit_ && jit_compile();
 #else
     compile();
 #endif
@@ -125,8 +121,6 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
   /// Delete matcher.
   virtual ~PCRE2Matcher()
   {
-    if (stk_ != nullptr)
-      pcre2_jit_stack_free(stk_);
     if (ctx_ != nullptr)
       pcre2_match_context_free(ctx_);
     if (dat_ != nullptr)
@@ -154,11 +148,10 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
     grp_ = 0;
     PatternMatcher::reset(opt);
     if (ctx_ == nullptr)
-      ctx_ = pcre2_match_context_create(nullptr);
-    if (ctx_ != nullptr && stk_ == nullptr)
     {
-      stk_ = pcre2_jit_stack_create(32*1024, 512*1024, nullptr);
-      pcre2_jit_stack_assign(ctx_, nullptr, stk_);
+      ctx_ = pcre2_match_context_create(nullptr);
+      if (ctx_ != nullptr)
+        pcre2_jit_stack_assign(ctx_, jit_stack, nullptr);
     }
   }
   using PatternMatcher::pattern;
@@ -182,7 +175,7 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
     }
     opc_ = pcre2_code_copy_with_tables(matcher.opc_);
     dat_ = pcre2_match_data_create_from_pattern(opc_, nullptr);
-    jit_ = matcher.jit_ && pcre2_jit_compile(opc_, PCRE2_JIT_PARTIAL_HARD) == 0 && pcre2_pattern_info(opc_, PCRE2_INFO_JITSIZE, nullptr) != 0;
+    jit_ = matcher.jit_ && jit_compile();
 #else
     compile();
 #endif
@@ -276,7 +269,32 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
     }
     return std::pair<size_t,const char*>(grp_, nullptr);
   }
-  /// Compile pattern for jit partial matching and allocate match data.
+  /// Return the JIT stack of the calling thread, which is shared by the PCRE2 matchers of the thread, called by PCRE2 when matching.
+  static pcre2_jit_stack *jit_stack(void*)
+    /// @returns JIT stack or nullptr to use the machine stack
+  {
+    struct Stack {
+      Stack()
+        :
+          stack(pcre2_jit_stack_create(32*1024, 512*1024, nullptr))
+      { }
+      ~Stack()
+      {
+        if (stack != nullptr)
+          pcre2_jit_stack_free(stack);
+      }
+      pcre2_jit_stack *stack;
+    };
+    static thread_local Stack stack;
+    return stack.stack;
+  }
+  /// JIT-compile the pattern for complete matching when the input is fully buffered and for partial matching otherwise.
+  bool jit_compile()
+    /// @returns true if JIT-compiled
+  {
+    return pcre2_jit_compile(opc_, PCRE2_JIT_COMPLETE | PCRE2_JIT_PARTIAL_HARD) == 0 && pcre2_pattern_info(opc_, PCRE2_INFO_JITSIZE, nullptr) != 0;
+  }
+  /// Compile pattern for jit complete and partial matching and allocate match data.
   void compile()
   {
     DBGLOG("BEGIN PCRE2Matcher::compile()");
@@ -300,7 +318,7 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
       pcre2_get_error_message(err, message, sizeof(message));
       throw regex_error(reinterpret_cast<char*>(message), *pat_, pos);
     }
-    jit_ = pcre2_jit_compile(opc_, PCRE2_JIT_PARTIAL_HARD) == 0 && pcre2_pattern_info(opc_, PCRE2_INFO_JITSIZE, nullptr) != 0;
+    jit_ = jit_compile();
     dat_ = pcre2_match_data_create_from_pattern(opc_, nullptr);
     DBGLOGN("jit=%d", jit_);
   }
@@ -378,23 +396,8 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
     while (true)
     {
       DBGLOGN("pcre2_match() pos = %zu end = %zu", pos_, end_);
-      int rc;
-      /* TODO this may be a bug in PCRE2? If JIT is used to compile the
-         pattern for complete and partial matching (these are not exclusive):
-         pcre2_jit_compile(opc_, PCRE2_JIT_COMPLETE | PCRE2_JIT_PARTIAL_HARD);
-         then pcre2_jit_match() without option PCRE2_PARTIAL_HARD always
-         returns error PCRE2_ERROR_JIT_BADOPTION when we actually want the
-         complete match when the end of the input is reached.  A final complete
-         match is required, because we cannot tell whether the final partial
-         match is also a complete match.  Therefore, pcre2_jit_match() is
-         unusable and disabled below in favor of pcre2_match().
-         */
-#if 0
-      if (jit_ && !(flg & PCRE2_ANCHORED))
-        rc = pcre2_jit_match(opc_, reinterpret_cast<PCRE2_SPTR>(buf_), end_, pos_, flg, dat_, ctx_);
-      else
-#endif
-        rc = pcre2_match(opc_, reinterpret_cast<PCRE2_SPTR>(buf_), end_, pos_, flg, dat_, ctx_);
+      // pcre2_match() checks UTF-8 with PCRE2_UTF and runs the JIT code for complete matching when the rest of the input is buffered, i.e. at EOF or with in-place buffer(base, size) input, otherwise the JIT code for PCRE2_PARTIAL_HARD partial matching runs and a final complete match is made when more input is not available
+      int rc = pcre2_match(opc_, reinterpret_cast<PCRE2_SPTR>(buf_), end_, pos_, flg, dat_, ctx_);
       if (rc > 0)
       {
         PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(dat_);
@@ -455,8 +458,7 @@ class PCRE2Matcher : public PatternMatcher<std::string> {
   uint32_t             flg_; ///< PCRE2 match flags
   pcre2_code          *opc_; ///< compiled PCRE2 code
   pcre2_match_data    *dat_; ///< PCRE2 match data
-  pcre2_match_context *ctx_; ///< PCRE2 match context;
-  pcre2_jit_stack     *stk_; ///< PCRE2 jit match stack
+  pcre2_match_context *ctx_; ///< PCRE2 match context with the JIT stack callback jit_stack()
   PCRE2_SIZE           grp_; ///< last index for group_next_id()
   bool                 jit_; ///< true if jit-compiled PCRE2 code
 };
@@ -0,0 +1,170 @@
+/******************************************************************************\
+* Copyright (c) 2016, Robert van Engelen, Genivia Inc. All rights reserved.    *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+*   (1) Redistributions of source code must retain the above copyright notice, *
+*       this list of conditions and the following disclaimer.                  *
+*                                                                              *
+*   (2) Redistributions in binary form must reproduce the above copyright      *
+*       notice, this list of conditions and the following disclaimer in the    *
+*       documentation and/or other materials provided with the distribution.   *
+*                                                                              *
+*   (3) The name of the author may not be used to endorse or promote products  *
+*       derived from this software without specific prior written permission.  *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF         *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO   *
+* EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       *
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;  *
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,     *
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR      *
+* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF       *
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                                   *
+\******************************************************************************/
+
+/**
+@file      pool.h
+@brief     RE/flex pool of matchers recycled with their buffers
+@author    Robert van Engelen - engelen@genivia.com
+@copyright (c) 2016-2020, Robert van Engelen, Genivia Inc. All rights reserved.
+@copyright (c) BSD-3 License - see LICENSE.txt
+*/
+
+#ifndef REFLEX_POOL_H
+#define REFLEX_POOL_H
+
+#include <reflex/matcher.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace reflex {
+
+/// Thread-safe pool of matchers sharing one pattern, matchers are recycled with their buffers to match many short inputs without allocating.
+/**
+Description
+-----------
+
+A matcher handle acquired from the pool is a `std::unique_ptr` that returns
+the matcher to the pool when the handle is destroyed.  A recycled matcher is
+reset and keeps its input buffer, so acquiring a matcher from the pool after
+the first few requests neither constructs a matcher nor allocates a buffer.
+The initial buffer of a new matcher is sized to fit the input when the size of
+the input is known, see `AbstractMatcher::capacity()`.  Matchers whose buffer
+grew beyond the capacity limit of the pool are deleted instead of recycled,
+which bounds the memory held by the pool.
+
+The pattern is shared by all matchers of the pool, which is safe because a
+pattern is immutable.  The pool must outlive the handles it returns.
+
+Example
+-------
+
+~~~{.cpp}
+    static reflex::MatcherPool<> pool(std::make_shared<reflex::Pattern>("\\w+"));
+    reflex::MatcherPool<>::Handle matcher = pool.acquire(request);
+    while (matcher->find())
+      std::cout << matcher->text() << std::endl;
+~~~
+
+Link with `-pthread` where threads are not part of the C library.
+*/
+template<class M = Matcher> /// @tparam <M> matcher class constructible from a pattern, input, and options
+class MatcherPool {
+ public:
+  typedef typename M::Pattern Pattern; ///< pattern class of the matchers
+  /// Deleter of a matcher handle that returns the matcher to its pool.
+  struct Recycle {
+    Recycle(MatcherPool *pool = nullptr) ///< pool to return the matcher to or nullptr to delete the matcher
+      :
+        pool(pool)
+    { }
+    void operator()(M *matcher) const
+    {
+      if (pool != nullptr)
+        pool->recycle(matcher);
+      else
+        delete matcher;
+    }
+    MatcherPool *pool; ///< pool to return the matcher to
+  };
+  typedef std::unique_ptr<M,Recycle> Handle; ///< matcher handle returns the matcher to the pool when destroyed
+  /// Construct a pool of matchers for the given shared pattern.
+  MatcherPool(
+      const std::shared_ptr<const Pattern>& pattern,                                  ///< shared pattern for the matchers
+      const char                           *opt = nullptr,                            ///< option string of the form `(A|N|T(=[[:digit:]])?|;)*` for the matchers
+      size_t                                max = 64,                                 ///< max number of idle matchers kept in the pool
+      size_t                                cap = 2 * AbstractMatcher::Const::BLOCK)  ///< max buffer capacity of a matcher to recycle it
+    :
+      pat_(pattern),
+      opt_(opt != nullptr ? opt : ""),
+      max_(max),
+      cap_(cap)
+  { }
+  /// Delete the pool and its idle matchers, the pool must outlive the handles it returned.
+  ~MatcherPool()
+  {
+    for (typename std::vector<M*>::iterator i = idle_.begin(); i != idle_.end(); ++i)
+      delete *i;
+  }
+  /// Acquire a matcher to match the given input, recycles an idle matcher when available.
+  Handle acquire(const Input& input = Input()) ///< input character sequence for the matcher
+    /// @returns matcher handle
+  {
+    M *matcher = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (!idle_.empty())
+      {
+        matcher = idle_.back();
+        idle_.pop_back();
+      }
+    }
+    if (matcher != nullptr)
+      matcher->input(input);
+    else
+      matcher = new M(*pat_, input, opt_.c_str());
+    return Handle(matcher, Recycle(this));
+  }
+  /// Returns the number of idle matchers in the pool.
+  size_t idle() const
+    /// @returns number of idle matchers
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return idle_.size();
+  }
+ private:
+  MatcherPool(const MatcherPool&);            ///< not copyable
+  MatcherPool& operator=(const MatcherPool&); ///< not assignable
+  /// Return a matcher to the pool, or delete it when the pool is full or when its buffer grew too large.
+  void recycle(M *matcher) ///< matcher to recycle
+  {
+    // release the input, the matcher keeps its buffer
+    matcher->input(Input());
+    if (matcher->capacity() <= cap_)
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (idle_.size() < max_)
+      {
+        idle_.push_back(matcher);
+        return;
+      }
+    }
+    delete matcher;
+  }
+  std::shared_ptr<const Pattern> pat_;  ///< pattern shared by the matchers
+  std::string                    opt_;  ///< matcher options
+  size_t                         max_;  ///< max number of idle matchers
+  size_t                         cap_;  ///< max buffer capacity of a recycled matcher
+  mutable std::mutex             mtx_;  ///< protects idle_
+  std::vector<M*>                idle_; ///< idle matchers
+};
+
+} // namespace reflex
+
+#endif
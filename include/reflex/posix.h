@@ -38,22 +38,24 @@
 #define REFLEX_POSIX_H
 
 #include <cstring>
-#include <map>
+#include <cstddef>
 
 namespace reflex {
 
 namespace Posix {
 
-class Tables {
- public:
-  struct lt {
-    bool operator()(const char *a, const char *b) const { return std::strcmp(a, b) < 0; }
-  };
-  typedef std::map<const char*,const int*,lt> Range;
-  Tables();
-  Range range;
+/// A named character class, tables of character classes are constant-initialized and sorted by name to look up a class by binary search.
+struct Class {
+  const char *name;  ///< character class name
+  const int  *range; ///< pairs of lo and hi code points of the character class, terminated by 0, 0
 };
 
+/// Returns the ranges of the named character class found by binary search in the table sorted by name, or nullptr when not found.
+const int * find(
+    const Class *table, ///< table of character classes sorted by name
+    size_t       size,  ///< number of character classes in the table
+    const char  *name); ///< name of the character class to find
+
 const int * range(const char *);
 
 }
@@ -42,8 +42,11 @@ This lowers storage overhead and reduces insertion, deletion, and search time.
 #ifndef REFLEX_RANGES_H
 #define REFLEX_RANGES_H
 
+#include <algorithm>  // std::copy, std::lower_bound
 #include <functional> // std::less
-#include <set>        // base class container
+#include <memory>     // std::allocator
+#include <set>        // base class container of Ranges
+#include <vector>     // base class container of FlatRanges
 
 namespace reflex {
 
@@ -72,6 +75,8 @@ is maintained by the `reflex::Ranges` methods.
 
 The `Ranges::value_type` is `std::pair<bound_type,bound_type>` with
 `Ranges::bound_type` the template parameter type `T`.
+The optional template parameter `A` is the allocator of the underlying
+`std::set` container.
 
 The `reflexx::Ranges` class introduces several new methods in addition to the
 inherited `std::set` methods:
@@ -157,13 +162,13 @@ Output:
     contains [1.0,2.5]
 
 */
-template<typename T>
-class Ranges : public std::set< std::pair<T,T>,range_compare<T> > {
+template<typename T,typename A = std::allocator< std::pair<T,T> > >
+class Ranges : public std::set< std::pair<T,T>,range_compare<T>,A > {
  public:
   /// Type of the bounds.
   typedef T bound_type;
   /// Synonym type defining the base class container std::set.
-  typedef typename std::set< std::pair<T,T>,range_compare<T> > container_type;
+  typedef typename std::set< std::pair<T,T>,range_compare<T>,A > container_type;
   /// Synonym type defining the base class container std::set::value_type.
   typedef typename container_type::value_type value_type;
   /// Synonym type defining the key/value comparison std::set::key_compare.
@@ -611,15 +616,15 @@ Output:
    [351,401)
 
 */
-template<typename T>
-class ORanges : public Ranges<T> {
+template<typename T,typename A = std::allocator< std::pair<T,T> > >
+class ORanges : public Ranges<T,A> {
  public:
-  using Ranges<T>::insert;
-  using Ranges<T>::contains;
+  using Ranges<T,A>::insert;
+  using Ranges<T,A>::contains;
   /// Type of the bounds.
   typedef T bound_type;
   /// Synonym type defining the base class container std::set.
-  typedef typename std::set< std::pair<T,T>,range_compare<T> > container_type;
+  typedef typename std::set< std::pair<T,T>,range_compare<T>,A > container_type;
   /// Synonym type defining the base class container std::set::value_type.
   typedef typename container_type::value_type value_type;
   /// Synonym type defining the key/value comparison std::set::key_compare.
@@ -655,7 +660,7 @@ class ORanges : public Ranges<T> {
       const bound_type& hi) ///< upper bound
     /// @returns a pair of an iterator to the range and a flag indicating whether the range was inserted as new.
   {
-    return Ranges<T>::insert(lo, bump(hi));
+    return Ranges<T,A>::insert(lo, bump(hi));
   }
   /// Update ranges to include range [val,val] by merging overlapping and adjacent ranges into one range.
   std::pair<iterator,bool> insert(const bound_type& val) ///< value to insert
@@ -705,7 +710,7 @@ class ORanges : public Ranges<T> {
     const
     /// @returns iterator to the first range that overlaps the given range, or the end iterator.
   {
-    return Ranges<T>::find(bump(lo), hi);
+    return Ranges<T,A>::find(bump(lo), hi);
   }
   /// Find the range that includes the given value.
   const_iterator find(const bound_type& val) ///< value to search for
@@ -825,7 +830,7 @@ class ORanges : public Ranges<T> {
     /// @returns the union of this set and rs.
   {
     ORanges copy(*this);
-    copy.Ranges<T>::operator|=(rs);
+    copy.Ranges<T,A>::operator|=(rs);
     return copy;
   }
   /// Returns the union of two range sets.
@@ -834,7 +839,7 @@ class ORanges : public Ranges<T> {
     /// @returns the union of this set and rs.
   {
     ORanges copy(*this);
-    copy.Ranges<T>::operator+=(rs);
+    copy.Ranges<T,A>::operator+=(rs);
     return copy;
   }
   /// Returns the difference of two open-ended range sets.
@@ -932,6 +937,545 @@ class ORanges : public Ranges<T> {
   }
 };
 
+/// RE/flex FlatRanges template class.
+/**
+The FlatRanges class is an alternative to the Ranges class that stores the
+disjoint ranges [lo,hi] in a `std::vector` sorted by bounds, rather than in a
+`std::set`.  FlatRanges has the same API as Ranges (except that `insert()`
+invalidates iterators), with lower memory overhead and better cache locality.
+Range set operations `|=`, `&=` and `-=` merge the sorted ranges in linear
+time into a new vector without allocating a tree node per range.  Inserting a
+single range moves the ranges that follow it, which is fast for the small to
+moderate numbers of ranges of character classes and location sets.
+
+The FlatRanges class is used by FlatORanges, which is used by the regex
+converter to compute Unicode character classes and by the pattern compiler to
+store locations and hashes.
+*/
+template<typename T,typename A = std::allocator< std::pair<T,T> > >
+class FlatRanges : public std::vector< std::pair<T,T>,A > {
+ public:
+  /// Type of the bounds.
+  typedef T bound_type;
+  /// Synonym type defining the base class container std::vector.
+  typedef typename std::vector< std::pair<T,T>,A > container_type;
+  /// Synonym type defining the base class container std::vector::value_type.
+  typedef typename container_type::value_type value_type;
+  /// Synonym type defining the range comparison, same as Ranges::key_compare.
+  typedef range_compare<T> key_compare;
+  typedef range_compare<T> value_compare;
+  /// Synonym type defining the base class container std::vector::iterator.
+  typedef typename container_type::iterator iterator;
+  /// Synonym type defining the base class container std::vector::const_iterator.
+  typedef typename container_type::const_iterator const_iterator;
+  /// Construct an empty range.
+  FlatRanges()
+  { }
+  /// Construct a copy of a range [lo,hi].
+  FlatRanges(const value_type& r)
+  {
+    insert(r);
+  }
+  /// Construct a range [lo,hi].
+  FlatRanges(
+      const bound_type& lo, ///< lower bound
+      const bound_type& hi) ///< upper bound
+  {
+    insert(lo, hi);
+  }
+  /// Construct a singleton range [val,val].
+  FlatRanges(const bound_type& val) ///< value
+  {
+    insert(val, val);
+  }
+  /// Update ranges to include range [lo,hi] by merging overlapping ranges into one range.
+  std::pair<iterator,bool> insert(const value_type& r) ///< range
+    /// @returns a pair of an iterator to the range and a flag indicating whether the range was inserted as new.
+  {
+    return insert(r.first, r.second);
+  }
+  /// Update ranges to include range [lo,hi] by merging overlapping ranges into one range.
+  std::pair<iterator,bool> insert(
+      const bound_type& lo, ///< lower bound
+      const bound_type& hi) ///< upper bound
+    /// @returns a pair of an iterator to the range and a flag indicating whether the range was inserted as new.
+  {
+    // r = [lo,hi]
+    value_type r(lo, hi);
+    iterator i = lower(lo);
+    // if [lo,hi] does not overlap any range then insert [lo,hi]
+    if (i == this->end() || std::less<bound_type>()(hi, i->first))
+      return std::pair<iterator,bool>(container_type::insert(i, r), true);
+    // if [lo,hi] is subsumed by a range then return without inserting
+    if (!std::less<bound_type>()(lo, i->first) && !std::less<bound_type>()(i->second, hi))
+      return std::pair<iterator,bool>(i, false);
+    // merge the ranges that overlap with [lo,hi] into range i
+    iterator j = i;
+    do
+    {
+      if (std::less<bound_type>()(j->first, r.first)) // lo = min(lo, j.lo)
+        r.first = j->first;
+      if (std::less<bound_type>()(r.second, j->second)) // hi = max(hi, j.hi)
+        r.second = j->second;
+      ++j;
+    }
+    while (j != this->end() && !std::less<bound_type>()(hi, j->first));
+    *i = r;
+    container_type::erase(i + 1, j);
+    return std::pair<iterator,bool>(i, true);
+  }
+  /// Update ranges to include the range [val,val].
+  std::pair<iterator,bool> insert(const bound_type& val) ///< value to insert
+    /// @returns a pair of an iterator to the range and a flag indicating whether the range was inserted as new.
+  {
+    return insert(val, val);
+  }
+  /// Find the first range [lo',hi'] that overlaps the given range [lo,hi], i.e. lo <= hi' and lo' <= hi.
+  const_iterator find(
+      const bound_type& lo, ///< lower bound
+      const bound_type& hi) ///< upper bound
+    const
+    /// @returns iterator to the first range that overlaps the given range, or the end iterator.
+  {
+    const_iterator i = lower(lo);
+    if (i != this->end() && !std::less<bound_type>()(hi, i->first))
+      return i;
+    return this->end();
+  }
+  /// Find the range [lo',hi'] that includes the given value val, i.e. lo' <= val <= hi'.
+  const_iterator find(const bound_type& val) ///< value to search for
+    const
+    /// @returns iterator to the range that includes the value, or the end iterator.
+  {
+    return find(val, val);
+  }
+  /// Update ranges to insert the given range set, merges the ranges in linear time.
+  FlatRanges& operator|=(const FlatRanges& rs) ///< ranges to insert
+    /// @returns reference to this object.
+  {
+    if (rs.empty())
+      return *this;
+    if (this->empty())
+      return *this = rs;
+    container_type r(this->get_allocator());
+    r.reserve(this->size() + rs.size());
+    const_iterator i = this->begin();
+    const_iterator j = rs.begin();
+    while (i != this->end() || j != rs.end())
+    {
+      const value_type& k = j == rs.end() || (i != this->end() && std::less<bound_type>()(i->first, j->first)) ? *i++ : *j++;
+      if (r.empty() || std::less<bound_type>()(r.back().second, k.first))
+        r.push_back(k);
+      else if (std::less<bound_type>()(r.back().second, k.second))
+        r.back().second = k.second;
+    }
+    container_type::swap(r);
+    return *this;
+  }
+  /// Update ranges to insert the ranges of the given range set, same as FlatRanges::operator|=(rs).
+  FlatRanges& operator+=(const FlatRanges& rs) ///< ranges to insert
+    /// @returns reference to this object.
+  {
+    return operator|=(rs);
+  }
+  /// Update ranges to intersect the ranges with the given range set.
+  FlatRanges& operator&=(const FlatRanges& rs) ///< ranges to intersect
+    /// @returns reference to this object.
+  {
+    intersect(rs, false);
+    return *this;
+  }
+  /// Returns the union of two range sets.
+  FlatRanges operator|(const FlatRanges& rs) ///< ranges to merge
+    const
+    /// @returns the union of this set and rs.
+  {
+    return FlatRanges(*this) |= rs;
+  }
+  /// Returns the union of two range sets, same as FlatRanges::operator|(rs).
+  FlatRanges operator+(const FlatRanges& rs) ///< ranges to merge
+    const
+    /// @returns the union of this set and rs.
+  {
+    return FlatRanges(*this) |= rs;
+  }
+  /// Returns the intersection of two range sets.
+  FlatRanges operator&(const FlatRanges& rs) ///< range set to intersect
+    const
+    /// @returns the intersection of this range set and rs.
+  {
+    return FlatRanges(*this) &= rs;
+  }
+  /// True if this range set is lexicographically less than range set rs.
+  bool operator<(const FlatRanges& rs) ///< ranges
+    const
+    /// @returns true if this range set is less than rs.
+  {
+    const_iterator i = this->begin();
+    const_iterator j = rs.begin();
+    while (i != this->end() && j != rs.end())
+    {
+      if (std::less<bound_type>()(i->first, j->first))
+        return true;
+      if (std::less<bound_type>()(j->first, i->first))
+        return false;
+      if (std::less<bound_type>()(i->second, j->second))
+        return true;
+      if (std::less<bound_type>()(j->second, i->second))
+        return false;
+      ++i;
+      ++j;
+    }
+    return false;
+  }
+  /// True if this range set is lexicographically greater than range set rs.
+  bool operator>(const FlatRanges& rs) ///< ranges
+    const
+    /// @returns true if this range set is greater than rs.
+  {
+    return rs.operator<(*this);
+  }
+  /// True if this range set is lexicographically less or equal to range set rs.
+  bool operator<=(const FlatRanges& rs) ///< ranges
+    const
+    /// @returns true if this range set is less or equal to rs.
+  {
+    return !operator>(rs);
+  }
+  /// True if this range set is lexicographically greater or equal to range set rs.
+  bool operator>=(const FlatRanges& rs) ///< ranges
+    const
+    /// @returns true if this is greater or equal to rs.
+  {
+    return !operator<(rs);
+  }
+  /// Return true if this set of ranges contains at least one range, i.e. is not empty.
+  bool any() const
+    /// @returns true if non empty, false if empty.
+  {
+    return !container_type::empty();
+  }
+  /// Return true if this set of ranges intersects with ranges rs, i.e. this set has at least one range [lo',hi'] that overlaps with a range [lo,hi] in rs such that lo <= hi' and lo' <= hi.
+  bool intersects(const FlatRanges& rs) ///< ranges
+    const
+    /// @returns true if this set intersects rs.
+  {
+    return overlaps(rs, false);
+  }
+  /// Return true if this set of ranges contains all ranges in rs, i.e. rs is a subset of this set which means that for each range [lo,hi] in rs, there is a range [lo',hi'] such that lo' <= lo and hi <= hi'.
+  bool contains(const FlatRanges& rs) ///< ranges
+    const
+    /// @returns true if this set contains rs.
+  {
+    const_iterator i = this->begin();
+    for (const_iterator j = rs.begin(); j != rs.end(); ++j)
+    {
+      while (i != this->end() && std::less<bound_type>()(i->second, j->first))
+        ++i;
+      if (i == this->end() || std::less<bound_type>()(j->first, i->first) || std::less<bound_type>()(i->second, j->second))
+        return false;
+    }
+    return true;
+  }
+  /// Return the lowest value in the set of ranges (the set cannot be empty)
+  bound_type lo() const
+    /// @returns lowest value
+  {
+    return this->front().first;
+  }
+  /// Return the highest value in the set of ranges (the set cannot be empty)
+  bound_type hi() const
+    /// @returns highest value
+  {
+    return this->back().second;
+  }
+ protected:
+  /// Returns the first range [lo',hi'] such that lo <= hi'.
+  iterator lower(const bound_type& lo)
+    /// @returns iterator to the range or the end iterator.
+  {
+    return std::lower_bound(this->begin(), this->end(), value_type(lo, lo), key_compare());
+  }
+  /// Returns the first range [lo',hi'] such that lo <= hi'.
+  const_iterator lower(const bound_type& lo)
+    const
+    /// @returns iterator to the range or the end iterator.
+  {
+    return std::lower_bound(this->begin(), this->end(), value_type(lo, lo), key_compare());
+  }
+  /// Intersect the ranges with the given range set in linear time, where open-ended ranges [lo,hi) do not intersect when they are adjacent.
+  void intersect(
+      const FlatRanges& rs,   ///< ranges to intersect
+      bool              open) ///< true if the ranges are open-ended
+  {
+    container_type r(this->get_allocator());
+    const_iterator i = this->begin();
+    const_iterator j = rs.begin();
+    while (i != this->end() && j != rs.end())
+    {
+      const bound_type& lo = std::less<bound_type>()(i->first, j->first) ? j->first : i->first;
+      const bound_type& hi = std::less<bound_type>()(i->second, j->second) ? i->second : j->second;
+      if (open ? std::less<bound_type>()(lo, hi) : !std::less<bound_type>()(hi, lo))
+        r.push_back(value_type(lo, hi));
+      if (std::less<bound_type>()(i->second, j->second))
+        ++i;
+      else
+        ++j;
+    }
+    container_type::swap(r);
+  }
+  /// Return true if the ranges intersect with the given range set, where open-ended ranges [lo,hi) do not intersect when they are adjacent.
+  bool overlaps(
+      const FlatRanges& rs,   ///< ranges
+      bool              open) ///< true if the ranges are open-ended
+    const
+    /// @returns true if this set intersects rs.
+  {
+    const_iterator i = this->begin();
+    const_iterator j = rs.begin();
+    while (i != this->end() && j != rs.end())
+    {
+      const bound_type& lo = std::less<bound_type>()(i->first, j->first) ? j->first : i->first;
+      const bound_type& hi = std::less<bound_type>()(i->second, j->second) ? i->second : j->second;
+      if (open ? std::less<bound_type>()(lo, hi) : !std::less<bound_type>()(hi, lo))
+        return true;
+      if (std::less<bound_type>()(i->second, j->second))
+        ++i;
+      else
+        ++j;
+    }
+    return false;
+  }
+};
+
+/// RE/flex FlatORanges (open-ended, ordinal value range) template class.
+/**
+The FlatORanges class is an alternative to the ORanges class that stores the
+open-ended ranges `[lo,hi+1)` in a `std::vector` sorted by bounds, see
+FlatRanges.  FlatORanges has the same API as ORanges.
+
+Example:
+
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~{.cpp}
+    reflex::FlatORanges<int> ints(0, 0x10FFFF);
+    ints -= reflex::FlatORanges<int>(0xD800, 0xDFFF);
+    for (reflex::FlatORanges<int>::const_iterator i = ints.begin(); i != ints.end(); ++i)
+      std::cout << "[" << i->first << "," << i->second << ")" << std::endl;
+~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+Output:
+
+   [0,55296)
+   [57344,1114112)
+
+*/
+template<typename T,typename A = std::allocator< std::pair<T,T> > >
+class FlatORanges : public FlatRanges<T,A> {
+ public:
+  using FlatRanges<T,A>::insert;
+  using FlatRanges<T,A>::contains;
+  /// Type of the bounds.
+  typedef T bound_type;
+  /// Synonym type defining the base class container std::vector.
+  typedef typename std::vector< std::pair<T,T>,A > container_type;
+  /// Synonym type defining the base class container std::vector::value_type.
+  typedef typename container_type::value_type value_type;
+  /// Synonym type defining the range comparison, same as ORanges::key_compare.
+  typedef range_compare<T> key_compare;
+  typedef range_compare<T> value_compare;
+  /// Synonym type defining the base class container std::vector::iterator.
+  typedef typename container_type::iterator iterator;
+  /// Synonym type defining the base class container std::vector::const_iterator.
+  typedef typename container_type::const_iterator const_iterator;
+  /// Construct an empty range.
+  FlatORanges()
+  { }
+  /// Construct a copy of a range [lo,hi].
+  FlatORanges(const value_type& r) ///< range
+  {
+    insert(r.first, r.second);
+  }
+  /// Construct a range [lo,hi].
+  FlatORanges(
+      const bound_type& lo, ///< lower bound
+      const bound_type& hi) ///< upper bound
+  {
+    insert(lo, hi);
+  }
+  /// Construct a singleton range [val,val].
+  FlatORanges(const bound_type& val) ///< value
+  {
+    insert(val, val);
+  }
+  /// Update ranges to include range [lo,hi] by merging overlapping and adjacent ranges into one range.
+  std::pair<iterator,bool> insert(
+      const bound_type& lo, ///< lower bound
+      const bound_type& hi) ///< upper bound
+    /// @returns a pair of an iterator to the range and a flag indicating whether the range was inserted as new.
+  {
+    return FlatRanges<T,A>::insert(lo, bump(hi));
+  }
+  /// Update ranges to include range [val,val] by merging overlapping and adjacent ranges into one range.
+  std::pair<iterator,bool> insert(const bound_type& val) ///< value to insert
+    /// @returns a pair of an iterator to the range and a flag indicating whether the range was inserted as new.
+  {
+    return insert(val, val);
+  }
+  /// Update ranges by deleting the given range [lo,hi].
+  bool erase(
+      const bound_type& lo, ///< lower bound
+      const bound_type& hi) ///< upper bound
+    /// @returns true if ranges was updated.
+  {
+    iterator i = this->lower(bump(lo));
+    // if [lo,hi] does not overlap any range in the set then return
+    if (i == this->end() || std::less<bound_type>()(hi, i->first))
+      return false;
+    iterator j = i;
+    while (j != this->end() && !std::less<bound_type>()(hi, j->first))
+      ++j;
+    // replace the ranges i to j-1 by the remaining partial ranges, if any
+    value_type parts[2];
+    size_t n = 0;
+    if (std::less<bound_type>()(i->first, lo))
+      parts[n++] = value_type(i->first, lo);
+    if (std::less<bound_type>()(bump(hi), (j - 1)->second))
+      parts[n++] = value_type(bump(hi), (j - 1)->second);
+    if (n > static_cast<size_t>(j - i))
+    {
+      *i = parts[0];
+      container_type::insert(i + 1, parts[1]);
+    }
+    else
+    {
+      std::copy(parts, parts + n, i);
+      container_type::erase(i + n, j);
+    }
+    return true;
+  }
+  /// Update ranges by deleting the given range [val,val].
+  bool erase(const bound_type& val) ///< value to delete
+    /// @returns true if ranges was updated.
+  {
+    return erase(val, val);
+  }
+  /// Find the first range that overlaps the given range.
+  const_iterator find(
+      const bound_type& lo, ///< lower bound
+      const bound_type& hi) ///< upper bound
+    const
+    /// @returns iterator to the first range that overlaps the given range, or the end iterator.
+  {
+    return FlatRanges<T,A>::find(bump(lo), hi);
+  }
+  /// Find the range that includes the given value.
+  const_iterator find(const bound_type& val) ///< value to search for
+    const
+    /// @returns iterator to the range that includes the value, or the end iterator.
+  {
+    return find(val, val);
+  }
+  /// Update ranges to remove ranges rs, in linear time.
+  FlatORanges& operator-=(const FlatORanges& rs)
+    /// @returns reference to this object.
+  {
+    if (this->empty() || rs.empty())
+      return *this;
+    container_type r(this->get_allocator());
+    r.reserve(this->size() + rs.size());
+    const_iterator j = rs.begin();
+    for (const_iterator i = this->begin(); i != this->end(); ++i)
+    {
+      value_type k = *i;
+      // skip ranges in rs that end before range k
+      while (j != rs.end() && !std::less<bound_type>()(k.first, j->second))
+        ++j;
+      // cut the ranges in rs that overlap with range k out of k
+      for (const_iterator l = j; l != rs.end() && std::less<bound_type>()(l->first, k.second); ++l)
+      {
+        if (std::less<bound_type>()(k.first, l->first))
+          r.push_back(value_type(k.first, l->first));
+        if (!std::less<bound_type>()(l->second, k.second))
+        {
+          k.first = k.second;
+          break;
+        }
+        k.first = l->second;
+      }
+      if (std::less<bound_type>()(k.first, k.second))
+        r.push_back(k);
+    }
+    container_type::swap(r);
+    return *this;
+  }
+  /// Update ranges to intersect the ranges of the given range set.
+  FlatORanges& operator&=(const FlatORanges& rs) ///< ranges to intersect
+    /// @returns reference to this object.
+  {
+    this->intersect(rs, true);
+    return *this;
+  }
+  /// Returns the union of two range sets.
+  FlatORanges operator|(const FlatORanges& rs) ///< ranges to merge
+    const
+    /// @returns the union of this set and rs.
+  {
+    FlatORanges copy(*this);
+    copy.FlatRanges<T,A>::operator|=(rs);
+    return copy;
+  }
+  /// Returns the union of two range sets.
+  FlatORanges operator+(const FlatORanges& rs) ///< ranges to merge
+    const
+    /// @returns the union of this set and rs.
+  {
+    FlatORanges copy(*this);
+    copy.FlatRanges<T,A>::operator+=(rs);
+    return copy;
+  }
+  /// Returns the difference of two open-ended range sets.
+  FlatORanges operator-(const FlatORanges& rs) ///< ranges
+    const
+    /// @returns the difference of this set and rs.
+  {
+    return FlatORanges(*this) -= rs;
+  }
+  /// Returns the intersection of two open-ended range sets.
+  FlatORanges operator&(const FlatORanges& rs) ///< ranges to intersect
+    const
+    /// @returns the intersection of this set and rs.
+  {
+    return FlatORanges(*this) &= rs;
+  }
+  /// Return true if this set of ranges intersects with ranges rs, i.e. this set has at least one range [lo',hi'] that overlaps with a range [lo,hi] in rs such that lo <= hi' and lo' <= hi.
+  bool intersects(const FlatORanges& rs) ///< ranges
+    const
+    /// @returns true if this set intersects rs.
+  {
+    return this->overlaps(rs, true);
+  }
+  /// Return the highest value in the set of ranges (the set cannot be empty)
+  bound_type hi() const
+    /// @returns highest value
+  {
+    return this->back().second - static_cast<bound_type>(1);
+  }
+ private:
+  /// Bump value.
+  static inline bound_type bump(bound_type val) ///< the value to bump
+    /// @returns val + 1.
+  {
+#ifdef WITH_ORANGES_CLAMPED
+    bound_type lav = ~val - 1; // trick to get around -Wstrict-overflow warning for signed types
+    if (std::less<bound_type>()(~lav, val)) // check integer overflow, if overflow do not bump
+      return val;
+    return ~lav;
+#else
+    return static_cast<bound_type>(val + static_cast<bound_type>(1));
+#endif
+  }
+};
+
 } // namespace reflex
 
 #endif
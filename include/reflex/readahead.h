@@ -0,0 +1,249 @@
+/******************************************************************************\
+* Copyright (c) 2016, Robert van Engelen, Genivia Inc. All rights reserved.    *
+*                                                                              *
+* Redistribution and use in source and binary forms, with or without           *
+* modification, are permitted provided that the following conditions are met:  *
+*                                                                              *
+*   (1) Redistributions of source code must retain the above copyright notice, *
+*       this list of conditions and the following disclaimer.                  *
+*                                                                              *
+*   (2) Redistributions in binary form must reproduce the above copyright      *
+*       notice, this list of conditions and the following disclaimer in the    *
+*       documentation and/or other materials provided with the distribution.   *
+*                                                                              *
+*   (3) The name of the author may not be used to endorse or promote products  *
+*       derived from this software without specific prior written permission.  *
+*                                                                              *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED *
+* WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF         *
+* MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO   *
+* EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,       *
+* SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, *
+* PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;  *
+* OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,     *
+* WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR      *
+* OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF       *
+* ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.                                   *
+\******************************************************************************/
+
+/**
+@file      readahead.h
+@brief     RE/flex asynchronous double-buffered read-ahead of FILE* and std::istream input
+@author    Robert van Engelen - engelen@genivia.com
+@copyright (c) 2016-2020, Robert van Engelen, Genivia Inc. All rights reserved.
+@copyright (c) BSD-3 License - see LICENSE.txt
+*/
+
+
+#ifndef REFLEX_READAHEAD_H
+#define REFLEX_READAHEAD_H
+
+#include <reflex/input.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace reflex {
+
+/// Input source that reads a `FILE*` or `std::istream` input ahead in a background thread, so reading the next block overlaps with matching the current block.
+/**
+Description
+-----------
+
+The background thread reads blocks of input into two buffers in turn.  The
+consumer, usually a matcher, copies data from one buffer while the thread
+fills the other.  The input is read and converted to UTF-8 by the underlying
+`reflex::Input` object as usual.
+
+When no data is available yet from a non-blocking `FILE*` source, the
+`reflex::Input::Handler` of the input is invoked by the consumer's thread, not
+by the background thread, so the handler may safely change the consumer's
+state.  The buffer shift handler of a matcher is unaffected, because the
+matcher still receives all input through `AbstractMatcher::get()`.
+
+The input passed to `ReadAhead::input()` should not be used afterwards.  The
+background thread is joined when the last copy of the returned input is
+destroyed or cleared, which waits for a blocking read to return.
+
+Example
+-------
+
+~~~{.cpp}
+    reflex::Matcher matcher("\\w+", reflex::ReadAhead::input(reflex::Input(stdin)));
+    while (matcher.find())
+      std::cout << matcher.text() << std::endl;
+~~~
+
+Link with `-pthread` where threads are not part of the C library.
+*/
+class ReadAhead : public Input::Source {
+ public:
+  /// Default size of the blocks read ahead.
+  static const size_t BLOCK = 65536;
+  /// Create an input that reads the given input ahead in a background thread.
+  static Input input(
+      const Input& input,         ///< FILE* or std::istream input to read ahead, should not be used afterwards
+      size_t       block = BLOCK) ///< size of the blocks read ahead
+    /// @returns input reading from a new ReadAhead source
+  {
+    return Input(std::shared_ptr<Input::Source>(new ReadAhead(input, block)));
+  }
+  /// Start reading the given input ahead in a background thread.
+  ReadAhead(
+      const Input& input,         ///< FILE* or std::istream input to read ahead, should not be used afterwards
+      size_t       block = BLOCK) ///< size of the blocks read ahead
+    :
+      in_(input),
+      han_(input.get_handler()),
+      blk_(block > 0 ? block : BLOCK),
+      cur_(0),
+      pos_(0),
+      stall_(false),
+      done_(false),
+      stop_(false)
+  {
+    in_.set_handler(nullptr);
+    for (int i = 0; i < 2; ++i)
+    {
+      buf_[i].resize(blk_);
+      len_[i] = 0;
+    }
+    thr_ = std::thread(&ReadAhead::read, this);
+  }
+  /// Stop reading ahead, waits for the background thread to finish its current read.
+  ~ReadAhead()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      stop_ = true;
+    }
+    cnd_.notify_all();
+    thr_.join();
+  }
+  /// Copy input data read ahead into buffer, waits for the background thread when no data was read ahead yet.
+  size_t get(
+      char  *s, ///< points to the string buffer to fill with input
+      size_t n) ///< size of buffer pointed to by s
+    /// @returns the nonzero number of (less or equal to n) bytes added to buffer s, or zero when EOF, an error occurred, or no data is available from a non-blocking FILE*
+    override
+  {
+    size_t k = 0;
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (stall_)
+    {
+      // no data was available the last time, read again
+      stall_ = false;
+      cnd_.notify_all();
+    }
+    while (k < n)
+    {
+      if (len_[cur_] > 0)
+      {
+        size_t l = std::min(n - k, len_[cur_] - pos_);
+        std::memcpy(s + k, &buf_[cur_][pos_], l);
+        k += l;
+        pos_ += l;
+        if (pos_ >= len_[cur_])
+        {
+          // release the consumed buffer to the background thread
+          len_[cur_] = 0;
+          pos_ = 0;
+          cur_ ^= 1;
+          cnd_.notify_all();
+        }
+      }
+      else if (k > 0 || done_)
+      {
+        break;
+      }
+      else if (stall_)
+      {
+        // no data available, invoke the handler in this thread like Input::get() does for a FILE*
+        if (han_ == nullptr)
+          break;
+        lock.unlock();
+        int more = (*han_)();
+        lock.lock();
+        if (more == 0)
+          break;
+        stall_ = false;
+        cnd_.notify_all();
+      }
+      else
+      {
+        cnd_.wait(lock);
+      }
+    }
+    return k;
+  }
+  /// Check if input is available.
+  bool good() const override
+    /// @returns true if data was read ahead or the input has no EOF or error state
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return len_[cur_] > 0 || (!done_ && !stall_);
+  }
+  /// Check if input reached EOF.
+  bool eof() const override
+    /// @returns true if input is at EOF and all data read ahead was consumed
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return len_[cur_] == 0 && done_;
+  }
+ protected:
+  /// The background thread reads blocks into the free buffer until EOF.
+  void read()
+  {
+    size_t w = 0;
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (!stop_)
+    {
+      if (len_[w] > 0 || stall_)
+      {
+        cnd_.wait(lock);
+        continue;
+      }
+      lock.unlock();
+      size_t k = in_.get(&buf_[w][0], blk_);
+      bool eof = k == 0 && in_.eof();
+      lock.lock();
+      if (k > 0)
+      {
+        len_[w] = k;
+        w ^= 1;
+      }
+      else if (eof)
+      {
+        done_ = true;
+      }
+      else
+      {
+        // no data available from a non-blocking FILE* or an error occurred, let the consumer decide
+        stall_ = true;
+      }
+      cnd_.notify_all();
+      if (done_)
+        break;
+    }
+  }
+  Input                   in_;     ///< the input read by the background thread
+  Input::Handler         *han_;    ///< the handler of the input invoked by the consumer
+  size_t                  blk_;    ///< block size
+  std::vector<char>       buf_[2]; ///< the two buffers, one is consumed while the other is filled
+  size_t                  len_[2]; ///< length of the data in each buffer, zero when the buffer is free
+  size_t                  cur_;    ///< the buffer consumed
+  size_t                  pos_;    ///< position in the buffer consumed
+  bool                    stall_;  ///< no data was available, the background thread waits for the consumer to read again
+  bool                    done_;   ///< EOF was reached by the background thread
+  bool                    stop_;   ///< stop the background thread
+  mutable std::mutex      mtx_;    ///< protects the state shared with the background thread
+  std::condition_variable cnd_;    ///< signals state changes to the consumer and the background thread
+  std::thread             thr_;    ///< the background thread
+};
+
+} // namespace reflex
+
+#endif
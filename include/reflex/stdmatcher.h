@@ -419,7 +419,7 @@ class StdEcmaMatcher : public StdMatcher {
   virtual PatternMatcher& pattern(const Pattern *pattern) ///< std::regex for this matcher
     /// @returns this matcher.
   {
-    assert(!(pattern.flags() & (std::regex::basic | std::regex::extended | std::regex::awk)));
+    assert(!(pattern->flags() & (std::regex::basic | std::regex::extended | std::regex::awk)));
     return StdMatcher::pattern(pattern);
   }
   /// Set the pattern from a regex string to use with this matcher.
@@ -500,7 +500,7 @@ class StdPosixMatcher : public StdMatcher {
   virtual PatternMatcher& pattern(const Pattern *pattern) ///< std::regex for this matcher
     /// @returns this matcher.
   {
-    assert(pattern.flags() & std::regex::awk);
+    assert(pattern->flags() & std::regex::awk);
     return StdMatcher::pattern(pattern);
   }
   /// Set the pattern from a regex string to use with this matcher.
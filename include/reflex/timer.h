@@ -28,7 +28,7 @@
 
 /**
 @file      timer.h
-@brief     Measure elapsed wall-clock time in milliseconds
+@brief     Measure elapsed time with a monotonic clock in milliseconds or nanoseconds
 @author    Robert van Engelen - engelen@genivia.com
 @copyright (c) 2016-2020, Robert van Engelen, Genivia Inc. All rights reserved.
 @copyright (c) BSD-3 License - see LICENSE.txt
@@ -37,69 +37,34 @@
 #ifndef REFLEX_TIMER_H
 #define REFLEX_TIMER_H
 
-#if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__CYGWIN__) || defined(__MINGW32__) || defined(__MINGW64__) || defined(__BORLANDC__)
-
-#include <windows.h>
+#include <chrono>
+#include <cstdint>
 
 namespace reflex {
 
-typedef SYSTEMTIME timer_type;
+typedef std::chrono::steady_clock::time_point timer_type;
 
 /// Start timer.
 inline void timer_start(timer_type& t) ///< timer to be initialized
 {
-  GetLocalTime(&t);
-}
-
-/// Return elapsed time in milliseconds (ms) since the last call up to 1 minute (wraps if elapsed time exceeds 1 minute!)
-inline float timer_elapsed(timer_type& t) ///< timer to be updated
-{
-  timer_type now;
-  GetLocalTime(&now);
-  float sec = now.wMilliseconds;
-  sec -= t.wMilliseconds;
-  t.wMilliseconds = now.wMilliseconds;
-  sec += 1000.0f * (now.wSecond - t.wSecond);
-  t.wSecond = now.wSecond;
-  if (sec < 0.0)
-    sec += 60000.0;
-  return sec;
+  t = std::chrono::steady_clock::now();
 }
 
-} // namespace reflex
-
-#else
-
-#include <cstddef>
-#include <sys/time.h>
-
-namespace reflex {
-
-typedef timeval timer_type;
-
-/// Start timer.
-inline void timer_start(timer_type& t) ///< timer to be initialized
+/// Return elapsed time in nanoseconds (ns) since the last call, the timer is monotonic and does not wrap.
+inline uint64_t timer_elapsed_ns(timer_type& t) ///< timer to be updated
 {
-  gettimeofday(&t, nullptr);
+  timer_type now = std::chrono::steady_clock::now();
+  uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - t).count());
+  t = now;
+  return ns;
 }
 
-/// Return elapsed time in milliseconds (ms) with microsecond precision since the last call up to 1 minute (wraps if elapsed time exceeds 1 minute!)
+/// Return elapsed time in milliseconds (ms) with nanosecond precision since the last call.
 inline float timer_elapsed(timer_type& t) ///< timer to be updated
 {
-  timer_type now;
-  gettimeofday(&now, nullptr);
-  float sec = now.tv_usec;
-  sec -= t.tv_usec;
-  t.tv_usec = now.tv_usec;
-  sec = 1000.0 * (now.tv_sec - t.tv_sec) + sec/1000.0;
-  t.tv_sec = now.tv_sec;
-  if (sec < 0.0)
-    sec += 60000.0;
-  return sec;
+  return static_cast<float>(static_cast<double>(timer_elapsed_ns(t)) / 1000000.0);
 }
 
 } // namespace reflex
 
 #endif
-
-#endif
@@ -43,14 +43,17 @@ namespace reflex {
 
 namespace Unicode {
 
-class Tables : public Posix::Tables {
- public:
-  Tables();
- private:
-  void block_scripts(void);
-  void language_scripts(void);
-  void letter_scripts(void);
-};
+/// Unicode block character classes sorted by name, generated by unicode/block_scripts.l.
+extern const Posix::Class block_scripts[];
+extern const size_t       block_scripts_size;
+
+/// Unicode language script and category character classes sorted by name, generated by unicode/language_scripts.l.
+extern const Posix::Class language_scripts[];
+extern const size_t       language_scripts_size;
+
+/// Unicode letter case character classes sorted by name, generated by unicode/letter_scripts.l.
+extern const Posix::Class letter_scripts[];
+extern const size_t       letter_scripts_size;
 
 const int * range(const char *);
 
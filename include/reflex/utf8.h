@@ -72,6 +72,16 @@ std::string utf8(
   /// @returns regex string to match the UCS range encoded in UTF-8
   ;
 
+/// Convert a sorted list of disjoint UCS-4 ranges [a,b] to a UTF-8 regex pattern factored by common byte prefixes and suffixes.
+std::string utf8(
+    const int  *ranges,    ///< points to n pairs of lower and upper bounds of UCS ranges, in ascending order
+    size_t      n,         ///< number of range pairs
+    int         esc = 'x', ///< escape char 'x' for hex \xXX, or '0' or '\0' for octal \0nnn and \nnn
+    const char *par = "(", ///< capturing or non-capturing parenthesis "(?:"
+    bool strict = true)    ///< returned regex is strict UTF-8 (true) or permissive and lean UTF-8 (false)
+  /// @returns regex string to match the UCS ranges encoded in UTF-8, as alternations without enclosing parenthesis
+  ;
+
 /// Convert UCS-4 to UTF-8, fills with REFLEX_NONCHAR_UTF8 when out of range, or unrestricted UTF-8 with WITH_UTF8_UNRESTRICTED.
 inline size_t utf8(
     int   c, ///< UCS-4 character U+0000 to U+10ffff (unless WITH_UTF8_UNRESTRICTED)
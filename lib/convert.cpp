@@ -39,9 +39,13 @@
 #include <reflex/ranges.h>
 #include <reflex/unicode.h>
 #include <reflex/utf8.h>
+#include <algorithm>
 #include <cctype>
 #include <cstdlib>
 #include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
 
 namespace reflex {
 
@@ -98,70 +102,73 @@ static std::string posix_class(const char *s, int esc)
   return regex;
 }
 
+/// max number of UTF-8 regex expansions of Unicode classes kept in the cache before it is cleared
+static const size_t utf8_cache_max = 256;
+
+/// Convert UCS ranges to a UTF-8 regex, memoized by key: the UTF-8 regex expansions of large Unicode classes such as \p{L} and \w are reused by all rules of a lexer specification that use them.
+static std::string utf8_cached(std::string& key, const std::vector<int>& ranges, int esc, const char *par, convert_flag_type flags)
+{
+  static std::mutex mutex;
+  static std::map<std::string,std::string> cache;
+  bool strict = !(flags & convert_flag::permissive);
+  key.push_back(static_cast<char>(esc));
+  key.push_back(strict ? 's' : 'p');
+  key.append(par);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<std::string,std::string>::const_iterator i = cache.find(key);
+    if (i != cache.end())
+      return i->second;
+  }
+  std::string regex = utf8(ranges.data(), ranges.size() / 2, esc, par, strict);
+  std::lock_guard<std::mutex> lock(mutex);
+  if (cache.size() >= utf8_cache_max)
+    cache.clear();
+  cache[key] = regex;
+  return regex;
+}
+
 static std::string unicode_class(const char *s, int esc, convert_flag_type flags, const char *par)
 {
   std::string regex;
   const int *wc = Unicode::range(s + (s[0] == '^'));
   if (wc != nullptr)
   {
+    std::vector<int> ranges;
     if (s[0] == '^') // inverted class \P{C} or \p{^C}
     {
-      if (wc[0] > 0x00)
+      int last = 0x00;
+      for (;; wc += 2)
       {
-        if (wc[0] > 0xDFFF)
+        int next = wc[1] != 0 ? wc[0] : 0x110000;
+        // exclude U+D800 to U+DFFF
+        if (last < 0xD800 && last < next)
         {
-          // exclude U+D800 to U+DFFF
-          regex.assign(utf8(0x00, 0xD7FF, esc, par, !(flags & convert_flag::permissive))).push_back('|');
-          if (wc[0] > 0xE000)
-            regex.append(utf8(0xE000, wc[0] - 1, esc, par, !(flags & convert_flag::permissive))).push_back('|');
+          ranges.push_back(last);
+          ranges.push_back(std::min(next, 0xD800) - 1);
         }
-        else
+        last = std::max(last, 0xE000);
+        if (last < next)
         {
-          regex.assign(utf8(0x00, wc[0] - 1, esc, par, !(flags & convert_flag::permissive))).push_back('|');
-        }
-      }
-      int last = wc[1] + 1;
-      wc += 2;
-      for (; wc[1] != 0; wc += 2)
-      {
-        if (last <= 0xD800 && wc[0] > 0xDFFF)
-        {
-          // exclude U+D800 to U+DFFF
-          if (last < 0xD800)
-            regex.append(utf8(last, 0xD7FF, esc, par, !(flags & convert_flag::permissive))).push_back('|');
-          if (wc[0] > 0xE000)
-            regex.append(utf8(0xE000, wc[0] - 1, esc, par, !(flags & convert_flag::permissive))).push_back('|');
-        }
-        else
-        {
-          regex.append(utf8(last, wc[0] - 1, esc, par, !(flags & convert_flag::permissive))).push_back('|');
+          ranges.push_back(last);
+          ranges.push_back(next - 1);
         }
+        if (wc[1] == 0)
+          break;
         last = wc[1] + 1;
       }
-      if (last <= 0x10FFFF)
-      {
-        if (last <= 0xD800)
-        {
-          // exclude U+D800 to U+DFFF
-          if (last < 0xD800)
-            regex.append(utf8(last, 0xD7FF, esc, par, !(flags & convert_flag::permissive))).push_back('|');
-          regex.append(utf8(0xE000, 0x10FFFF, esc, par, !(flags & convert_flag::permissive))).push_back('|');
-        }
-        else
-        {
-          regex.append(utf8(last, 0x10FFFF, esc, par, !(flags & convert_flag::permissive))).push_back('|');
-        }
-      }
-      if (!regex.empty())
-        regex.pop_back();
     }
     else
     {
-      regex.assign(utf8(wc[0], wc[1], esc, par, !(flags & convert_flag::permissive)));
-      wc += 2;
       for (; wc[1] != 0; wc += 2)
-        regex.append("|").append(utf8(wc[0], wc[1], esc, par, !(flags & convert_flag::permissive)));
+      {
+        ranges.push_back(wc[0]);
+        ranges.push_back(wc[1]);
+      }
     }
+    std::string key(s);
+    key.push_back('\0');
+    regex = utf8_cached(key, ranges, esc, par, flags);
   }
   if (regex.find('|') != std::string::npos)
     regex.insert(0, par).push_back(')');
@@ -355,51 +362,56 @@ static const std::string& expand(const std::map<std::string,std::string> *macros
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 
-static std::string convert_unicode_ranges(const ORanges<int>& ranges, convert_flag_type flags, const char *signature, const char *par)
+static std::string convert_unicode_ranges(const FlatORanges<int>& ranges, convert_flag_type flags, const char *signature, const char *par)
 {
-  std::string regex;
   int esc = hex_or_octal_escape(signature);
-  for (ORanges<int>::const_iterator i = ranges.begin(); i != ranges.end(); ++i)
-    regex.append(utf8(i->first, i->second - 1, esc, par, !(flags & convert_flag::permissive))).push_back('|');
-  regex.pop_back();
+  std::vector<int> bounds;
+  std::string key(1, '\0');
+  for (FlatORanges<int>::const_iterator i = ranges.begin(); i != ranges.end(); ++i)
+  {
+    bounds.push_back(i->first);
+    bounds.push_back(i->second - 1);
+    key.append(reinterpret_cast<const char*>(&i->first), sizeof(int)).append(reinterpret_cast<const char*>(&i->second), sizeof(int));
+  }
+  std::string regex = utf8_cached(key, bounds, esc, par, flags);
   regex.insert(0, par).push_back(')');
   return regex;
 }
 
-static std::string convert_posix_ranges(const ORanges<int>& ranges, const char *signature)
+static std::string convert_posix_ranges(const FlatORanges<int>& ranges, const char *signature)
 {
   int esc = hex_or_octal_escape(signature);
   std::string regex;
   bool negate = ranges.lo() == 0x00 && ranges.hi() >= 0x7F;
   if (negate && ranges.size() > 1)
   {
-    ORanges<int> inverse(0x00, 0xFF);
+    FlatORanges<int> inverse(0x00, 0xFF);
     inverse -= ranges;
     regex = "[^";
-    for (ORanges<int>::const_iterator i = inverse.begin(); i != inverse.end(); ++i)
+    for (FlatORanges<int>::const_iterator i = inverse.begin(); i != inverse.end(); ++i)
       regex.append(latin1(i->first, i->second - 1, esc, false));
   }
   else
   {
     regex = "[";
-    for (ORanges<int>::const_iterator i = ranges.begin(); i != ranges.end(); ++i)
+    for (FlatORanges<int>::const_iterator i = ranges.begin(); i != ranges.end(); ++i)
       regex.append(latin1(i->first, i->second - 1, esc, false));
   }
   regex.push_back(']');
   return regex;
 }
 
-static void convert_anycase_ranges(ORanges<int>& ranges)
+static void convert_anycase_ranges(FlatORanges<int>& ranges)
 {
-  ORanges<int> letters;
+  FlatORanges<int> letters;
   letters.insert('A', 'Z');
   letters.insert('a', 'z');
   letters &= ranges;
-  for (ORanges<int>::const_iterator i = letters.begin(); i != letters.end(); ++i)
+  for (FlatORanges<int>::const_iterator i = letters.begin(); i != letters.end(); ++i)
     ranges.insert(i->first ^ 0x20, (i->second - 1) ^ 0x20);
 }
 
-static std::string convert_ranges(const char *pattern, size_t pos, ORanges<int>& ranges, const std::map<size_t,std::string>& mod, convert_flag_type flags, const char *signature, const char *par)
+static std::string convert_ranges(const char *pattern, size_t pos, FlatORanges<int>& ranges, const std::map<size_t,std::string>& mod, convert_flag_type flags, const char *signature, const char *par)
 {
   if (is_modified(mod, 'i'))
     convert_anycase_ranges(ranges);
@@ -516,7 +528,7 @@ static void expand_list(const char *pattern, size_t len, size_t& loc, size_t& po
   }
 }
 
-static void insert_escape_class(const char *pattern, size_t pos, const std::map<size_t,std::string>& mod, ORanges<int>& ranges)
+static void insert_escape_class(const char *pattern, size_t pos, const std::map<size_t,std::string>& mod, FlatORanges<int>& ranges)
 {
   int c = pattern[pos];
   char name[2] = { static_cast<char>(lowercase(c)), '\0' };
@@ -572,7 +584,7 @@ static void insert_escape_class(const char *pattern, size_t pos, const std::map<
   }
 }
 
-static int insert_escape(const char *pattern, size_t len, size_t& pos, convert_flag_type flags, const std::map<size_t,std::string>& mod, ORanges<int>& ranges)
+static int insert_escape(const char *pattern, size_t len, size_t& pos, convert_flag_type flags, const std::map<size_t,std::string>& mod, FlatORanges<int>& ranges)
 {
   int c = pattern[pos];
   if (c == 'c')
@@ -726,7 +738,7 @@ static int insert_escape(const char *pattern, size_t len, size_t& pos, convert_f
   return c;
 }
 
-static void insert_posix_class(const char *pattern, size_t len, size_t& pos, ORanges<int>& ranges)
+static void insert_posix_class(const char *pattern, size_t len, size_t& pos, FlatORanges<int>& ranges)
 {
   pos += 2;
   char buf[8] = "";
@@ -768,9 +780,9 @@ static void insert_posix_class(const char *pattern, size_t len, size_t& pos, ORa
   ++pos;
 }
 
-static void insert_list(const char *pattern, size_t len, size_t& pos, convert_flag_type flags, const std::map<size_t,std::string>& mod, ORanges<int>& ranges, const std::map<std::string,std::string> *macros);
+static void insert_list(const char *pattern, size_t len, size_t& pos, convert_flag_type flags, const std::map<size_t,std::string>& mod, FlatORanges<int>& ranges, const std::map<std::string,std::string> *macros);
 
-static void merge_list(const char *pattern, size_t len, size_t& pos, convert_flag_type flags, const std::map<size_t,std::string>& mod, ORanges<int>& ranges, const std::map<std::string,std::string> *macros)
+static void merge_list(const char *pattern, size_t len, size_t& pos, convert_flag_type flags, const std::map<size_t,std::string>& mod, FlatORanges<int>& ranges, const std::map<std::string,std::string> *macros)
 {
   if (pattern[pos] == '[')
   {
@@ -794,9 +806,9 @@ static void merge_list(const char *pattern, size_t len, size_t& pos, convert_fla
   }
 }
 
-static void intersect_list(const char *pattern, size_t len, size_t& pos, convert_flag_type flags, const std::map<size_t,std::string>& mod, ORanges<int>& ranges, const std::map<std::string,std::string> *macros)
+static void intersect_list(const char *pattern, size_t len, size_t& pos, convert_flag_type flags, const std::map<size_t,std::string>& mod, FlatORanges<int>& ranges, const std::map<std::string,std::string> *macros)
 {
-  ORanges<int> intersect;
+  FlatORanges<int> intersect;
   if (pattern[pos] == '[')
   {
     ++pos;
@@ -821,9 +833,9 @@ static void intersect_list(const char *pattern, size_t len, size_t& pos, convert
   }
 }
 
-static void subtract_list(const char *pattern, size_t len, size_t& pos, convert_flag_type flags, const std::map<size_t,std::string>& mod, ORanges<int>& ranges, const std::map<std::string,std::string> *macros)
+static void subtract_list(const char *pattern, size_t len, size_t& pos, convert_flag_type flags, const std::map<size_t,std::string>& mod, FlatORanges<int>& ranges, const std::map<std::string,std::string> *macros)
 {
-  ORanges<int> subtract;
+  FlatORanges<int> subtract;
   if (pattern[pos] == '[')
   {
     ++pos;
@@ -848,7 +860,7 @@ static void subtract_list(const char *pattern, size_t len, size_t& pos, convert_
   }
 }
 
-static void extend_list(const char *pattern, size_t len, size_t& pos, convert_flag_type flags, const std::map<size_t,std::string>& mod, ORanges<int>& ranges, const std::map<std::string,std::string> *macros)
+static void extend_list(const char *pattern, size_t len, size_t& pos, convert_flag_type flags, const std::map<size_t,std::string>& mod, FlatORanges<int>& ranges, const std::map<std::string,std::string> *macros)
 {
   if ((flags & convert_flag::lex))
   {
@@ -874,20 +886,20 @@ static void extend_list(const char *pattern, size_t len, size_t& pos, convert_fl
   }
 }
 
-static void negate_list(convert_flag_type flags, const std::map<size_t,std::string>& mod, ORanges<int>& ranges)
+static void negate_list(convert_flag_type flags, const std::map<size_t,std::string>& mod, FlatORanges<int>& ranges)
 {
   if (is_modified(mod, 'i'))
     convert_anycase_ranges(ranges);
   if (is_modified(mod, 'u'))
   {
-    ORanges<int> inverse(0x00, 0x10FFFF);
-    inverse -= ORanges<int>(0xD800, 0xDFFF); // remove surrogates
+    FlatORanges<int> inverse(0x00, 0x10FFFF);
+    inverse -= FlatORanges<int>(0xD800, 0xDFFF); // remove surrogates
     inverse -= ranges;
     ranges.swap(inverse);
   }
   else
   {
-    ORanges<int> inverse(0x00, 0xFF);
+    FlatORanges<int> inverse(0x00, 0xFF);
     inverse -= ranges;
     ranges.swap(inverse);
   }
@@ -895,7 +907,7 @@ static void negate_list(convert_flag_type flags, const std::map<size_t,std::stri
     ranges.erase('\n');
 }
 
-static void insert_list(const char *pattern, size_t len, size_t& pos, convert_flag_type flags, const std::map<size_t,std::string>& mod, ORanges<int>& ranges, const std::map<std::string,std::string> *macros)
+static void insert_list(const char *pattern, size_t len, size_t& pos, convert_flag_type flags, const std::map<size_t,std::string>& mod, FlatORanges<int>& ranges, const std::map<std::string,std::string> *macros)
 {
   size_t loc = pos;
   bool negate = false;
@@ -1375,7 +1387,7 @@ static void convert_escape(const char *pattern, size_t len, size_t& loc, size_t&
     }
     else
     {
-      ORanges<int> ranges;
+      FlatORanges<int> ranges;
       insert_escape_class(pattern, pos, mod, ranges);
       ranges.erase('\n');
       regex.append(&pattern[loc], pos - loc - 1);
@@ -1828,7 +1840,7 @@ std::string convert(const char *pattern, const char *signature, convert_flag_typ
         }
         else
         {
-          ORanges<int> ranges;
+          FlatORanges<int> ranges;
           regex.append(&pattern[loc], pos - loc);
           ++pos;
           insert_list(pattern, len, pos, flags, mod, ranges, macros);
@@ -1923,7 +1935,7 @@ std::string convert(const char *pattern, const char *signature, convert_flag_typ
             if ((flags & convert_flag::lex) && pos + 5 < len && pattern[pos + 1] == '{' && ((c = pattern[pos + 2]) == '+' || c == '|' || c == '&' || c == '-') && pattern[pos + 3] == '}')
             {
               size_t subpos = 0;
-              ORanges<int> ranges;
+              FlatORanges<int> ranges;
               merge_list(subregex.c_str(), subregex.size(), subpos, flags, mod, ranges, macros);
               if (subpos + 1 < subregex.size())
                 throw regex_error(regex_error::invalid_class_range, pattern, loc);
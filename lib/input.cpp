@@ -48,7 +48,11 @@
 # define ftello _ftelli64
 # define fseeko _fseeki64
 #else
-# include <unistd.h> // off_t, fstat()
+# include <unistd.h> // off_t, fstat(), _POSIX_MAPPED_FILES
+# if defined(_POSIX_MAPPED_FILES) && _POSIX_MAPPED_FILES > 0
+#  include <sys/mman.h> // mmap(), munmap()
+#  define REFLEX_MMAP // Input::map() memory-maps files, not on MinGW and other systems without POSIX mmap()
+# endif
 #endif
 
 namespace reflex {
@@ -708,10 +712,11 @@ void Input::file_init(file_encoding enc)
               }
               else
               {
-                size_ = 0;
-                uidx_ = 2;
-                ulen_ = 1;
-                utfx_ = file_encoding::utf16le;
+                // UTF-16 little endian BOM FFFE, translate the first code unit that follows it
+                utf8_[0] = utf8_[2];
+                utf8_[1] = utf8_[3];
+                ulen_ = 2;
+                set_file_encoding(file_encoding::utf16le);
               }
             }
           }
@@ -745,6 +750,106 @@ void Input::file_init(file_encoding enc)
 #endif
 }
 
+// ASCII fast paths of the block transcoders in Input::file_get(), each returns the number of raw code units converted
+
+// copy a run of ASCII bytes, at most k
+static size_t ascii_run(const unsigned char *raw, size_t k, char *t)
+{
+  size_t i = 0;
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2)
+  while (i + 16 <= k)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + i));
+    if (_mm_movemask_epi8(v) != 0)
+      break;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(t + i), v);
+    i += 16;
+  }
+#else
+  while (i + 8 <= k)
+  {
+    uint64_t w;
+    std::memcpy(&w, raw + i, 8);
+    if ((w & 0x8080808080808080ULL) != 0)
+      break;
+    std::memcpy(t + i, &w, 8);
+    i += 8;
+  }
+#endif
+  while (i < k && raw[i] < 0x80)
+  {
+    t[i] = static_cast<char>(raw[i]);
+    ++i;
+  }
+  return i;
+}
+
+// the maximum UTF-8 length of a UTF-16 or UTF-32 code unit, invalid units produce REFLEX_NONCHAR_UTF8
+#ifndef WITH_UTF8_UNRESTRICTED
+static const size_t UTF8_UNIT_MAX = sizeof(REFLEX_NONCHAR_UTF8) - 1 > 4 ? sizeof(REFLEX_NONCHAR_UTF8) - 1 : 4;
+#else
+static const size_t UTF8_UNIT_MAX = 6;
+#endif
+
+// convert a run of ASCII UTF-16 code units, at most k
+static size_t utf16_ascii_run(const unsigned char *raw, size_t k, char *t, bool be)
+{
+  size_t i = 0;
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2)
+  const __m128i mask = _mm_set1_epi16(static_cast<short>(be ? 0x80FF : 0xFF80));
+  const __m128i zero = _mm_setzero_si128();
+  while (i + 8 <= k)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + 2 * i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, mask), zero)) != 0xFFFF)
+      break;
+    if (be)
+      v = _mm_srli_epi16(v, 8);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(t + i), _mm_packus_epi16(v, v));
+    i += 8;
+  }
+#endif
+  int lo = be ? 1 : 0;
+  while (i < k && raw[2 * i + 1 - lo] == 0 && raw[2 * i + lo] < 0x80)
+  {
+    t[i] = static_cast<char>(raw[2 * i + lo]);
+    ++i;
+  }
+  return i;
+}
+
+// convert a run of ASCII UTF-32 code units, at most k
+static size_t utf32_ascii_run(const unsigned char *raw, size_t k, char *t, bool be)
+{
+  size_t i = 0;
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2)
+  const __m128i mask = _mm_set1_epi32(static_cast<int>(be ? 0x80FFFFFF : 0xFFFFFF80));
+  const __m128i zero = _mm_setzero_si128();
+  while (i + 4 <= k)
+  {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + 4 * i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(v, mask), zero)) != 0xFFFF)
+      break;
+    if (be)
+      v = _mm_srli_epi32(v, 24);
+    v = _mm_packs_epi32(v, v);
+    int w = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+    std::memcpy(t + i, &w, 4);
+    i += 4;
+  }
+#endif
+  while (i < k)
+  {
+    const unsigned char *u = raw + 4 * i;
+    uint32_t c = be ? static_cast<uint32_t>(u[0]) << 24 | u[1] << 16 | u[2] << 8 | u[3] : u[0] | u[1] << 8 | u[2] << 16 | static_cast<uint32_t>(u[3]) << 24;
+    if (c >= 0x80)
+      break;
+    t[i] = static_cast<char>(c);
+    ++i;
+  }
+  return i;
+}
+
 size_t Input::file_get(char *s, size_t n)
 {
   char *t = s;
@@ -764,64 +869,45 @@ size_t Input::file_get(char *s, size_t n)
     }
     ulen_ = 0;
   }
+  // read blocks of raw input to transcode, each block is limited to the number of code units that fit in the remaining n bytes
   unsigned char buf[4];
+  unsigned char raw[4096];
   switch (utfx_)
   {
     case file_encoding::utf16be:
-      while (n > 0 && ::fread(buf, 2, 1, underlying_input_.file_) == 1)
-      {
-        int c = buf[0] << 8 | buf[1];
-        if (c < 0x80)
-        {
-          *t++ = static_cast<char>(c);
-          --n;
-        }
-        else
-        {
-          if (c >= 0xD800 && c < 0xE000)
-          {
-            // UTF-16 surrogate pair
-            if (c < 0xDC00 && ::fread(buf + 2, 2, 1, underlying_input_.file_) == 1 && (buf[2] & 0xFC) == 0xDC)
-              c = 0x010000 - 0xDC00 + ((c - 0xD800) << 10) + (buf[2] << 8 | buf[3]);
-            else
-              c = REFLEX_NONCHAR;
-          }
-          size_t l = utf8(c, utf8_);
-          if (n < l)
-          {
-            std::memcpy(t, utf8_, n);
-            uidx_ = static_cast<unsigned short>(n);
-            ulen_ = static_cast<unsigned short>(l);
-            t += n;
-            n = 0;
-          }
-          else
-          {
-            std::memcpy(t, utf8_, l);
-            t += l;
-            n -= l;
-          }
-        }
-      }
-      if (size_ + s >= t)
-        size_ -= t - s;
-      return t - s;
     case file_encoding::utf16le:
-      while (n > 0 && ::fread(buf, 2, 1, underlying_input_.file_) == 1)
+    {
+      bool be = utfx_ == file_encoding::utf16be;
+      while (n > 0)
       {
-        int c = buf[0] | buf[1] << 8;
-        if (c < 0x80)
-        {
-          *t++ = static_cast<char>(c);
-          --n;
-        }
-        else
+        size_t k = n / UTF8_UNIT_MAX > 0 ? n / UTF8_UNIT_MAX : 1;
+        if (k > sizeof(raw) / 2)
+          k = sizeof(raw) / 2;
+        size_t m = ::fread(raw, 2, k, underlying_input_.file_);
+        size_t i = 0;
+        while (i < m)
         {
+          size_t a = utf16_ascii_run(raw + 2 * i, m - i, t, be);
+          t += a;
+          n -= a;
+          i += a;
+          if (i >= m)
+            break;
+          int c = be ? raw[2 * i] << 8 | raw[2 * i + 1] : raw[2 * i] | raw[2 * i + 1] << 8;
+          ++i;
           if (c >= 0xD800 && c < 0xE000)
           {
-            // UTF-16 surrogate pair
-            if (c < 0xDC00 && ::fread(buf + 2, 2, 1, underlying_input_.file_) == 1 && (buf[3] & 0xFC) == 0xDC)
-              c = 0x010000 - 0xDC00 + ((c - 0xD800) << 10) + (buf[2] | buf[3] << 8);
+            // UTF-16 surrogate pair, the second code unit may be in the next block
+            const unsigned char *next = nullptr;
+            if (c < 0xDC00)
+            {
+              if (i < m)
+                next = raw + 2 * i++;
+              else if (::fread(buf, 2, 1, underlying_input_.file_) == 1)
+                next = buf;
+            }
+            if (next != nullptr && (next[be ? 0 : 1] & 0xFC) == 0xDC)
+              c = 0x010000 - 0xDC00 + ((c - 0xD800) << 10) + (be ? next[0] << 8 | next[1] : next[0] | next[1] << 8);
             else
               c = REFLEX_NONCHAR;
           }
@@ -830,7 +916,7 @@ size_t Input::file_get(char *s, size_t n)
           {
             std::memcpy(t, utf8_, n);
             uidx_ = static_cast<unsigned short>(n);
-            ulen_ = static_cast<unsigned short>(l);
+            ulen_ = static_cast<unsigned short>(l - n);
             t += n;
             n = 0;
           }
@@ -841,58 +927,40 @@ size_t Input::file_get(char *s, size_t n)
             n -= l;
           }
         }
+        if (m < k)
+          break;
       }
       if (size_ + s >= t)
         size_ -= t - s;
       return t - s;
+    }
     case file_encoding::utf32be:
-      while (n > 0 && ::fread(buf, 4, 1, underlying_input_.file_) == 1)
-      {
-        int c = buf[0] << 24 | buf[1] << 16 | buf[2] << 8 | buf[3];
-        if (c < 0x80)
-        {
-          *t++ = static_cast<char>(c);
-          --n;
-        }
-        else
-        {
-          size_t l = utf8(c, utf8_);
-          if (n < l)
-          {
-            std::memcpy(t, utf8_, n);
-            uidx_ = static_cast<unsigned short>(n);
-            ulen_ = static_cast<unsigned short>(l);
-            t += n;
-            n = 0;
-          }
-          else
-          {
-            std::memcpy(t, utf8_, l);
-            t += l;
-            n -= l;
-          }
-        }
-      }
-      if (size_ + s >= t)
-        size_ -= t - s;
-      return t - s;
     case file_encoding::utf32le:
-      while (n > 0 && ::fread(buf, 4, 1, underlying_input_.file_) == 1)
+    {
+      bool be = utfx_ == file_encoding::utf32be;
+      while (n > 0)
       {
-        int c = buf[0] | buf[1] << 8 | buf[2] << 16 | buf[3] << 24;
-        if (c < 0x80)
-        {
-          *t++ = static_cast<char>(c);
-          --n;
-        }
-        else
+        size_t k = n / UTF8_UNIT_MAX > 0 ? n / UTF8_UNIT_MAX : 1;
+        if (k > sizeof(raw) / 4)
+          k = sizeof(raw) / 4;
+        size_t m = ::fread(raw, 4, k, underlying_input_.file_);
+        size_t i = 0;
+        while (i < m)
         {
+          size_t a = utf32_ascii_run(raw + 4 * i, m - i, t, be);
+          t += a;
+          n -= a;
+          i += a;
+          if (i >= m)
+            break;
+          const unsigned char *u = raw + 4 * i++;
+          int c = be ? u[0] << 24 | u[1] << 16 | u[2] << 8 | u[3] : u[0] | u[1] << 8 | u[2] << 16 | u[3] << 24;
           size_t l = utf8(c, utf8_);
           if (n < l)
           {
             std::memcpy(t, utf8_, n);
             uidx_ = static_cast<unsigned short>(n);
-            ulen_ = static_cast<unsigned short>(l);
+            ulen_ = static_cast<unsigned short>(l - n);
             t += n;
             n = 0;
           }
@@ -903,22 +971,30 @@ size_t Input::file_get(char *s, size_t n)
             n -= l;
           }
         }
+        if (m < k)
+          break;
       }
       if (size_ + s >= t)
         size_ -= t - s;
       return t - s;
+    }
     case file_encoding::latin:
-      while (n > 0 && ::fread(t, 1, 1, underlying_input_.file_) == 1)
+      while (n > 0)
       {
-        int c = static_cast<unsigned char>(*t);
-        if (c < 0x80)
-        {
-          t++;
-          --n;
-        }
-        else
+        size_t k = n / 2 > 0 ? n / 2 : 1;
+        if (k > sizeof(raw))
+          k = sizeof(raw);
+        size_t m = ::fread(raw, 1, k, underlying_input_.file_);
+        size_t i = 0;
+        while (i < m)
         {
-          utf8(c, utf8_);
+          size_t a = ascii_run(raw + i, m - i, t);
+          t += a;
+          n -= a;
+          i += a;
+          if (i >= m)
+            break;
+          utf8(raw[i++], utf8_);
           *t++ = utf8_[0];
           --n;
           if (n > 0)
@@ -929,9 +1005,11 @@ size_t Input::file_get(char *s, size_t n)
           else
           {
             uidx_ = 1;
-            ulen_ = 2;
+            ulen_ = 1;
           }
         }
+        if (m < k)
+          break;
       }
       if (size_ + s >= t)
         size_ -= t - s;
@@ -968,36 +1046,61 @@ size_t Input::file_get(char *s, size_t n)
     case file_encoding::koi8_u:
     case file_encoding::koi8_ru:
     case file_encoding::custom:
-      while (n > 0 && ::fread(t, 1, 1, underlying_input_.file_) == 1)
+    {
+      // copy runs of ASCII straight through when the code page maps ASCII to itself, e.g. not for EBCDIC
+      bool ascii = page_ != nullptr;
+      for (int c = 0; c < 0x80 && ascii; ++c)
+        ascii = page_[c] == c;
+      while (n > 0)
       {
-        int c = page_[static_cast<unsigned char>(*t)];
-        if (c < 0x80)
+        size_t k = n / 3 > 0 ? n / 3 : 1;
+        if (k > sizeof(raw))
+          k = sizeof(raw);
+        size_t m = ::fread(raw, 1, k, underlying_input_.file_);
+        size_t i = 0;
+        while (i < m)
         {
-          *t++ = static_cast<char>(c);
-          --n;
-        }
-        else
-        {
-          size_t l = utf8(c, utf8_);
-          if (n < l)
+          if (ascii)
           {
-            std::memcpy(t, utf8_, n);
-            uidx_ = static_cast<unsigned short>(n);
-            ulen_ = static_cast<unsigned short>(l);
-            t += n;
-            n = 0;
+            size_t a = ascii_run(raw + i, m - i, t);
+            t += a;
+            n -= a;
+            i += a;
+            if (i >= m)
+              break;
+          }
+          int c = page_[raw[i++]];
+          if (c < 0x80)
+          {
+            *t++ = static_cast<char>(c);
+            --n;
           }
           else
           {
-            std::memcpy(t, utf8_, l);
-            t += l;
-            n -= l;
+            size_t l = utf8(c, utf8_);
+            if (n < l)
+            {
+              std::memcpy(t, utf8_, n);
+              uidx_ = static_cast<unsigned short>(n);
+              ulen_ = static_cast<unsigned short>(l - n);
+              t += n;
+              n = 0;
+            }
+            else
+            {
+              std::memcpy(t, utf8_, l);
+              t += l;
+              n -= l;
+            }
           }
         }
+        if (m < k)
+          break;
       }
       if (size_ + s >= t)
         size_ -= t - s;
       return t - s;
+    }
     default:
       t += ::fread(t, 1, n, underlying_input_.file_);
       if (size_ + s >= t)
@@ -1034,18 +1137,45 @@ void Input::wstring_size()
   }
 }
 
+// count the bytes with the high bit set, i.e. the latin-1 bytes converted to two UTF-8 bytes
+static size_t high_count(const unsigned char *raw, size_t k)
+{
+  size_t n = 0;
+  size_t i = 0;
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || defined(HAVE_SSE2)
+  for (; i + 16 <= k; i += 16)
+    n += popcount(static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + i)))));
+#else
+  for (; i + 8 <= k; i += 8)
+  {
+    uint64_t w;
+    std::memcpy(&w, raw + i, 8);
+    n += static_cast<size_t>((((w & 0x8080808080808080ULL) >> 7) * 0x0101010101010101ULL) >> 56);
+  }
+#endif
+  for (; i < k; ++i)
+    n += raw[i] >> 7;
+  return n;
+}
+
 void Input::file_size()
 {
   off_t k = ftello(underlying_input_.file_);
   if (k >= 0)
   {
+    // the UTF-8 bytes buffered in utf8_[] by file_init() were already read from the file
+    size_ = ulen_;
     unsigned char buf[4];
     switch (utfx_)
     {
       case file_encoding::latin:
-        while (::fread(buf, 1, 1, underlying_input_.file_) == 1)
-          size_ += 1 + (buf[0] >= 0x80);
+      {
+        unsigned char raw[4096];
+        size_t m;
+        while ((m = ::fread(raw, 1, sizeof(raw), underlying_input_.file_)) > 0)
+          size_ += m + high_count(raw, m);
         break;
+      }
       case file_encoding::cp437:
       case file_encoding::cp850:
       case file_encoding::cp858:
@@ -1078,12 +1208,22 @@ void Input::file_size()
       case file_encoding::koi8_u:
       case file_encoding::koi8_ru:
       case file_encoding::custom:
-        while (::fread(buf, 1, 1, underlying_input_.file_) == 1)
+      {
+        unsigned char raw[4096];
+        size_t m = ::fread(raw, 1, sizeof(raw), underlying_input_.file_);
+        if (m == 0)
+          break;
+        // UTF-8 length of each byte translated by the code page
+        unsigned char len[256];
+        for (int c = 0; c < 256; ++c)
+          len[c] = static_cast<unsigned char>(1 + (page_[c] >= 0x80) + (page_[c] >= 0x0800)); // + (c >= 0x010000); NOTE: page_[] value range < Unicode range
+        do
         {
-          int c = page_[buf[0]];
-          size_ += 1 + (c >= 0x80) + (c >= 0x0800); // + (c >= 0x010000); NOTE: page_[] value range < Unicode range
-        }
+          for (size_t i = 0; i < m; ++i)
+            size_ += len[raw[i]];
+        } while ((m = ::fread(raw, 1, sizeof(raw), underlying_input_.file_)) > 0);
         break;
+      }
       case file_encoding::utf16be:
         while (::fread(buf, 2, 1, underlying_input_.file_) == 1)
         {
@@ -1112,8 +1252,8 @@ void Input::file_size()
           if (c >= 0xD800 && c < 0xE000)
           {
             // UTF-16 surrogate pair
-            if (c < 0xDC00 && ::fread(buf + 2, 2, 1, underlying_input_.file_) == 1 && (buf[2] & 0xFC) == 0xDC)
-              c = 0x010000 - 0xDC00 + ((c - 0xD800) << 10) + (buf[2] << 8 | buf[3]);
+            if (c < 0xDC00 && ::fread(buf + 2, 2, 1, underlying_input_.file_) == 1 && (buf[3] & 0xFC) == 0xDC)
+              c = 0x010000 - 0xDC00 + ((c - 0xD800) << 10) + (buf[2] | buf[3] << 8);
             else
               c = REFLEX_NONCHAR;
           }
@@ -1149,10 +1289,10 @@ void Input::file_size()
         }
         break;
       default:
-        fseeko(underlying_input_.file_, k, SEEK_END);
+        fseeko(underlying_input_.file_, 0, SEEK_END);
         off_t n = ftello(underlying_input_.file_);
         if (n >= k)
-          size_ = static_cast<size_t>(n - k);
+          size_ += static_cast<size_t>(n - k);
     }
     ::clearerr(underlying_input_.file_);
     fseeko(underlying_input_.file_, k, SEEK_SET);
@@ -1160,6 +1300,35 @@ void Input::file_size()
   ::clearerr(underlying_input_.file_);
 }
 
+size_t Input::file_size_hint()
+{
+  // each code unit is converted to at least one UTF-8 byte, so the number of code units left in the file is a lower bound
+  size_t n = 0;
+  off_t k = ftello(underlying_input_.file_);
+  if (k >= 0 && fseeko(underlying_input_.file_, 0, SEEK_END) == 0)
+  {
+    off_t e = ftello(underlying_input_.file_);
+    if (e >= k)
+      n = static_cast<size_t>(e - k);
+    fseeko(underlying_input_.file_, k, SEEK_SET);
+    switch (utfx_)
+    {
+      case file_encoding::utf16be:
+      case file_encoding::utf16le:
+        n /= 2;
+        break;
+      case file_encoding::utf32be:
+      case file_encoding::utf32le:
+        n /= 4;
+        break;
+      default:
+        break;
+    }
+  }
+  ::clearerr(underlying_input_.file_);
+  return n;
+}
+
 void Input::istream_size()
 {
   std::streampos k = underlying_input_.istream_->tellg();
@@ -1173,6 +1342,50 @@ void Input::istream_size()
   }
 }
 
+bool Input::map()
+{
+#if !defined(REFLEX_MMAP)
+  return false;
+#else
+  // only plain and UTF-8 content can be scanned in place, other encodings require conversion by get()
+  if (input_type_ != input_type_enum::FILE_P || (utfx_ != file_encoding::plain && utfx_ != file_encoding::utf8))
+    return false;
+  int fd = ::fileno(underlying_input_.file_);
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    return false;
+  off_t pos = ftello(underlying_input_.file_);
+  // the (non-BOM) bytes buffered in utf8_[] by file_init() were not consumed yet
+  if (pos < static_cast<off_t>(ulen_) || st.st_size <= pos - static_cast<off_t>(ulen_))
+    return false;
+  size_t off = static_cast<size_t>(pos - ulen_);
+  size_t len = static_cast<size_t>(st.st_size);
+  size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  // reserve zero-filled pages with at least one byte beyond the file content, then map the file over them, so a \0 always follows the content
+  size_t total = (len / page + 1) * page;
+  char *base = static_cast<char*>(::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0));
+  if (base == MAP_FAILED)
+    return false;
+  if (::mmap(base, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+  {
+    ::munmap(base, total);
+    return false;
+  }
+#if defined(MADV_SEQUENTIAL)
+  ::madvise(base, len, MADV_SEQUENTIAL);
+#endif
+  map_ = std::shared_ptr<void>(base, [total](void *p) { ::munmap(p, total); });
+  // the FILE* is no longer read, move it to the end as if all content was consumed
+  fseeko(underlying_input_.file_, 0, SEEK_END);
+  input_type_ = input_type_enum::MMAP_P;
+  underlying_input_.cstring_ = base + off;
+  size_ = len - off;
+  uidx_ = 0;
+  ulen_ = 0;
+  return true;
+#endif
+}
+
 void Input::set_file_encoding(file_encoding enc, const unsigned short *page)
 {
   if (input_type_==input_type_enum::FILE_P && utfx_ != enc)
@@ -1263,92 +1476,54 @@ void Input::set_file_encoding(file_encoding enc, const unsigned short *page)
           }
           break;
         case file_encoding::utf16be:
-          // enforcing non-BOM UTF-16: translate utf8_[] to UTF-16 then to UTF-8
-          if (b[1] == '\0' && ::fread(b + 1, 1, 1, underlying_input_.file_) == 1)
-          {
-            if (b[2] == '\0' ? ::fread(b + 2, 2, 1, underlying_input_.file_) == 1 :
-                b[3] == '\0' ? ::fread(b + 3, 1, 1, underlying_input_.file_) == 1 :
-                false
-               )
-            {
-              c1 = b[0] << 8 | b[1];
-              c2 = b[2] << 8 | b[3];
-              if (c1 >= 0xD800 && c1 < 0xE000)
-              {
-                // UTF-16 surrogate pair
-                if (c1 < 0xDC00 && (c2 & 0xFC00) == 0xDC00)
-                  c1 = 0x010000 - 0xDC00 + ((c1 - 0xD800) << 10) + c2;
-                else
-                  c1 = REFLEX_NONCHAR;
-                t += utf8(c1, t);
-              }
-              else
-              {
-                t += utf8(c1, t);
-                t += utf8(c2, t);
-              }
-              uidx_ = 0;
-              ulen_ = static_cast<unsigned short>(t - utf8_);
-            }
-          }
-          break;
         case file_encoding::utf16le:
-          // enforcing non-BOM UTF-16: translate utf8_[] to UTF-16 then to UTF-8
-          if (b[1] == '\0' && ::fread(b + 1, 1, 1, underlying_input_.file_) == 1)
+        {
+          // enforcing non-BOM UTF-16: complete the code units of the 1 to 4 bytes buffered in utf8_[] then translate to UTF-8
+          bool be = enc == file_encoding::utf16be;
+          size_t len = ulen_;
+          if (len % 2 != 0 && ::fread(b + len, 1, 1, underlying_input_.file_) == 1)
+            ++len;
+          for (size_t i = 0; i + 1 < len; i += 2)
           {
-            if (b[2] == '\0' ? ::fread(b + 2, 2, 1, underlying_input_.file_) == 1 :
-                b[3] == '\0' ? ::fread(b + 3, 1, 1, underlying_input_.file_) == 1 :
-                false
-               )
+            c1 = be ? b[i] << 8 | b[i + 1] : b[i] | b[i + 1] << 8;
+            if (c1 >= 0xD800 && c1 < 0xE000)
             {
-              c1 = b[0] | b[1] << 8;
-              c2 = b[2] | b[3] << 8;
-              if (c1 >= 0xD800 && c1 < 0xE000)
+              // UTF-16 surrogate pair, the second code unit may not be buffered yet
+              c2 = 0;
+              if (c1 < 0xDC00)
               {
-                // UTF-16 surrogate pair
-                if (c1 < 0xDC00 && (c2 & 0xFC00) == 0xDC00)
-                  c1 = 0x010000 - 0xDC00 + ((c1 - 0xD800) << 10) + c2;
-                else
-                  c1 = REFLEX_NONCHAR;
-                t += utf8(c1, t);
+                if (i + 2 >= len && ::fread(b + len, 2, 1, underlying_input_.file_) == 1)
+                  len += 2;
+                if (i + 3 < len)
+                {
+                  c2 = be ? b[i + 2] << 8 | b[i + 3] : b[i + 2] | b[i + 3] << 8;
+                  i += 2;
+                }
               }
+              if ((c2 & 0xFC00) == 0xDC00)
+                c1 = 0x010000 - 0xDC00 + ((c1 - 0xD800) << 10) + c2;
               else
-              {
-                t += utf8(c1, t);
-                t += utf8(c2, t);
-              }
-              uidx_ = 0;
-              ulen_ = static_cast<unsigned short>(t - utf8_);
+                c1 = REFLEX_NONCHAR;
             }
-          }
-          break;
-        case file_encoding::utf32be:
-          // enforcing non-BOM UTF-32: translate utf8_[] to UTF-32 then to UTF-8
-          if (b[1] == '\0' ? ::fread(b + 1, 3, 1, underlying_input_.file_) == 1 :
-              b[2] == '\0' ? ::fread(b + 2, 2, 1, underlying_input_.file_) == 1 :
-              b[3] == '\0' ? ::fread(b + 3, 1, 1, underlying_input_.file_) == 1 :
-              false
-             )
-          {
-            c1 = buf[0] << 24 | buf[1] << 16 | buf[2] << 8 | buf[3];
             t += utf8(c1, t);
-            uidx_ = 0;
-            ulen_ = static_cast<unsigned short>(t - utf8_);
           }
+          uidx_ = 0;
+          ulen_ = static_cast<unsigned short>(t - utf8_);
           break;
+        }
+        case file_encoding::utf32be:
         case file_encoding::utf32le:
-          // enforcing non-BOM UTF-32: translate utf8_[] to UTF-32 then to UTF-8
-          if (b[1] == '\0' ? ::fread(b + 1, 3, 1, underlying_input_.file_) == 1 :
-              b[2] == '\0' ? ::fread(b + 2, 2, 1, underlying_input_.file_) == 1 :
-              b[3] == '\0' ? ::fread(b + 3, 1, 1, underlying_input_.file_) == 1 :
-              false
-             )
+          // enforcing non-BOM UTF-32: complete the code unit of the 1 to 4 bytes buffered in utf8_[] then translate to UTF-8
+          if (ulen_ == 4 || ::fread(b + ulen_, 4 - ulen_, 1, underlying_input_.file_) == 1)
           {
-            c1 = buf[0] | buf[1] << 8 | buf[2] << 16 | buf[3] << 24;
+            if (enc == file_encoding::utf32be)
+              c1 = b[0] << 24 | b[1] << 16 | b[2] << 8 | b[3];
+            else
+              c1 = b[0] | b[1] << 8 | b[2] << 16 | b[3] << 24;
             t += utf8(c1, t);
-            uidx_ = 0;
-            ulen_ = static_cast<unsigned short>(t - utf8_);
           }
+          uidx_ = 0;
+          ulen_ = static_cast<unsigned short>(t - utf8_);
           break;
         default:
           break;
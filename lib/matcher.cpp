@@ -37,61 +37,6 @@
 #include <reflex/matcher.h>
 
 namespace reflex {
-/// Boyer-Moore preprocessing of the given pattern prefix pat of length len (<=255), generates bmd_ > 0 and bms_[] shifts.
-void Matcher::boyer_moore_init(const char *pat, size_t len)
-{
-  // Relative frequency table of English letters, source code, and UTF-8 bytes
-  static unsigned char freq[256] = "\0\0\0\0\0\0\0\0\0\73\4\0\0\4\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\73\70\70\1\1\2\2\70\70\70\2\2\70\70\70\2\3\3\3\3\3\3\3\3\3\3\70\70\70\70\70\70\2\35\14\24\26\37\20\17\30\33\11\12\25\22\32\34\15\7\27\31\36\23\13\21\10\16\6\70\1\70\2\70\1\67\46\56\60\72\52\51\62\65\43\44\57\54\64\66\47\41\61\63\71\55\45\53\42\50\40\70\2\70\2\0\47\47\47\47\47\47\47\47\47\47\47\47\47\47\47\47\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\44\44\44\44\44\44\44\44\44\44\44\44\44\44\44\44\0\0\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\46\56\56\56\56\56\56\56\56\56\56\56\56\46\56\56\73\0\0\0\0\0\0\0\0\0\0\0\0\0\0";
-  uint8_t n = static_cast<uint8_t>(len); // okay to cast: actually never more than 255
-  uint16_t i;
-  for (i = 0; i < 256; ++i)
-    bms_[i] = n;
-  lcp_ = 0;
-  lcs_ = n > 1;
-  for (i = 0; i < n; ++i)
-  {
-    uint8_t pch = static_cast<uint8_t>(pat[i]);
-    bms_[pch] = static_cast<uint8_t>(n - i - 1);
-    if (i > 0)
-    {
-      if (freq[static_cast<uint8_t>(pat[lcp_])] > freq[pch])
-      {
-        lcs_ = lcp_;
-        lcp_ = i;
-      }
-      else if (freq[static_cast<uint8_t>(pat[lcs_])] > freq[pch])
-      {
-        lcs_ = i;
-      }
-    }
-  }
-  uint16_t j;
-  for (i = n - 1, j = i; j > 0; --j)
-    if (pat[j - 1] == pat[i])
-      break;
-  bmd_ = i - j + 1;
-#if !defined(HAVE_NEON)
-  size_t score = 0;
-  for (i = 0; i < n; ++i)
-    score += bms_[static_cast<uint8_t>(pat[i])];
-  score /= n;
-  uint8_t fch = freq[static_cast<uint8_t>(pat[lcp_])];
-  if (!have_HW_SSE2() && !have_HW_AVX2() && !have_HW_AVX512BW())
-  {
-    // if scoring is high and freq is high, then use our improved Boyer-Moore instead of memchr()
-#if defined(__SSE2__) || defined(__x86_64__) || _M_IX86_FP == 2
-    // SSE2 is available, expect fast memchr()
-    if (score > 1 && fch > 35 && (score > 3 || fch > 50) && fch + score > 52)
-      lcs_ = 0xffff;
-#else
-    // no SSE2 available, expect slow memchr()
-    if (fch > 37 || (fch > 8 && score > 0))
-      lcs_ = 0xffff;
-#endif
-  }
-#endif
-}
-
 // advance input cursor position after mismatch to align input for the next match
 bool Matcher::advance()
 {
@@ -109,6 +54,109 @@ bool Matcher::advance()
       if (loc + min > end_)
         return false;
     }
+#if defined(HAVE_AVX512BW) || defined(HAVE_AVX2) || (defined(HAVE_NEON) && defined(__aarch64__))
+    size_t tsz = pat_->tsz_;
+#if defined(HAVE_NEON)
+    if (tsz > 0)
+#else
+    if (tsz > 0 && have_HW_AVX2())
+#endif
+    {
+      // implements a Teddy-style nibble shuffle filter of the chars at the first tsz (up to 4) positions of a match, see Pattern::gen_predict_nibbles()
+#if defined(HAVE_NEON)
+      uint8x16_t vlo[4], vhi[4];
+      uint8x16_t v0f = vdupq_n_u8(0x0f);
+      for (size_t k = 0; k < tsz; ++k)
+      {
+        vlo[k] = vld1q_u8(pat_->tlo_[k]);
+        vhi[k] = vld1q_u8(pat_->thi_[k]);
+      }
+      const size_t n = 16;
+#else
+      __m256i vlo[4], vhi[4];
+      __m256i v0f = _mm256_set1_epi8(0x0f);
+      __m256i vzero = _mm256_setzero_si256();
+      for (size_t k = 0; k < tsz; ++k)
+      {
+        vlo[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pat_->tlo_[k])));
+        vhi[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pat_->thi_[k])));
+      }
+      const size_t n = 32;
+#endif
+      const Pattern::Pred *bit = pat_->bit_;
+      while (true)
+      {
+        const char *s = buf_ + loc;
+        // n match positions with min chars per match must fit in the buffer
+        while (s + n + min <= buf_ + end_ + 1)
+        {
+#if defined(HAVE_NEON)
+          uint8x16_t vmask = vdupq_n_u8(0xff);
+          for (size_t k = 0; k < tsz; ++k)
+          {
+            uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(s + k));
+            uint8x16_t vl = vqtbl1q_u8(vlo[k], vandq_u8(v, v0f));
+            uint8x16_t vh = vqtbl1q_u8(vhi[k], vshrq_n_u8(v, 4));
+            vmask = vandq_u8(vmask, vtstq_u8(vl, vh));
+          }
+          uint64x2_t vmask64 = vreinterpretq_u64_u8(vmask);
+          uint64_t mask0 = vgetq_lane_u64(vmask64, 0);
+          uint64_t mask1 = vgetq_lane_u64(vmask64, 1);
+          uint32_t mask = 0;
+          for (int i = 0; i < 8; ++i)
+          {
+            mask |= static_cast<uint32_t>(mask0 & 1) << i;
+            mask |= static_cast<uint32_t>(mask1 & 1) << (i + 8);
+            mask0 >>= 8;
+            mask1 >>= 8;
+          }
+#else
+          __m256i vnot = vzero;
+          for (size_t k = 0; k < tsz; ++k)
+          {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + k));
+            __m256i vl = _mm256_shuffle_epi8(vlo[k], _mm256_and_si256(v, v0f));
+            __m256i vh = _mm256_shuffle_epi8(vhi[k], _mm256_and_si256(_mm256_srli_epi16(v, 4), v0f));
+            vnot = _mm256_or_si256(vnot, _mm256_cmpeq_epi8(_mm256_and_si256(vl, vh), vzero));
+          }
+          uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(vnot));
+#endif
+          while (mask != 0)
+          {
+#if defined(HAVE_NEON)
+            uint32_t offset = 0;
+            while (((mask >> offset) & 1) == 0)
+              ++offset;
+#else
+            uint32_t offset = ctz(mask);
+#endif
+            const char *t = s + offset;
+            size_t k = tsz;
+            while (k < min && (bit[static_cast<uint8_t>(t[k])] & (1 << k)) == 0)
+              ++k;
+            if (k >= min)
+            {
+              loc = t - buf_;
+              if (min >= 4 ? Pattern::predict_match(pat_->pmh_, t, min) : t + 4 > buf_ + end_ || Pattern::predict_match(pat_->pma_, t) == 0)
+              {
+                set_current(loc);
+                return true;
+              }
+            }
+            mask &= mask - 1;
+          }
+          s += n;
+        }
+        loc = s - buf_;
+        set_current_match(loc - 1);
+        peek_more();
+        loc = cur_ + 1;
+        // continue with the scalar bitap below when the remaining input is too short
+        if (loc + n + min > end_ + 1)
+          break;
+      }
+    }
+#endif
     if (min >= 4)
     {
       const Pattern::Pred *bit = pat_->bit_;
@@ -268,7 +316,10 @@ bool Matcher::advance()
       {
         loc = s - buf_;
         set_current(loc);
-        return true;
+        if (predicted(loc, len, min))
+          return true;
+        ++loc;
+        continue;
       }
       loc = e - buf_;
       set_current_match(loc - 1);
@@ -278,44 +329,37 @@ bool Matcher::advance()
         return false;
     }
   }
-  if (bmd_ == 0)
-    boyer_moore_init(pre, len);
+  // Boyer-Moore tables are precomputed by the pattern and shared by all matchers
+  const uint16_t lcp = pat_->lcp_;
+  const uint16_t lcs = pat_->lcs_;
+  const size_t bmd = pat_->bmd_;
+  const uint8_t *bms = pat_->bms_;
   while (true)
   {
-    if (lcs_ < len)
+    if (lcs < len)
     {
-      const char *s = buf_ + loc + lcp_;
-      const char *e = buf_ + end_ + lcp_ - len + 1;
+      const char *s = buf_ + loc + lcp;
+      const char *e = buf_ + end_ + lcp - len + 1;
 #if defined(HAVE_AVX512BW) && (!defined(_MSC_VER) || defined(_WIN64))
       if (have_HW_AVX512BW())
       {
         // implements AVX512 string search scheme based on in http://0x80.pl/articles/simd-friendly-karp-rabin.html
-        __m512i vlcp = _mm512_set1_epi8(pre[lcp_]);
-        __m512i vlcs = _mm512_set1_epi8(pre[lcs_]);
+        __m512i vlcp = _mm512_set1_epi8(pre[lcp]);
+        __m512i vlcs = _mm512_set1_epi8(pre[lcs]);
         while (s + 64 <= e)
         {
           __m512i vlcpm = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(s));
-          __m512i vlcsm = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(s + lcs_ - lcp_));
+          __m512i vlcsm = _mm512_loadu_si512(reinterpret_cast<const __m512i*>(s + lcs - lcp));
           uint64_t mask = _mm512_cmpeq_epi8_mask(vlcp, vlcpm) & _mm512_cmpeq_epi8_mask(vlcs, vlcsm);
           while (mask != 0)
           {
             uint32_t offset = ctzl(mask);
-            if (std::memcmp(s - lcp_ + offset, pre, len) == 0)
+            if (std::memcmp(s - lcp + offset, pre, len) == 0)
             {
-              loc = s - lcp_ + offset - buf_;
+              loc = s - lcp + offset - buf_;
               set_current(loc);
-              if (min == 0)
+              if (predicted(loc, len, min))
                 return true;
-              if (min >= 4)
-              {
-                if (loc + len + min > end_ || Pattern::predict_match(pat_->pmh_, &buf_[loc + len], min))
-                  return true;
-              }
-              else
-              {
-                if (loc + len + 4 > end_ || Pattern::predict_match(pat_->pma_, &buf_[loc + len]) == 0)
-                  return true;
-              }
             }
             mask &= ~(1ULL << offset);
           }
@@ -325,34 +369,24 @@ bool Matcher::advance()
       else if (have_HW_AVX2())
       {
         // implements AVX2 string search scheme based on in http://0x80.pl/articles/simd-friendly-karp-rabin.html
-        __m256i vlcp = _mm256_set1_epi8(pre[lcp_]);
-        __m256i vlcs = _mm256_set1_epi8(pre[lcs_]);
-        while (s + 32 < e)
+        __m256i vlcp = _mm256_set1_epi8(pre[lcp]);
+        __m256i vlcs = _mm256_set1_epi8(pre[lcs]);
+        while (s + 32 <= e)
         {
           __m256i vlcpm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
-          __m256i vlcsm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + lcs_ - lcp_));
+          __m256i vlcsm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + lcs - lcp));
           __m256i vlcpeq = _mm256_cmpeq_epi8(vlcp, vlcpm);
           __m256i vlcseq = _mm256_cmpeq_epi8(vlcs, vlcsm);
           uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(vlcpeq, vlcseq));
           while (mask != 0)
           {
             uint32_t offset = ctz(mask);
-            if (std::memcmp(s - lcp_ + offset, pre, len) == 0)
+            if (std::memcmp(s - lcp + offset, pre, len) == 0)
             {
-              loc = s - lcp_ + offset - buf_;
+              loc = s - lcp + offset - buf_;
               set_current(loc);
-              if (min == 0)
+              if (predicted(loc, len, min))
                 return true;
-              if (min >= 4)
-              {
-                if (loc + len + min > end_ || Pattern::predict_match(pat_->pmh_, &buf_[loc + len], min))
-                  return true;
-              }
-              else
-              {
-                if (loc + len + 4 > end_ || Pattern::predict_match(pat_->pma_, &buf_[loc + len]) == 0)
-                  return true;
-              }
             }
             mask &= mask - 1;
           }
@@ -362,34 +396,24 @@ bool Matcher::advance()
       else if (have_HW_SSE2())
       {
         // implements SSE2 string search scheme based on in http://0x80.pl/articles/simd-friendly-karp-rabin.html
-        __m128i vlcp = _mm_set1_epi8(pre[lcp_]);
-        __m128i vlcs = _mm_set1_epi8(pre[lcs_]);
+        __m128i vlcp = _mm_set1_epi8(pre[lcp]);
+        __m128i vlcs = _mm_set1_epi8(pre[lcs]);
         while (s + 16 <= e)
         {
           __m128i vlcpm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
-          __m128i vlcsm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + lcs_ - lcp_));
+          __m128i vlcsm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + lcs - lcp));
           __m128i vlcpeq = _mm_cmpeq_epi8(vlcp, vlcpm);
           __m128i vlcseq = _mm_cmpeq_epi8(vlcs, vlcsm);
           uint32_t mask = _mm_movemask_epi8(_mm_and_si128(vlcpeq, vlcseq));
           while (mask != 0)
           {
             uint32_t offset = ctz(mask);
-            if (std::memcmp(s - lcp_ + offset, pre, len) == 0)
+            if (std::memcmp(s - lcp + offset, pre, len) == 0)
             {
-              loc = s - lcp_ + offset - buf_;
+              loc = s - lcp + offset - buf_;
               set_current(loc);
-              if (min == 0)
+              if (predicted(loc, len, min))
                 return true;
-              if (min >= 4)
-              {
-                if (loc + len + min > end_ || Pattern::predict_match(pat_->pmh_, &buf_[loc + len], min))
-                  return true;
-              }
-              else
-              {
-                if (loc + len + 4 > end_ || Pattern::predict_match(pat_->pma_, &buf_[loc + len]) == 0)
-                  return true;
-              }
             }
             mask &= mask - 1;
           }
@@ -400,34 +424,24 @@ bool Matcher::advance()
       if (have_HW_AVX2())
       {
         // implements AVX2 string search scheme based on in http://0x80.pl/articles/simd-friendly-karp-rabin.html
-        __m256i vlcp = _mm256_set1_epi8(pre[lcp_]);
-        __m256i vlcs = _mm256_set1_epi8(pre[lcs_]);
+        __m256i vlcp = _mm256_set1_epi8(pre[lcp]);
+        __m256i vlcs = _mm256_set1_epi8(pre[lcs]);
         while (s + 32 <= e)
         {
           __m256i vlcpm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s));
-          __m256i vlcsm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + lcs_ - lcp_));
+          __m256i vlcsm = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + lcs - lcp));
           __m256i vlcpeq = _mm256_cmpeq_epi8(vlcp, vlcpm);
           __m256i vlcseq = _mm256_cmpeq_epi8(vlcs, vlcsm);
           uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(vlcpeq, vlcseq));
           while (mask != 0)
           {
             uint32_t offset = ctz(mask);
-            if (std::memcmp(s - lcp_ + offset, pre, len) == 0)
+            if (std::memcmp(s - lcp + offset, pre, len) == 0)
             {
-              loc = s - lcp_ + offset - buf_;
+              loc = s - lcp + offset - buf_;
               set_current(loc);
-              if (min == 0)
+              if (predicted(loc, len, min))
                 return true;
-              if (min >= 4)
-              {
-                if (loc + len + min > end_ || Pattern::predict_match(pat_->pmh_, &buf_[loc + len], min))
-                  return true;
-              }
-              else
-              {
-                if (loc + len + 4 > end_ || Pattern::predict_match(pat_->pma_, &buf_[loc + len]) == 0)
-                  return true;
-              }
             }
             mask &= mask - 1;
           }
@@ -437,34 +451,24 @@ bool Matcher::advance()
       else if (have_HW_SSE2())
       {
         // implements SSE2 string search scheme based on in http://0x80.pl/articles/simd-friendly-karp-rabin.html
-        __m128i vlcp = _mm_set1_epi8(pre[lcp_]);
-        __m128i vlcs = _mm_set1_epi8(pre[lcs_]);
+        __m128i vlcp = _mm_set1_epi8(pre[lcp]);
+        __m128i vlcs = _mm_set1_epi8(pre[lcs]);
         while (s + 16 <= e)
         {
           __m128i vlcpm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
-          __m128i vlcsm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + lcs_ - lcp_));
+          __m128i vlcsm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + lcs - lcp));
           __m128i vlcpeq = _mm_cmpeq_epi8(vlcp, vlcpm);
           __m128i vlcseq = _mm_cmpeq_epi8(vlcs, vlcsm);
           uint32_t mask = _mm_movemask_epi8(_mm_and_si128(vlcpeq, vlcseq));
           while (mask != 0)
           {
             uint32_t offset = ctz(mask);
-            if (std::memcmp(s - lcp_ + offset, pre, len) == 0)
+            if (std::memcmp(s - lcp + offset, pre, len) == 0)
             {
-              loc = s - lcp_ + offset - buf_;
+              loc = s - lcp + offset - buf_;
               set_current(loc);
-              if (min == 0)
+              if (predicted(loc, len, min))
                 return true;
-              if (min >= 4)
-              {
-                if (loc + len + min > end_ || Pattern::predict_match(pat_->pmh_, &buf_[loc + len], min))
-                  return true;
-              }
-              else
-              {
-                if (loc + len + 4 > end_ || Pattern::predict_match(pat_->pma_, &buf_[loc + len]) == 0)
-                  return true;
-              }
             }
             mask &= mask - 1;
           }
@@ -475,34 +479,24 @@ bool Matcher::advance()
       if (have_HW_SSE2())
       {
         // implements SSE2 string search scheme based on in http://0x80.pl/articles/simd-friendly-karp-rabin.html
-        __m128i vlcp = _mm_set1_epi8(pre[lcp_]);
-        __m128i vlcs = _mm_set1_epi8(pre[lcs_]);
+        __m128i vlcp = _mm_set1_epi8(pre[lcp]);
+        __m128i vlcs = _mm_set1_epi8(pre[lcs]);
         while (s + 16 <= e)
         {
           __m128i vlcpm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
-          __m128i vlcsm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + lcs_ - lcp_));
+          __m128i vlcsm = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + lcs - lcp));
           __m128i vlcpeq = _mm_cmpeq_epi8(vlcp, vlcpm);
           __m128i vlcseq = _mm_cmpeq_epi8(vlcs, vlcsm);
           uint32_t mask = _mm_movemask_epi8(_mm_and_si128(vlcpeq, vlcseq));
           while (mask != 0)
           {
             uint32_t offset = ctz(mask);
-            if (std::memcmp(s - lcp_ + offset, pre, len) == 0)
+            if (std::memcmp(s - lcp + offset, pre, len) == 0)
             {
-              loc = s - lcp_ + offset - buf_;
+              loc = s - lcp + offset - buf_;
               set_current(loc);
-              if (min == 0)
+              if (predicted(loc, len, min))
                 return true;
-              if (min >= 4)
-              {
-                if (loc + len + min > end_ || Pattern::predict_match(pat_->pmh_, &buf_[loc + len], min))
-                  return true;
-              }
-              else
-              {
-                if (loc + len + 4 > end_ || Pattern::predict_match(pat_->pma_, &buf_[loc + len]) == 0)
-                  return true;
-              }
             }
             mask &= mask - 1;
           }
@@ -511,12 +505,12 @@ bool Matcher::advance()
       }
 #elif defined(HAVE_NEON)
       // implements NEON/AArch64 string search scheme based on in http://0x80.pl/articles/simd-friendly-karp-rabin.html but 64 bit optimized
-      uint8x16_t vlcp = vdupq_n_u8(pre[lcp_]);
-      uint8x16_t vlcs = vdupq_n_u8(pre[lcs_]);
+      uint8x16_t vlcp = vdupq_n_u8(pre[lcp]);
+      uint8x16_t vlcs = vdupq_n_u8(pre[lcs]);
       while (s + 16 <= e)
       {
         uint8x16_t vlcpm = vld1q_u8(reinterpret_cast<const uint8_t*>(s));
-        uint8x16_t vlcsm = vld1q_u8(reinterpret_cast<const uint8_t*>(s) + lcs_ - lcp_);
+        uint8x16_t vlcsm = vld1q_u8(reinterpret_cast<const uint8_t*>(s) + lcs - lcp);
         uint8x16_t vlcpeq = vceqq_u8(vlcp, vlcpm);
         uint8x16_t vlcseq = vceqq_u8(vlcs, vlcsm);
         uint8x16_t vmask8 = vandq_u8(vlcpeq, vlcseq);
@@ -526,22 +520,12 @@ bool Matcher::advance()
         {
           for (int i = 0; i < 8; ++i)
           {
-            if ((mask & 0xff) && std::memcmp(s - lcp_ + i, pre, len) == 0)
+            if ((mask & 0xff) && std::memcmp(s - lcp + i, pre, len) == 0)
             {
-              loc = s - lcp_ + i - buf_;
+              loc = s - lcp + i - buf_;
               set_current(loc);
-              if (min == 0)
+              if (predicted(loc, len, min))
                 return true;
-              if (min >= 4)
-              {
-                if (loc + len + min > end_ || Pattern::predict_match(pat_->pmh_, &buf_[loc + len], min))
-                  return true;
-              }
-              else
-              {
-                if (loc + len + 4 > end_ || Pattern::predict_match(pat_->pma_, &buf_[loc + len]) == 0)
-                  return true;
-              }
             }
             mask >>= 8;
           }
@@ -551,22 +535,12 @@ bool Matcher::advance()
         {
           for (int i = 0; i < 8; ++i)
           {
-            if ((mask & 0xff) && std::memcmp(s - lcp_ + i + 8, pre, len) == 0)
+            if ((mask & 0xff) && std::memcmp(s - lcp + i + 8, pre, len) == 0)
             {
-              loc = s - lcp_ + i + 8 - buf_;
+              loc = s - lcp + i + 8 - buf_;
               set_current(loc);
-              if (min == 0)
+              if (predicted(loc, len, min))
                 return true;
-              if (min >= 4)
-              {
-                if (loc + len + min > end_ || Pattern::predict_match(pat_->pmh_, &buf_[loc + len], min))
-                  return true;
-              }
-              else
-              {
-                if (loc + len + 4 > end_ || Pattern::predict_match(pat_->pma_, &buf_[loc + len]) == 0)
-                  return true;
-              }
             }
             mask >>= 8;
           }
@@ -577,33 +551,23 @@ bool Matcher::advance()
       while (s < e)
       {
         do
-          s = static_cast<const char*>(std::memchr(s, pre[lcp_], e - s));
-        while (s != nullptr && s[lcs_ - lcp_] != pre[lcs_] && ++s < e);
+          s = static_cast<const char*>(std::memchr(s, pre[lcp], e - s));
+        while (s != nullptr && s[lcs - lcp] != pre[lcs] && ++s < e);
         if (s == nullptr || s >= e)
         {
           s = e;
           break;
         }
-        if (len <= 2 || memcmp(s - lcp_, pre, len) == 0)
+        if (len <= 2 || memcmp(s - lcp, pre, len) == 0)
         {
-          loc = s - lcp_ - buf_;
+          loc = s - lcp - buf_;
           set_current(loc);
-          if (min == 0)
+          if (predicted(loc, len, min))
             return true;
-          if (min >= 4)
-          {
-            if (loc + len + min > end_ || Pattern::predict_match(pat_->pmh_, &buf_[loc + len], min))
-              return true;
-          }
-          else
-          {
-            if (loc + len + 4 > end_ || Pattern::predict_match(pat_->pma_, &buf_[loc + len]) == 0)
-              return true;
-          }
         }
         ++s;
       }
-      loc = s - lcp_ - buf_;
+      loc = s - lcp - buf_;
       set_current_match(loc - 1);
       peek_more();
       loc = cur_ + 1;
@@ -620,8 +584,8 @@ bool Matcher::advance()
       {
         size_t k = 0;
         do
-          s += k = bms_[static_cast<uint8_t>(*s)];
-        while (k > 0 ? s < e : s[lcp_ - len + 1] != pre[lcp_] && (s += bmd_) < e);
+          s += k = bms[static_cast<uint8_t>(*s)];
+        while (k > 0 ? s < e : s[lcp - len + 1] != pre[lcp] && (s += bmd) < e);
         if (s >= e)
           break;
         const char *p = t - 1;
@@ -635,30 +599,20 @@ bool Matcher::advance()
         {
           loc = q - buf_ + 1;
           set_current(loc);
-          if (min == 0)
+          if (predicted(loc, len, min))
             return true;
-          if (min >= 4)
-          {
-            if (loc + len + min > end_ || Pattern::predict_match(pat_->pmh_, &buf_[loc + len], min))
-              return true;
-          }
-          else
-          {
-            if (loc + len + 4 > end_ || Pattern::predict_match(pat_->pma_, &buf_[loc + len]) == 0)
-              return true;
-          }
         }
-        if (pre + bmd_ >= p)
+        if (pre + bmd >= p)
         {
-          s += bmd_;
+          s += bmd;
         }
         else
         {
-          size_t k = bms_[static_cast<uint8_t>(*q)];
-          if (p + k > t + bmd_)
+          size_t k = bms[static_cast<uint8_t>(*q)];
+          if (p + k > t + bmd)
             s += k - (t - p);
           else
-            s += bmd_;
+            s += bmd;
         }
       }
       s -= len - 1;
@@ -672,4 +626,84 @@ bool Matcher::advance()
   }
 }
 
+// search the string of a one_ pattern with FIND or SPLIT, without running the DFA
+size_t Matcher::match_one(Method method)
+{
+  const char *pre = pat_->pre_;
+  size_t len = pat_->len_;
+  txt_ = buf_ + cur_;
+  if (method == Const::FIND)
+  {
+    // the string at the current position or the next string found by advance()
+    pos_ = end_;
+    while (cur_ + len > end_ && peek_more() != EOF)
+      pos_ = end_;
+    if (cur_ + len <= end_ && (std::memcmp(buf_ + cur_, pre, len) == 0 || advance()))
+    {
+      txt_ = buf_ + cur_;
+      len_ = len;
+      set_current(cur_ + len);
+      DBGLOG("One: txt = '%s' len = %zu", std::string(txt_, len_).c_str(), len_);
+      return cap_ = pat_->one_;
+    }
+    set_current_match(end_);
+    len_ = 0;
+    return cap_ = 0;
+  }
+  // SPLIT: find the least common char of the string with memchr, then compare the string
+  size_t lcp = pat_->lcp_ < len ? pat_->lcp_ : 0;
+  size_t loc = cur_;
+  while (true)
+  {
+    if (loc + len <= end_)
+    {
+      const char *s = buf_ + loc + lcp;
+      const char *e = buf_ + end_ - len + 1 + lcp;
+      while (s < e && (s = static_cast<const char*>(std::memchr(s, pre[lcp], e - s))) != nullptr)
+      {
+        if (std::memcmp(s - lcp, pre, len) == 0)
+        {
+          loc = s - lcp - buf_;
+          len_ = loc - cur_;
+          set_current(loc + len);
+          DBGLOG("One split: txt = '%s' len = %zu", std::string(txt_, len_).c_str(), len_);
+          return cap_ = pat_->one_;
+        }
+        ++s;
+      }
+      loc = end_ - len + 1;
+    }
+    // the string is not in the buffer, read more input while keeping the text to split
+    size_t gap = loc - cur_;
+    pos_ = end_;
+    if (peek_more() == EOF)
+      break;
+    pos_ = cur_;
+    loc = cur_ + gap;
+  }
+  len_ = end_ - cur_;
+  cap_ = got_ != Const::EOB ? Const::EMPTY : 0;
+  set_current(end_);
+  got_ = Const::EOB;
+  DBGLOG("One split at eof: cap = %zu txt = '%s' len = %zu", cap_, std::string(txt_, len_).c_str(), len_);
+  return cap_;
+}
+
+#if !defined(WITH_NO_INDENT)
+// advance col_ by eight columns at a time as long as the next eight chars of the indent have no tab
+void Matcher::skip_indent()
+{
+  while (ind_ + 9 <= pos_)
+  {
+    uint64_t word;
+    std::memcpy(&word, buf_ + ind_, sizeof(word));
+    word ^= 0x0909090909090909ULL;
+    if (((word - 0x0101010101010101ULL) & ~word & 0x8080808080808080ULL) != 0)
+      break;
+    col_ += 8;
+    ind_ += 8;
+  }
+}
+#endif
+
 } // namespace reflex
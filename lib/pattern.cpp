@@ -38,7 +38,16 @@
 #include <reflex/timer.h>
 #include <cstdlib>
 #include <cerrno>
+#include <cstdio>
 #include <cmath>
+#include <exception>
+#include <thread>
+
+#if (defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)) && !defined(__CYGWIN__) && !defined(__MINGW32__) && !defined(__MINGW64__)
+# include <process.h> // _getpid()
+#else
+# include <unistd.h>  // getpid()
+#endif
 
 /// DFA compaction: -1 == reverse order edge compression (best); 1 == edge compression; 0 == no edge compression.
 /** Edge compression reorders edges to produce fewer tests when executed in the compacted order.
@@ -83,8 +92,10 @@ namespace reflex {
 
 #if (defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(_WIN64) || defined(__BORLANDC__)) && !defined(__CYGWIN__) && !defined(__MINGW32__) && !defined(__MINGW64__)
 inline int fopen_s(FILE **file, const char *name, const char *mode) { return ::fopen_s(file, name, mode); }
+inline unsigned long process_id() { return static_cast<unsigned long>(::_getpid()); }
 #else
 inline int fopen_s(FILE **file, const char *name, const char *mode) { return (*file = ::fopen(name, mode)) ? 0 : errno; }
+inline unsigned long process_id() { return static_cast<unsigned long>(::getpid()); }
 #endif
 
 static void print_char(FILE *file, int c, bool h = false)
@@ -103,6 +114,44 @@ static void print_char(FILE *file, int c, bool h = false)
     ::fprintf(file, "%u", c);
 }
 
+static size_t bits_of(uint16_t x)
+{
+  size_t n = 0;
+  for (; x != 0; x &= x - 1)
+    ++n;
+  return n;
+}
+
+static uint64_t hash_of(const std::string& s, size_t n = std::string::npos)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+  n = std::min(n, s.size());
+  for (size_t i = 0; i < n; ++i)
+    h = (h ^ static_cast<uint8_t>(s[i])) * 0x100000001b3ULL;
+  return h;
+}
+
+template<typename T>
+static void put_cache(std::string& data, T x)
+{
+  data.append(reinterpret_cast<const char*>(&x), sizeof(T));
+}
+
+static bool get_cache(const char *& s, const char *e, void *p, size_t n)
+{
+  if (static_cast<size_t>(e - s) < n)
+    return false;
+  std::memcpy(p, s, n);
+  s += n;
+  return true;
+}
+
+/// Cache file format version, must be incremented when the opcode encoding or the cached data changes.
+static const uint32_t cache_version = 2;
+
+/// Cache file magic, followed by the version and a byte order mark.
+static const char cache_magic[8] = { 'R', 'E', 'f', 'l', 'e', 'x', 'C', '\0' };
+
 static const char *posix_class[] = {
   "ASCII",
   "Space",
@@ -152,6 +201,8 @@ const std::string Pattern::operator[](Accept choice) const
   return "";
 }
 
+thread_local Pattern::Arena *Pattern::Arena::current = nullptr;
+
 void Pattern::error(regex_error_type code, size_t pos) const
 {
   regex_error err(code, rex_, pos);
@@ -167,14 +218,17 @@ void Pattern::init(const char *options, const uint8_t *pred)
   nop_ = 0;
   len_ = 0;
   min_ = 0;
-  one_ = false;
+  one_ = 0;
   if (opc_ || fsm_)
   {
+    // a narrow table starts with Const::NTBL, which is not an opcode: REDO is 0xFD000000 and a GOTO on 0xFD has hi 0xFD to 0xFF
+    if (opc_ != nullptr && (opc_[0] & 0xFFFF0000) == Const::NTBL)
+      decode_narrow();
     if (pred != nullptr)
     {
       len_ = pred[0];
       min_ = pred[1] & 0x0f;
-      one_ = pred[1] & 0x10;
+      one_ = (pred[1] & 0x10) ? 1 : 0;
       memcpy(pre_, pred + 2, len_);
       if (min_ > 0)
       {
@@ -198,35 +252,90 @@ void Pattern::init(const char *options, const uint8_t *pred)
       }
     }
   }
+  else if (opt_.u)
+  {
+    // option u: parse the regex pattern into an NFA kept on the heap to add and remove subpatterns later
+    {
+      Arena::Scope scope(nullptr);
+      upd_.reset(new Parsed());
+      parse(upd_->startpos, upd_->followpos, upd_->modifiers, upd_->lookahead);
+    }
+    compile_parsed();
+  }
   else
   {
-    Positions startpos;
-    Follow    followpos;
-    Map       modifiers;
-    Map       lookahead;
-    // parse the regex pattern to construct the followpos NFA without epsilon transitions
-    parse(startpos, followpos, modifiers, lookahead);
-    // start state = startpos = firstpost of the followpos NFA, also merge the tree DFA root when non-nullptr
-    DFA::State *start = dfa_.state(tfa_.tree, startpos);
-    // compile the NFA into a DFA
-    compile(start, followpos, modifiers, lookahead);
-    // assemble DFA opcode tables or direct code
-    assemble(start);
-    // delete the DFA
-    dfa_.clear();
+    // option c=dir: load the compiled pattern from the cache, unless code files are requested with option f
+    std::string file;
+    if (!opt_.c.empty() && opt_.f.empty())
+    {
+      char name[32];
+      uint64_t h = hash_of(cache_key());
+      (void)snprintf(name, sizeof(name), "/reflex-%08x%08x.dfa", static_cast<unsigned int>(h >> 32), static_cast<unsigned int>(h));
+      file.assign(opt_.c).append(name);
+    }
+    if (file.empty() || !load_cache(file))
+    {
+      // allocate the compiler's containers in an arena that is released at once when done
+      Arena arena;
+      Arena::Scope scope(arena);
+      // delete the DFA before the arena is released, also when an exception is thrown
+      struct Clear {
+        ~Clear()
+        {
+          dfa.clear();
+        }
+        DFA& dfa;
+      } guard = { dfa_ };
+      Positions startpos;
+      Follow    followpos;
+      Map       modifiers;
+      Map       lookahead;
+      // parse the regex pattern to construct the followpos NFA without epsilon transitions
+      parse(startpos, followpos, modifiers, lookahead);
+      // option l: keep the NFA for matchers to construct the DFA states on demand
+      if (!keep_nfa(startpos, followpos, modifiers, lookahead))
+      {
+        // start state = startpos = firstpost of the followpos NFA, also merge the tree DFA root when non-nullptr
+        DFA::State *start = dfa_.state(tfa_.tree, startpos);
+        // compile the NFA into a DFA
+        compile(start, followpos, modifiers, lookahead);
+        // assemble DFA opcode tables or direct code
+        assemble(start);
+        // save the compiled pattern to the cache
+        if (!file.empty())
+          save_cache(file);
+      }
+    }
   }
+  gen_predict_nibbles();
+  gen_boyer_moore();
+  dtt_.clear();
+  if (opt_.t)
+    gen_dense_table();
+  dsp_.clear();
+  if (dtt_.empty())
+    gen_dispatch();
 }
 
 void Pattern::init_options(const char *options)
 {
+  opt_.a = false;
   opt_.b = false;
+  opt_.c.clear();
+  opt_.d = false;
+  opt_.g.clear();
   opt_.i = false;
+  opt_.j = 0;
+  opt_.k = false;
+  opt_.l = 0;
   opt_.m = false;
   opt_.o = false;
   opt_.p = false;
   opt_.q = false;
   opt_.r = false;
   opt_.s = false;
+  opt_.t = false;
+  opt_.u = false;
   opt_.w = false;
   opt_.x = false;
   opt_.e = '\\';
@@ -236,19 +345,70 @@ void Pattern::init_options(const char *options)
     {
       switch (*s)
       {
+        case 'a':
+          opt_.a = true;
+          break;
         case 'b':
           opt_.b = true;
           break;
+        case 'c':
+          for (const char *t = s += (s[1] == '='); *s != ';' && *s != '\0'; ++t)
+          {
+            if (std::isspace(*t) || *t == ';' || *t == '\0')
+            {
+              if (t > s + 1)
+                opt_.c = std::string(s + 1, t - s - 1);
+              s = t;
+            }
+          }
+          --s;
+          break;
+        case 'd':
+          opt_.d = true;
+          break;
         case 'e':
           opt_.e = (*(s += (s[1] == '=') + 1) == ';' || *s == '\0' ? 256 : *s++);
           --s;
           break;
+        case 'g':
+          for (const char *t = s += (s[1] == '='); *s != ';' && *s != '\0'; ++t)
+          {
+            if (std::isspace(*t) || *t == ';' || *t == '\0')
+            {
+              if (t > s + 1)
+                opt_.g = std::string(s + 1, t - s - 1);
+              s = t;
+            }
+          }
+          --s;
+          break;
         case 'p':
           opt_.p = true;
           break;
         case 'i':
           opt_.i = true;
           break;
+        case 'j':
+        {
+          const char *t = s + 1 + (s[1] == '=');
+          char *r = nullptr;
+          unsigned long n = std::strtoul(t, &r, 10);
+          opt_.j = r > t && n > 0 ? static_cast<size_t>(n) : std::thread::hardware_concurrency();
+          s = (r > t ? r : t) - 1;
+          break;
+        }
+        case 'l':
+        {
+          const char *t = s + 1 + (s[1] == '=');
+          char *r = nullptr;
+          unsigned long n = std::strtoul(t, &r, 10);
+          opt_.l = r > t && n > 0 ? static_cast<size_t>(n) : Const::LAZY;
+          s = (r > t ? r : t) - 1;
+          break;
+        }
+        case 'k':
+          opt_.k = true;
+          break;
         case 'm':
           opt_.m = true;
           break;
@@ -264,6 +424,12 @@ void Pattern::init_options(const char *options)
         case 's':
           opt_.s = true;
           break;
+        case 't':
+          opt_.t = true;
+          break;
+        case 'u':
+          opt_.u = true;
+          break;
         case 'w':
           opt_.w = true;
           break;
@@ -306,6 +472,207 @@ void Pattern::init_options(const char *options)
   }
 }
 
+std::string Pattern::cache_key() const
+{
+  // the regex and the options that affect the compiled pattern
+  std::string key(rex_);
+  key.push_back('\0');
+  if (opt_.a)
+    key.push_back('a');
+  if (opt_.b)
+    key.push_back('b');
+  if (opt_.d)
+    key.push_back('d');
+  if (opt_.i)
+    key.push_back('i');
+  // option l: never load a DFA cached without option l, only a DFA that option l falls back to
+  if (opt_.l > 0)
+    key.push_back('l');
+  if (opt_.m)
+    key.push_back('m');
+  if (opt_.q)
+    key.push_back('q');
+  if (opt_.s)
+    key.push_back('s');
+  if (opt_.x)
+    key.push_back('x');
+  key.push_back('e');
+  put_cache(key, opt_.e);
+  return key;
+}
+
+bool Pattern::load_cache(const std::string& file)
+{
+  FILE *fd = nullptr;
+  if (reflex::fopen_s(&fd, file.c_str(), "rb") != 0 || fd == nullptr)
+    return false;
+  std::string data;
+  char block[4096];
+  size_t n;
+  while ((n = ::fread(block, 1, sizeof(block), fd)) > 0)
+    data.append(block, n);
+  ::fclose(fd);
+  // the file ends with the hash of its content
+  uint64_t check;
+  if (data.size() < sizeof(check))
+    return false;
+  n = data.size() - sizeof(check);
+  std::memcpy(&check, data.data() + n, sizeof(check));
+  if (check != hash_of(data, n))
+    return false;
+  const char *s = data.data();
+  const char *e = s + n;
+  char magic[sizeof(cache_magic)];
+  uint32_t version, order, size;
+  if (!get_cache(s, e, magic, sizeof(magic)) ||
+      std::memcmp(magic, cache_magic, sizeof(magic)) != 0 ||
+      !get_cache(s, e, &version, sizeof(version)) ||
+      version != cache_version ||
+      !get_cache(s, e, &order, sizeof(order)) ||
+      order != 0x01020304 ||
+      !get_cache(s, e, &size, sizeof(size)))
+    return false;
+  // compare the whole key to rule out hash collisions
+  std::string key = cache_key();
+  if (size != key.size() || static_cast<size_t>(e - s) < size || key.compare(0, size, s, size) != 0)
+    return false;
+  s += size;
+  // decode into locals first, this pattern is left unchanged when the cached data is invalid
+  uint32_t nop, len, min, one, ends, accs;
+  uint64_t vno, eno;
+  char pre[sizeof(pre_)];
+  Pred bit[256];
+  Pred pmh[Const::HASH];
+  Pred pma[Const::HASH];
+  if (!get_cache(s, e, &nop, sizeof(nop)) ||
+      nop == 0 ||
+      static_cast<size_t>(e - s) / sizeof(Opcode) < nop)
+    return false;
+  const char *code = s;
+  s += nop * sizeof(Opcode);
+  if (!get_cache(s, e, &len, sizeof(len)) ||
+      len >= sizeof(pre) ||
+      !get_cache(s, e, &min, sizeof(min)) ||
+      !get_cache(s, e, &one, sizeof(one)) ||
+      !get_cache(s, e, pre, len) ||
+      !get_cache(s, e, bit, sizeof(bit)) ||
+      !get_cache(s, e, pmh, sizeof(pmh)) ||
+      !get_cache(s, e, pma, sizeof(pma)) ||
+      !get_cache(s, e, &vno, sizeof(vno)) ||
+      !get_cache(s, e, &eno, sizeof(eno)) ||
+      !get_cache(s, e, &ends, sizeof(ends)) ||
+      static_cast<size_t>(e - s) / sizeof(Location) < ends)
+    return false;
+  std::vector<Location> end(ends);
+  for (uint32_t i = 0; i < ends; ++i)
+    (void)get_cache(s, e, &end[i], sizeof(Location));
+  if (!get_cache(s, e, &accs, sizeof(accs)) || static_cast<size_t>(e - s) < accs)
+    return false;
+  std::vector<bool> acc(accs);
+  for (uint32_t i = 0; i < accs; ++i)
+    acc[i] = s[i] != 0;
+  s += accs;
+  // option a: the lists of subpatterns accepted by the DFA states
+  std::vector<Accept> acs;
+  std::vector<std::pair<Index,Index> > aci;
+  if (opt_.a)
+  {
+    uint32_t sets, lists;
+    if (!get_cache(s, e, &sets, sizeof(sets)) || static_cast<size_t>(e - s) / sizeof(Accept) < sets)
+      return false;
+    acs.resize(sets);
+    for (uint32_t i = 0; i < sets; ++i)
+      (void)get_cache(s, e, &acs[i], sizeof(Accept));
+    if (!get_cache(s, e, &lists, sizeof(lists)) || static_cast<size_t>(e - s) / (2 * sizeof(Index)) < lists)
+      return false;
+    aci.resize(lists);
+    for (uint32_t i = 0; i < lists; ++i)
+    {
+      (void)get_cache(s, e, &aci[i].first, sizeof(Index));
+      (void)get_cache(s, e, &aci[i].second, sizeof(Index));
+    }
+  }
+  if (s != e)
+    return false;
+  Opcode *opcode = new Opcode[nop];
+  std::memcpy(opcode, code, nop * sizeof(Opcode));
+  opc_ = opcode;
+  nop_ = nop;
+  len_ = len;
+  min_ = min;
+  one_ = one;
+  std::memcpy(pre_, pre, len);
+  std::memcpy(bit_, bit, sizeof(bit_));
+  std::memcpy(pmh_, pmh, sizeof(pmh_));
+  std::memcpy(pma_, pma, sizeof(pma_));
+  vno_ = static_cast<size_t>(vno);
+  eno_ = static_cast<size_t>(eno);
+  end_.swap(end);
+  acc_.swap(acc);
+  acs_.swap(acs);
+  aci_.swap(aci);
+  pms_ = 0.0;
+  vms_ = 0.0;
+  ems_ = 0.0;
+  wms_ = 0.0;
+  return true;
+}
+
+void Pattern::save_cache(const std::string& file) const
+{
+  if (nop_ == 0 || opc_ == nullptr)
+    return;
+  std::string data(cache_magic, sizeof(cache_magic));
+  put_cache(data, cache_version);
+  put_cache(data, static_cast<uint32_t>(0x01020304));
+  std::string key = cache_key();
+  put_cache(data, static_cast<uint32_t>(key.size()));
+  data.append(key);
+  put_cache(data, static_cast<uint32_t>(nop_));
+  data.append(reinterpret_cast<const char*>(opc_), nop_ * sizeof(Opcode));
+  put_cache(data, static_cast<uint32_t>(len_));
+  put_cache(data, static_cast<uint32_t>(min_));
+  put_cache(data, static_cast<uint32_t>(one_));
+  data.append(pre_, len_);
+  data.append(reinterpret_cast<const char*>(bit_), sizeof(bit_));
+  data.append(reinterpret_cast<const char*>(pmh_), sizeof(pmh_));
+  data.append(reinterpret_cast<const char*>(pma_), sizeof(pma_));
+  put_cache(data, static_cast<uint64_t>(vno_));
+  put_cache(data, static_cast<uint64_t>(eno_));
+  put_cache(data, static_cast<uint32_t>(end_.size()));
+  for (std::vector<Location>::const_iterator i = end_.begin(); i != end_.end(); ++i)
+    put_cache(data, *i);
+  put_cache(data, static_cast<uint32_t>(acc_.size()));
+  for (std::vector<bool>::const_iterator i = acc_.begin(); i != acc_.end(); ++i)
+    data.push_back(*i ? 1 : 0);
+  if (opt_.a)
+  {
+    put_cache(data, static_cast<uint32_t>(acs_.size()));
+    for (std::vector<Accept>::const_iterator i = acs_.begin(); i != acs_.end(); ++i)
+      put_cache(data, *i);
+    put_cache(data, static_cast<uint32_t>(aci_.size()));
+    for (std::vector<std::pair<Index,Index> >::const_iterator i = aci_.begin(); i != aci_.end(); ++i)
+    {
+      put_cache(data, i->first);
+      put_cache(data, i->second);
+    }
+  }
+  put_cache(data, hash_of(data));
+  // write to a temporary file first and then rename it, so a concurrent load never sees a partial file
+  // the temporary file name is unique to this process and pattern, so concurrent writers do not clobber it
+  char tmp[64];
+  (void)snprintf(tmp, sizeof(tmp), ".%lu.%p.tmp", process_id(), static_cast<const void*>(this));
+  std::string temp(file);
+  temp.append(tmp);
+  FILE *fd = nullptr;
+  if (reflex::fopen_s(&fd, temp.c_str(), "wb") != 0 || fd == nullptr)
+    return;
+  bool ok = ::fwrite(data.data(), 1, data.size(), fd) == data.size();
+  ok = ::fclose(fd) == 0 && ok;
+  if (!ok || std::rename(temp.c_str(), file.c_str()) != 0)
+    (void)std::remove(temp.c_str());
+}
+
 void Pattern::parse(
     Positions& startpos,
     Follow&    followpos,
@@ -319,10 +686,6 @@ void Pattern::parse(
   Location   loc = 0;
   Accept     choice = 1;
   Lazy       lazyidx = 0;
-  Positions  firstpos;
-  Positions  lastpos;
-  bool       nullable;
-  Iter       iter;
   timer_type t;
   timer_start(t);
   if (at(0) == '(' && at(1) == '?')
@@ -363,118 +726,15 @@ void Pattern::parse(
   }
   do
   {
-    Location end = loc;
-    if (!opt_.q && !opt_.x)
-    {
-      while (true)
-      {
-        Char c = at(end);
-        if (c == '\0' || c == '|')
-          break;
-        if (c == '.' || c == '^' || c == '$' || c == '(' || c == ')' || c == '[' || c == '{' || c == '?' || c == '*' || c == '+')
-        {
-          end = loc;
-          break;
-        }
-        if (c == opt_.e)
-        {
-          c = at(++end);
-          if (c == '\0' || std::strchr("0123456789<>ABDHLNPSUWXbcdehijklpsuwxz", c) != nullptr)
-          {
-            end = loc;
-            break;
-          }
-          if (c == 'Q')
-          {
-            while ((c = at(++end)) != '\0')
-              if (c == opt_.e && at(end + 1) == 'E')
-                break;
-          }
-        }
-        ++end;
-      }
-    }
-    if (loc < end)
-    {
-      // string pattern found w/o regex metas: merge string into the tree DFA
-      bool quote = false;
-      Tree::Node *t = tfa_.root();
-      while (loc < end)
-      {
-        Char c = at(loc++);
-        if (c == opt_.e)
-        {
-          if (at(loc) == 'Q')
-          {
-            quote = true;
-            ++loc;
-            continue;
-          }
-          if (at(loc) == 'E')
-          {
-            quote = false;
-            ++loc;
-            continue;
-          }
-          if (!quote)
-          {
-            static const char abtnvfr[] = "abtnvfr";
-            c = at(loc++);
-            const char *s = std::strchr(abtnvfr, c);
-            if (s != nullptr)
-              c = static_cast<Char>(s - abtnvfr + '\a');
-          }
-        }
-        else if (c >= 'A' && c <= 'Z' && opt_.i)
-        {
-          c = lowercase(c);
-        }
-        t = tfa_.edge(t, c);
-      }
-      if (t->accept == 0)
-        t->accept = choice;
-    }
-    else
+    Positions   first;
+    Tree::Node *node = parse_choice(loc, choice, first, followpos, lazyidx, modifiers, lookahead);
+    set_insert(startpos, first);
+    // option u: keep the start positions and the tree DFA node of each subpattern to remove subpatterns
+    if (upd_)
     {
-      Lazyset lazyset;
-      parse2(
-          true,
-          loc,
-          firstpos,
-          lastpos,
-          nullable,
-          followpos,
-          lazyidx,
-          lazyset,
-          modifiers,
-          lookahead[choice],
-          iter);
-      end_.push_back(loc);
-      set_insert(startpos, firstpos);
-      if (nullable)
-      {
-        if (lazyset.empty())
-        {
-          startpos.insert(Position(choice).accept(true));
-        }
-        else
-        {
-          for (Lazyset::const_iterator l = lazyset.begin(); l != lazyset.end(); ++l)
-            startpos.insert(Position(choice).accept(true).lazy(*l));
-        }
-      }
-      for (Positions::const_iterator p = lastpos.begin(); p != lastpos.end(); ++p)
-      {
-        if (lazyset.empty())
-        {
-          followpos[p->pos()].insert(Position(choice).accept(true));
-        }
-        else
-        {
-          for (Lazyset::const_iterator l = lazyset.begin(); l != lazyset.end(); ++l)
-            followpos[p->pos()].insert(Position(choice).accept(true).lazy(*l));
-        }
-      }
+      upd_->firstpos.push_back(first);
+      upd_->nodes.push_back(node);
+      upd_->removed.push_back(false);
     }
     if (++choice == 0)
       error(regex_error::exceeds_limits, loc); // overflow: too many top-level alternations (should never happen)
@@ -490,6 +750,8 @@ void Pattern::parse(
     update_modified('m', modifiers, 0, len - 1);
   if (opt_.s)
     update_modified('s', modifiers, 0, len - 1);
+  if (upd_)
+    upd_->lazyidx = lazyidx;
   pms_ = timer_elapsed(t);
 #ifdef DEBUG_REFLEX
   DBGLOGN("startpos = {");
@@ -509,6 +771,137 @@ void Pattern::parse(
   DBGLOG("END parse()");
 }
 
+Pattern::Tree::Node *Pattern::parse_choice(
+    Location&  loc,
+    Accept     choice,
+    Positions& startpos,
+    Follow&    followpos,
+    Lazy&      lazyidx,
+    Map&       modifiers,
+    Map&       lookahead)
+{
+  Location end = loc;
+  // option a: skip the tree DFA, which keeps only the first of the subpatterns that accept the same string
+  if (!opt_.q && !opt_.x && !opt_.a)
+  {
+    while (true)
+    {
+      Char c = at(end);
+      if (c == '\0' || c == '|')
+        break;
+      if (c == '.' || c == '^' || c == '$' || c == '(' || c == ')' || c == '[' || c == '{' || c == '?' || c == '*' || c == '+')
+      {
+        end = loc;
+        break;
+      }
+      if (c == opt_.e)
+      {
+        c = at(++end);
+        if (c == '\0' || std::strchr("0123456789<>ABDHLNPSUWXbcdehijklpsuwxz", c) != nullptr)
+        {
+          end = loc;
+          break;
+        }
+        if (c == 'Q')
+        {
+          while ((c = at(++end)) != '\0')
+            if (c == opt_.e && at(end + 1) == 'E')
+              break;
+        }
+      }
+      ++end;
+    }
+  }
+  if (loc < end)
+  {
+    // string pattern found w/o regex metas: merge string into the tree DFA
+    bool quote = false;
+    Tree::Node *t = tfa_.root();
+    while (loc < end)
+    {
+      Char c = at(loc++);
+      if (c == opt_.e)
+      {
+        if (at(loc) == 'Q')
+        {
+          quote = true;
+          ++loc;
+          continue;
+        }
+        if (at(loc) == 'E')
+        {
+          quote = false;
+          ++loc;
+          continue;
+        }
+        if (!quote)
+        {
+          static const char abtnvfr[] = "abtnvfr";
+          c = at(loc++);
+          const char *s = std::strchr(abtnvfr, c);
+          if (s != nullptr)
+            c = static_cast<Char>(s - abtnvfr + '\a');
+        }
+      }
+      else if (c >= 'A' && c <= 'Z' && opt_.i)
+      {
+        c = lowercase(c);
+      }
+      t = tfa_.edge(t, c);
+    }
+    if (t->accept == 0)
+      t->accept = choice;
+    return t;
+  }
+  else
+  {
+    Positions firstpos;
+    Positions lastpos;
+    bool      nullable;
+    Iter      iter;
+    Lazyset   lazyset;
+    parse2(
+        true,
+        loc,
+        firstpos,
+        lastpos,
+        nullable,
+        followpos,
+        lazyidx,
+        lazyset,
+        modifiers,
+        lookahead[choice],
+        iter);
+    end_.push_back(loc);
+    set_insert(startpos, firstpos);
+    if (nullable)
+    {
+      if (lazyset.empty())
+      {
+        startpos.insert(Position(choice).accept(true));
+      }
+      else
+      {
+        for (Lazyset::const_iterator l = lazyset.begin(); l != lazyset.end(); ++l)
+          startpos.insert(Position(choice).accept(true).lazy(*l));
+      }
+    }
+    for (Positions::const_iterator p = lastpos.begin(); p != lastpos.end(); ++p)
+    {
+      if (lazyset.empty())
+      {
+        followpos[p->pos()].insert(Position(choice).accept(true));
+      }
+      else
+      {
+        for (Lazyset::const_iterator l = lazyset.begin(); l != lazyset.end(); ++l)
+          followpos[p->pos()].insert(Position(choice).accept(true).lazy(*l));
+      }
+    }
+  }
+  return nullptr;
+}
+
 void Pattern::parse1(
     bool       begin,
     Location&  loc,
@@ -1283,6 +1676,24 @@ Pattern::Char Pattern::parse_esc(Location& loc, Chars *chars) const
   return c;
 }
 
+/// A thread of option j with its own arena and its own copy of the followpos NFA, since compile_transition() updates the followpos NFA.
+struct Pattern::Job {
+  Job(const Follow& followpos)
+    :
+      arena(new Arena)
+  {
+    // the thread updates its copy of the followpos NFA, which therefore allocates from the arena of the thread
+    Arena::Scope scope(*arena);
+    Follow copy(followpos);
+    this->followpos.swap(copy);
+  }
+  std::unique_ptr<Arena> arena;     ///< arena of the thread, adopted by the arena of the compiler when done
+  Follow                 followpos; ///< copy of the followpos NFA used by the thread
+  size_t                 k;         ///< the thread computes the transitions of the k-th state of the frontier and every step-th state after it
+  size_t                 step;      ///< number of threads
+  std::exception_ptr     error;     ///< exception thrown by the thread
+};
+
 void Pattern::compile(
     DFA::State *start,
     Follow&     followpos,
@@ -1308,41 +1719,77 @@ void Pattern::compile(
     table[hash_pos(start)] = start;
   // last added state
   DFA::State *last_state = start;
+  // option j: compute the transitions of the frontier of states added but not yet expanded with multiple threads, requires an arena to release the memory allocated by the threads
+  size_t threads = Arena::current != nullptr ? opt_.j : 0;
+  std::vector<Job*> jobs;
+  std::vector<DFA::State*> frontier;
+  std::vector<Moves> frontier_moves;
+  size_t next = 0;
+  // release the jobs and adopt the memory they allocated when done, also when an exception is thrown
+  struct Release {
+    ~Release()
+    {
+      for (std::vector<Job*>::iterator job = jobs.begin(); job != jobs.end(); ++job)
+      {
+        // the DFA states may use memory allocated by the thread
+        Arena::current->adopt((*job)->arena.release());
+        delete *job;
+      }
+    }
+    std::vector<Job*>& jobs;
+  } release = { jobs };
   for (DFA::State *state = start; state; state = state->next)
   {
     Moves moves;
     timer_start(et);
-    // use the tree DFA accept state, if present
-    if (state->tnode != nullptr && state->tnode->accept > 0)
-      state->accept = state->tnode->accept;
-    compile_transition(
-        state,
-        followpos,
-        modifiers,
-        lookahead,
-        moves);
+    if (threads > 1)
+    {
+      if (next >= frontier.size())
+      {
+        // the next frontier are the states from this state to the last state added, their numbering does not depend on the threads
+        frontier.clear();
+        for (DFA::State *s = state; s != nullptr; s = s->next)
+          frontier.push_back(s);
+        if (jobs.empty() && frontier.size() >= 2 * threads)
+          for (size_t k = 1; k < threads; ++k)
+            jobs.push_back(new Job(followpos));
+        compile_frontier(frontier, followpos, modifiers, lookahead, jobs, frontier_moves);
+        next = 0;
+      }
+      moves.swap(frontier_moves[next++]);
+    }
+    else
+    {
+      // use the tree DFA accept state, if present
+      if (state->tnode != nullptr && state->tnode->accept > 0)
+        state->accept = state->tnode->accept;
+      compile_transition(
+          state,
+          followpos,
+          modifiers,
+          lookahead,
+          moves);
+    }
     if (state->tnode != nullptr)
     {
       // merge tree DFA transitions into the final DFA transitions to target states
       if (moves.empty())
       {
         // no DFA transitions: the final DFA transitions are the tree DFA transitions to target states
-        for (Char c = 0; c < 256; ++c)
+        for (Tree::Node *t = state->tnode->child; t != nullptr; t = t->sibling)
         {
-          if (state->tnode->edge[c] != nullptr)
+          Char c = t->chr;
+          DFA::State *target_state = last_state = last_state->next = dfa_.state(t);
+          if (opt_.i && std::isalpha(c))
           {
-            DFA::State *target_state = last_state = last_state->next = dfa_.state(state->tnode->edge[c]);
-            if (opt_.i && std::isalpha(c))
-            {
-              state->edges[lowercase(c)] = std::pair<Char,DFA::State*>(lowercase(c), target_state);
-              state->edges[uppercase(c)] = std::pair<Char,DFA::State*>(uppercase(c), target_state);
-              eno_ += 2;
-            }
-            else
-            {
-              state->edges[c] = std::pair<Char,DFA::State*>(c, target_state);
-              ++eno_;
-            }
+            state->edges[lowercase(c)] = std::pair<Char,DFA::State*>(lowercase(c), target_state);
+            state->edges[uppercase(c)] = std::pair<Char,DFA::State*>(uppercase(c), target_state);
+            eno_ += 2;
+          }
+          else
+          {
+            state->edges[c] = std::pair<Char,DFA::State*>(c, target_state);
+            ++eno_;
           }
         }
       }
@@ -1350,16 +1797,14 @@ void Pattern::compile(
       {
         // combine the tree DFA transitions with the regex DFA transition moves
         Chars chars;
-        for (Char c = 0; c < 256; ++c)
-          if (state->tnode->edge[c] != nullptr)
-            chars.insert(c);
-        if (opt_.i)
-          for (Char c = 'a'; c <= 'z'; ++c)
-            if (state->tnode->edge[c] != nullptr)
-              chars.insert(uppercase(c));
+        for (Tree::Node *t = state->tnode->child; t != nullptr; t = t->sibling)
+        {
+          chars.insert(t->chr);
+          if (opt_.i && t->chr >= 'a' && t->chr <= 'z')
+            chars.insert(uppercase(t->chr));
+        }
         Moves::iterator i = moves.begin();
-        Moves::iterator end = moves.end();
-        while (i != end)
+        while (i != moves.end())
         {
           if (chars.intersects(i->first))
           {
@@ -1377,7 +1822,7 @@ void Pattern::compile(
                 {
                   if (c >= 'a' && c <= 'z')
                   {
-                    DFA::State *target_state = last_state = last_state->next = dfa_.state(state->tnode->edge[c], pos);
+                    DFA::State *target_state = last_state = last_state->next = dfa_.state(Tree::target(state->tnode, c), pos);
                     state->edges[c] = std::pair<Char,DFA::State*>(c, target_state);
                     state->edges[uppercase(c)] = std::pair<Char,DFA::State*>(uppercase(c), target_state);
                     eno_ += 2;
@@ -1385,7 +1830,7 @@ void Pattern::compile(
                 }
                 else
                 {
-                  DFA::State *target_state = last_state = last_state->next = dfa_.state(state->tnode->edge[c], pos);
+                  DFA::State *target_state = last_state = last_state->next = dfa_.state(Tree::target(state->tnode, c), pos);
                   state->edges[c] = std::pair<Char,DFA::State*>(c, target_state);
                   ++eno_;
                 }
@@ -1395,7 +1840,7 @@ void Pattern::compile(
             if (i->first.any())
               ++i;
             else
-              moves.erase(i++);
+              i = moves.erase(i);
           }
           else
           {
@@ -1416,7 +1861,7 @@ void Pattern::compile(
           {
             if (chars.contains(c))
             {
-              DFA::State *target_state = last_state = last_state->next = dfa_.state(state->tnode->edge[c]);
+              DFA::State *target_state = last_state = last_state->next = dfa_.state(Tree::target(state->tnode, c));
               if (opt_.i && std::isalpha(c))
               {
                 state->edges[lowercase(c)] = std::pair<Char,DFA::State*>(lowercase(c), target_state);
@@ -1494,19 +1939,270 @@ void Pattern::compile(
     ++vno_;
   }
   delete[] table;
-  tfa_.clear();
+  // option u: keep the tree DFA to add and remove subpatterns
+  if (!upd_)
+    tfa_.clear();
   vms_ = timer_elapsed(vt) - ems_;
   DBGLOG("END compile()");
 }
 
-void Pattern::lazy(
-    const Lazyset& lazyset,
-    Positions&     pos) const
+void Pattern::compile_parsed()
 {
-  if (!lazyset.empty())
-  {
-    Positions pos1;
-    lazy(lazyset, pos, pos1);
+  // allocate the compiler's containers in an arena that is released at once when done
+  Arena arena;
+  Arena::Scope scope(arena);
+  // delete the DFA before the arena is released, also when an exception is thrown
+  struct Clear {
+    ~Clear()
+    {
+      dfa.clear();
+    }
+    DFA& dfa;
+  } guard = { dfa_ };
+  // compile a copy of the kept NFA, because the DFA state construction modifies followpos
+  Positions startpos(upd_->startpos);
+  Follow followpos(upd_->followpos);
+  DFA::State *start = dfa_.state(tfa_.tree, startpos);
+  compile(start, followpos, upd_->modifiers, upd_->lookahead);
+  assemble(start);
+}
+
+Pattern::Accept Pattern::add(const char *regex)
+{
+  if (!upd_)
+    return 0;
+  DBGLOG("BEGIN add(%s)", regex);
+  // the kept NFA is allocated on the heap
+  Arena::Scope scope(nullptr);
+  Location len = static_cast<Location>(rex_.size());
+  Accept first = static_cast<Accept>(upd_->nodes.size() + 1);
+  Accept choice = first;
+  Positions startpos;
+  Follow    followpos;
+  Map       modifiers;
+  Map       lookahead;
+  Lazy      lazyidx = upd_->lazyidx;
+  std::vector<Positions>   firstpos;
+  std::vector<Tree::Node*> nodes;
+  // undo the changes to the regex string and the tree DFA when a syntax error is thrown
+  struct Undo {
+    ~Undo()
+    {
+      if (done)
+        return;
+      for (size_t i = 0; i < nodes.size(); ++i)
+        if (nodes[i] != nullptr && nodes[i]->accept == first + i)
+          nodes[i]->accept = 0;
+      pattern.rex_.resize(len);
+      pattern.end_.resize(ends);
+    }
+    Pattern&                        pattern;
+    const std::vector<Tree::Node*>& nodes;
+    Accept                          first;
+    Location                        len;
+    size_t                          ends;
+    bool                            done;
+  } undo = { *this, nodes, first, len, end_.size(), false };
+  timer_type t;
+  timer_start(t);
+  rex_.append("|").append(regex);
+  if (rex_.size() > Position::MAXLOC)
+    throw regex_error(regex_error::exceeds_length, rex_, Position::MAXLOC);
+  Location loc = len + 1;
+  do
+  {
+    Positions   start;
+    Tree::Node *node = parse_choice(loc, choice, start, followpos, lazyidx, modifiers, lookahead);
+    set_insert(startpos, start);
+    firstpos.push_back(start);
+    nodes.push_back(node);
+    if (++choice == 0)
+      error(regex_error::exceeds_limits, loc); // overflow: too many top-level alternations (should never happen)
+  } while (at(loc++) == '|');
+  --loc;
+  if (at(loc) == ')')
+    error(regex_error::mismatched_parens, loc);
+  else if (at(loc) != 0)
+    error(regex_error::invalid_syntax, loc);
+  if (opt_.i)
+    update_modified('i', modifiers, len + 1, loc - 1);
+  if (opt_.m)
+    update_modified('m', modifiers, len + 1, loc - 1);
+  if (opt_.s)
+    update_modified('s', modifiers, len + 1, loc - 1);
+  // merge the NFA of the new subpatterns into the kept NFA, the new positions do not overlap the kept positions
+  set_insert(upd_->startpos, startpos);
+  upd_->followpos.insert(followpos.begin(), followpos.end());
+  for (Map::const_iterator i = modifiers.begin(); i != modifiers.end(); ++i)
+    upd_->modifiers[i->first] |= i->second;
+  upd_->lookahead.insert(lookahead.begin(), lookahead.end());
+  upd_->lazyidx = lazyidx;
+  upd_->firstpos.insert(upd_->firstpos.end(), firstpos.begin(), firstpos.end());
+  upd_->nodes.insert(upd_->nodes.end(), nodes.begin(), nodes.end());
+  upd_->removed.resize(upd_->nodes.size(), false);
+  undo.done = true;
+  pms_ = timer_elapsed(t);
+  DBGLOG("END add()");
+  return first;
+}
+
+void Pattern::remove(Accept choice)
+{
+  if (!upd_ || choice == 0 || choice > upd_->nodes.size() || upd_->removed[choice - 1])
+    return;
+  DBGLOG("BEGIN remove(%u)", choice);
+  // the kept NFA is allocated on the heap
+  Arena::Scope scope(nullptr);
+  upd_->removed[choice - 1] = true;
+  Tree::Node *node = upd_->nodes[choice - 1];
+  if (node != nullptr)
+  {
+    // the tree DFA node accepts the next string subpattern that is not removed and that has the same string
+    if (node->accept == choice)
+    {
+      node->accept = 0;
+      for (Accept i = choice; i < upd_->nodes.size(); ++i)
+      {
+        if (upd_->nodes[i] == node && !upd_->removed[i])
+        {
+          node->accept = i + 1;
+          break;
+        }
+      }
+    }
+  }
+  else
+  {
+    // without its start positions the subpattern's positions in followpos are unreachable
+    Positions& firstpos = upd_->firstpos[choice - 1];
+    for (Positions::const_iterator p = firstpos.begin(); p != firstpos.end(); ++p)
+    {
+      Positions::const_iterator i = upd_->startpos.find(*p);
+      if (i != upd_->startpos.end())
+        upd_->startpos.erase(i);
+    }
+    firstpos.clear();
+  }
+  DBGLOG("END remove()");
+}
+
+void Pattern::update()
+{
+  if (!upd_)
+    return;
+  DBGLOG("BEGIN update()");
+  if (nop_ > 0 && opc_ != nullptr)
+    delete[] opc_;
+  opc_ = nullptr;
+  nop_ = 0;
+  len_ = 0;
+  min_ = 0;
+  one_ = 0;
+  acc_.clear();
+  acs_.clear();
+  aci_.clear();
+  compile_parsed();
+  gen_predict_nibbles();
+  gen_boyer_moore();
+  dtt_.clear();
+  if (opt_.t)
+    gen_dense_table();
+  dsp_.clear();
+  if (dtt_.empty())
+    gen_dispatch();
+  DBGLOG("END update()");
+}
+
+void Pattern::compile_frontier(
+    const std::vector<DFA::State*>& frontier,
+    Follow&                         followpos,
+    const Map&                      modifiers,
+    const Map&                      lookahead,
+    std::vector<Job*>&              jobs,
+    std::vector<Moves>&             moves) const
+{
+  DBGLOG("BEGIN compile_frontier(%zu)", frontier.size());
+  moves.resize(frontier.size());
+  size_t step = jobs.size() + 1;
+  if (jobs.empty() || frontier.size() < 2 * step)
+    step = 1;
+  std::vector<std::thread> threads;
+  // the threads take the states of the frontier in turn, so the followpos copies are updated the same way each time the pattern is compiled
+  for (size_t k = 1; k < step; ++k)
+  {
+    Job *job = jobs[k - 1];
+    job->k = k;
+    job->step = step;
+    threads.push_back(std::thread(&Pattern::compile_job, this, job, &frontier, &modifiers, &lookahead, &moves));
+  }
+  std::exception_ptr error;
+  try
+  {
+    for (size_t i = 0; i < frontier.size(); i += step)
+    {
+      DFA::State *state = frontier[i];
+      // use the tree DFA accept state, if present
+      if (state->tnode != nullptr && state->tnode->accept > 0)
+        state->accept = state->tnode->accept;
+      compile_transition(state, followpos, modifiers, lookahead, moves[i]);
+    }
+  }
+  catch (...)
+  {
+    error = std::current_exception();
+  }
+  for (size_t k = 1; k < step; ++k)
+  {
+    threads[k - 1].join();
+    if (!error)
+      error = jobs[k - 1]->error;
+  }
+  if (error)
+    std::rethrow_exception(error);
+  DBGLOG("END compile_frontier()");
+}
+
+void Pattern::compile_job(
+    Job                            *job,
+    const std::vector<DFA::State*> *frontier,
+    const Map                      *modifiers,
+    const Map                      *lookahead,
+    std::vector<Moves>             *moves) const
+{
+  // allocate from the arena of this thread
+  Arena::Scope scope(*job->arena);
+  try
+  {
+    for (size_t i = job->k; i < frontier->size(); i += job->step)
+    {
+      DFA::State *state = (*frontier)[i];
+      // use the tree DFA accept state, if present
+      if (state->tnode != nullptr && state->tnode->accept > 0)
+        state->accept = state->tnode->accept;
+      // the moves and the (still empty) lookahead sets of the state are updated by this thread, so they allocate from the arena of this thread
+      Lookaheads heads;
+      Lookaheads tails;
+      state->heads.swap(heads);
+      state->tails.swap(tails);
+      Moves state_moves;
+      compile_transition(state, job->followpos, *modifiers, *lookahead, state_moves);
+      (*moves)[i].swap(state_moves);
+    }
+  }
+  catch (...)
+  {
+    job->error = std::current_exception();
+  }
+}
+
+void Pattern::lazy(
+    const Lazyset& lazyset,
+    Positions&     pos) const
+{
+  if (!lazyset.empty())
+  {
+    Positions pos1;
+    lazy(lazyset, pos, pos1);
     pos.swap(pos1);
   }
 }
@@ -1540,20 +2236,19 @@ void Pattern::trim_anchors(Positions& follow, const Position p) const
   DBGLOGA(" }, %u)", p.loc());
 #endif
   Positions::iterator q = follow.begin();
-  Positions::iterator end = follow.end();
   // check if we follow into an accepting state, if so trim follow state to remove back edges and cyclic anchors e.g. (^$)*
-  while (q != end && !q->accept())
+  while (q != follow.end() && !q->accept())
     ++q;
-  if (q != end)
+  if (q != follow.end())
   {
     q = follow.begin();
     if (p.anchor())
     {
-      while (q != end)
+      while (q != follow.end())
       {
         // erase if not accepting and not a begin anchor and not a ) lookahead tail
         if (!q->accept() && !q->anchor() && at(q->loc()) != ')')
-          follow.erase(q++);
+          q = follow.erase(q);
         else
           ++q;
       }
@@ -1561,11 +2256,11 @@ void Pattern::trim_anchors(Positions& follow, const Position p) const
     else
     {
       Location loc = p.loc();
-      while (q != end)
+      while (q != follow.end())
       {
         // erase if not accepting and not a begin anchor and back edge
         if (!q->accept() && !q->anchor() && q->loc() <= loc)
-          follow.erase(q++);
+          q = follow.erase(q);
         else
           ++q;
       }
@@ -1587,60 +2282,49 @@ void Pattern::trim_lazy(Positions *pos) const
     DBGLOGPOS(*q);
   DBGLOGA(" })");
 #endif
-  Positions::reverse_iterator p = pos->rbegin();
-  while (p != pos->rend() && p->lazy())
+  // lazy positions are last, trim them from the back and then merge the non-lazy positions that replace them
+  Positions pos1;
+  size_t n = pos->size();
+  while (n > 0 && (*pos)[n - 1].lazy())
   {
-    Location l = p->lazy();
-    if (p->accept() || p->anchor()) // CHECKED algorithmic options: 7/28 added p->anchor()
+    Position p = (*pos)[n - 1];
+    Location l = p.lazy();
+    if (p.accept() || p.anchor()) // CHECKED algorithmic options: 7/28 added p->anchor()
     {
-      pos->insert(p->lazy(0)); // make lazy accept/anchor a non-lazy accept/anchor
-      pos->erase(--p.base());
-      while (p != pos->rend() && !p->accept() && p->lazy() == l)
-      {
-#if 0 // CHECKED algorithmic options: set to 1 to turn lazy trimming off
-        ++p;
-#else
-        pos->erase(--p.base());
-#endif
-      }
+      pos1.insert(p.lazy(0)); // make lazy accept/anchor a non-lazy accept/anchor
+      --n;
+      while (n > 0 && !(*pos)[n - 1].accept() && (*pos)[n - 1].lazy() == l)
+        --n;
     }
     else
     {
-#if 0 // CHECKED algorithmic options: 7/31
-      if (p->greedy())
-      {
-        pos->insert(p->lazy(0).greedy(false));
-        pos->erase(--p.base());
-      }
-      else
-      {
-        break; // ++p;
-      }
-#else
-      if (!p->greedy()) // stop here, greedy bit is 0 from here on
+      if (!p.greedy()) // stop here, greedy bit is 0 from here on
         break;
-      pos->insert(p->lazy(0));
-      pos->erase(--p.base()); // CHECKED 10/21 ++p;
-#endif
+      pos1.insert(p.lazy(0));
+      --n; // CHECKED 10/21 ++p;
     }
   }
-#if 0 // CHECKED algorithmic options: 7/31 but results in more states
-  while (p != pos->rend() && p->greedy())
+  if (n < pos->size())
   {
-    pos->insert(p->greedy(false));
-    pos->erase(--p.base());
+    pos->erase(pos->begin() + n, pos->end());
+    pos->insert(pos1.begin(), pos1.end());
   }
-#endif
-  // trims accept positions keeping the first only
-  Positions::iterator q = pos->begin(), a = pos->end();
+  // trims accept positions keeping the first only, or all with option a
+  Positions::iterator q = pos->begin();
+  bool a = false;
   while (q != pos->end())
   {
     if (q->accept() && !q->negate())
     {
-      if (a == pos->end())
-        a = q++;
+      if (!a || opt_.a)
+      {
+        a = true;
+        ++q;
+      }
       else
-        pos->erase(q++);
+      {
+        q = pos->erase(q);
+      }
     }
     else
     {
@@ -1878,12 +2562,11 @@ void Pattern::compile_transition(
     }
   }
   Moves::iterator i = moves.begin();
-  Moves::iterator e = moves.end();
-  while (i != e)
+  while (i != moves.end())
   {
     trim_lazy(&i->second);
     if (i->second.empty())
-      moves.erase(i++);
+      i = moves.erase(i);
     else
       ++i;
   }
@@ -1896,40 +2579,41 @@ void Pattern::transition(
     const Positions& follow) const
 {
   Moves::iterator i = moves.begin();
-  Moves::iterator end = moves.end();
-  while (i != end)
+  while (i != moves.end())
   {
     if (i->second == follow)
     {
       chars += i->first;
-      moves.erase(i++);
+      i = moves.erase(i);
     }
     else
     {
       ++i;
     }
   }
-  for (i = moves.begin(); i != end; ++i)
+  // index the moves, since moves are appended while iterating
+  for (size_t k = 0; k < moves.size(); ++k)
   {
-    if (chars.intersects(i->first))
+    Move& move = moves[k];
+    if (chars.intersects(move.first))
     {
-      if (is_subset(follow, i->second))
+      if (is_subset(follow, move.second))
       {
-        chars -= i->first;
+        chars -= move.first;
       }
       else
       {
-        if (chars.contains(i->first))
+        if (chars.contains(move.first))
         {
-          chars -= i->first;
-          set_insert(i->second, follow);
+          chars -= move.first;
+          set_insert(move.second, follow);
         }
         else
         {
-          Move back(chars & i->first, i->second);
+          Move back(chars & move.first, move.second);
           set_insert(back.second, follow);
           chars -= back.first;
-          i->first -= back.first;
+          move.first -= back.first;
           moves.push_back(back);
         }
       }
@@ -2053,21 +2737,459 @@ void Pattern::flip(Chars& chars) const
   chars.flip256();
 }
 
+bool Pattern::keep_nfa(
+    const Positions& startpos,
+    const Follow&    followpos,
+    const Map&       modifiers,
+    const Map&       lookahead)
+{
+  if (opt_.l == 0 || opt_.a || !opt_.f.empty())
+    return false;
+  // lookaheads, anchors, lazy quantifiers and negative patterns require the DFA to be constructed
+  for (Map::const_iterator i = lookahead.begin(); i != lookahead.end(); ++i)
+    if (!i->second.empty())
+      return false;
+  if (!plain(startpos, modifiers))
+    return false;
+  for (Follow::const_iterator i = followpos.begin(); i != followpos.end(); ++i)
+    if (!plain(i->second, modifiers))
+      return false;
+  DBGLOG("BEGIN keep_nfa()");
+  // copy the NFA from the compiler's arena to the heap
+  Arena::Scope scope(nullptr);
+  NFA *nfa = new NFA;
+  nfa_.reset(nfa);
+  nfa->startpos = startpos;
+  nfa->followpos = followpos;
+  nfa->modifiers = modifiers;
+  trim_lazy(&nfa->startpos);
+  nfa->tree.tree = tfa_.tree;
+  nfa->tree.list.swap(tfa_.list);
+  nfa->tree.next = tfa_.next;
+  tfa_.tree = nullptr;
+  tfa_.next = Tree::ALLOC;
+  acc_.assign(end_.size(), true);
+  vno_ = 0;
+  eno_ = 0;
+  vms_ = 0.0;
+  ems_ = 0.0;
+  wms_ = 0.0;
+  DBGLOG("END keep_nfa()");
+  return true;
+}
+
+bool Pattern::plain(
+    const Positions& pos,
+    const Map&       modifiers) const
+{
+  for (Positions::const_iterator p = pos.begin(); p != pos.end(); ++p)
+  {
+    if (p->lazy() || p->negate())
+      return false;
+    if (!p->accept())
+    {
+      Location loc = p->loc();
+      Char c = at(loc);
+      if (!is_modified('q', modifiers, loc) && c != '.' && c != '[')
+      {
+        if (c == '^' || c == '$' || c == '(' || c == ')')
+          return false;
+        switch (escape_at(loc))
+        {
+          case 'i':
+          case 'j':
+          case 'k':
+          case 'A':
+          case 'z':
+          case 'B':
+          case 'b':
+          case '<':
+          case '>':
+            return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+const Pattern::Index *Pattern::LazyDFA::start(const Pattern *pattern)
+{
+  pat_ = pattern;
+  if (nfa_ != pattern->nfa_)
+  {
+    // swap the cached states of the previous pattern with the states put aside for this pattern, if any
+    size_t i = 0;
+    while (i < saved_.size() && saved_[i].nfa != pattern->nfa_)
+      ++i;
+    if (i == saved_.size())
+      saved_.push_back(Saved());
+    Saved& saved = saved_[i];
+    saved.nfa.swap(nfa_);
+    saved.states.swap(states_);
+    saved.keys.swap(keys_);
+    saved.rows.swap(rows_);
+    if (!saved.nfa)
+    {
+      std::swap(saved, saved_.back());
+      saved_.pop_back();
+    }
+    if (nfa_ != pattern->nfa_)
+    {
+      nfa_ = pattern->nfa_;
+      flush();
+    }
+  }
+  return &rows_[0];
+}
+
+void Pattern::LazyDFA::flush()
+{
+  DBGLOG("LazyDFA flush %zu states", keys_.size());
+  states_.clear();
+  keys_.clear();
+  rows_.clear();
+  insert(Key(nfa_->tree.tree, nfa_->startpos));
+}
+
+Pattern::Index Pattern::LazyDFA::insert(const Key& key)
+{
+  std::pair<States::iterator,bool> i = states_.insert(States::value_type(key, static_cast<Index>(rows_.size())));
+  if (i.second)
+  {
+    // the accept index of the tree DFA node or the lowest accept index of the positions
+    Accept accept = key.first != nullptr ? key.first->accept : 0;
+    for (Positions::const_iterator p = key.second.begin(); p != key.second.end(); ++p)
+      if (p->accept() && (accept == 0 || p->accepts() < accept))
+        accept = p->accepts();
+    if (accept > Const::AMAX)
+      accept = Const::AMAX;
+    keys_.push_back(&i.first->first);
+    rows_.push_back(accept | Const::DNEW);
+    rows_.resize(rows_.size() + WIDTH - 1, static_cast<Index>(Const::IMAX));
+  }
+  return i.first->second;
+}
+
+Pattern::Index Pattern::LazyDFA::expand(Index row)
+{
+  DBGLOG("BEGIN LazyDFA::expand(%u)", row);
+  Key key(*keys_[row / WIDTH]);
+  // compute the transition moves of the state's positions
+  DFA::State state;
+  Positions pos(key.second);
+  state.assign(const_cast<Tree::Node*>(key.first), pos);
+  Moves moves;
+  pat_->compile_transition(&state, nfa_->followpos, nfa_->modifiers, nfa_->lookahead, moves);
+  // the target state of each byte combines the tree DFA transition with the move on the byte, as in compile()
+  std::vector<Key> targets;
+  std::map<std::pair<const Tree::Node*,size_t>,size_t> index;
+  const size_t NONE = static_cast<size_t>(-1);
+  size_t target[256];
+  for (Char c = 0; c < 256; ++c)
+  {
+    const Tree::Node *node = nullptr;
+    if (key.first != nullptr)
+      node = Tree::target(key.first, pat_->opt_.i && std::isalpha(c) ? lowercase(c) : c);
+    size_t k = 0;
+    while (k < moves.size() && !moves[k].first.contains(c))
+      ++k;
+    if (node == nullptr && k >= moves.size())
+    {
+      target[c] = NONE;
+    }
+    else
+    {
+      std::pair<std::map<std::pair<const Tree::Node*,size_t>,size_t>::iterator,bool> i = index.insert(std::pair<std::pair<const Tree::Node*,size_t>,size_t>(std::pair<const Tree::Node*,size_t>(node, k), targets.size()));
+      if (i.second)
+        targets.push_back(k < moves.size() ? Key(node, moves[k].second) : Key(node, Positions()));
+      target[c] = i.first->second;
+    }
+  }
+  // flush the cache when the new target states exceed the budget, then add this state again
+  size_t fresh = 0;
+  for (std::vector<Key>::const_iterator i = targets.begin(); i != targets.end(); ++i)
+    if (states_.find(*i) == states_.end())
+      ++fresh;
+  if (keys_.size() + fresh > pat_->opt_.l && keys_.size() > 1)
+  {
+    flush();
+    row = insert(key);
+  }
+  std::vector<Index> rows;
+  rows.reserve(targets.size());
+  for (std::vector<Key>::const_iterator i = targets.begin(); i != targets.end(); ++i)
+    rows.push_back(insert(*i));
+  Index info = rows_[row] & ~Const::DNEW;
+  if (targets.empty())
+    info |= Const::DEND;
+  rows_[row] = info;
+  for (Char c = 0; c < 256; ++c)
+    rows_[row + 1 + c] = target[c] != NONE ? rows[target[c]] : static_cast<Index>(Const::IMAX);
+  DBGLOG("END LazyDFA::expand(%u) %zu states", row, keys_.size());
+  return row;
+}
+
 void Pattern::assemble(DFA::State *start)
 {
   DBGLOG("BEGIN assemble()");
   timer_type t;
   timer_start(t);
+  // option a: do not minimize, which merges states that accept different sets of subpatterns
+  if (opt_.d && !opt_.a)
+    minimize_dfa(start);
   predict_match_dfa(start);
   export_dfa(start);
   compact_dfa(start);
   encode_dfa(start);
+  if (opt_.a)
+    encode_accepts(start);
+  // option f: export a narrow opcode table instead when the DFA fits
+  if (!opt_.o && !opt_.k && !opt_.f.empty())
+    encode_narrow(start);
   wms_ = timer_elapsed(t);
   gencode_dfa(start);
   export_code();
   DBGLOG("END assemble()");
 }
 
+void Pattern::minimize_dfa(DFA::State *start)
+{
+  DBGLOG("BEGIN minimize_dfa()");
+  // Hopcroft's partition refinement of the states of a partial DFA, using Valmari and Lehtinen's refinement of blocks of states and cords of transitions
+  struct Partition {
+    /// mark element e of its set, to split the set later.
+    void mark(size_t e)
+    {
+      size_t s = S[e];
+      size_t i = L[e];
+      size_t j = F[s] + M[s];
+      E[i] = E[j];
+      L[E[i]] = i;
+      E[j] = e;
+      L[e] = j;
+      if (M[s]++ == 0)
+        W.push_back(s);
+    }
+    /// split the sets with marked elements into the marked and unmarked elements, the smaller part becomes a new set.
+    void split()
+    {
+      while (!W.empty())
+      {
+        size_t s = W.back();
+        size_t j = F[s] + M[s];
+        W.pop_back();
+        if (j == P[s])
+        {
+          M[s] = 0;
+          continue;
+        }
+        if (M[s] <= P[s] - j)
+        {
+          F.push_back(F[s]);
+          P.push_back(j);
+          F[s] = j;
+        }
+        else
+        {
+          F.push_back(j);
+          P.push_back(P[s]);
+          P[s] = j;
+        }
+        M[s] = 0;
+        M.push_back(0);
+        for (size_t i = F.back(); i < P.back(); ++i)
+          S[E[i]] = F.size() - 1;
+      }
+    }
+    std::vector<size_t> E; ///< elements grouped by set
+    std::vector<size_t> L; ///< location of element e in E
+    std::vector<size_t> S; ///< set of element e
+    std::vector<size_t> F; ///< first location of set s in E
+    std::vector<size_t> P; ///< past the last location of set s in E
+    std::vector<size_t> M; ///< number of marked elements of set s, marked elements are moved to the front of a set
+    std::vector<size_t> W; ///< sets with marked elements
+  };
+  // number the states in list order, index is assigned later by encode_dfa()
+  std::vector<DFA::State*> states;
+  for (DFA::State *state = start; state; state = state->next)
+  {
+    state->index = static_cast<Index>(states.size());
+    states.push_back(state);
+  }
+  size_t n = states.size();
+  // the bounds of the edge ranges split the chars into classes of chars on which all states transition alike
+  std::vector<Char> bounds;
+  for (size_t i = 0; i < n; ++i)
+  {
+    for (DFA::State::Edges::const_iterator edge = states[i]->edges.begin(); edge != states[i]->edges.end(); ++edge)
+    {
+#if WITH_COMPACT_DFA == -1
+      bounds.push_back(edge->first);
+      bounds.push_back(edge->second.first + 1);
+#else
+      bounds.push_back(edge->second.first);
+      bounds.push_back(edge->first + 1);
+#endif
+    }
+  }
+  std::sort(bounds.begin(), bounds.end());
+  bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+  // the transitions from a tail state on a char class to a head state
+  std::vector<size_t> tail;
+  std::vector<size_t> label;
+  std::vector<size_t> head;
+  for (size_t i = 0; i < n; ++i)
+  {
+    for (DFA::State::Edges::const_iterator edge = states[i]->edges.begin(); edge != states[i]->edges.end(); ++edge)
+    {
+#if WITH_COMPACT_DFA == -1
+      Char lo = edge->first;
+      Char hi = edge->second.first;
+#else
+      Char lo = edge->second.first;
+      Char hi = edge->first;
+#endif
+      for (size_t k = std::lower_bound(bounds.begin(), bounds.end(), lo) - bounds.begin(); k < bounds.size() && bounds[k] <= hi; ++k)
+      {
+        tail.push_back(i);
+        label.push_back(k);
+        head.push_back(edge->second.second->index);
+      }
+    }
+  }
+  size_t m = tail.size();
+  // initial blocks of states with the same accept, redo, and lookahead heads and tails
+  std::vector<size_t> order(n);
+  for (size_t i = 0; i < n; ++i)
+    order[i] = i;
+  struct Compare {
+    bool operator()(size_t i, size_t j) const
+    {
+      const DFA::State *s = states[i];
+      const DFA::State *t = states[j];
+      if (s->accept != t->accept)
+        return s->accept < t->accept;
+      if (s->redo != t->redo)
+        return s->redo < t->redo;
+      if (s->heads != t->heads)
+        return s->heads < t->heads;
+      if (s->tails != t->tails)
+        return s->tails < t->tails;
+      return i < j;
+    }
+    const std::vector<DFA::State*>& states;
+  } compare = { states };
+  std::sort(order.begin(), order.end(), compare);
+  Partition blocks;
+  blocks.E = order;
+  blocks.L.resize(n);
+  blocks.S.resize(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    const DFA::State *s = states[order[i]];
+    if (i == 0 || s->accept != states[order[i - 1]]->accept || s->redo != states[order[i - 1]]->redo || s->heads != states[order[i - 1]]->heads || s->tails != states[order[i - 1]]->tails)
+    {
+      if (i > 0)
+        blocks.P.push_back(i);
+      blocks.F.push_back(i);
+      blocks.M.push_back(0);
+    }
+    blocks.L[order[i]] = i;
+    blocks.S[order[i]] = blocks.F.size() - 1;
+  }
+  blocks.P.push_back(n);
+  // initial cords of transitions on the same char class
+  Partition cords;
+  cords.E.resize(m);
+  cords.L.resize(m);
+  cords.S.resize(m);
+  {
+    std::vector<size_t> count(bounds.size() + 1, 0);
+    for (size_t t = 0; t < m; ++t)
+      ++count[label[t] + 1];
+    for (size_t k = 1; k < count.size(); ++k)
+      count[k] += count[k - 1];
+    for (size_t t = 0; t < m; ++t)
+      cords.E[count[label[t]]++] = t;
+    for (size_t i = 0; i < m; ++i)
+    {
+      size_t t = cords.E[i];
+      if (i == 0 || label[t] != label[cords.E[i - 1]])
+      {
+        if (i > 0)
+          cords.P.push_back(i);
+        cords.F.push_back(i);
+        cords.M.push_back(0);
+      }
+      cords.L[t] = i;
+      cords.S[t] = cords.F.size() - 1;
+    }
+    if (m > 0)
+      cords.P.push_back(m);
+  }
+  // the transitions into each state
+  std::vector<size_t> adjacent(m);
+  std::vector<size_t> first(n + 1, 0);
+  for (size_t t = 0; t < m; ++t)
+    ++first[head[t]];
+  for (size_t i = 0; i < n; ++i)
+    first[i + 1] += first[i];
+  for (size_t t = 0; t < m; ++t)
+    adjacent[--first[head[t]]] = t;
+  // split blocks by the tails of cords and split cords by the heads in blocks, block 0 is not needed as a splitter
+  size_t b = 1;
+  size_t c = 0;
+  while (c < cords.F.size())
+  {
+    for (size_t i = cords.F[c]; i < cords.P[c]; ++i)
+      blocks.mark(tail[cords.E[i]]);
+    blocks.split();
+    ++c;
+    while (b < blocks.F.size())
+    {
+      for (size_t i = blocks.F[b]; i < blocks.P[b]; ++i)
+        for (size_t j = first[blocks.E[i]]; j < first[blocks.E[i] + 1]; ++j)
+          cords.mark(adjacent[j]);
+      cords.split();
+      ++b;
+    }
+  }
+  // the first state of a block in the list of states represents the block, the start state is first and remains first
+  std::vector<DFA::State*> rep(blocks.F.size(), nullptr);
+  for (size_t i = 0; i < n; ++i)
+    if (rep[blocks.S[i]] == nullptr)
+      rep[blocks.S[i]] = states[i];
+  // redirect edges to the representative states and remove the other states from the list of states
+  DFA::State *last = nullptr;
+  vno_ = 0;
+  eno_ = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    DFA::State *state = states[i];
+    if (rep[blocks.S[i]] == state)
+    {
+      for (DFA::State::Edges::iterator edge = state->edges.begin(); edge != state->edges.end(); ++edge)
+      {
+        edge->second.second = rep[blocks.S[edge->second.second->index]];
+#if WITH_COMPACT_DFA == -1
+        eno_ += edge->second.first - edge->first + 1;
+#else
+        eno_ += edge->first - edge->second.first + 1;
+#endif
+      }
+      if (last != nullptr)
+        last->next = state;
+      last = state;
+      ++vno_;
+    }
+  }
+  last->next = nullptr;
+  for (size_t i = 0; i < n; ++i)
+    states[i]->index = 0;
+  DBGLOG("END minimize_dfa()");
+}
+
 void Pattern::compact_dfa(DFA::State *start)
 {
 #if WITH_COMPACT_DFA == -1
@@ -2087,7 +3209,7 @@ void Pattern::compact_dfa(DFA::State *start)
         if (j->second.second == i->second.second)
         {
           i->second.first = hi;
-          state->edges.erase(j++);
+          j = state->edges.erase(j);
         }
         else
         {
@@ -2113,7 +3235,10 @@ void Pattern::compact_dfa(DFA::State *start)
         if (j->second.second == i->second.second)
         {
           i->second.first = lo;
-          state->edges.erase(--j.base());
+          // erasing invalidates i, restore i and j by their distance from rend()
+          size_t k = state->edges.rend() - i;
+          j = DFA::State::Edges::reverse_iterator(state->edges.erase(--j.base()));
+          i = state->edges.rend() - (k - 1);
         }
         else
         {
@@ -2368,50 +3493,266 @@ void Pattern::encode_dfa(DFA::State *start)
   }
 }
 
-void Pattern::gencode_dfa(const DFA::State *start) const
+void Pattern::encode_accepts(const DFA::State *start)
 {
-  if (!opt_.o)
-    return;
-  for (std::vector<std::string>::const_iterator i = opt_.f.begin(); i != opt_.f.end(); ++i)
+  // option a: list the subpatterns accepted by a DFA state when its TAKE opcode holds only the first, or when REDO holds none
+  acs_.clear();
+  aci_.clear();
+  std::vector<Accept> accepts;
+  for (const DFA::State *state = start; state; state = state->next)
   {
-    const std::string& filename = *i;
-    size_t len = filename.length();
-    if ((len > 2 && filename.compare(len - 2, 2, ".h"  ) == 0)
-     || (len > 4 && filename.compare(len - 4, 4, ".hpp") == 0)
-     || (len > 4 && filename.compare(len - 4, 4, ".cpp") == 0)
-     || (len > 3 && filename.compare(len - 3, 3, ".cc" ) == 0))
+    accepts.clear();
+    for (Positions::const_iterator k = state->begin(); k != state->end(); ++k)
+      if (k->accept() && !k->negate())
+        accepts.push_back(k->accepts());
+    std::sort(accepts.begin(), accepts.end());
+    accepts.erase(std::unique(accepts.begin(), accepts.end()), accepts.end());
+    for (std::vector<Accept>::const_iterator i = accepts.begin(); i != accepts.end(); ++i)
+      if (*i <= acc_.size())
+        acc_[*i - 1] = true;
+    if (accepts.size() > 1 || (state->redo && !accepts.empty()))
     {
-      FILE *file = nullptr;
-      int err = 0;
-      if (filename.compare(0, 7, "stdout.") == 0)
-        file = stdout;
-      else if (filename.at(0) == '+')
-        err = reflex::fopen_s(&file, filename.c_str() + 1, "a");
-      else
-        err = reflex::fopen_s(&file, filename.c_str(), "w");
-      if (!err && file)
-      {
-        ::fprintf(file,
-            "#include <reflex/matcher.h>\n\n"
-            "#if defined(OS_WIN)\n"
-            "#pragma warning(disable:4101 4102)\n"
-            "#elif defined(__GNUC__)\n"
-            "#pragma GCC diagnostic ignored \"-Wunused-variable\"\n"
-            "#pragma GCC diagnostic ignored \"-Wunused-label\"\n"
-            "#elif defined(__clang__)\n"
-            "#pragma clang diagnostic ignored \"-Wunused-variable\"\n"
-            "#pragma clang diagnostic ignored \"-Wunused-label\"\n"
-            "#endif\n\n");
-        write_namespace_open(file);
-        ::fprintf(file,
-            "void reflex_code_%s(reflex::Matcher& m)\n"
-            "{\n"
-            "  int c0 = 0, c1 = 0;\n"
-            "  m.FSM_INIT(c1);\n", opt_.n.empty() ? "FSM" : opt_.n.c_str());
-        for (const DFA::State *state = start; state; state = state->next)
-        {
-          ::fprintf(file, "\nS%u:\n", state->index);
-          if (state == start)
+      aci_.push_back(std::pair<Index,Index>(state->index, static_cast<Index>(acs_.size())));
+      acs_.insert(acs_.end(), accepts.begin(), accepts.end());
+      acs_.push_back(0);
+    }
+  }
+}
+
+void Pattern::encode_narrow(const DFA::State *start)
+{
+  // the narrow opcode table of 16-bit words starts with the class bits, the start state, the number of final states, the number of states, and the byte classes as a list of byte ranges with the lowest byte in the high half and the class in the low half, followed by the offsets of the states
+  // a state is a list of transitions on the byte classes in descending class order, each with the lowest class in the high bits and the target state in the low bits, final states are numbered first and begin with the accept index or NRDO
+  opn_.clear();
+  const Index NONE = Const::IMAX;
+  std::map<const DFA::State*,Index> number;
+  for (const DFA::State *state = start; state; state = state->next)
+  {
+    // states with lookaheads or anchors cannot be encoded
+    if (!state->heads.empty() || !state->tails.empty() || state->accept >= Const::NRDO)
+      return;
+    Index n = static_cast<Index>(number.size());
+    number[state] = n;
+  }
+  Index states = static_cast<Index>(number.size());
+  std::vector<Index> next(256 * states, NONE);
+  for (const DFA::State *state = start; state; state = state->next)
+  {
+    Index k = number[state];
+    for (DFA::State::Edges::const_iterator edge = state->edges.begin(); edge != state->edges.end(); ++edge)
+    {
+#if WITH_COMPACT_DFA == -1
+      Char lo = edge->first;
+      Char hi = edge->second.first;
+#else
+      Char lo = edge->second.first;
+      Char hi = edge->first;
+#endif
+      if (is_meta(lo))
+        return;
+      if (edge->second.second != nullptr)
+        for (Char c = lo; c <= hi; ++c)
+          next[256 * k + c] = number[edge->second.second];
+    }
+  }
+  // partition the bytes into classes of bytes with the same transitions in all states, ordered by target states to join the transitions of a state to the same target
+  struct Compare {
+    bool operator()(Char c, Char d) const
+    {
+      for (size_t k = 0; k < next.size(); k += 256)
+        if (next[k + c] != next[k + d])
+          return next[k + c] < next[k + d];
+      return c < d;
+    }
+    const std::vector<Index>& next;
+  } compare = { next };
+  std::vector<Char> order(256);
+  for (Char c = 0; c < 256; ++c)
+    order[c] = c;
+  std::sort(order.begin(), order.end(), compare);
+  uint8_t cls[256];
+  Index classes = 0;
+  for (Char i = 0; i < 256; ++i)
+  {
+    bool same = i > 0;
+    for (size_t k = 0; same && k < next.size(); k += 256)
+      same = next[k + order[i - 1]] == next[k + order[i]];
+    if (!same)
+      ++classes;
+    cls[order[i]] = static_cast<uint8_t>(classes - 1);
+  }
+  Index bits = 1;
+  while ((1U << bits) < classes)
+    ++bits;
+  Index shift = 16 - bits;
+  Index halt = (1U << shift) - 1;
+  // the transitions of each state on runs of classes with the same target, the last transition is on the lowest class 0
+  std::vector<std::vector<std::pair<Index,Index> > > runs(states);
+  for (Index k = 0; k < states; ++k)
+  {
+    std::vector<Index> target(classes, NONE);
+    for (Char c = 0; c < 256; ++c)
+      target[cls[c]] = next[256 * k + c];
+    Index i = classes;
+    while (i > 0)
+    {
+      Index j = i - 1;
+      while (j > 0 && target[j - 1] == target[i - 1])
+        --j;
+      runs[k].push_back(std::pair<Index,Index>(j, target[i - 1]));
+      i = j;
+    }
+  }
+  // number the final states first
+  std::vector<const DFA::State*> rows;
+  for (const DFA::State *state = start; state; state = state->next)
+    if (state->accept > 0 || state->redo)
+      rows.push_back(state);
+  Index finals = static_cast<Index>(rows.size());
+  for (const DFA::State *state = start; state; state = state->next)
+    if (state->accept == 0 && !state->redo)
+      rows.push_back(state);
+  std::vector<Index> renumber(states);
+  for (Index i = 0; i < states; ++i)
+    renumber[number[rows[i]]] = i;
+  // the byte ranges of the classes
+  std::vector<Opcode16> code(5, 0);
+  for (Char c = 0; c < 256; ++c)
+    if (c == 0 || cls[c] != cls[c - 1])
+      code.push_back(static_cast<Opcode16>(c << 8 | cls[c]));
+  code[0] = static_cast<Opcode16>(bits);
+  code[4] = static_cast<Opcode16>(code.size() - 5);
+  size_t size = code.size() + states;
+  for (Index i = 0; i < states; ++i)
+    size += (i < finals) + runs[number[rows[i]]].size();
+  // select the narrow opcode table only when the states and offsets fit and when it is smaller than the opcode table
+  if (states >= halt || size > 0xFFFF || 1 + (size + 1) / 2 >= nop_)
+    return;
+  code[1] = static_cast<Opcode16>(renumber[0]);
+  code[2] = static_cast<Opcode16>(finals);
+  code[3] = static_cast<Opcode16>(states);
+  size_t offset = code.size() + states;
+  for (Index i = 0; i < states; ++i)
+  {
+    code.push_back(static_cast<Opcode16>(offset));
+    offset += (i < finals) + runs[number[rows[i]]].size();
+  }
+  for (Index i = 0; i < states; ++i)
+  {
+    if (i < finals)
+      code.push_back(static_cast<Opcode16>(rows[i]->redo ? Const::NRDO : rows[i]->accept));
+    const std::vector<std::pair<Index,Index> >& run = runs[number[rows[i]]];
+    for (std::vector<std::pair<Index,Index> >::const_iterator r = run.begin(); r != run.end(); ++r)
+      code.push_back(static_cast<Opcode16>(r->first << shift | (r->second == NONE ? halt : renumber[r->second])));
+  }
+  opn_.swap(code);
+  std::memcpy(dcl_, cls, sizeof(dcl_));
+  DBGLOGN("narrow opcode table: %zu words, %u states, %u classes", opn_.size(), states, classes);
+}
+
+void Pattern::decode_narrow()
+{
+  // unpack the 16-bit words of a narrow code table from the 32-bit words following the table's first word, low half first
+  size_t n = opc_[0] & 0x0000FFFF;
+  opn_.resize(n);
+  for (size_t i = 0; i < n; ++i)
+    opn_[i] = static_cast<Opcode16>(opc_[1 + i / 2] >> (i % 2 * 16));
+  // the byte classes of the byte ranges
+  for (Index i = 0; i < opn_[4]; ++i)
+  {
+    Char hi = i + 1 < opn_[4] ? opn_[6 + i] >> 8 : 0x100;
+    for (Char c = opn_[5 + i] >> 8; c < hi; ++c)
+      dcl_[c] = static_cast<uint8_t>(opn_[5 + i]);
+  }
+  opc_ = nullptr;
+}
+
+void Pattern::gencode_dfa(const DFA::State *start) const
+{
+  if (!opt_.o)
+    return;
+  // with option g, profile the DFA on the sample input to emit hot states and edges first
+  Profile profile;
+  if (!opt_.g.empty())
+    profile_dfa(start, profile);
+  std::vector<const DFA::State*> states;
+  for (const DFA::State *state = start; state; state = state->next)
+    states.push_back(state);
+  if (!profile.empty())
+  {
+    // order the states by decreasing number of visits, the start state stays first
+    std::vector<std::pair<size_t,size_t> > order;
+    for (size_t k = 1; k < states.size(); ++k)
+      order.push_back(std::pair<size_t,size_t>(~profile[states[k]][0], k));
+    std::sort(order.begin(), order.end());
+    std::vector<const DFA::State*> sorted(1, start);
+    for (std::vector<std::pair<size_t,size_t> >::const_iterator k = order.begin(); k != order.end(); ++k)
+      sorted.push_back(states[k->second]);
+    states.swap(sorted);
+  }
+  for (std::vector<std::string>::const_iterator i = opt_.f.begin(); i != opt_.f.end(); ++i)
+  {
+    const std::string& filename = *i;
+    size_t len = filename.length();
+    if ((len > 2 && filename.compare(len - 2, 2, ".h"  ) == 0)
+     || (len > 4 && filename.compare(len - 4, 4, ".hpp") == 0)
+     || (len > 4 && filename.compare(len - 4, 4, ".cpp") == 0)
+     || (len > 3 && filename.compare(len - 3, 3, ".cc" ) == 0))
+    {
+      FILE *file = nullptr;
+      int err = 0;
+      if (filename.compare(0, 7, "stdout.") == 0)
+        file = stdout;
+      else if (filename.at(0) == '+')
+        err = reflex::fopen_s(&file, filename.c_str() + 1, "a");
+      else
+        err = reflex::fopen_s(&file, filename.c_str(), "w");
+      if (!err && file)
+      {
+        ::fprintf(file,
+            "#include <reflex/matcher.h>\n\n"
+            "#if defined(OS_WIN)\n"
+            "#pragma warning(disable:4101 4102)\n"
+            "#elif defined(__GNUC__)\n"
+            "#pragma GCC diagnostic ignored \"-Wunused-variable\"\n"
+            "#pragma GCC diagnostic ignored \"-Wunused-label\"\n"
+            "#elif defined(__clang__)\n"
+            "#pragma clang diagnostic ignored \"-Wunused-variable\"\n"
+            "#pragma clang diagnostic ignored \"-Wunused-label\"\n"
+            "#endif\n\n");
+        if (!profile.empty())
+          ::fprintf(file,
+              "#ifndef FSM_UNLIKELY\n"
+              "#if defined(__GNUC__) || defined(__clang__)\n"
+              "#define FSM_UNLIKELY(x) __builtin_expect(!!(x), 0)\n"
+              "#else\n"
+              "#define FSM_UNLIKELY(x) (x)\n"
+              "#endif\n"
+              "#endif\n\n"
+              "#ifndef FSM_COLD\n"
+              "#if defined(__GNUC__) && !defined(__clang__)\n"
+              "#define FSM_COLD __attribute__((cold))\n"
+              "#else\n"
+              "#define FSM_COLD\n"
+              "#endif\n"
+              "#endif\n\n");
+        write_namespace_open(file);
+        ::fprintf(file,
+            "void reflex_code_%s(reflex::Matcher& m)\n"
+            "{\n"
+            "  int c0 = 0, c1 = 0;\n"
+            "  m.FSM_INIT(c1);\n", opt_.n.empty() ? "FSM" : opt_.n.c_str());
+        for (std::vector<const DFA::State*>::const_iterator s = states.begin(); s != states.end(); ++s)
+        {
+          const DFA::State *state = *s;
+          const std::vector<size_t> *hits = nullptr;
+          if (!profile.empty())
+            hits = &profile[state];
+          if (hits != nullptr && (*hits)[0] == 0)
+            ::fprintf(file, "\nS%u: FSM_COLD;\n", state->index);
+          else
+            ::fprintf(file, "\nS%u:\n", state->index);
+          if (state == start)
             ::fprintf(file, "  m.FSM_FIND();\n");
           if (state->redo)
             ::fprintf(file, "  m.FSM_REDO();\n");
@@ -2461,23 +3802,74 @@ void Pattern::gencode_dfa(const DFA::State *start) const
           bool read = peek;
           bool elif = false;
 #if WITH_COMPACT_DFA == -1
+          if (read)
+          {
+            if (prev)
+              ::fprintf(file, "  c0 = c1, c1 = m.FSM_CHAR();\n");
+            else
+              ::fprintf(file, "  c1 = m.FSM_CHAR();\n");
+          }
+          size_t tests = 0; // number of char range tests in edge order
           for (DFA::State::Edges::const_reverse_iterator i = state->edges.rbegin(); i != state->edges.rend(); ++i)
           {
             Char lo = i->first;
             Char hi = i->second.first;
-            Index target_index = Const::IMAX;
-            if (i->second.second != nullptr)
-              target_index = i->second.second->index;
-            if (read)
+            if (!is_meta(lo))
             {
-              if (prev)
-                ::fprintf(file, "  c0 = c1, c1 = m.FSM_CHAR();\n");
-              else
-                ::fprintf(file, "  c1 = m.FSM_CHAR();\n");
-              read = false;
+              DFA::State::Edges::const_reverse_iterator j = i;
+              if (i->second.second == nullptr && (++j == state->edges.rend() || is_meta(j->second.first)))
+                break;
+              ++tests;
+              continue;
             }
-            if (!is_meta(lo))
+            do
             {
+              switch (lo)
+              {
+                case META_EOB:
+                case META_EOL:
+                  ::fprintf(file, "  ");
+                  if (elif)
+                    ::fprintf(file, "else ");
+                  ::fprintf(file, "if (m.FSM_META_%s(c1)) {\n", meta_label[lo - META_MIN]);
+                  gencode_dfa_closure(file, i->second.second, 2, peek);
+                  ::fprintf(file, "  }\n");
+                  elif = true;
+                  break;
+                case META_EWE:
+                case META_BWE:
+                case META_NWE:
+                  ::fprintf(file, "  ");
+                  if (elif)
+                    ::fprintf(file, "else ");
+                  ::fprintf(file, "if (m.FSM_META_%s(c0, c1)) {\n", meta_label[lo - META_MIN]);
+                  gencode_dfa_closure(file, i->second.second, 2, peek);
+                  ::fprintf(file, "  }\n");
+                  elif = true;
+                  break;
+                default:
+                  ::fprintf(file, "  ");
+                  if (elif)
+                    ::fprintf(file, "else ");
+                  ::fprintf(file, "if (m.FSM_META_%s()) {\n", meta_label[lo - META_MIN]);
+                  gencode_dfa_closure(file, i->second.second, 2, peek);
+                  ::fprintf(file, "  }\n");
+                  elif = true;
+              }
+            } while (++lo <= hi);
+          }
+          if (hits == nullptr && tests <= 8)
+          {
+            // compacted edges overlap, test them in reverse order such that the edge with the highest lo takes priority
+            for (DFA::State::Edges::const_reverse_iterator i = state->edges.rbegin(); i != state->edges.rend(); ++i)
+            {
+              Char lo = i->first;
+              Char hi = i->second.first;
+              if (is_meta(lo))
+                continue;
+              Index target_index = Const::IMAX;
+              if (i->second.second != nullptr)
+                target_index = i->second.second->index;
               DFA::State::Edges::const_reverse_iterator j = i;
               if (target_index == Const::IMAX && (++j == state->edges.rend() || is_meta(j->second.first)))
                 break;
@@ -2513,43 +3905,93 @@ void Pattern::gencode_dfa(const DFA::State *start) const
                 ::fprintf(file, " goto S%u;\n", target_index);
               }
             }
+          }
+          else
+          {
+            // map each byte to its target state to test disjoint ranges in any order, bytes that halt are not tested
+            const DFA::State *target[256];
+            for (int c = 0; c < 256; ++c)
+              target[c] = nullptr;
+            for (DFA::State::Edges::const_iterator i = state->edges.begin(); i != state->edges.end(); ++i)
+              if (!is_meta(i->first))
+                for (Char c = i->first; c <= i->second.first && c <= 0xFF; ++c)
+                  target[c] = i->second.second;
+            std::vector<std::pair<Char,Char> > ranges;
+            std::vector<std::pair<size_t,size_t> > order;
+            for (int c = 255; c >= 0; --c)
+            {
+              if (target[c] == nullptr)
+                continue;
+              int lo = c;
+              while (lo > 0 && target[lo - 1] == target[c])
+                --lo;
+              size_t count = 0;
+              if (hits != nullptr)
+                for (int k = lo; k <= c; ++k)
+                  count += (*hits)[k + 1];
+              // most frequently taken ranges first when profiled, otherwise in decreasing order
+              order.push_back(std::pair<size_t,size_t>(~count, ranges.size()));
+              ranges.push_back(std::pair<Char,Char>(static_cast<Char>(lo), static_cast<Char>(c)));
+              c = lo;
+            }
+            std::sort(order.begin(), order.end());
+            if (tests > 8)
+            {
+              // many ranges: a switch is compiled to a jump table, with one goto per target state
+              ::fprintf(file, "  switch (c1)\n  {\n");
+              for (size_t k = 0; k < order.size(); ++k)
+              {
+                const DFA::State *next = target[ranges[order[k].second].first];
+                bool done = false;
+                for (size_t n = 0; n < k && !done; ++n)
+                  done = target[ranges[order[n].second].first] == next;
+                if (done)
+                  continue;
+                size_t labels = 0;
+                for (size_t n = k; n < order.size(); ++n)
+                {
+                  const std::pair<Char,Char>& range = ranges[order[n].second];
+                  if (target[range.first] != next)
+                    continue;
+                  for (Char c = range.first; c <= range.second; ++c)
+                  {
+                    ::fprintf(file, labels % 8 == 0 ? "    case " : " case ");
+                    print_char(file, c);
+                    ::fprintf(file, labels % 8 == 7 ? ":\n" : ":");
+                    ++labels;
+                  }
+                }
+                ::fprintf(file, "%s      goto S%u;\n", labels % 8 == 0 ? "" : "\n", next->index);
+              }
+              ::fprintf(file, "  }\n");
+            }
             else
             {
-              do
+              for (size_t k = 0; k < order.size(); ++k)
               {
-                switch (lo)
+                Char lo = ranges[order[k].second].first;
+                Char hi = ranges[order[k].second].second;
+                // ranges never taken in a visited state are marked unlikely
+                bool cold = hits != nullptr && (*hits)[0] > 0 && order[k].first == ~static_cast<size_t>(0);
+                ::fprintf(file, cold ? "  if (FSM_UNLIKELY(" : "  if (");
+                if (lo == hi)
                 {
-                  case META_EOB:
-                  case META_EOL:
-                    ::fprintf(file, "  ");
-                    if (elif)
-                      ::fprintf(file, "else ");
-                    ::fprintf(file, "if (m.FSM_META_%s(c1)) {\n", meta_label[lo - META_MIN]);
-                    gencode_dfa_closure(file, i->second.second, 2, peek);
-                    ::fprintf(file, "  }\n");
-                    elif = true;
-                    break;
-                  case META_EWE:
-                  case META_BWE:
-                  case META_NWE:
-                    ::fprintf(file, "  ");
-                    if (elif)
-                      ::fprintf(file, "else ");
-                    ::fprintf(file, "if (m.FSM_META_%s(c0, c1)) {\n", meta_label[lo - META_MIN]);
-                    gencode_dfa_closure(file, i->second.second, 2, peek);
-                    ::fprintf(file, "  }\n");
-                    elif = true;
-                    break;
-                  default:
-                    ::fprintf(file, "  ");
-                    if (elif)
-                      ::fprintf(file, "else ");
-                    ::fprintf(file, "if (m.FSM_META_%s()) {\n", meta_label[lo - META_MIN]);
-                    gencode_dfa_closure(file, i->second.second, 2, peek);
-                    ::fprintf(file, "  }\n");
-                    elif = true;
+                  ::fprintf(file, "c1 == ");
+                  print_char(file, lo);
                 }
-              } while (++lo <= hi);
+                else if (hi == 0xFF)
+                {
+                  print_char(file, lo);
+                  ::fprintf(file, " <= c1");
+                }
+                else
+                {
+                  print_char(file, lo);
+                  ::fprintf(file, " <= c1 && c1 <= ");
+                  print_char(file, hi);
+                }
+                ::fprintf(file, cold ? ")) goto S%u;\n" : ") goto S%u;\n", target[lo]->index);
+              }
             }
           }
 #else
@@ -2674,6 +4116,75 @@ void Pattern::gencode_dfa(const DFA::State *start) const
   }
 }
 
+void Pattern::profile_dfa(const DFA::State *start, Profile& profile) const
+{
+  FILE *file = nullptr;
+  if (reflex::fopen_s(&file, opt_.g.c_str(), "rb") != 0 || file == nullptr)
+    return;
+  for (const DFA::State *state = start; state; state = state->next)
+    profile[state].assign(257, 0);
+  // run the DFA over the sample input, restart at the start state when the DFA halts
+  const DFA::State *state = start;
+  ++profile[start][0];
+  char buf[4096];
+  size_t len;
+  while ((len = ::fread(buf, 1, sizeof(buf), file)) > 0)
+  {
+    for (size_t n = 0; n < len; ++n)
+    {
+      Char c = static_cast<uint8_t>(buf[n]);
+      while (true)
+      {
+        // take a char edge of this state or else of a state reached by one of its meta edges
+        const DFA::State *from = state;
+        const DFA::State *next = nullptr;
+        for (size_t k = 0; k <= state->edges.size() && next == nullptr; ++k)
+        {
+          if (k > 0)
+          {
+            const DFA::State::Edges::value_type& edge = state->edges.begin()[k - 1];
+#if WITH_COMPACT_DFA == -1
+            if (!is_meta(edge.first) || edge.second.second == nullptr)
+#else
+            if (!is_meta(edge.second.first) || edge.second.second == nullptr)
+#endif
+              continue;
+            from = edge.second.second;
+          }
+          // compacted edges overlap, the edge with the highest lo takes priority
+          for (DFA::State::Edges::const_reverse_iterator i = from->edges.rbegin(); i != from->edges.rend(); ++i)
+          {
+#if WITH_COMPACT_DFA == -1
+            Char lo = i->first;
+            Char hi = i->second.first;
+#else
+            Char hi = i->first;
+            Char lo = i->second.first;
+#endif
+            if (lo <= c && c <= hi)
+            {
+              next = i->second.second;
+              break;
+            }
+          }
+        }
+        if (next != nullptr)
+        {
+          ++profile[from][c + 1];
+          state = next;
+          ++profile[state][0];
+          break;
+        }
+        if (state == start)
+          break;
+        state = start;
+        ++profile[start][0];
+      }
+    }
+  }
+  ::fclose(file);
+}
+
 void Pattern::check_dfa_closure(const DFA::State *state, int nest, bool& peek, bool& prev) const
 {
   if (nest > 4)
@@ -2945,70 +4456,77 @@ void Pattern::export_code() const
       {
         ::fprintf(file, "#ifndef REFLEX_CODE_DECL\n#include <reflex/pattern.h>\n#define REFLEX_CODE_DECL const reflex::Pattern::Opcode\n#endif\n\n");
         write_namespace_open(file);
-        ::fprintf(file, "extern REFLEX_CODE_DECL reflex_code_%s[%u] =\n{\n", opt_.n.empty() ? "FSM" : opt_.n.c_str(), nop_);
-        for (Index i = 0; i < nop_; ++i)
-        {
-          Opcode opcode = opc_[i];
-          Char lo = lo_of(opcode);
-          Char hi = hi_of(opcode);
-          ::fprintf(file, "  0x%08X, // %u: ", opcode, i);
-          if (is_opcode_redo(opcode))
-          {
-            ::fprintf(file, "REDO\n");
-          }
-          else if (is_opcode_take(opcode))
-          {
-            ::fprintf(file, "TAKE %u\n", long_index_of(opcode));
-          }
-          else if (is_opcode_tail(opcode))
-          {
-            ::fprintf(file, "TAIL %u\n", long_index_of(opcode));
-          }
-          else if (is_opcode_head(opcode))
-          {
-            ::fprintf(file, "HEAD %u\n", long_index_of(opcode));
-          }
-          else if (is_opcode_halt(opcode))
-          {
-            ::fprintf(file, "HALT\n");
-          }
-          else
+        if (!opn_.empty())
+        {
+          export_narrow(file);
+        }
+        else
+        {
+          ::fprintf(file, "extern REFLEX_CODE_DECL reflex_code_%s[%u] =\n{\n", opt_.n.empty() ? "FSM" : opt_.n.c_str(), nop_);
+          for (Index i = 0; i < nop_; ++i)
           {
-            Index index = index_of(opcode);
-            if (index == Const::HALT)
+            Opcode opcode = opc_[i];
+            Char lo = lo_of(opcode);
+            Char hi = hi_of(opcode);
+            ::fprintf(file, "  0x%08X, // %u: ", opcode, i);
+            if (is_opcode_redo(opcode))
+            {
+              ::fprintf(file, "REDO\n");
+            }
+            else if (is_opcode_take(opcode))
+            {
+              ::fprintf(file, "TAKE %u\n", long_index_of(opcode));
+            }
+            else if (is_opcode_tail(opcode))
             {
-              ::fprintf(file, "HALT ON ");
+              ::fprintf(file, "TAIL %u\n", long_index_of(opcode));
+            }
+            else if (is_opcode_head(opcode))
+            {
+              ::fprintf(file, "HEAD %u\n", long_index_of(opcode));
+            }
+            else if (is_opcode_halt(opcode))
+            {
+              ::fprintf(file, "HALT\n");
             }
             else
             {
-              if (index == Const::LONG)
+              Index index = index_of(opcode);
+              if (index == Const::HALT)
               {
-                opcode = opc_[++i];
-                index = long_index_of(opcode);
-                ::fprintf(file, "GOTO\n  0x%08X, // %u:  FAR %u ON ", opcode, i, index);
+                ::fprintf(file, "HALT ON ");
               }
               else
               {
-                ::fprintf(file, "GOTO %u ON ", index);
+                if (index == Const::LONG)
+                {
+                  opcode = opc_[++i];
+                  index = long_index_of(opcode);
+                  ::fprintf(file, "GOTO\n  0x%08X, // %u:  FAR %u ON ", opcode, i, index);
+                }
+                else
+                {
+                  ::fprintf(file, "GOTO %u ON ", index);
+                }
+              }
+              if (!is_meta(lo))
+              {
+                print_char(file, lo, true);
+                if (lo != hi)
+                {
+                  ::fprintf(file, "-");
+                  print_char(file, hi, true);
+                }
               }
-            }
-            if (!is_meta(lo))
-            {
-              print_char(file, lo, true);
-              if (lo != hi)
+              else
               {
-                ::fprintf(file, "-");
-                print_char(file, hi, true);
+                ::fprintf(file, "%s", meta_label[lo - META_MIN]);
               }
+              ::fprintf(file, "\n");
             }
-            else
-            {
-              ::fprintf(file, "%s", meta_label[lo - META_MIN]);
-            }
-            ::fprintf(file, "\n");
           }
+          ::fprintf(file, "};\n\n");
         }
-        ::fprintf(file, "};\n\n");
         if (opt_.p)
           write_predictor(file);
         write_namespace_close(file);
@@ -3019,16 +4537,112 @@ void Pattern::export_code() const
   }
 }
 
+void Pattern::export_narrow(FILE *file) const
+{
+  // the 16-bit words of the narrow opcode table are packed in 32-bit words, low half first, after the first word with the number of 16-bit words
+  size_t n = opn_.size();
+  Index shift = 16 - opn_[0];
+  Index halt = (1U << shift) - 1;
+  Index finals = opn_[2];
+  Index states = opn_[3];
+  Index ranges = opn_[4];
+  Index classes = 0;
+  for (Index k = 0; k < ranges; ++k)
+    classes = std::max(classes, (opn_[5 + k] & 0xFFU) + 1);
+  const Index NONE = Const::IMAX;
+  std::vector<Index> state_at(n, NONE);
+  for (Index k = 0; k < states; ++k)
+    state_at[opn_[5 + ranges + k]] = k;
+  ::fprintf(file, "extern REFLEX_CODE_DECL reflex_code_%s[%zu] =\n{\n  0x%08X, // narrow opcode table of %zu 16-bit words\n", opt_.n.empty() ? "FSM" : opt_.n.c_str(), 1 + (n + 1) / 2, Const::NTBL | static_cast<Opcode>(n), n);
+  Index upper = classes;
+  for (size_t i = 0; i < n; i += 2)
+  {
+    Opcode word = opn_[i];
+    if (i + 1 < n)
+      word |= static_cast<Opcode>(opn_[i + 1]) << 16;
+    ::fprintf(file, "  0x%08X, //", word);
+    for (size_t j = i; j < i + 2 && j < n; ++j)
+    {
+      Index w = opn_[j];
+      ::fprintf(file, " %zu: ", j);
+      if (j == 0)
+      {
+        ::fprintf(file, "%u CLASS BITS", w);
+      }
+      else if (j == 1)
+      {
+        ::fprintf(file, "START %u", w);
+      }
+      else if (j == 2)
+      {
+        ::fprintf(file, "%u FINAL STATES", w);
+      }
+      else if (j == 3)
+      {
+        ::fprintf(file, "%u STATES", w);
+      }
+      else if (j == 4)
+      {
+        ::fprintf(file, "%u RANGES", w);
+      }
+      else if (j < 5 + ranges)
+      {
+        ::fprintf(file, "CLASS %u FROM ", w & 0xFF);
+        print_char(file, w >> 8, true);
+      }
+      else if (j < 5 + ranges + states)
+      {
+        ::fprintf(file, "STATE %zu AT %u", j - 5 - ranges, w);
+      }
+      else
+      {
+        if (state_at[j] != NONE)
+        {
+          upper = classes;
+          ::fprintf(file, "STATE %u ", state_at[j]);
+          if (state_at[j] < finals)
+          {
+            if (w == Const::NRDO)
+              ::fprintf(file, "REDO");
+            else
+              ::fprintf(file, "TAKE %u", w);
+            upper = NONE;
+          }
+        }
+        if (upper == NONE)
+        {
+          upper = classes;
+        }
+        else
+        {
+          Index lower = w >> shift;
+          if ((w & halt) == halt)
+            ::fprintf(file, "HALT ON CLASS %u", lower);
+          else
+            ::fprintf(file, "GOTO %u ON CLASS %u", w & halt, lower);
+          if (lower + 1 < upper)
+            ::fprintf(file, "-%u", upper - 1);
+          upper = lower;
+        }
+      }
+      if (j == i && j + 1 < n)
+        ::fprintf(file, ";");
+    }
+    ::fprintf(file, "\n");
+  }
+  ::fprintf(file, "};\n\n");
+}
+
 void Pattern::predict_match_dfa(DFA::State *start)
 {
   DBGLOG("BEGIN Pattern::predict_match_dfa()");
   DFA::State *state = start;
-  one_ = true;
+  bool one = true;
   while (state->accept == 0)
   {
-    if (state->edges.size() != 1)
+    if (state->edges.size() != 1 || !state->heads.empty() || !state->tails.empty())
     {
-      one_ = false;
+      one = false;
       break;
     }
     Char lo = state->edges.begin()->first;
@@ -3038,26 +4652,29 @@ void Pattern::predict_match_dfa(DFA::State *start)
         break;
       if (len_ >= 255)
       {
-        one_ = false;
+        one = false;
         break;
       }
       pre_[len_++] = static_cast<uint8_t>(lo);
     }
     else
     {
-      one_ = false;
+      one = false;
       break;
     }
     DFA::State *next = state->edges.begin()->second.second;
     if (next == nullptr)
     {
-      one_ = false;
+      one = false;
       break;
     }
     state = next;
   }
-  if (state != nullptr && state->accept > 0 && !state->edges.empty())
-    one_ = false;
+  // one string when the final state at the end of the string has no transitions, lookaheads or redo
+  if (one && state != nullptr && state->accept > 0 && state->edges.empty() && state->heads.empty() && state->tails.empty() && !state->redo)
+    one_ = state->accept;
+  else
+    one_ = 0;
   min_ = 0;
   std::memset(bit_, 0xFF, sizeof(bit_));
   std::memset(pmh_, 0xFF, sizeof(pmh_));
@@ -3105,16 +4722,275 @@ void Pattern::predict_match_dfa(DFA::State *start)
 void Pattern::gen_predict_match(DFA::State *state)
 {
   min_ = 8;
-  std::map<DFA::State*,ORanges<Hash> > states[8];
+  StateHashes states[8];
   gen_predict_match_transitions(state, states[0]);
   for (int level = 1; level < 8; ++level)
-    for (std::map<DFA::State*,ORanges<Hash> >::iterator from = states[level - 1].begin(); from != states[level - 1].end(); ++from)
+    for (StateHashes::iterator from = states[level - 1].begin(); from != states[level - 1].end(); ++from)
       gen_predict_match_transitions(level, from->first, from->second, states[level]);
   for (Char i = 0; i < 256; ++i)
     bit_[i] &= (1 << min_) - 1;
 }
 
-void Pattern::gen_predict_match_transitions(DFA::State *state, std::map<DFA::State*,ORanges<Hash> >& states)
+void Pattern::gen_boyer_moore()
+{
+  // Relative frequency table of English letters, source code, and UTF-8 bytes
+  static unsigned char freq[256] = "\0\0\0\0\0\0\0\0\0\73\4\0\0\4\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\73\70\70\1\1\2\2\70\70\70\2\2\70\70\70\2\3\3\3\3\3\3\3\3\3\3\70\70\70\70\70\70\2\35\14\24\26\37\20\17\30\33\11\12\25\22\32\34\15\7\27\31\36\23\13\21\10\16\6\70\1\70\2\70\1\67\46\56\60\72\52\51\62\65\43\44\57\54\64\66\47\41\61\63\71\55\45\53\42\50\40\70\2\70\2\0\47\47\47\47\47\47\47\47\47\47\47\47\47\47\47\47\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\45\44\44\44\44\44\44\44\44\44\44\44\44\44\44\44\44\0\0\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\5\46\56\56\56\56\56\56\56\56\56\56\56\56\46\56\56\73\0\0\0\0\0\0\0\0\0\0\0\0\0\0";
+  bmd_ = 0;
+  if (len_ == 0)
+    return;
+  const char *pat = pre_;
+  uint8_t n = static_cast<uint8_t>(len_); // okay to cast: actually never more than 255
+  uint16_t i;
+  for (i = 0; i < 256; ++i)
+    bms_[i] = n;
+  lcp_ = 0;
+  lcs_ = n > 1;
+  for (i = 0; i < n; ++i)
+  {
+    uint8_t pch = static_cast<uint8_t>(pat[i]);
+    bms_[pch] = static_cast<uint8_t>(n - i - 1);
+    if (i > 0)
+    {
+      if (freq[static_cast<uint8_t>(pat[lcp_])] > freq[pch])
+      {
+        lcs_ = lcp_;
+        lcp_ = i;
+      }
+      else if (freq[static_cast<uint8_t>(pat[lcs_])] > freq[pch])
+      {
+        lcs_ = i;
+      }
+    }
+  }
+  uint16_t j;
+  for (i = n - 1, j = i; j > 0; --j)
+    if (pat[j - 1] == pat[i])
+      break;
+  bmd_ = i - j + 1;
+#if !defined(HAVE_NEON)
+  size_t score = 0;
+  for (i = 0; i < n; ++i)
+    score += bms_[static_cast<uint8_t>(pat[i])];
+  score /= n;
+  uint8_t fch = freq[static_cast<uint8_t>(pat[lcp_])];
+  if (!have_HW_SSE2() && !have_HW_AVX2() && !have_HW_AVX512BW())
+  {
+    // if scoring is high and freq is high, then use our improved Boyer-Moore instead of memchr()
+#if defined(__SSE2__) || defined(__x86_64__) || _M_IX86_FP == 2
+    // SSE2 is available, expect fast memchr()
+    if (score > 1 && fch > 35 && (score > 3 || fch > 50) && fch + score > 52)
+      lcs_ = 0xffff;
+#else
+    // no SSE2 available, expect slow memchr()
+    if (fch > 37 || (fch > 8 && score > 0))
+      lcs_ = 0xffff;
+#endif
+  }
+#endif
+}
+
+void Pattern::gen_predict_nibbles()
+{
+  tsz_ = 0;
+  if (len_ > 0 || min_ == 0)
+    return;
+  size_t n = min_ < 4 ? min_ : 4;
+  float density = 1.0;
+  for (size_t k = 0; k < n; ++k)
+  {
+    // rows[h] is the set of low nibbles of the chars with high nibble h that may occur at position k
+    uint16_t rows[16] = { 0 };
+    size_t count = 0;
+    for (Char c = 0; c < 256; ++c)
+    {
+      if (min_ == 1 ? (pma_[c] & 0xc0) != 0xc0 : (bit_[c] & (1 << k)) == 0)
+      {
+        rows[c >> 4] |= static_cast<uint16_t>(1 << (c & 0x0f));
+        ++count;
+      }
+    }
+    density *= static_cast<float>(count) / 256;
+    // assign equal rows to the same bucket
+    uint16_t lo[16];
+    uint16_t hi[16];
+    size_t m = 0;
+    for (size_t h = 0; h < 16; ++h)
+    {
+      if (rows[h] != 0)
+      {
+        size_t b = 0;
+        while (b < m && lo[b] != rows[h])
+          ++b;
+        if (b == m)
+        {
+          lo[m] = rows[h];
+          hi[m++] = 0;
+        }
+        hi[b] |= static_cast<uint16_t>(1 << h);
+      }
+    }
+    // merge buckets until we have eight buckets, each merge adds the fewest false positive chars to the set
+    while (m > 8)
+    {
+      size_t bi = 0;
+      size_t bj = 1;
+      size_t least = 256;
+      for (size_t i = 0; i < m; ++i)
+      {
+        for (size_t j = i + 1; j < m; ++j)
+        {
+          size_t more = bits_of(lo[i] | lo[j]) * bits_of(hi[i] | hi[j]) - bits_of(lo[i]) * bits_of(hi[i]) - bits_of(lo[j]) * bits_of(hi[j]);
+          if (more < least)
+          {
+            least = more;
+            bi = i;
+            bj = j;
+          }
+        }
+      }
+      lo[bi] |= lo[bj];
+      hi[bi] |= hi[bj];
+      lo[bj] = lo[--m];
+      hi[bj] = hi[m];
+    }
+    std::memset(tlo_[k], 0, sizeof(tlo_[k]));
+    std::memset(thi_[k], 0, sizeof(thi_[k]));
+    for (size_t b = 0; b < m; ++b)
+    {
+      for (size_t i = 0; i < 16; ++i)
+      {
+        if (lo[b] & (1 << i))
+          tlo_[k][i] |= static_cast<uint8_t>(1 << b);
+        if (hi[b] & (1 << i))
+          thi_[k][i] |= static_cast<uint8_t>(1 << b);
+      }
+    }
+  }
+  // use the filter when it rejects at least half of the input positions, assuming uniform distribution of chars
+  if (density < 0.5)
+    tsz_ = n;
+  DBGLOGN("tsz = %zu density = %f", tsz_, density);
+}
+
+void Pattern::gen_dense_table()
+{
+  DBGLOG("BEGIN gen_dense_table()");
+  if (opc_ == nullptr || nop_ == 0)
+    return;
+  // decode the opcodes of the states reachable from the start state, states with lookaheads or anchors cannot be tabulated
+  const Index NONE = Const::IMAX;
+  std::vector<Index> state_of(nop_, NONE);
+  std::vector<Index> start;
+  std::vector<Index> info;
+  std::vector<Index> next;
+  state_of[0] = 0;
+  start.push_back(0);
+  for (size_t k = 0; k < start.size(); ++k)
+  {
+    Index pc = start[k];
+    Index accept = 0;
+    while (pc < nop_ && (opc_[pc] >> 24) >= 0xFB && (opc_[pc] >> 24) <= 0xFE)
+    {
+      Opcode opcode = opc_[pc++];
+      if (is_opcode_redo(opcode))
+        accept = Const::DRDO;
+      else if ((opcode >> 24) == 0xFE)
+        accept = long_index_of(opcode);
+      else
+        return; // HEAD or TAIL
+    }
+    if (pc >= nop_)
+      return;
+    info.push_back(is_opcode_halt(opc_[pc]) ? accept | Const::DEND : accept);
+    size_t base = next.size();
+    next.resize(base + 256, NONE);
+    bool covered[256] = { false };
+    size_t count = 0;
+    while (count < 256)
+    {
+      if (pc >= nop_)
+        return;
+      Opcode opcode = opc_[pc++];
+      if (!is_opcode_goto(opcode) || is_opcode_meta(opcode))
+        return;
+      Index jump = index_of(opcode);
+      if (jump == Const::LONG)
+      {
+        if (pc >= nop_)
+          return;
+        jump = long_index_of(opc_[pc++]);
+      }
+      Index target = NONE;
+      if (jump != Const::HALT)
+      {
+        if (jump >= nop_)
+          return;
+        if (state_of[jump] == NONE)
+        {
+          state_of[jump] = static_cast<Index>(start.size());
+          start.push_back(jump);
+        }
+        target = state_of[jump];
+      }
+      for (Char c = lo_of(opcode); c <= hi_of(opcode); ++c)
+      {
+        if (!covered[c])
+        {
+          covered[c] = true;
+          next[base + c] = target;
+          ++count;
+        }
+      }
+    }
+  }
+  // partition the 256 byte values into classes of bytes with the same transitions in all states
+  std::vector<Index> cls(256, 0);
+  Index classes = 1;
+  for (size_t k = 0; k < start.size() && classes < 256; ++k)
+  {
+    std::map<std::pair<Index,Index>,Index> refine;
+    for (Char c = 0; c < 256; ++c)
+    {
+      std::pair<std::map<std::pair<Index,Index>,Index>::iterator,bool> i = refine.insert(std::pair<std::pair<Index,Index>,Index>(std::pair<Index,Index>(cls[c], next[256 * k + c]), static_cast<Index>(refine.size())));
+      cls[c] = i.first->second;
+    }
+    classes = static_cast<Index>(refine.size());
+  }
+  size_t width = classes + 1;
+  if (start.size() * width > Const::DTBL)
+    return;
+  // each row holds the row info followed by the targets per byte class as offsets of the target rows, or IMAX for no transition
+  for (Char c = 0; c < 256; ++c)
+    dcl_[c] = static_cast<uint8_t>(cls[c]);
+  dtt_.resize(start.size() * width, NONE);
+  for (size_t k = 0; k < start.size(); ++k)
+  {
+    dtt_[k * width] = info[k];
+    for (Char c = 0; c < 256; ++c)
+    {
+      Index target = next[256 * k + c];
+      dtt_[k * width + 1 + cls[c]] = target == NONE ? NONE : static_cast<Index>(target * width);
+    }
+  }
+  DBGLOGN("dense table: %zu states, %u classes", start.size(), classes);
+  DBGLOG("END gen_dense_table()");
+}
+
+void Pattern::gen_dispatch()
+{
+  if (opc_ == nullptr || nop_ == 0)
+    return;
+  // pre-decode the opcodes, LONG opcodes are decoded but never dispatched
+  dsp_.resize(nop_);
+  for (Index i = 0; i < nop_; ++i)
+    dsp_[i] = dispatch_of(opc_[i]);
+  // fuse TAKE followed by a GOTO on a char range, the common case of a final state with transitions
+  for (Index i = 0; i + 1 < nop_; ++i)
+    if (dsp_[i] == DISPATCH_TAKE && dsp_[i + 1] == DISPATCH_GOTO)
+      dsp_[i] = DISPATCH_TAKE_GOTO;
+}
+
+void Pattern::gen_predict_match_transitions(DFA::State *state, StateHashes& states)
 {
   for (DFA::State::Edges::const_iterator edge = state->edges.begin(); edge != state->edges.end(); ++edge)
   {
@@ -3160,7 +5036,7 @@ void Pattern::gen_predict_match_transitions(DFA::State *state, std::map<DFA::Sta
   }
 }
 
-void Pattern::gen_predict_match_transitions(size_t level, DFA::State *state, ORanges<Hash>& labels, std::map<DFA::State*,ORanges<Hash> >& states)
+void Pattern::gen_predict_match_transitions(size_t level, DFA::State *state, Hashes& labels, StateHashes& states)
 {
   for (DFA::State::Edges::const_iterator edge = state->edges.begin(); edge != state->edges.end(); ++edge)
   {
@@ -3194,7 +5070,7 @@ void Pattern::gen_predict_match_transitions(size_t level, DFA::State *state, ORa
       if (level <= min_)
         while (lo <= hi)
           bit_[lo++] &= ~(1 << level);
-      for (ORanges<Hash>::const_iterator label = labels.begin(); label != labels.end(); ++label)
+      for (Hashes::const_iterator label = labels.begin(); label != labels.end(); ++label)
       {
         Hash label_hi = label->second - 1;
         for (Hash label_lo = label->first; label_lo <= label_hi; ++label_lo)
@@ -3221,7 +5097,8 @@ void Pattern::gen_predict_match_transitions(size_t level, DFA::State *state, ORa
 void Pattern::write_predictor(FILE *file) const
 {
   ::fprintf(file, "extern const reflex::Pattern::Pred reflex_pred_%s[%zu] = {", opt_.n.empty() ? "FSM" : opt_.n.c_str(), 2 + len_ + (min_ > 1 && len_ == 0) * 256 + (min_ > 0) * Const::HASH);
-  ::fprintf(file, "\n  %3hhu,%3hhu,", static_cast<uint8_t>(len_), (static_cast<uint8_t>(min_ | (one_ << 4))));
+  // the one string flag 0x10 is set for a string that accepts subpattern 1, the other strings are searched with the DFA
+  ::fprintf(file, "\n  %3hhu,%3hhu,", static_cast<uint8_t>(len_), (static_cast<uint8_t>(min_ | ((one_ == 1) << 4))));
   for (size_t i = 0; i < len_; ++i)
     ::fprintf(file, "%s%3hhu,", ((i + 2) & 0xF) ? "" : "\n  ", static_cast<uint8_t>(pre_[i]));
   if (min_ > 0)
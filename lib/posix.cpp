@@ -35,52 +35,64 @@
 */
 
 #include <reflex/posix.h>
+#include <algorithm>
 
 namespace reflex {
 
 namespace Posix {
 
-Tables::Tables()
-{
-  static const int Alnum[]  = { '0', '9', 'A', 'Z', 'a', 'z', 0, 0 };
-  static const int Alpha[]  = { 'A', 'Z', 'a', 'z', 0, 0 };
-  static const int ASCII[]  = { 0, 127, 0, 0 };
-  static const int Blank[]  = { 9, 9, 32, 32, 0, 0 };
-  static const int Cntrl[]  = { 0, 31, 127, 127, 0, 0 };
-  static const int Digit[]  = { '0', '9', 0, 0 };
-  static const int Graph[]  = { '!', '~', 0, 0 };
-  static const int Lower[]  = { 'a', 'z', 0, 0 };
-  static const int Print[]  = { ' ', '~', 0, 0 };
-  static const int Punct[]  = { '!', '/', ':', '@', '[', '`', '{', '~', 0, 0 };
-  static const int Space[]  = { 9, 13, 32, 32, 0, 0 };
-  static const int Upper[]  = { 'A', 'Z', 0, 0 };
-  static const int Word[]   = { '0', '9', 'A', 'Z', '_', '_', 'a', 'z', 0, 0 };
-  static const int XDigit[] = { '0', '9', 'A', 'F', 'a', 'f', 0, 0 };
+static constexpr int Alnum[]  = { '0', '9', 'A', 'Z', 'a', 'z', 0, 0 };
+static constexpr int Alpha[]  = { 'A', 'Z', 'a', 'z', 0, 0 };
+static constexpr int ASCII[]  = { 0, 127, 0, 0 };
+static constexpr int Blank[]  = { 9, 9, 32, 32, 0, 0 };
+static constexpr int Cntrl[]  = { 0, 31, 127, 127, 0, 0 };
+static constexpr int Digit[]  = { '0', '9', 0, 0 };
+static constexpr int Graph[]  = { '!', '~', 0, 0 };
+static constexpr int Lower[]  = { 'a', 'z', 0, 0 };
+static constexpr int Print[]  = { ' ', '~', 0, 0 };
+static constexpr int Punct[]  = { '!', '/', ':', '@', '[', '`', '{', '~', 0, 0 };
+static constexpr int Space[]  = { 9, 13, 32, 32, 0, 0 };
+static constexpr int Upper[]  = { 'A', 'Z', 0, 0 };
+static constexpr int Word[]   = { '0', '9', 'A', 'Z', '_', '_', 'a', 'z', 0, 0 };
+static constexpr int XDigit[] = { '0', '9', 'A', 'F', 'a', 'f', 0, 0 };
 
-  range["Alnum"]               = Alnum;
-  range["Alpha"]               = Alpha;
-  range["ASCII"]               = ASCII;
-  range["Blank"]  = range["h"] = Blank;
-  range["Cntrl"]               = Cntrl;
-  range["Digit"]  = range["d"] = Digit;
-  range["Graph"]               = Graph;
-  range["Lower"]  = range["l"] = Lower;
-  range["Print"]               = Print;
-  range["Punct"]               = Punct;
-  range["Space"]  = range["s"] = Space;
-  range["Upper"]  = range["u"] = Upper;
-  range["Word"]   = range["w"] = Word;
-  range["XDigit"] = range["x"] = XDigit;
-}
+// sorted by name with strcmp()
+static const Class classes[] = {
+  { "ASCII",  ASCII },
+  { "Alnum",  Alnum },
+  { "Alpha",  Alpha },
+  { "Blank",  Blank },
+  { "Cntrl",  Cntrl },
+  { "Digit",  Digit },
+  { "Graph",  Graph },
+  { "Lower",  Lower },
+  { "Print",  Print },
+  { "Punct",  Punct },
+  { "Space",  Space },
+  { "Upper",  Upper },
+  { "Word",   Word },
+  { "XDigit", XDigit },
+  { "d",      Digit },
+  { "h",      Blank },
+  { "l",      Lower },
+  { "s",      Space },
+  { "u",      Upper },
+  { "w",      Word },
+  { "x",      XDigit },
+};
 
-static const Tables tables;
+const int * find(const Class *table, size_t size, const char *name)
+{
+  const Class *end = table + size;
+  const Class *i = std::lower_bound(table, end, name, [](const Class& c, const char *s) { return std::strcmp(c.name, s) < 0; });
+  if (i != end && std::strcmp(i->name, name) == 0)
+    return i->range;
+  return nullptr;
+}
 
 const int * range(const char *s)
 {
-  Tables::Range::const_iterator i = tables.range.find(s);
-  if (i != tables.range.end())
-    return i->second;
-  return nullptr;
+  return find(classes, sizeof(classes) / sizeof(classes[0]), s);
 }
 
 }
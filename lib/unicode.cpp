@@ -36,67 +36,75 @@
 
 #include <reflex/unicode.h>
 #include <reflex/utf8.h>
+#include <algorithm>
 
 namespace reflex {
 
 namespace Unicode {
 
-Tables::Tables()
-{
-  block_scripts();
-  language_scripts();
-  letter_scripts();
-
-  range["Other"]                  = range["C"];
-  range["Letter"]                 = range["L"];
-  range["Mark"]                   = range["M"];
-  range["Number"]                 = range["N"];
-  range["Punctuation"]            = range["P"];
-  range["Symbol"]                 = range["S"];
-  range["Separator"]              = range["Z"];
-  range["Lowercase_Letter"]       = range["Ll"];
-  range["Uppercase_Letter"]       = range["Lu"];
-  range["Titlecase_Letter"]       = range["Lt"];
-  range["Modifier_Letter"]        = range["Lm"];
-  range["Other_Letter"]           = range["Lo"];
-  range["Non_Spacing_Mark"]       = range["Mn"];
-  range["Spacing_Combining_Mark"] = range["Mc"];
-  range["Enclosing_Mark"]         = range["Me"];
-  range["Space_Separator"]        = range["Zs"];
-  range["Line_Separator"]         = range["Zl"];
-  range["Paragraph_Separator"]    = range["Zp"];
-  range["Math_Symbol"]            = range["Sm"];
-  range["Currency_Symbol"]        = range["Sc"];
-  range["Modifier_Symbol"]        = range["Sk"];
-  range["Other_Symbol"]           = range["So"];
-  range["Decimal_Digit_Number"]   = range["Nd"];
-  range["Letter_Number"]          = range["Nl"];
-  range["Other_Number"]           = range["No"];
-  range["Dash_Punctuation"]       = range["Pd"];
-  range["Open_Punctuation"]       = range["Ps"];
-  range["Close_Punctuation"]      = range["Pe"];
-  range["Initial_Punctuation"]    = range["Pi"];
-  range["Final_Punctuation"]      = range["Pf"];
-  range["Connector_Punctuation"]  = range["Pc"];
-  range["Other_Punctuation"]      = range["Po"];
-  range["Control"]                = range["Cc"];
-  range["Format"]                 = range["Cf"];
-
-  range["d"] = range["Decimal_Digit_Number"];
-  range["l"] = range["Lowercase_Letter"];
-  range["u"] = range["Uppercase_Letter"];
-  range["s"] = range["Space"];
-  range["w"] = range["Word"];
-}
+/// An alias of a Unicode character class.
+struct Alias {
+  const char *name;   ///< alias name
+  const char *target; ///< name of the character class
+};
 
-static const Tables tables;
+// sorted by name with strcmp()
+static const Alias aliases[] = {
+  { "Close_Punctuation",      "Pe" },
+  { "Connector_Punctuation",  "Pc" },
+  { "Control",                "Cc" },
+  { "Currency_Symbol",        "Sc" },
+  { "Dash_Punctuation",       "Pd" },
+  { "Decimal_Digit_Number",   "Nd" },
+  { "Enclosing_Mark",         "Me" },
+  { "Final_Punctuation",      "Pf" },
+  { "Format",                 "Cf" },
+  { "Initial_Punctuation",    "Pi" },
+  { "Letter",                 "L" },
+  { "Letter_Number",          "Nl" },
+  { "Line_Separator",         "Zl" },
+  { "Lowercase_Letter",       "Ll" },
+  { "Mark",                   "M" },
+  { "Math_Symbol",            "Sm" },
+  { "Modifier_Letter",        "Lm" },
+  { "Modifier_Symbol",        "Sk" },
+  { "Non_Spacing_Mark",       "Mn" },
+  { "Number",                 "N" },
+  { "Open_Punctuation",       "Ps" },
+  { "Other",                  "C" },
+  { "Other_Letter",           "Lo" },
+  { "Other_Number",           "No" },
+  { "Other_Punctuation",      "Po" },
+  { "Other_Symbol",           "So" },
+  { "Paragraph_Separator",    "Zp" },
+  { "Punctuation",            "P" },
+  { "Separator",              "Z" },
+  { "Space_Separator",        "Zs" },
+  { "Spacing_Combining_Mark", "Mc" },
+  { "Symbol",                 "S" },
+  { "Titlecase_Letter",       "Lt" },
+  { "Uppercase_Letter",       "Lu" },
+  { "d",                      "Nd" },
+  { "l",                      "Ll" },
+  { "s",                      "Space" },
+  { "u",                      "Lu" },
+  { "w",                      "Word" },
+};
 
 const int * range(const char *s)
 {
-  Tables::Range::const_iterator i = tables.range.find(s);
-  if (i != tables.range.end())
-    return i->second;
-  return nullptr;
+  const Alias *end = aliases + sizeof(aliases) / sizeof(aliases[0]);
+  const Alias *i = std::lower_bound(aliases, end, s, [](const Alias& a, const char *name) { return std::strcmp(a.name, name) < 0; });
+  if (i != end && std::strcmp(i->name, s) == 0)
+    s = i->target;
+  const int *r = Posix::find(letter_scripts, letter_scripts_size, s);
+  if (r == nullptr)
+    r = Posix::find(language_scripts, language_scripts_size, s);
+  if (r == nullptr)
+    r = Posix::find(block_scripts, block_scripts_size, s);
+  if (r == nullptr)
+    r = Posix::range(s);
+  return r;
 }
 
 }
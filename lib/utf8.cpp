@@ -35,9 +35,36 @@
 */
 
 #include <reflex/utf8.h>
+#include <algorithm>
+#include <vector>
 
 namespace reflex {
 
+static const char *min_utf8_strict[6] = { // strict: pattern is strict, matching only strictly valid UTF-8
+  "\x00",
+  "\xc2\x80",
+  "\xe0\xa0\x80",
+  "\xf0\x90\x80\x80",
+  "\xf8\x88\x80\x80\x80",
+  "\xfc\x84\x80\x80\x80\x80"
+};
+static const char *min_utf8_lean[6] = { // lean: pattern is permissive, matching also some invalid UTF-8 but more tightly compressed UTF-8
+  "\x00",
+  "\xc2\x80",
+  "\xe0\x80\x80",
+  "\xf0\x80\x80\x80",
+  "\xf8\x80\x80\x80\x80",
+  "\xfc\x80\x80\x80\x80\x80"
+};
+static const char *max_utf8[6] = {
+  "\x7f",
+  "\xdf\xbf",
+  "\xef\xbf\xbf",
+  "\xf7\xbf\xbf\xbf",
+  "\xfb\xbf\xbf\xbf\xbf",
+  "\xfd\xbf\xbf\xbf\xbf\xbf"
+};
+
 static const char *regex_char(char *buf, int a, int esc, size_t *n = nullptr)
 {
   static const char digits[] = "0123456789abcdef";
@@ -116,166 +143,178 @@ std::string latin1(int a, int b, int esc, bool brackets)
   return regex_range(buf, a, b, esc, brackets);
 }
 
-/// Convert a UCS-4 range [a,b] to a UTF-8 regex pattern.
-std::string utf8(int a, int b, int esc, const char *par, bool strict)
+/// A sequence of byte ranges [lo[i],hi[i]] that matches a part of a UCS range encoded in UTF-8.
+struct UTF8Seq {
+  unsigned char lo[6]; ///< lower bounds of the byte ranges
+  unsigned char hi[6]; ///< upper bounds of the byte ranges
+  size_t        len;   ///< number of byte ranges, the length of the UTF-8 sequences
+};
+
+/// Split the UTF-8 sequences as[i..n-1] to bs[i..n-1] of length n into byte range sequences.
+static void utf8_split(const unsigned char *as, const unsigned char *bs, size_t n, size_t i, UTF8Seq& seq, std::vector<UTF8Seq>& seqs)
 {
-  if (a < 0)
-    return ""; // undefined
-  if (a > b)
-    b = a;
-  static const char *min_utf8_strict[6] = { // strict: pattern is strict, matching only strictly valid UTF-8
-    "\x00",
-    "\xc2\x80",
-    "\xe0\xa0\x80",
-    "\xf0\x90\x80\x80",
-    "\xf8\x88\x80\x80\x80",
-    "\xfc\x84\x80\x80\x80\x80"
-  };
-  static const char *min_utf8_lean[6] = { // lean: pattern is permissive, matching also some invalid UTF-8 but more tightly compressed UTF-8
-    "\x00",
-    "\xc2\x80",
-    "\xe0\x80\x80",
-    "\xf0\x80\x80\x80",
-    "\xf8\x80\x80\x80\x80",
-    "\xfc\x80\x80\x80\x80\x80"
-  };
-  static const char *max_utf8[6] = {
-    "\x7f",
-    "\xdf\xbf",
-    "\xef\xbf\xbf",
-    "\xf7\xbf\xbf\xbf",
-    "\xfb\xbf\xbf\xbf\xbf",
-    "\xfd\xbf\xbf\xbf\xbf\xbf"
-  };
-  const char **min_utf8 = (strict ? min_utf8_strict : min_utf8_lean);
-  char any[16];
-  char buf[16];
-  char at[6];
-  char bt[6];
-  size_t n = utf8(a, at);
-  size_t m = utf8(b, bt);
-  const unsigned char *as = reinterpret_cast<const unsigned char*>(at);
-  const unsigned char *bs = nullptr;
-  std::string regex;
-  if (strict)
+  while (i < n && as[i] == bs[i])
   {
-    regex_range(any, 0x80, 0xbf, esc);
+    seq.lo[i] = seq.hi[i] = as[i];
+    ++i;
   }
-  else
+  seq.len = n;
+  if (i >= n)
   {
-    any[0] = '.';
-    any[1] = '\0';
+    seqs.push_back(seq);
+    return;
   }
-  while (n <= m)
+  bool l = true; // as[i+1..n-1] is the lowest continuation
+  bool h = true; // bs[i+1..n-1] is the highest continuation
+  for (size_t k = i + 1; k < n; ++k)
   {
-    if (n < m)
-      bs = reinterpret_cast<const unsigned char*>(max_utf8[n - 1]);
+    l = l && as[k] == 0x80;
+    h = h && bs[k] == 0xbf;
+  }
+  unsigned char lo = as[i];
+  unsigned char hi = bs[i];
+  if (!l)
+  {
+    unsigned char top[6];
+    for (size_t k = 0; k < n; ++k)
+      top[k] = k <= i ? as[k] : 0xbf;
+    seq.lo[i] = seq.hi[i] = lo++;
+    utf8_split(as, top, n, i + 1, seq, seqs);
+  }
+  if (!h)
+    --hi;
+  if (lo <= hi)
+  {
+    seq.lo[i] = lo;
+    seq.hi[i] = hi;
+    for (size_t k = i + 1; k < n; ++k)
+    {
+      seq.lo[k] = 0x80;
+      seq.hi[k] = 0xbf;
+    }
+    seq.len = n;
+    seqs.push_back(seq);
+  }
+  if (!h)
+  {
+    unsigned char bot[6];
+    for (size_t k = 0; k < n; ++k)
+      bot[k] = k <= i ? bs[k] : 0x80;
+    seq.lo[i] = seq.hi[i] = bs[i];
+    utf8_split(bot, bs, n, i + 1, seq, seqs);
+  }
+}
+
+/// Factor the byte range sequences at byte position d into alternations of byte classes that share a common suffix, sets alts to the number of alternations.
+static std::string utf8_factor(const std::vector<UTF8Seq>& seqs, size_t d, int esc, const char *par, bool strict, size_t& alts)
+{
+  alts = 1;
+  if (seqs.front().len <= d)
+    return "";
+  // split the byte ranges at position d into disjoint byte intervals [cuts[k],cuts[k+1]-1]
+  std::vector<int> cuts;
+  for (std::vector<UTF8Seq>::const_iterator s = seqs.begin(); s != seqs.end(); ++s)
+  {
+    cuts.push_back(s->lo[d]);
+    cuts.push_back(s->hi[d] + 1);
+  }
+  std::sort(cuts.begin(), cuts.end());
+  cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+  // group the byte intervals by their common suffix, in order of appearance
+  std::vector< std::pair< std::string,std::vector< std::pair<int,int> > > > groups;
+  std::vector<UTF8Seq> sub;
+  for (size_t k = 0; k + 1 < cuts.size(); ++k)
+  {
+    int x = cuts[k];
+    int y = cuts[k + 1] - 1;
+    sub.clear();
+    for (std::vector<UTF8Seq>::const_iterator s = seqs.begin(); s != seqs.end(); ++s)
+      if (s->lo[d] <= x && y <= s->hi[d])
+        sub.push_back(*s);
+    if (sub.empty())
+      continue;
+    size_t n;
+    std::string suffix = utf8_factor(sub, d + 1, esc, par, strict, n);
+    if (n > 1)
+      suffix.insert(0, par).push_back(')');
+    size_t g = 0;
+    while (g < groups.size() && groups[g].first != suffix)
+      ++g;
+    if (g == groups.size())
+      groups.push_back(std::pair< std::string,std::vector< std::pair<int,int> > >(suffix, std::vector< std::pair<int,int> >()));
+    std::vector< std::pair<int,int> >& intervals = groups[g].second;
+    if (!intervals.empty() && intervals.back().second + 1 == x)
+      intervals.back().second = y;
     else
-      bs = reinterpret_cast<const unsigned char*>(bt);
-    size_t i;
-    for (i = 0; i < n && as[i] == bs[i]; ++i)
-      regex.append(regex_char(buf, as[i], esc));
-    int l = 0; // pattern compression: l == 0 -> as[i+1..n-1] == UTF-8 lower bound
-    for (size_t k = i + 1; k < n && l == 0; ++k)
-      if (as[k] != 0x80)
-        l = 1;
-    int h = 0; // pattern compression: h == 0 -> bs[i+1..n-1] == UTF-8 upper bound
-    for (size_t k = i + 1; k < n && h == 0; ++k)
-      if (bs[k] != 0xbf)
-        h = 1;
-    if (i + 1 < n)
+      intervals.push_back(std::pair<int,int>(x, y));
+  }
+  std::string regex;
+  char buf[16];
+  for (size_t g = 0; g < groups.size(); ++g)
+  {
+    const std::vector< std::pair<int,int> >& intervals = groups[g].second;
+    if (g > 0)
+      regex.push_back('|');
+    if (intervals.size() == 1 && intervals[0].first == intervals[0].second)
     {
-      size_t j = i;
-      if (i != 0)
-        regex.append(par);
-      if (l != 0)
-      {
-        size_t p = 0;
-        regex.append(regex_char(buf, as[i], esc));
-        ++i;
-        while (i + 1 < n)
-        {
-          if (as[i + 1] == 0x80) // pattern compression
-          {
-            regex.append(regex_range(buf, as[i], 0xbf, esc));
-            for (++i; i < n && as[i] == 0x80; ++i)
-              regex.append(any);
-          }
-          else
-          {
-            if (as[i] != 0xbf)
-            {
-              ++p;
-              regex.append(par).append(regex_range(buf, as[i] + 1, 0xbf, esc));
-              for (size_t k = i + 1; k < n; ++k)
-                regex.append(any);
-              regex.append("|");
-            }
-            regex.append(regex_char(buf, as[i], esc));
-            ++i;
-          }
-        }
-        if (i < n)
-          regex.append(regex_range(buf, as[i], 0xbf, esc));
-        for (size_t k = 0; k < p; ++k)
-          regex.append(")");
-        i = j;
-      }
-      if (i + 1 < n && as[i] + l <= bs[i] - h)
-      {
-        if (l != 0)
-          regex.append("|");
-        regex.append(regex_range(buf, as[i] + l, bs[i] - h, esc));
-        for (size_t k = i + 1; k < n; ++k)
-          regex.append(any);
-      }
-      if (h != 0)
-      {
-        size_t p = 0;
-        regex.append("|").append(regex_char(buf, bs[i], esc));
-        ++i;
-        while (i + 1 < n)
-        {
-          if (bs[i + 1] == 0xbf) // pattern compression
-          {
-            regex.append(regex_range(buf, 0x80, bs[i], esc));
-            for (++i; i < n && bs[i] == 0xbf; ++i)
-              regex.append(any);
-          }
-          else
-          {
-            if (bs[i] != 0x80)
-            {
-              ++p;
-              regex.append(par).append(regex_range(buf, 0x80, bs[i] - 1, esc));
-              for (size_t k = i + 1; k < n; ++k)
-                regex.append(any);
-              regex.append("|");
-            }
-            regex.append(regex_char(buf, bs[i], esc));
-            ++i;
-          }
-        }
-        if (i < n)
-          regex.append(regex_range(buf, 0x80, bs[i], esc));
-        for (size_t k = 0; k < p; ++k)
-          regex.append(")");
-      }
-      if (j != 0)
-        regex.append(")");
+      regex.append(regex_char(buf, intervals[0].first, esc));
     }
-    else if (i < n)
+    else if (!strict && d > 0 && intervals.size() == 1 && intervals[0].first == 0x80 && intervals[0].second == 0xbf)
     {
-      regex.append(regex_range(buf, as[i], bs[i], esc));
+      regex.push_back('.');
     }
-    if (n < m)
+    else
     {
-      as = reinterpret_cast<const unsigned char*>(min_utf8[n]);
-      regex.append("|");
+      regex.push_back('[');
+      for (std::vector< std::pair<int,int> >::const_iterator i = intervals.begin(); i != intervals.end(); ++i)
+        regex.append(regex_range(buf, i->first, i->second, esc, false));
+      regex.push_back(']');
     }
-    ++n;
+    regex.append(groups[g].first);
   }
+  alts = groups.size();
   return regex;
 }
 
+/// Convert a sorted list of disjoint UCS-4 ranges [a,b] to a UTF-8 regex pattern factored by common byte prefixes and suffixes.
+std::string utf8(const int *ranges, size_t n, int esc, const char *par, bool strict)
+{
+  const char **min_utf8 = (strict ? min_utf8_strict : min_utf8_lean);
+  std::vector<UTF8Seq> seqs;
+  UTF8Seq seq;
+  for (size_t r = 0; r < n; ++r)
+  {
+    int a = ranges[2 * r];
+    int b = ranges[2 * r + 1];
+    if (a < 0)
+      continue; // undefined
+    if (a > b)
+      b = a;
+    char at[6];
+    char bt[6];
+    size_t k = utf8(a, at);
+    size_t m = utf8(b, bt);
+    const unsigned char *as = reinterpret_cast<const unsigned char*>(at);
+    while (k <= m)
+    {
+      const unsigned char *bs = reinterpret_cast<const unsigned char*>(k < m ? max_utf8[k - 1] : bt);
+      utf8_split(as, bs, k, 0, seq, seqs);
+      if (k < m)
+        as = reinterpret_cast<const unsigned char*>(min_utf8[k]);
+      ++k;
+    }
+  }
+  if (seqs.empty())
+    return "";
+  size_t alts;
+  return utf8_factor(seqs, 0, esc, par, strict, alts);
+}
+
+/// Convert a UCS-4 range [a,b] to a UTF-8 regex pattern.
+std::string utf8(int a, int b, int esc, const char *par, bool strict)
+{
+  int range[2] = { a, b };
+  return utf8(range, 1, esc, par, strict);
+}
+
 } // namespace reflex
@@ -79,18 +79,21 @@ static const char *options_table[] = {
   "flex",
   "freespace",
   "full",
+  "fuzzy",
   "graphs_file",
   "header_file",
   "include",
   "indent",
   "input",
   "interactive",
+  "jobs",
   "lex",
   "lex_compat",
   "lexer",
   "templated_lexer",
   "main",
   "matcher",
+  "minimize",
   "namespace",
   "never_interactive",
   "noarray",
@@ -121,11 +124,13 @@ static const char *options_table[] = {
   "perf_report",
   "posix_compat",
   "prefix",
+  "profile",
   "reentrant",
   "regexp_file",
   "stack",
   "stdinit",
   "stdout",
+  "suspend",
   "tables_file",
   "tabs",
   "token_eof",
@@ -259,6 +264,13 @@ static const Reflex::Library library_table[] = {
     "reflex::PCRE2Matcher",
     "imsx!#<=:abcdefghlnrstuvwxzABDGHKLNQRSUWXZ0?+.",
   },
+  {
+    "fuzzy",
+    "reflex/fuzzymatcher.h",
+    "reflex::Pattern",
+    "reflex::FuzzyMatcher",
+    "imsx#=^:abcdefhijklnrstuvwxzABDHLNQSUW<>?.",
+  },
   {
     "std_ecma", // this is an experimental option, not recommended!!
     "reflex/stdmatcher.h",
@@ -293,6 +305,94 @@ static std::string file_ext(std::string& name, const char *ext)
   return name;
 }
 
+/// Name of the file to output the tables or code of start condition start to, or the name of a part file to append to the file later when parts is non-null
+static std::string output_file(
+    const std::string& name,
+    bool               append,
+    size_t             start,
+    Reflex::Strings   *parts)
+  /// @returns file name, prefixed with + to append
+{
+  size_t dot = name.rfind('.');
+  // without a file extension the name is not a file to output to
+  if (parts == nullptr || dot == std::string::npos || name.find_first_of("/\\", dot) != std::string::npos)
+    return std::string(append ? "+" : "").append(name);
+  std::string part(name.compare(0, 7, "stdout.") == 0 ? "./" : ""); // a part file is never standard output
+  part.append(name, 0, dot).append(".part").append(std::to_string(start)).append(name, dot, std::string::npos);
+  parts->push_back(part);
+  parts->push_back(std::string(append ? "+" : "").append(name));
+  return part;
+}
+
+/// Remove the part files of the start conditions from start condition start on
+static void remove_parts(
+    const std::vector<Reflex::Strings>& parts,
+    size_t                              start)
+{
+  for (; start < parts.size(); ++start)
+    for (size_t i = 0; i < parts[start].size(); i += 2)
+      remove(parts[start][i].c_str());
+}
+
+/// Copy the part files to the output files, appending to the output files prefixed with + and writing standard output for stdout. names, then remove the part files
+static bool append_parts(const Reflex::Strings& parts)
+  /// @returns true if successful
+{
+  bool ok = true;
+  for (size_t i = 0; i + 1 < parts.size(); i += 2)
+  {
+    const std::string& name = parts[i + 1];
+    FILE *part = fopen(parts[i].c_str(), "rb");
+    if (part == nullptr)
+      continue;
+    FILE *file = nullptr;
+    if (name.compare(0, 7, "stdout.") == 0)
+      file = stdout;
+    else if (name.at(0) == '+')
+      file = fopen(name.c_str() + 1, "ab");
+    else
+      file = fopen(name.c_str(), "wb");
+    if (file != nullptr)
+    {
+      char buf[4096];
+      size_t n;
+      while ((n = fread(buf, 1, sizeof(buf), part)) > 0)
+        ok = fwrite(buf, 1, n, file) == n && ok;
+      if (file != stdout)
+        ok = fclose(file) == 0 && ok;
+    }
+    else
+    {
+      ok = false;
+    }
+    fclose(part);
+    remove(parts[i].c_str());
+  }
+  return ok;
+}
+
+/// Compile the patterns of every step-th start condition from start condition k with option --jobs, keep the errors to report them in order
+static void compile_patterns(
+    const Reflex::Strings           *regexes,
+    const Reflex::Strings           *options,
+    std::vector<reflex::Pattern>    *patterns,
+    std::vector<std::exception_ptr> *errors,
+    size_t                           k,
+    size_t                           step)
+{
+  for (size_t start = k; start < regexes->size(); start += step)
+  {
+    try
+    {
+      (*patterns)[start].assign((*regexes)[start], (*options)[start]); // This generates DFA and writes code to part files.
+    }
+    catch (...)
+    {
+      (*errors)[start] = std::current_exception();
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
 //  Main                                                                      //
@@ -564,6 +664,14 @@ void Reflex::help(const char *message, const char *arg)
                 ignore case in patterns\n\
         -I, --interactive, --always-interactive\n\
                 generate interactive scanner\n\
+        --minimize\n\
+                minimize the DFA of the scanner to reduce its tables or code size\n\
+        --jobs[=N]\n\
+                construct the DFAs of the scanner with N threads or one per core\n\
+        --profile=FILE\n\
+                order the fast scanner's FSM code by the hot paths taken on sample FILE\n\
+        --fuzzy[=MAX]\n\
+                fuzzy match with up to MAX errors (default 1), same as -m fuzzy\n\
         -m NAME, --matcher=NAME\n\
                 match with ";
   for (LibraryMap::const_iterator i = libraries.begin(); i != libraries.end(); ++i)
@@ -575,6 +683,9 @@ void Reflex::help(const char *message, const char *arg)
                 include header FILE.h for custom matcher option -m\n\
         -S, --find\n\
                 generate search engine to find matches, ignores unmatched input\n\
+        --suspend\n\
+                return the EOF token when non-blocking input runs dry, to resume\n\
+                scanning when lex() is called again after more input arrived\n\
         -T N, --tabs=N\n\
                 set default tab size to N (1,2,4,8) for indent/dedent matching\n\
         -u, --unicode\n\
@@ -645,8 +756,9 @@ void Reflex::help(const char *message, const char *arg)
     Debugging:\n\
         -d, --debug\n\
                 enable debug mode in scanner\n\
-        -p, --perf-report\n\
-                scanner reports detailed performance statistics to stderr\n\
+        -p, --perf-report[=FORMAT|FILE]\n\
+                scanner reports detailed performance statistics to stderr, or\n\
+                in json or csv FORMAT, or to FILE (text, .json or .csv)\n\
         -s, --nodefault\n\
                 disable the default rule in scanner that echoes unmatched text\n\
         -v, --verbose\n\
@@ -683,6 +795,13 @@ void Reflex::set_library()
 {
   if (!definitions.empty())
     warning("%option matcher should be specified before the start of regular definitions");
+  if (!options["fuzzy"].empty())
+  {
+    if (options["matcher"].empty())
+      options["matcher"] = "fuzzy";
+    else if (options["matcher"] != "fuzzy")
+      warning("%option fuzzy requires matcher=fuzzy");
+  }
   if (options["matcher"] == "reflex")
   {
     options["matcher"].clear();
@@ -1658,7 +1777,7 @@ void Reflex::parse_section_1()
                     }
                     if (!option && !nl(pos))
                       error("trailing text after %option: ", name.c_str());
-                    if (name.compare("matcher") == 0)
+                    if (name.compare("matcher") == 0 || name.compare("fuzzy") == 0)
                       set_library();
                   }
                 } while (!nl(pos));
@@ -1882,15 +2001,18 @@ void Reflex::write()
   std::string args = options["params"].empty() ? "" : param_args(params);
   std::string comma_args = options["params"].empty() ? "" : ", " + args;
   *out << "// " << options["outfile"] << " generated by reflex " REFLEX_VERSION " from " << infile << "\n";
-  if (options["header_file"]!="false"){
+  if (!options["header_file"].empty())
+  {
     write_section_cpptop();
-    *out<<"\n#include\""<<options["header_file"]<<"\"\n";
-  }else{
+    *out << "\n#include \"" << options["header_file"] << "\"\n";
+  }
+  else
+  {
     write_prelude();
     write_section_cpptop();
   }
   write_defines();
-  if (options["header_file"]=="false")
+  if (options["header_file"].empty())
     write_class();
   write_section_1();
   write_lexer();
@@ -2151,7 +2273,11 @@ void Reflex::write_prelude()
     }
   }
   if (!options["perf_report"].empty())
+  {
     *out << "\n// --perf-report option requires a timer:\n#include <reflex/timer.h>\n";
+    if (options["perf_report"] != "true" && options["perf_report"] != "json" && options["perf_report"] != "csv")
+      *out << "#include <fstream>\n";
+  }
 }
 
 /// Write Flex-compatible #defines to lex.yy.cpp
@@ -2550,34 +2676,131 @@ void Reflex::write_perf_report()
 {
   if (!options["perf_report"].empty())
   {
+    // --perf-report=json and --perf-report=csv report to std::cerr, --perf-report=FILE reports to FILE in the format given by its .json or .csv extension, or as text
+    std::string report = options["perf_report"];
+    std::string format = "text";
+    std::string file;
+    if (report == "json" || report == "csv")
+    {
+      format = report;
+    }
+    else if (report != "true")
+    {
+      file = report;
+      size_t dot = file.rfind('.');
+      if (dot != std::string::npos && (file.compare(dot, std::string::npos, ".json") == 0 || file.compare(dot, std::string::npos, ".csv") == 0))
+        format = file.substr(dot + 1);
+    }
     *out <<
       "  void perf_report()\n"
       "  {\n"
       "    if (perf_report_time_pointer != nullptr)\n"
-      "      *perf_report_time_pointer += reflex::timer_elapsed(perf_report_timer);\n"
-      "    std::cerr << \"reflex " REFLEX_VERSION " " << escape_bs(infile) << " performance report:\\n\";\n";
-    for (Start start = 0; start < conditions.size(); ++start)
+      "      *perf_report_time_pointer += reflex::timer_elapsed_ns(perf_report_timer);\n";
+    if (file.empty())
+    {
+      *out <<
+        "    std::ostream& os = std::cerr;\n";
+    }
+    else
     {
       *out <<
-        "    std::cerr << \"  " << conditions[start] << " rules matched:\\n\"";
+        "    std::ofstream perf_report_file(\"" << escape_bs(file) << "\");\n"
+        "    std::ostream& os = perf_report_file;\n";
+    }
+    *out <<
+      "    size_t shifts = has_matcher() ? matcher().shifts() : 0;\n"
+      "    size_t matches, bytes;\n"
+      "    uint64_t ns;\n";
+    if (format == "json")
+      *out <<
+        "    os << \"{\\\"reflex\\\":\\\"" REFLEX_VERSION "\\\",\\\"file\\\":\\\"" << escape_bs(escape_bs(infile)) << "\\\",\\\"conditions\\\":[\";\n";
+    else if (format == "csv")
+      *out <<
+        "    os << \"condition,rule,matches,bytes,ns,mbps\\n\";\n";
+    else
+      *out <<
+        "    os << \"reflex " REFLEX_VERSION " " << escape_bs(infile) << " performance report:\\n\";\n";
+    for (Start start = 0; start < conditions.size(); ++start)
+    {
+      const std::string& name = conditions[start];
+      std::string rule_array = "perf_report_" + name + "_rule";
+      std::string size_array = "perf_report_" + name + "_size";
+      std::string time_array = "perf_report_" + name + "_time";
+      if (format == "json")
+        *out <<
+          "    os << \"" << (start > 0 ? "," : "") << "{\\\"name\\\":\\\"" << name << "\\\",\\\"rules\\\":[\"";
+      else if (format == "text")
+        *out <<
+          "    os << \"  " << name << " rules matched:\\n\"";
+      else
+        *out <<
+          "    os";
       size_t report = 0;
       for (Rules::const_iterator rule = rules[start].begin(); rule != rules[start].end(); ++rule)
       {
         if (rule->regex != "<<EOF>>" && rule->code.line != "|")
         {
-          *out <<
-            "\n      \"    rule at line " << rule->code.lineno << " matched \" << perf_report_" << conditions[start] << "_rule[" << report << "] << \" times matching \" << perf_report_" << conditions[start] << "_size[" << report << "] << \" bytes total in \" << perf_report_" << conditions[start] << "_time[" << report << "] << \" ms\\n\"";
+          std::string r = "[" + std::to_string(report) + "]";
+          if (format == "json")
+            *out <<
+              "\n      << \"" << (report > 0 ? "," : "") << "{\\\"line\\\":" << rule->code.lineno << ",\\\"matches\\\":\" << " << rule_array << r << " << \",\\\"bytes\\\":\" << " << size_array << r << " << \",\\\"ns\\\":\" << " << time_array << r << " << \",\\\"mbps\\\":\" << perf_report_mbps(" << size_array << r << ", " << time_array << r << ") << \"}\"";
+          else if (format == "csv")
+            *out <<
+              "\n      << \"" << name << "," << rule->code.lineno << ",\" << " << rule_array << r << " << ',' << " << size_array << r << " << ',' << " << time_array << r << " << ',' << perf_report_mbps(" << size_array << r << ", " << time_array << r << ") << '\\n'";
+          else
+            *out <<
+              "\n      << \"    rule at line " << rule->code.lineno << " matched \" << " << rule_array << r << " << \" times matching \" << " << size_array << r << " << \" bytes total in \" << " << time_array << r << " / 1000000.0 << \" ms\\n\"";
           ++report;
         }
       }
+      if (format == "json")
+        *out << "\n      << \"]\"";
       if (options["nodefault"].empty())
-        *out <<
-          "\n      \"    default rule invoked \" << perf_report_" << conditions[start] << "_default << \" times\\n\"";
+      {
+        if (format == "json")
+          *out <<
+            "\n      << \",\\\"default\\\":\" << perf_report_" << name << "_default";
+        else if (format == "csv")
+          *out <<
+            "\n      << \"" << name << ",default,\" << perf_report_" << name << "_default << \",,,\\n\"";
+        else
+          *out <<
+            "\n      << \"    default rule invoked \" << perf_report_" << name << "_default << \" times\\n\"";
+      }
       *out <<
-        ";\n";
+        ";\n"
+        "    matches = 0;\n"
+        "    bytes = 0;\n"
+        "    ns = 0;\n";
+      if (report > 0)
+        *out <<
+          "    for (size_t i = 0; i < " << report << "; ++i)\n"
+          "    {\n"
+          "      matches += " << rule_array << "[i];\n"
+          "      bytes += " << size_array << "[i];\n"
+          "      ns += " << time_array << "[i];\n"
+          "    }\n";
+      if (format == "json")
+        *out <<
+          "    os << \",\\\"matches\\\":\" << matches << \",\\\"bytes\\\":\" << bytes << \",\\\"ns\\\":\" << ns << \",\\\"mbps\\\":\" << perf_report_mbps(bytes, ns) << \"}\";\n";
+      else if (format == "csv")
+        *out <<
+          "    os << \"" << name << ",total,\" << matches << ',' << bytes << ',' << ns << ',' << perf_report_mbps(bytes, ns) << '\\n';\n";
+      else
+        *out <<
+          "    os << \"    all rules matched \" << matches << \" times matching \" << bytes << \" bytes total in \" << ns / 1000000.0 << \" ms at \" << perf_report_mbps(bytes, ns) << \" MB/s\\n\";\n";
     }
+    if (format == "json")
+      *out <<
+        "    os << \"],\\\"shifts\\\":\" << shifts << \"}\" << std::endl;\n";
+    else if (format == "csv")
+      *out <<
+        "    os << \",shifts,\" << shifts << \",,,\" << std::endl;\n";
+    else
+      *out <<
+        "    os << \"  buffer shifted or enlarged \" << shifts << \" times\\n\";\n"
+        "    os << \"  WARNING: execution time measurements are relative:\\n  - includes caller's execution time between matches when " << options["lex"] << "() returns\\n  - perf-report instrumentation adds overhead that increases execution times\\n\" << std::endl;\n";
     *out <<
-      "    std::cerr << \"  WARNING: execution time measurements are relative:\\n  - includes caller's execution time between matches when " << options["lex"] << "() returns\\n  - perf-report instrumentation adds overhead that increases execution times\\n\" << std::endl;\n"
       "    set_perf_report();\n"
       "  }\n";
     *out <<
@@ -2605,7 +2828,11 @@ void Reflex::write_perf_report()
       "    perf_report_time_pointer = nullptr;\n"
       "    reflex::timer_start(perf_report_timer);\n"
       "  }\n"
-      " protected:\n";
+      " protected:\n"
+      "  static double perf_report_mbps(size_t bytes, uint64_t ns)\n"
+      "  {\n"
+      "    return ns > 0 ? 1000.0 * static_cast<double>(bytes) / static_cast<double>(ns) : 0.0;\n"
+      "  }\n";
     for (Start start = 0; start < conditions.size(); ++start)
     {
       size_t report = 0;
@@ -2613,15 +2840,15 @@ void Reflex::write_perf_report()
         if (rule->regex != "<<EOF>>" && rule->code.line != "|")
           ++report;
       *out <<
-        "  size_t perf_report_" << conditions[start] << "_rule[" << report << "];\n"
-        "  size_t perf_report_" << conditions[start] << "_size[" << report << "];\n"
-        "  float  perf_report_" << conditions[start] << "_time[" << report << "];\n";
+        "  size_t   perf_report_" << conditions[start] << "_rule[" << report << "];\n"
+        "  size_t   perf_report_" << conditions[start] << "_size[" << report << "];\n"
+        "  uint64_t perf_report_" << conditions[start] << "_time[" << report << "];\n";
       if (options["nodefault"].empty())
         *out <<
-          "  size_t perf_report_" << conditions[start] << "_default;\n";
+          "  size_t   perf_report_" << conditions[start] << "_default;\n";
     }
     *out <<
-      "  float *perf_report_time_pointer;\n"
+      "  uint64_t *perf_report_time_pointer;\n"
       "  reflex::timer_type perf_report_timer;\n";
   }
 }
@@ -3034,7 +3261,17 @@ void Reflex::write_lexer()
       else
       {
         write_regex(&conditions[start], patterns[start]);
-        *out << "  static const reflex::Pattern PATTERN_" << conditions[start] << "(REGEX_" << conditions[start] << ");\n";
+        std::string option;
+        if (!options["minimize"].empty())
+          option.append("d");
+        if (options["jobs"] == "true")
+          option.append(option.empty() ? "" : ";").append("j");
+        else if (!options["jobs"].empty())
+          option.append(option.empty() ? "" : ";").append("j=").append(options["jobs"]);
+        *out << "  static const reflex::Pattern PATTERN_" << conditions[start] << "(REGEX_" << conditions[start];
+        if (!option.empty())
+          *out << ", \"" << option << "\"";
+        *out << ");\n";
       }
     }
     else
@@ -3049,10 +3286,16 @@ void Reflex::write_lexer()
     "  {\n";
   if (!options["tabs"].empty())
     *out <<
-      "    matcher(new Matcher(PATTERN_" << conditions[0] << ", " << (options["nostdinit"].empty() ? "stdinit()" : "nostdinit()") << ", this, \"T=" << options["tabs"] << "\"));\n";
+      "    matcher(new Matcher(PATTERN_" << conditions[0] << ", " << (options["nostdinit"].empty() ? "stdinit()" : "nostdinit()") << ", this, \"" << (options["suspend"].empty() ? "" : "S") << "T=" << options["tabs"] << "\"));\n";
+  else if (!options["suspend"].empty())
+    *out <<
+      "    matcher(new Matcher(PATTERN_" << conditions[0] << ", " << (options["nostdinit"].empty() ? "stdinit()" : "nostdinit()") << ", this, \"S\"));\n";
   else
     *out <<
       "    matcher(new Matcher(PATTERN_" << conditions[0] << ", " << (options["nostdinit"].empty() ? "stdinit()" : "nostdinit()") << ", this));\n";
+  if (!options["fuzzy"].empty() && options["matcher"] == "fuzzy")
+    *out <<
+      "    matcher().distance(" << (options["fuzzy"] == "true" ? "1" : options["fuzzy"]) << ");\n";
 #ifdef WITH_BOOST_PARTIAL_MATCH_BUG
   if (options["matcher"] == "boost" || options["matcher"] == "boost-perl")
     *out <<
@@ -3092,7 +3335,7 @@ void Reflex::write_lexer()
   if (!options["perf_report"].empty())
     *out <<
       "    if (perf_report_time_pointer != nullptr)\n"
-      "      *perf_report_time_pointer += reflex::timer_elapsed(perf_report_timer);\n";
+      "      *perf_report_time_pointer += reflex::timer_elapsed_ns(perf_report_timer);\n";
   if (conditions.size() > 1)
     *out <<
       "    switch (start())\n"
@@ -3130,7 +3373,12 @@ void Reflex::write_lexer()
           "        switch (matcher().scan())\n";
       *out <<
         "        {\n"
-        "          case 0:\n"
+        "          case 0:\n";
+      if (!options["suspend"].empty())
+        *out <<
+          "            if (matcher().dry())\n"
+          "              return " << token_eof << ";\n";
+      *out <<
         "            if (matcher().at_end())\n"
         "            {\n";
       bool has_eof = false;
@@ -3443,29 +3691,78 @@ void Reflex::stats()
   }
   else
   {
+    // option --jobs: compile the patterns of the start conditions concurrently, their tables and code are written to part files that are appended to the output files in order
+    size_t threads = 0;
+    if (conditions.size() > 1)
+    {
+      if (options["jobs"] == "true")
+        threads = std::thread::hardware_concurrency();
+      else if (!options["jobs"].empty())
+        threads = static_cast<size_t>(strtoul(options["jobs"].c_str(), nullptr, 10));
+      if (threads > conditions.size())
+        threads = conditions.size();
+    }
+    bool parallel = threads > 1;
+    Strings option(conditions.size());
+    std::vector<Strings> parts(conditions.size());
     for (Start start = 0; start < conditions.size(); ++start)
     {
-      std::string option = "r";
-      option.append(";n=").append(conditions[start]);
+      option[start] = "r";
+      option[start].append(";n=").append(conditions[start]);
       if (!options["namespace"].empty())
-        option.append(";z=").append(options["namespace"]);
+        option[start].append(";z=").append(options["namespace"]);
       if (options["graphs_file"] == "true")
-        option.append(";f=reflex.").append(conditions[start]).append(".gv");
+        option[start].append(";f=reflex.").append(conditions[start]).append(".gv");
       else if (!options["graphs_file"].empty())
-        option.append(";f=").append(start > 0 ? "+" : "").append(file_ext(options["graphs_file"], "gv"));
+        option[start].append(";f=").append(output_file(file_ext(options["graphs_file"], "gv"), start > 0, start, parallel ? &parts[start] : nullptr));
       if (!options["fast"].empty())
-        option.append(";o");
+        option[start].append(";o");
+      if (!options["minimize"].empty())
+        option[start].append(";d");
+      if (options["matcher"] == "fuzzy")
+        option[start].append(";k");
+      // construct the DFA with threads when the start conditions are not compiled concurrently
+      if (!parallel && options["jobs"] == "true")
+        option[start].append(";j");
+      else if (!parallel && !options["jobs"].empty())
+        option[start].append(";j=").append(options["jobs"]);
+      if (!options["fast"].empty() && !options["profile"].empty())
+        option[start].append(";g=").append(options["profile"]);
       if (!options["find"].empty())
-        option.append(";p");
+        option[start].append(";p");
       if (options["tables_file"] == "true")
-        option.append(";f=reflex.").append(conditions[start]).append(".cpp");
+        option[start].append(";f=reflex.").append(conditions[start]).append(".cpp");
       else if (!options["tables_file"].empty())
-        option.append(";f=").append(start > 0 ? "+" : "").append(file_ext(options["tables_file"], "cpp"));
+        option[start].append(";f=").append(output_file(file_ext(options["tables_file"], "cpp"), start > 0, start, parallel ? &parts[start] : nullptr));
       if ((!options["full"].empty() || !options["fast"].empty()) && options["tables_file"].empty() && options["stdout"].empty())
-        option.append(";f=+").append(escape_bs(options["outfile"]));
+        option[start].append(";f=").append(output_file(escape_bs(options["outfile"]), true, start, parallel ? &parts[start] : nullptr));
+    }
+    std::vector<reflex::Pattern> compiled(parallel ? conditions.size() : 0);
+    std::vector<std::exception_ptr> errors(compiled.size());
+    if (parallel)
+    {
+      std::vector<std::thread> workers;
+      for (size_t k = 1; k < threads; ++k)
+        workers.push_back(std::thread(compile_patterns, &patterns, &option, &compiled, &errors, k, threads));
+      compile_patterns(&patterns, &option, &compiled, &errors, 0, threads);
+      for (size_t k = 0; k < workers.size(); ++k)
+        workers[k].join();
+    }
+    for (Start start = 0; start < conditions.size(); ++start)
+    {
       try
       {
-        reflex::Pattern pattern(patterns[start], option); // This generates DFA and writes code.
+        reflex::Pattern serial;
+        if (!parallel)
+          serial.assign(patterns[start], option[start]); // This generates DFA and writes code.
+        else if (errors[start])
+          std::rethrow_exception(errors[start]);
+        else if (!append_parts(parts[start]))
+        {
+          remove_parts(parts, start + 1);
+          abort("error in writing");
+        }
+        const reflex::Pattern& pattern = parallel ? compiled[start] : serial;
         reflex::Pattern::Index accept = 1;
         for (size_t rule = 0; rule < rules[start].size(); ++rule)
           if (rules[start][rule].regex != "<<EOF>>" && rules[start][rule].regex != "<<DEFAULT>>")
@@ -3494,6 +3791,7 @@ void Reflex::stats()
       }
       catch (reflex::regex_error& e)
       {
+        remove_parts(parts, start);
         abort("malformed regular expression\n", e.what());
       }
     }
@@ -45,12 +45,15 @@
 #include <cctype>
 #include <cstdlib>
 #include <cerrno>
+#include <cstdio>
+#include <exception>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <map>
 #include <set>
 #include <stack>
+#include <thread>
 #include <vector>
 
 #if defined(__WIN32__) || defined(_WIN32) || defined(WIN32) || defined(__CYGWIN__) || defined(__MINGW32__) || defined(__MINGW64__) || defined(__BORLANDC__)
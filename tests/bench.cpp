@@ -0,0 +1,381 @@
+// Benchmark the RE/flex matcher engines and the Boost.Regex, PCRE2 and std::regex matchers on fixed corpora
+//
+// Build and run with:
+// > make -f Make bench
+//
+// Reports pattern compile time, MB/s and tokens (matches) per second for each workload and engine.  The corpora are
+// generated with a fixed pseudo-random sequence, so the numbers are repeatable across runs and platforms.
+//
+// Usage: bench [-c] [-n RUNS] [WORKLOAD|ENGINE ...]
+//   -c       report in CSV format
+//   -n RUNS  best of RUNS timings, 5 by default
+//   WORKLOAD or ENGINE names select the workloads and engines to run, all by default
+//
+// The "fast" engine runs FSM code generated for each workload (pattern options o, p and f), which requires two steps:
+// 1. compile with -DBENCH_GEN and run to generate bench_fsm_*.cpp
+// 2. compile without -DBENCH_GEN to include the generated bench_fsm_*.cpp
+// Compile with -DBENCH_NO_BOOST or -DBENCH_NO_PCRE2 when Boost.Regex or PCRE2 is not installed.
+
+#include <reflex/matcher.h>
+#include <reflex/timer.h>
+#ifndef BENCH_GEN
+#include "../fuzzy/fuzzymatcher.h"
+#ifndef BENCH_NO_BOOST
+#include <reflex/boostmatcher.h>
+#endif
+#ifndef BENCH_NO_PCRE2
+#include <reflex/pcre2matcher.h>
+#endif
+#include <reflex/stdmatcher.h>
+#include "bench_fsm_csource.cpp"
+#include "bench_fsm_logerror.cpp"
+#include "bench_fsm_logip.cpp"
+#include "bench_fsm_utf16.cpp"
+#include "bench_fsm_alternation.cpp"
+#endif
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+using namespace reflex;
+
+// deterministic pseudo-random numbers, the same on all platforms
+static uint32_t rnd_state = 20240101;
+
+static uint32_t rnd(uint32_t n)
+{
+  rnd_state = rnd_state * 1103515245 + 12345;
+  return (rnd_state >> 8) % n;
+}
+
+static const char *pick(const char *const *words, size_t n)
+{
+  return words[rnd(static_cast<uint32_t>(n))];
+}
+
+// about 2MB of C source code
+static std::string corpus_csource()
+{
+  static const char *const types[] = { "int", "char", "size_t", "double", "unsigned", "struct node *" };
+  static const char *const names[] = { "count", "buffer", "next", "len", "value", "head", "tmp", "result", "flags", "index" };
+  static const char *const ops[] = { " + ", " - ", " * ", " / ", " << ", " & ", " == ", " != ", " <= ", " || " };
+  std::string text;
+  while (text.size() < 2000000)
+  {
+    text.append("/* ").append(pick(names, 10)).append(" helper */\nstatic ").append(pick(types, 6)).append(" ").append(pick(names, 10)).append("_").append(std::to_string(rnd(1000))).append("(").append(pick(types, 6)).append(" ").append(pick(names, 10)).append(")\n{\n");
+    for (uint32_t i = rnd(8) + 2; i > 0; --i)
+    {
+      text.append("  ").append(pick(names, 10)).append(" = ").append(pick(names, 10)).append(pick(ops, 10)).append(std::to_string(rnd(65536)));
+      if (rnd(4) == 0)
+        text.append(pick(ops, 10)).append(std::to_string(rnd(100))).append(".").append(std::to_string(rnd(100)));
+      text.append(";");
+      if (rnd(3) == 0)
+        text.append(" // ").append(pick(names, 10)).append(" updated");
+      text.append("\n");
+      if (rnd(5) == 0)
+        text.append("  printf(\"").append(pick(names, 10)).append(" = %d\\n\", ").append(pick(names, 10)).append(");\n");
+    }
+    text.append("  return ").append(pick(names, 10)).append(";\n}\n\n");
+  }
+  return text;
+}
+
+// about 2MB of log lines
+static std::string corpus_log()
+{
+  static const char *const levels[] = { "INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR" };
+  static const char *const msgs[] = { "request served", "cache miss", "connection closed", "connection timeout", "retry scheduled", "upstream timeout" };
+  std::string text;
+  while (text.size() < 2000000)
+  {
+    char line[256];
+    snprintf(line, sizeof(line), "2024-01-%02u %02u:%02u:%02u.%03u %s [worker-%u] %u.%u.%u.%u %s id=%u status=%u %ums\n",
+        rnd(28) + 1, rnd(24), rnd(60), rnd(60), rnd(1000), pick(levels, 6), rnd(16), rnd(256), rnd(256), rnd(256), rnd(256), pick(msgs, 6), rnd(1000000), 200 + 100 * rnd(4), rnd(5000));
+    text.append(line);
+  }
+  return text;
+}
+
+// about 1MB of UTF-8 text with some non-ASCII words, saved as UTF-16LE in a temporary file
+static FILE *corpus_utf16(std::string& text)
+{
+  static const char *const words[] = { "lorem", "ipsum", "dolor", "sit", "amet", "caf\xC3\xA9", "na\xC3\xAFve", "\xCE\xBA\xCF\x8C\xCF\x83\xCE\xBC\xCE\xB5", "\xE6\x97\xA5\xE6\x9C\xAC", "stra\xC3\x9F" "e" };
+  text.clear();
+  while (text.size() < 1000000)
+    text.append(pick(words, 10)).append(rnd(12) == 0 ? ".\n" : " ");
+  FILE *fd = tmpfile();
+  if (fd == nullptr)
+    return nullptr;
+  std::wstring wide = wcs(text);
+  for (size_t i = 0; i < wide.size(); ++i)
+  {
+    int c = static_cast<int>(wide[i]);
+    putc(c & 0xFF, fd);
+    putc((c >> 8) & 0xFF, fd);
+  }
+  return fd;
+}
+
+// about 512KB of words searched for 2000 dictionary words
+static std::string corpus_alternation(std::string& regex)
+{
+  std::vector<std::string> dictionary;
+  regex.clear();
+  for (size_t i = 0; i < 2000; ++i)
+  {
+    std::string word;
+    for (uint32_t n = rnd(6) + 4; n > 0; --n)
+      word.push_back(static_cast<char>('a' + rnd(26)));
+    dictionary.push_back(word);
+    if (i > 0)
+      regex.push_back('|');
+    regex.append(word);
+  }
+  std::string text;
+  while (text.size() < 512000)
+  {
+    if (rnd(100) == 0)
+    {
+      text.append(dictionary[rnd(2000)]);
+    }
+    else
+    {
+      for (uint32_t n = rnd(6) + 4; n > 0; --n)
+        text.push_back(static_cast<char>('a' + rnd(26)));
+    }
+    text.push_back(rnd(10) == 0 ? '\n' : ' ');
+  }
+  return text;
+}
+
+static const char *csource_regex =
+  "/\\*(?:[^*]|\\*+[^*/])*\\*+/|//.*|[A-Za-z_]\\w*|\\d+(?:\\.\\d+)?|\"(?:[^\"\\\\\\n]|\\\\.)*\"|[-+*/%=<>!&|^~?:;,.(){}\\[\\]]+|\\s+|.";
+static const char *logerror_regex = "ERROR[^\\n]*timeout";
+static const char *logip_regex = "\\d+\\.\\d+\\.\\d+\\.\\d+";
+static const char *utf16_regex = "[A-Za-z]+";
+
+/// A workload is a pattern to scan or search a corpus.
+struct Workload {
+  Workload()
+    :
+      name(nullptr),
+      scan(false),
+      heavy(false),
+      file(nullptr),
+      bytes(0)
+#ifndef BENCH_GEN
+    , fsm(nullptr),
+      pred(nullptr)
+#endif
+  { }
+  const char  *name;    ///< workload name
+  std::string  regex;   ///< regex pattern
+  bool         scan;    ///< scan (tokenize) the input when true, search the input otherwise
+  bool         heavy;   ///< too slow for std::regex, run only when selected explicitly
+  std::string  text;    ///< the corpus, or its UTF-8 contents when file is not null
+  FILE        *file;    ///< UTF-16LE input file or null
+  size_t       bytes;   ///< number of input bytes per run
+#ifndef BENCH_GEN
+  Pattern::FSM fsm;     ///< generated FSM code of the pattern
+  const Pattern::Pred *pred; ///< generated predict-match array of the pattern
+#endif
+};
+
+static size_t runs = 5;
+static bool csv = false;
+static std::vector<std::string> selected_workloads;
+static std::vector<std::string> selected_engines;
+
+static const char *const workload_names[] = { "csource", "logerror", "logip", "utf16", "alternation" };
+
+#ifndef BENCH_GEN
+
+// returns true if the name is selected, or if none are selected and the heavy workload is not too slow to run
+static bool is_selected(const std::vector<std::string>& selected, const char *name, bool heavy = false)
+{
+  if (selected.empty())
+    return !heavy;
+  return std::find(selected.begin(), selected.end(), name) != selected.end();
+}
+
+static Input input_of(const Workload& w)
+{
+  if (w.file != nullptr)
+  {
+    rewind(w.file);
+    return Input(w.file, Input::file_encoding::utf16le);
+  }
+  return Input(w.text.data(), w.text.size());
+}
+
+/// Compile a pattern and return a new matcher, timed separately from matching.
+typedef std::function<AbstractMatcher*()> Compile;
+
+static void bench(const Workload& w, const char *engine, Compile compile, bool (*step)(AbstractMatcher&))
+{
+  if (!is_selected(selected_engines, engine, w.heavy && std::strcmp(engine, "std") == 0))
+    return;
+  timer_type t;
+  uint64_t compile_ns = UINT64_MAX;
+  uint64_t match_ns = UINT64_MAX;
+  size_t matches = 0;
+  std::unique_ptr<AbstractMatcher> matcher;
+  for (size_t i = 0; i < runs; ++i)
+  {
+    timer_start(t);
+    matcher.reset(compile());
+    uint64_t ns = timer_elapsed_ns(t);
+    if (ns < compile_ns)
+      compile_ns = ns;
+  }
+  for (size_t i = 0; i < runs; ++i)
+  {
+    Input in = input_of(w);
+    timer_start(t);
+    matcher->input(in);
+    size_t n = 0;
+    while (step(*matcher))
+      ++n;
+    uint64_t ns = timer_elapsed_ns(t);
+    if (ns < match_ns)
+      match_ns = ns;
+    matches = n;
+  }
+  double mbps = match_ns > 0 ? 1000.0 * static_cast<double>(w.bytes) / static_cast<double>(match_ns) : 0.0;
+  double mtps = match_ns > 0 ? 1000.0 * static_cast<double>(matches) / static_cast<double>(match_ns) : 0.0;
+  if (csv)
+    printf("%s,%s,%.3f,%.1f,%.3f,%zu\n", w.name, engine, compile_ns / 1000000.0, mbps, mtps, matches);
+  else
+    printf("%-12s %-8s %12.3f %10.1f %12.3f %10zu\n", w.name, engine, compile_ns / 1000000.0, mbps, mtps, matches);
+  fflush(stdout);
+}
+
+static bool scan(AbstractMatcher& m)
+{
+  return m.scan() != 0;
+}
+
+static bool find(AbstractMatcher& m)
+{
+  return m.find() != 0;
+}
+
+/// A matcher that owns the reflex::Pattern it was compiled with.
+template<typename M>
+class Owner : public M {
+ public:
+  Owner(const std::string& regex, const char *opt)
+    :
+      pat_(regex, opt)
+  {
+    this->pattern(pat_);
+  }
+  Owner(Pattern::FSM fsm, const Pattern::Pred *pred)
+    :
+      pat_(fsm, pred)
+  {
+    this->pattern(pat_);
+  }
+ private:
+  Pattern pat_;
+};
+
+static void bench(const Workload& w)
+{
+  if (!is_selected(selected_workloads, w.name))
+    return;
+  bool (*step)(AbstractMatcher&) = w.scan ? scan : find;
+  const std::string& regex = w.regex;
+  bench(w, "opcode", [&]() { return new Owner<Matcher>(regex, ""); }, step);
+  bench(w, "table", [&]() { return new Owner<Matcher>(regex, "t"); }, step);
+  bench(w, "lazy", [&]() { return new Owner<Matcher>(regex, "l=4096"); }, step);
+  bench(w, "fast", [&]() { return new Owner<Matcher>(w.fsm, w.pred); }, step);
+  if (!w.scan)
+    bench(w, "fuzzy", [&]() { return new Owner<FuzzyMatcher>(regex, ""); }, step);
+#ifndef BENCH_NO_BOOST
+  bench(w, "boost", [&]() { return new BoostPosixMatcher(regex); }, step);
+#endif
+#ifndef BENCH_NO_PCRE2
+  bench(w, "pcre2", [&]() { return new PCRE2Matcher(regex); }, step);
+#endif
+  bench(w, "std", [&]() { return new StdEcmaMatcher(regex); }, step);
+}
+
+#endif
+
+int main(int argc, char **argv)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::strcmp(argv[i], "-c") == 0)
+      csv = true;
+    else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      runs = std::max(1, atoi(argv[++i]));
+    else if (std::find(workload_names, workload_names + 5, std::string(argv[i])) != workload_names + 5)
+      selected_workloads.push_back(argv[i]);
+    else
+      selected_engines.push_back(argv[i]);
+  }
+  std::vector<Workload> workloads(5);
+  workloads[0].name = "csource";
+  workloads[0].regex = csource_regex;
+  workloads[0].scan = true;
+  workloads[0].text = corpus_csource();
+  workloads[1].name = "logerror";
+  workloads[1].regex = logerror_regex;
+  workloads[1].text = corpus_log();
+  workloads[2].name = "logip";
+  workloads[2].regex = logip_regex;
+  workloads[2].text = workloads[1].text;
+  workloads[3].name = "utf16";
+  workloads[3].regex = utf16_regex;
+  workloads[3].file = corpus_utf16(workloads[3].text);
+  workloads[4].name = "alternation";
+  workloads[4].text = corpus_alternation(workloads[4].regex);
+  workloads[4].heavy = true;
+  for (size_t i = 0; i < workloads.size(); ++i)
+  {
+    Workload& w = workloads[i];
+    if (w.file != nullptr)
+    {
+      fseek(w.file, 0, SEEK_END);
+      w.bytes = static_cast<size_t>(ftell(w.file));
+    }
+    else
+    {
+      w.bytes = w.text.size();
+    }
+  }
+#ifdef BENCH_GEN
+  for (size_t i = 0; i < workloads.size(); ++i)
+  {
+    std::string opt = std::string("o;p;n=bench_") + workloads[i].name + ";f=bench_fsm_" + workloads[i].name + ".cpp";
+    Pattern pattern(workloads[i].regex, opt);
+    printf("generated bench_fsm_%s.cpp\n", workloads[i].name);
+  }
+#else
+  workloads[0].fsm = reflex_code_bench_csource;
+  workloads[0].pred = reflex_pred_bench_csource;
+  workloads[1].fsm = reflex_code_bench_logerror;
+  workloads[1].pred = reflex_pred_bench_logerror;
+  workloads[2].fsm = reflex_code_bench_logip;
+  workloads[2].pred = reflex_pred_bench_logip;
+  workloads[3].fsm = reflex_code_bench_utf16;
+  workloads[3].pred = reflex_pred_bench_utf16;
+  workloads[4].fsm = reflex_code_bench_alternation;
+  workloads[4].pred = reflex_pred_bench_alternation;
+  if (csv)
+    printf("workload,engine,compile_ms,mbps,mtokens_per_s,matches\n");
+  else
+    printf("%-12s %-8s %12s %10s %12s %10s\n", "workload", "engine", "compile ms", "MB/s", "Mtokens/s", "matches");
+  for (size_t i = 0; i < workloads.size(); ++i)
+    bench(workloads[i]);
+#endif
+  for (size_t i = 0; i < workloads.size(); ++i)
+    if (workloads[i].file != nullptr)
+      fclose(workloads[i].file);
+  return EXIT_SUCCESS;
+}
@@ -1,5 +1,6 @@
 
 #include <reflex/boostmatcher.h>
+#include <sstream>
 
 // #define INTERACTIVE // for interactive mode testing
 
@@ -452,6 +453,22 @@ int main()
   while (n-- && matcher.split())
     std::cout << matcher.text() << "/";
   std::cout << std::endl << "REST = " << matcher.rest() << std::endl;
+  // split a stream read with a small buffer that grows at the end of the input
+  for (size_t size = 1; size <= 3; ++size)
+  {
+    std::istringstream stream("xc. ");
+    BoostMatcher streamed("x*", stream);
+    streamed.buffer(size);
+    test = "";
+    while (streamed.split())
+    {
+      std::cout << streamed.accept() << ":" << streamed.first() << "+" << streamed.size() << "/";
+      test.append(std::to_string(streamed.accept())).append(":").append(std::to_string(streamed.first())).append("+").append(std::to_string(streamed.size())).append("/");
+    }
+    std::cout << std::endl;
+    if (test != "1:0+0/1:1+0/1:1+1/1:2+1/1:3+1/" + std::to_string(AbstractMatcher::Const::EMPTY) + ":4+0/")
+      error("split stream results");
+  }
   //
   banner("TEST INPUT/UNPUT");
   //
@@ -446,6 +446,30 @@ int main()
     std::cout << matcher.text() << "/";
   std::cout << std::endl << "REST = " << matcher.rest() << std::endl;
   //
+  banner("TEST INVALID UTF-8");
+  //
+  {
+    // pcre2_match() checks the UTF-8 of the buffered input with PCRE2_UTF, invalid UTF-8 stops the search
+    PCRE2UTFMatcher utf8("\\w+", "ab \xc3\xa4 cd");
+    test = "";
+    while (utf8.find())
+      test.append(utf8.text()).append("/");
+    std::cout << test << std::endl;
+    if (test != "ab/\xc3\xa4/cd/")
+      error("valid UTF-8");
+    for (size_t size = 2; size <= 64; size += 62)
+    {
+      PCRE2UTFMatcher invalid("\\w+", "ab \xff\xc3 cd \xc3");
+      invalid.buffer(size);
+      test = "";
+      while (invalid.find())
+        test.append(invalid.text()).append("/");
+      std::cout << size << ": " << test << std::endl;
+      if (!test.empty())
+        error("invalid UTF-8");
+    }
+  }
+  //
   banner("TEST INPUT/UNPUT");
   //
   matcher.pattern(pattern2);
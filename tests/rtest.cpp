@@ -4,7 +4,15 @@
 // Or disable trigraphs by enabling the GNU standard:
 // c++ -std=gnu++11 -Wall test.cpp pattern.cpp matcher.cpp
 
+#include <reflex/feed.h>
+#include <reflex/fixed.h>
 #include <reflex/matcher.h>
+#include <reflex/parallel.h>
+#include <reflex/patternset.h>
+#include <reflex/pool.h>
+#include <reflex/readahead.h>
+#include <dirent.h> // opendir(), readdir() to locate the option c cache files
+#include <unistd.h> // ftruncate(), pipe() for the FILE* input tests
 
 // #define INTERACTIVE // for interactive mode testing
 
@@ -49,6 +57,100 @@ class WrappedMatcher : public Matcher {
   int source;
 };
 
+// records the matches reported by PatternSet::feed() and finish() as "id@end "
+struct MatchRecorder : public PatternSet::Handler {
+  bool operator()(PatternSet::Accept id, size_t end)
+  {
+    text.append(std::to_string(id)).append("@").append(std::to_string(end)).push_back(' ');
+    return true;
+  }
+  std::string text;
+};
+
+// the match of a matcher as "accept:text@first,lineno.columno "
+static std::string match_record(AbstractMatcher& matcher)
+{
+  return std::to_string(matcher.accept()).append(":").append(matcher.str()).append("@").append(std::to_string(matcher.first())).append(",").append(std::to_string(matcher.lineno())).append(".").append(std::to_string(matcher.columno())).append(" ");
+}
+
+// the matches of find() or split() as "accept:text@first ", accept n > 0 is renumbered to choices[n - 1] when given
+static std::string matches_of(const Pattern& pattern, const std::string& text, bool split, const std::vector<size_t>& choices)
+{
+  Matcher matcher(pattern, text);
+  std::string matches;
+  while (split ? matcher.split() : matcher.find())
+  {
+    size_t accept = matcher.accept();
+    if (accept > 0 && accept <= choices.size())
+      accept = choices[accept - 1];
+    matches.append(std::to_string(accept)).append(":").append(matcher.str()).append("@").append(std::to_string(matcher.first())).append(" ");
+  }
+  return matches;
+}
+
+// the opcode table reflex_code_FSM[] saved by a pattern with option f in a file
+static std::vector<Pattern::Opcode> load_code(const char *filename)
+{
+  std::vector<Pattern::Opcode> code;
+  FILE *file = fopen(filename, "r");
+  if (file == NULL)
+    return code;
+  char line[256];
+  while (fgets(line, sizeof(line), file) != NULL && strstr(line, "reflex_code_FSM") == NULL)
+    continue;
+  while (fgets(line, sizeof(line), file) != NULL && strncmp(line, "};", 2) != 0)
+  {
+    unsigned int word;
+    if (sscanf(line, " 0x%8X,", &word) == 1)
+      code.push_back(word);
+  }
+  fclose(file);
+  return code;
+}
+
+// the option c cache files reflex-*.dfa in a directory
+static std::vector<std::string> cache_files(const char *dir)
+{
+  std::vector<std::string> files;
+  DIR *d = opendir(dir);
+  if (d == NULL)
+    return files;
+  struct dirent *entry;
+  while ((entry = readdir(d)) != NULL)
+  {
+    size_t len = strlen(entry->d_name);
+    if (strncmp(entry->d_name, "reflex-", 7) == 0 && len > 4 && strcmp(entry->d_name + len - 4, ".dfa") == 0)
+      files.push_back(std::string(dir).append("/").append(entry->d_name));
+  }
+  closedir(d);
+  return files;
+}
+
+// the content of a file in binary mode
+static std::string read_file(const std::string& filename)
+{
+  std::string data;
+  FILE *file = fopen(filename.c_str(), "rb");
+  if (file == NULL)
+    return data;
+  char block[4096];
+  size_t n;
+  while ((n = fread(block, 1, sizeof(block), file)) > 0)
+    data.append(block, n);
+  fclose(file);
+  return data;
+}
+
+// replace the content of a file in binary mode
+static void write_file(const std::string& filename, const std::string& data)
+{
+  FILE *file = fopen(filename.c_str(), "wb");
+  if (file == NULL)
+    return;
+  fwrite(data.data(), 1, data.size(), file);
+  fclose(file);
+}
+
 struct Test {
   const char *pattern;
   const char *popts;
@@ -119,6 +221,11 @@ Test tests[] = {
   { "(?x: a b\n c)", "", "", "abc", { 1 } },
   { "(?x) a b c\n|\n# COMMENT\n x y z", "", "", "abcxyz", { 1, 2 } },
   { "(?# test option (?x:... )(?x: a b c)|x y z", "", "", "abcx y z", { 1, 2 } },
+  // Pattern option t
+  { "(if|else)|[a-z]+|[0-9]+|\\s+", "t", "", "if x else 12 elsewhere", { 1, 4, 2, 4, 1, 4, 3, 4, 2 } },
+  // Pattern option l
+  { "(if|else)|[a-z]+|[0-9]+|\\s+", "l", "", "if x else 12 elsewhere", { 1, 4, 2, 4, 1, 4, 3, 4, 2 } },
+  { "(?i)abc|[a-z]+x|\\s+", "l=2", "", "ABC abcx AbC", { 1, 3, 2, 3, 1 } },
   // Pattern option s
   { "(?s).", "", "", "a\n", { 1, 1 } },
   { "(?s:.)", "", "", "a\n", { 1, 1 } },
@@ -654,6 +761,10 @@ int main()
   std::cout << std::endl;
   if (test != "abc/def/")
     error("skip");
+  matcher.input("/* a * b **\n** c */d */e\n*/");
+  matcher.buffer(4);
+  if (!matcher.skip("*/") || matcher.lineno() != 2 || matcher.input() != 'd' || !matcher.skip("*/") || matcher.input() != 'e' || matcher.skip("**"))
+    error("skip string");
   //
 #ifdef WITH_SPAN
   banner("TEST SPAN");
@@ -760,6 +871,883 @@ int main()
     error("match results");
   std::cout << std::endl;
   //
+  if (Matcher("(" + utf8(0x5003B, 0xB65FA) + ")", "\xf1\xb2\x88\xa5").matches()) // U+72225
+    std::cout << "OK";
+  else
+    error("match results");
+  std::cout << std::endl;
+  if (Matcher(Matcher::convert("\\P{Glagolitic}", convert_flag::unicode), "\xf0\x9e\x81\x80").matches()) // U+1E040
+    std::cout << "OK";
+  else
+    error("match results");
+  std::cout << std::endl;
+  if (!Matcher(Matcher::convert("\\P{IsHighSurrogates}", convert_flag::unicode), "\xed\xb0\x80").matches()) // U+DC00
+    std::cout << "OK";
+  else
+    error("match results");
+  std::cout << std::endl;
+  //
+  banner("TEST MAP");
+  //
+  FILE *file = tmpfile();
+  if (file != NULL)
+  {
+    fputs("abc def\nxyz", file);
+    rewind(file);
+    Input mapped(file);
+    if (mapped.mapped() || mapped.mapped_data() != nullptr)
+      error("not mapped");
+    if (!mapped.map() || !mapped.mapped() || mapped.size() != 11)
+      error("map");
+    fclose(file);
+    matcher.pattern(pattern8);
+    matcher.input(mapped);
+    test = "";
+    while (matcher.find())
+    {
+      std::cout << matcher.text() << "/";
+      test.append(matcher.text()).append("/");
+    }
+    std::cout << std::endl;
+    if (test != "abc/def/xyz/" || matcher.lineno() != 2)
+      error("map");
+  }
+  //
+  banner("TEST SHARED");
+  //
+  {
+    std::shared_ptr<const Pattern> shared = std::make_shared<Pattern>("\\w+");
+    char small[8];
+    Matcher borrowed(shared, "abc defghijklmnop xyz", Matcher::Buffer(small, sizeof(small)));
+    shared.reset();
+    Matcher *cloned = new Matcher("\\w+", "uvw");
+    Matcher copied(*cloned);
+    delete cloned;
+    test = "";
+    while (borrowed.find())
+    {
+      std::cout << borrowed.text() << "/";
+      test.append(borrowed.text()).append("/");
+    }
+    copied.input("rst uvw");
+    while (copied.find())
+    {
+      std::cout << copied.text() << "/";
+      test.append(copied.text()).append("/");
+    }
+    std::cout << std::endl;
+    if (test != "abc/defghijklmnop/xyz/rst/uvw/" || borrowed.shared_pattern().use_count() != 1)
+      error("shared pattern and borrowed buffer");
+    borrowed.input("a bc");
+    if (!borrowed.find() || borrowed.size() != 1 || !borrowed.find() || borrowed.size() != 2 || borrowed.find())
+      error("borrowed buffer reset");
+  }
+  //
+  banner("TEST POOL");
+  //
+  {
+    MatcherPool<> pool(std::make_shared<Pattern>("\\w+"));
+    const Matcher *first = nullptr;
+    test = "";
+    for (int i = 0; i < 3; ++i)
+    {
+      MatcherPool<>::Handle pooled = pool.acquire(i < 2 ? "abc" : "abc def ghij");
+      if (first == nullptr)
+        first = pooled.get();
+      else if (pooled.get() != first)
+        error("pool recycle");
+      while (pooled->find())
+      {
+        std::cout << pooled->text() << "/";
+        test.append(pooled->text()).append("/");
+      }
+    }
+    std::cout << std::endl;
+    if (test != "abc/abc/abc/def/ghij/" || pool.idle() != 1)
+      error("pool");
+    Matcher sized(pattern8, "abc");
+    if (sized.capacity() >= AbstractMatcher::Const::BLOCK)
+      error("buffer sized to input");
+  }
+  //
+  banner("TEST IN PLACE");
+  //
+  {
+    const char message[] = "abc def xyzw";
+    Matcher viewed("\\<\\w+\\>", Input(message, 11));
+    viewed.in_place(Input(message, 11));
+    test = "";
+    while (viewed.find())
+    {
+      std::cout << viewed.text() << "/";
+      test.append(viewed.text()).append("/");
+      if (viewed.begin() < message || viewed.end() > message + 11)
+        error("in place text");
+    }
+    std::cout << std::endl;
+    if (test != "abc/def/xyz/" || std::strcmp(message, "abc def xyzw") != 0 || !viewed.in_place())
+      error("in place");
+    viewed.in_place(Input(message, 3));
+    if (!viewed.find() || viewed.input() != EOF)
+      error("in place end");
+    viewed.unput('x');
+    viewed.unput('c');
+    if (viewed.input() != 'c' || viewed.input() != EOF || !viewed.in_place())
+      error("in place unput");
+#if defined(HAVE_STRING_VIEW)
+    viewed.in_place(std::string_view(message + 4, 3));
+    if (!viewed.find() || viewed.str() != "def" || viewed.find())
+      error("in place string_view");
+#endif
+    viewed.input("uvw");
+    if (viewed.in_place() || !viewed.find() || viewed.str() != "uvw")
+      error("in place reset");
+  }
+  //
+  banner("TEST LIMIT");
+  //
+  {
+    struct Overflow : AbstractMatcher::OverflowHandler {
+      Overflow() : count(0) { }
+      void operator()(AbstractMatcher&, size_t) { ++count; }
+      size_t count;
+    } overflow;
+    std::string longword = "ab " + std::string(100, 'x') + " cd";
+    Matcher limited("\\w+|\\s+", longword);
+    limited.set_overflow_handler(&overflow);
+    limited.limit(16);
+    test = "";
+    while (limited.scan())
+    {
+      std::cout << limited.text() << "/";
+      test.append(limited.text()).append("/");
+    }
+    std::cout << std::endl;
+    if (test != "ab/ /xxxxxxxxxxxxxxx/" || !limited.overflow() || overflow.count != 1 || limited.capacity() != 16)
+      error("buffer limit");
+    limited.limit(4);
+    limited.input("ab cd ef");
+    test = "";
+    while (limited.scan())
+      test.append(limited.text()).append("/");
+    if (test != "ab/ /cd/ /ef/" || limited.overflow() || limited.capacity() > 4)
+      error("buffer limit shift");
+  }
+  //
+  banner("TEST FIXED");
+  //
+  {
+    using namespace reflex::fixed;
+    typedef cls<range<'a','z'>, chr<'_'> > Alpha;
+    typedef seq<Alpha, star<alt<Alpha, range<'0','9'> > > > Name;
+    typedef plus<range<'0','9'> > Number;
+    typedef seq<lit<'/','*'>, star<alt<not_cls<chr<'*'> >, seq<plus<chr<'*'> >, not_cls<chr<'*'>, chr<'/'> > > > >, plus<chr<'*'> >, chr<'/'> > Comment;
+    Pattern fixed(fsm<lit<'i','f'>, Name, Number, Comment, any>);
+    Matcher tokenizer(fixed, "if iffy=x1 /* a ** b */42");
+    test = "";
+    while (tokenizer.scan())
+    {
+      std::cout << tokenizer.accept() << ":" << tokenizer.text() << "/";
+      test.append(1, static_cast<char>('0' + tokenizer.accept())).append(tokenizer.text()).append("/");
+    }
+    std::cout << std::endl;
+    if (test != "1if/5 /2iffy/5=/2x1/5 /4/* a ** b *//342/")
+      error("fixed pattern scan");
+    Pattern optional(fsm<seq<chr<'a'>, opt<chr<'b'> >, chr<'c'> > >);
+    Matcher searcher(optional, "xxacyyabczzabbc");
+    test = "";
+    while (searcher.find())
+      test.append(searcher.text()).append("/");
+    if (test != "ac/abc/")
+      error("fixed pattern find");
+  }
+  //
+  banner("TEST PARALLEL");
+  //
+  {
+    // compare with a sequential matcher, chunks synchronize at newlines or after a ';' in the middle of a line
+    std::string text;
+    for (int i = 0; i < 200; ++i)
+    {
+      text.append(i % 3 ? "\t" : "").append("abc").append(1, static_cast<char>('a' + i % 26)).append(" ");
+      text.append(std::to_string(i * 7)).append(i % 5 ? "; x\xc3\xa9y " : "  ").append(i % 4 ? "\n" : "; ");
+    }
+    Pattern semicolon(";");
+    for (int sync = 0; sync < 2; ++sync)
+    {
+      for (int method = 0; method < 2; ++method)
+      {
+        const char *regex = method == 0 ? "([a-z]+)|([0-9]+)" : "[ \\t]+|\\n|(;)";
+        Matcher prototype(regex);
+        ParallelMatcher parallel(prototype, 4, 64);
+        if (sync)
+          parallel.sync(&semicolon);
+        ParallelMatcher::Matches matches = method == 0 ? parallel.find(text.data(), text.size()) : parallel.split(text.data(), text.size());
+        Matcher sequential(regex, text);
+        size_t i = 0;
+        while (method == 0 ? sequential.find() : sequential.split())
+        {
+          if (i >= matches.size())
+            error("parallel matches");
+          const ParallelMatcher::Match& match = matches[i++];
+          if (match.accept != sequential.accept() || match.offset != sequential.first() || match.size != sequential.size() || match.lineno != sequential.lineno() || match.columno != sequential.columno())
+            error("parallel match");
+        }
+        if (i != matches.size() || i < 700)
+          error("parallel matches");
+        std::cout << (method == 0 ? "find" : "split") << (sync ? " sync ';'" : "") << ": " << i << " OK" << std::endl;
+      }
+    }
+  }
+  //
+  banner("TEST SCAN BATCH");
+  //
+  {
+    // batches of 7 tokens end in the middle of the input and in the middle of a line
+    std::string text;
+    for (int i = 0; i < 20; ++i)
+      text.append("abc ").append(std::to_string(i)).append(i % 3 ? " x\n" : " yz ");
+    Matcher batched("([a-z]+)|([0-9]+)|\\s+", text);
+    Matcher::TokenBuffer tokens;
+    size_t batches = 0;
+    while (batched.scan_batch(tokens, 7, true) == 7)
+      ++batches;
+    Matcher tokenizer("([a-z]+)|([0-9]+)|\\s+", text);
+    size_t i = 0;
+    while (tokenizer.scan())
+    {
+      if (i >= tokens.size())
+        error("scan batch tokens");
+      const Matcher::Token& token = tokens[i++];
+      if (token.accept != tokenizer.accept() || token.offset != tokenizer.first() || token.size != tokenizer.size() || token.lineno != tokenizer.lineno())
+        error("scan batch token");
+    }
+    std::cout << i << " tokens in " << batches << " full batches" << std::endl;
+    if (i != tokens.size() || batches != i / 7 || i % 7 == 0)
+      error("scan batch tokens");
+    Matcher::TokenBuffer more;
+    if (batched.scan_batch(more, 7) != 0 || !more.empty())
+      error("scan batch at end");
+  }
+  //
+  banner("TEST PATTERN SET");
+  //
+  {
+    std::vector<std::string> rules;
+    rules.push_back("error");
+    rules.push_back("disk [0-9]+");
+    rules.push_back("\\btimeout\\b");
+    rules.push_back("^warn");
+    rules.push_back("x(?=y)");
+    rules.push_back("end$");
+    PatternSet set(rules);
+    Bits ids;
+    if (!set.find("disk 3 timeout", ids) || ids.count() != 2 || !ids[2] || !ids[3])
+      error("pattern set find");
+    // ^warn does not match after a newline without option m
+    if (!set.find("timeouts xy\nwarning errors", ids) || ids.count() != 2 || !ids[1] || !ids[5])
+      error("pattern set find");
+    if (set.find("no match here, xx", ids) || ids.any())
+      error("pattern set find no match");
+    // matches span chunks of 1, 2, 4, 8 and 16 chars, the match of end$ is reported by finish()
+    const char *text = "warn disk 42 xy timeout\nthe end";
+    size_t len = strlen(text);
+    for (size_t n = 1; n <= 32; n *= 2)
+    {
+      MatchRecorder matches;
+      set.reset();
+      for (size_t i = 0; i < len; i += n)
+        set.feed(text + i, std::min(n, len - i), matches);
+      std::cout << n << ": " << matches.text << "| ";
+      if (matches.text != "4@4 2@11 2@12 5@15 3@23 " || set.offset() != len - 1)
+        error("pattern set feed");
+      matches.text.clear();
+      set.finish(matches);
+      std::cout << matches.text << std::endl;
+      if (matches.text != "6@31 " || set.offset() != 0)
+        error("pattern set finish");
+    }
+  }
+  //
+  banner("TEST SUSPEND AND RESUME");
+  //
+  {
+    // a feed of chunks of 1 to 9 chars suspends scan(), find() and split() in the middle of tokens and lines
+    std::string text;
+    for (int i = 0; i < 30; ++i)
+      text.append("abc ").append(std::to_string(37 * i)).append(i % 4 ? " \"s t\"\n" : " defgh ");
+    const char *tokens = "([a-z]+)|([0-9]+)|(\"[^\"]*\")|\\s+";
+    const char *search = "[0-9]+|\"[^\"]*\"";
+    const char *separator = "[0-9]*"; // matches empty at the start of the input
+    std::string scanned, found, splitted;
+    Matcher tokenizer(tokens, text);
+    while (tokenizer.scan())
+      scanned.append(match_record(tokenizer));
+    Matcher searcher(search, text);
+    while (searcher.find())
+      found.append(match_record(searcher));
+    Matcher splitter(separator, text);
+    while (splitter.split())
+      splitted.append(match_record(splitter));
+    for (size_t n = 1; n <= 9; ++n)
+    {
+      std::shared_ptr<Feed> scan_feed(new Feed);
+      std::shared_ptr<Feed> find_feed(new Feed);
+      Matcher scan_matcher(tokens, Input(scan_feed), "S");
+      std::shared_ptr<Feed> split_feed(new Feed);
+      Matcher find_matcher(search, Input(find_feed), "S");
+      Matcher split_matcher(separator, Input(split_feed), "S");
+      std::string scan_result, find_result, split_result;
+      for (size_t i = 0; i < text.size(); i += n)
+      {
+        scan_feed->append(text.data() + i, std::min(n, text.size() - i));
+        find_feed->append(text.data() + i, std::min(n, text.size() - i));
+        split_feed->append(text.data() + i, std::min(n, text.size() - i));
+        while (scan_matcher.scan())
+          scan_result.append(match_record(scan_matcher));
+        while (find_matcher.find())
+          find_result.append(match_record(find_matcher));
+        while (split_matcher.split())
+          split_result.append(match_record(split_matcher));
+        if (!scan_matcher.dry() || !find_matcher.dry() || !split_matcher.dry())
+          error("suspend when dry");
+      }
+      scan_feed->close();
+      find_feed->close();
+      split_feed->close();
+      while (scan_matcher.scan())
+        scan_result.append(match_record(scan_matcher));
+      while (find_matcher.find())
+        find_result.append(match_record(find_matcher));
+      while (split_matcher.split())
+        split_result.append(match_record(split_matcher));
+      std::cout << "chunks of " << n << ": " << scan_result.size() << " " << find_result.size() << " " << split_result.size() << std::endl;
+      if (scan_matcher.dry() || find_matcher.dry() || split_matcher.dry() || !scan_matcher.at_end() || !find_matcher.at_end() || !split_matcher.at_end())
+        error("resume at end");
+      if (scan_result != scanned || find_result != found || split_result != splitted)
+        error("resume");
+    }
+  }
+  //
+  banner("TEST OPTION u");
+  //
+  {
+    // after each add(), remove() and update() find() and split() match as a pattern compiled from the remaining subpatterns
+    std::string text = "see evil.com bad42.net xxy ab abc worse.org evil.comx bad.net xy abcd";
+    std::vector<std::string> subpatterns;
+    subpatterns.push_back("evil\\.com");
+    subpatterns.push_back("bad[0-9]+\\.net");
+    subpatterns.push_back("x+y");
+    subpatterns.push_back("abc");
+    std::vector<bool> removed(subpatterns.size(), false);
+    Pattern pattern("evil\\.com|bad[0-9]+\\.net|x+y|abc", "u");
+    for (int step = 0; step <= 5; ++step)
+    {
+      switch (step)
+      {
+        case 1:
+          if (pattern.add("worse\\.org|ab") != 5)
+            error("option u add");
+          subpatterns.push_back("worse\\.org");
+          subpatterns.push_back("ab");
+          removed.resize(subpatterns.size(), false);
+          break;
+        case 2:
+          pattern.remove(1);
+          removed[0] = true;
+          break;
+        case 3:
+          // the strings abc and evil.com are matched by the first subpattern of the same string that is not removed
+          if (pattern.add("abc|evil\\.com") != 7)
+            error("option u add");
+          subpatterns.push_back("abc");
+          subpatterns.push_back("evil\\.com");
+          removed.resize(subpatterns.size(), false);
+          break;
+        case 4:
+          pattern.remove(4);
+          removed[3] = true;
+          break;
+        case 5:
+          pattern.remove(3);
+          removed[2] = true;
+          pattern.remove(6);
+          removed[5] = true;
+          break;
+      }
+      if (step > 0)
+        pattern.update();
+      std::string regex;
+      std::vector<size_t> choices;
+      for (size_t i = 0; i < subpatterns.size(); ++i)
+      {
+        if (!removed[i])
+        {
+          if (!regex.empty())
+            regex.push_back('|');
+          regex.append(subpatterns[i]);
+          choices.push_back(i + 1);
+        }
+      }
+      Pattern compiled(regex);
+      std::vector<size_t> same;
+      std::string found = matches_of(pattern, text, false, same);
+      std::string split = matches_of(pattern, text, true, same);
+      std::cout << regex << std::endl << found << std::endl << split << std::endl;
+      if (found != matches_of(compiled, text, false, choices))
+        error("option u find");
+      if (split != matches_of(compiled, text, true, choices))
+        error("option u split");
+    }
+  }
+  //
+  banner("TEST ONE STRING");
+  //
+  {
+    // a pattern of one string is searched without the DFA, unless it has a lookahead
+    std::string text = "xx" + std::string(104, '.') + "xxx.xxxx";
+    const char *regexes[] = { "x(?=x)", "xx", "\\.x", "x\\." };
+    for (size_t i = 0; i < sizeof(regexes) / sizeof(regexes[0]); ++i)
+    {
+      // the DFA searches the same pattern with another string that is not in the text
+      Pattern one(regexes[i]);
+      Pattern two(std::string(regexes[i]).append("|\\x01\\x02"));
+      for (size_t size = 1; size <= 17; size += 16)
+      {
+        std::string found[2], split[2];
+        for (int j = 0; j < 2; ++j)
+        {
+          Matcher matcher(j ? two : one, text);
+          matcher.buffer(size);
+          while (matcher.find())
+            found[j].append(match_record(matcher));
+          matcher.input(text);
+          matcher.buffer(size);
+          while (matcher.split())
+            split[j].append(match_record(matcher));
+        }
+        std::cout << regexes[i] << " buffer(" << size << ")" << std::endl << found[0] << std::endl << split[0] << std::endl;
+        if (found[0] != found[1] || split[0] != split[1])
+          error("one string");
+      }
+    }
+    // the string of subpattern 2 after removing subpattern 1 accepts 2
+    Pattern pattern("x+|abab", "u");
+    pattern.remove(1);
+    pattern.update();
+    std::vector<size_t> same;
+    std::string found = matches_of(pattern, "ab abab xabab", false, same);
+    std::string split = matches_of(pattern, "ab abab xabab", true, same);
+    std::cout << found << std::endl << split << std::endl;
+    if (found != "2:abab@3 2:abab@9 " || split != "2:ab @0 2: x@7 4294967295:@13 ")
+      error("one string accept");
+  }
+  //
+  banner("TEST OPCODE TABLES");
+  //
+  {
+    // the opcode tables saved with option f match as the patterns they are saved from, narrow or not
+    const char *regexes[] = { "if|else|while|return|([a-z]+)|([0-9]+)|(\\s+)", "\\x{ff}a|b" };
+    std::string text = "if abc 123\nwhile \xff" "a xyz\xff" "b 4\xff" "ab return";
+    for (size_t i = 0; i < sizeof(regexes) / sizeof(regexes[0]); ++i)
+    {
+      Pattern pattern(regexes[i], "f=dump.cpp");
+      std::vector<Pattern::Opcode> code = load_code("dump.cpp");
+      if (code.empty())
+        error("opcode table saved");
+      bool narrow = (code[0] & 0xFFFF0000) == Pattern::Const::NTBL;
+      std::cout << regexes[i] << ": " << code.size() << " words, first word " << std::hex << code[0] << std::dec << (narrow ? " narrow" : "") << std::endl;
+      if (narrow != (i == 0))
+        error("opcode table narrow");
+      Pattern loaded(code.data());
+      std::vector<size_t> same;
+      std::string found = matches_of(pattern, text, false, same);
+      std::string split = matches_of(pattern, text, true, same);
+      std::cout << found << std::endl << split << std::endl;
+      if (found != matches_of(loaded, text, false, same) || split != matches_of(loaded, text, true, same))
+        error("opcode table loaded");
+    }
+  }
+  //
+  banner("TEST LOOKAHEAD");
+  //
+  {
+    // a lookahead is not part of the match, empty matches are rejected as without a lookahead
+    struct { const char *regex; const char *text; const char *found; const char *split; const char *scanned; } lookaheads[] = {
+      { "a(?=b)", "ab aab ab", "1:a@0 1:a@4 1:a@7 ", "1:@0 1:b a@1 1:b @5 4294967295:b@8 ", "1:a@0 " },
+      { "a*(?=b)", "aab b ab", "1:aa@0 1:a@6 ", "1:@0 1:b @2 1:b @4 4294967295:b@7 ", "1:aa@0 " },
+      { "[a-z]+(?=[0-9])|[0-9]+|\\s", "ab1 cd xy23", "1:ab@0 2:1@2 3: @3 3: @6 1:xy@7 2:23@9 ", "1:@0 2:@2 3:@3 3:cd@4 1:@7 2:@9 4294967295:@11 ", "1:ab@0 2:1@2 3: @3 " },
+      { "x(?=y)|y", "xyxxy", "1:x@0 2:y@1 1:x@3 2:y@4 ", "1:@0 2:@1 1:x@2 2:@4 4294967295:@5 ", "1:x@0 2:y@1 " },
+    };
+    std::vector<size_t> same;
+    for (size_t i = 0; i < sizeof(lookaheads) / sizeof(lookaheads[0]); ++i)
+    {
+      Pattern pattern(lookaheads[i].regex);
+      std::string found = matches_of(pattern, lookaheads[i].text, false, same);
+      std::string split = matches_of(pattern, lookaheads[i].text, true, same);
+      Matcher scanner(pattern, lookaheads[i].text);
+      std::string scanned;
+      while (scanner.scan())
+        scanned.append(std::to_string(scanner.accept())).append(":").append(scanner.str()).append("@").append(std::to_string(scanner.first())).append(" ");
+      std::cout << lookaheads[i].regex << std::endl << found << std::endl << split << std::endl << scanned << std::endl;
+      if (found != lookaheads[i].found)
+        error("lookahead find");
+      if (split != lookaheads[i].split)
+        error("lookahead split");
+      if (scanned != lookaheads[i].scanned)
+        error("lookahead scan");
+    }
+  }
+  //
+  banner("TEST OPTION j");
+  //
+  {
+    // the DFA constructed with threads saves the same opcode table as the DFA constructed serially
+    const char *regexes[] = { "if|else|while|return|([a-z]+)|([0-9]+)|(\\s+)", "(a|b)*a(a|b){6}", "\\w+@\\w+\\.(com|org|net)|[[:upper:]][[:lower:]]*", "x(?=y)|[xy]+z?|\\d{2,5}" };
+    std::string text = "if abc 123\nwhile abbbbbbbab Foo bar@baz.org xyz xxy 987654";
+    for (size_t i = 0; i < sizeof(regexes) / sizeof(regexes[0]); ++i)
+    {
+      Pattern serial(regexes[i], "f=dump.cpp");
+      std::vector<Pattern::Opcode> serial_code = load_code("dump.cpp");
+      for (int jobs = 2; jobs <= 8; jobs *= 2)
+      {
+        Pattern parallel(regexes[i], "j=" + std::to_string(jobs) + ";f=dump.cpp");
+        std::vector<Pattern::Opcode> parallel_code = load_code("dump.cpp");
+        std::cout << regexes[i] << " j=" << jobs << ": " << parallel.nodes() << " states, " << parallel_code.size() << " words" << std::endl;
+        if (serial_code.empty() || parallel_code != serial_code || parallel.nodes() != serial.nodes() || parallel.edges() != serial.edges())
+          error("option j opcode table");
+        std::vector<size_t> same;
+        if (matches_of(parallel, text, false, same) != matches_of(serial, text, false, same))
+          error("option j matches");
+      }
+    }
+  }
+  //
+  banner("TEST OPTION c");
+  //
+  {
+    // a pattern loaded from the cache matches as the pattern it is saved from, a corrupted cache file is ignored and replaced
+    struct { const char *regex; const char *options; } cached[] = {
+      { "if|else|while|return|([a-z]+)|([0-9]+)|(\\s+)", "" },
+      { "[a-z]+(?=[0-9])|[0-9]+|\\s", "" },
+      { "\\w+@\\w+\\.(com|org|net)|[[:upper:]][[:lower:]]*", "a" },
+    };
+    std::string text = "if abc 123\nwhile ab1 Foo bar@baz.org xyz99 return";
+    std::vector<size_t> same;
+    std::vector<std::string> stale = cache_files(".");
+    for (size_t i = 0; i < stale.size(); ++i)
+      remove(stale[i].c_str());
+    for (size_t i = 0; i < sizeof(cached) / sizeof(cached[0]); ++i)
+    {
+      std::string options = std::string(cached[i].options).append(";c=.");
+      Pattern fresh(cached[i].regex, cached[i].options);
+      std::string found = matches_of(fresh, text, false, same);
+      std::string split = matches_of(fresh, text, true, same);
+      std::cout << cached[i].regex << std::endl << found << std::endl << split << std::endl;
+      Pattern compiled(cached[i].regex, options);
+      std::vector<std::string> files = cache_files(".");
+      if (files.size() != 1)
+        error("option c saved");
+      std::string saved = read_file(files[0]);
+      Pattern loaded(cached[i].regex, options);
+      if (matches_of(compiled, text, false, same) != found || matches_of(compiled, text, true, same) != split ||
+          matches_of(loaded, text, false, same) != found || matches_of(loaded, text, true, same) != split)
+        error("option c loaded");
+      for (int k = 0; k < 3; ++k)
+      {
+        std::string data = saved;
+        switch (k)
+        {
+          case 0: data.resize(data.size() / 2);
+                  break;
+          case 1: data[data.size() / 2] ^= 0x55;
+                  break;
+          case 2: data.assign("REflexC");
+                  break;
+        }
+        write_file(files[0], data);
+        Pattern recompiled(cached[i].regex, options);
+        if (matches_of(recompiled, text, false, same) != found || matches_of(recompiled, text, true, same) != split)
+          error("option c corrupted");
+        if (read_file(files[0]) != saved)
+          error("option c replaced");
+        Pattern reloaded(cached[i].regex, options);
+        if (matches_of(reloaded, text, false, same) != found || matches_of(reloaded, text, true, same) != split)
+          error("option c reloaded");
+      }
+      remove(files[0].c_str());
+    }
+  }
+  //
+  banner("TEST MULTIPLE PREFIXES");
+  //
+  {
+    // strings without a common prefix are searched with the nibble filter of their first chars, also when a match straddles a 16 or 32 byte block
+    const char *strings[][4] = {
+      { "foo", "bar", "baz", "qux" },
+      { "ab", "xy", "mn", "" },
+      { "abcd", "wxyz", "klmn", "" },
+      { "kw1", "kw22", "q9", "" },
+    };
+    for (size_t i = 0; i < sizeof(strings) / sizeof(strings[0]); ++i)
+    {
+      std::vector<std::string> literals;
+      std::string regex;
+      for (size_t j = 0; j < 4 && *strings[i][j] != '\0'; ++j)
+      {
+        literals.push_back(strings[i][j]);
+        regex.append(j > 0 ? "|" : "").append(strings[i][j]);
+      }
+      Pattern pattern(regex);
+      std::vector<std::string> texts;
+      for (size_t pos = 10; pos <= 70; ++pos)
+        for (size_t j = 0; j < literals.size(); ++j)
+          texts.push_back(std::string(pos, '.').append(literals[j]).append(std::string(pos % 7, '.')));
+      std::string text;
+      for (size_t pos = 0; text.size() < 200; pos += 5)
+        text.append(std::string(pos % 11, '.')).append(literals[pos % literals.size()]);
+      texts.push_back(text);
+      for (size_t t = 0; t < texts.size(); ++t)
+      {
+        // the leftmost longest string at each position, as found by a naive search
+        std::string expected;
+        for (size_t loc = 0; loc < texts[t].size(); )
+        {
+          size_t longest = 0;
+          for (size_t j = 0; j < literals.size(); ++j)
+            if (texts[t].compare(loc, literals[j].size(), literals[j]) == 0 && (longest == 0 || literals[j].size() > literals[longest - 1].size()))
+              longest = j + 1;
+          if (longest == 0)
+          {
+            ++loc;
+            continue;
+          }
+          expected.append(std::to_string(longest)).append(":").append(literals[longest - 1]).append("@").append(std::to_string(loc)).append(" ");
+          loc += literals[longest - 1].size();
+        }
+        const size_t sizes[] = { 0, 17, 37 };
+        for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k)
+        {
+          Matcher matcher(pattern, texts[t]);
+          if (sizes[k] > 0)
+            matcher.buffer(sizes[k]);
+          std::string found;
+          while (matcher.find())
+            found.append(std::to_string(matcher.accept())).append(":").append(matcher.str()).append("@").append(std::to_string(matcher.first())).append(" ");
+          if (found != expected)
+          {
+            std::cout << regex << " buffer(" << sizes[k] << ")" << std::endl << texts[t] << std::endl << found << std::endl << expected << std::endl;
+            error("multiple prefixes");
+          }
+        }
+      }
+      std::cout << regex << ": " << texts.size() << " texts" << std::endl;
+    }
+  }
+  //
+  banner("TEST OPTION d");
+  //
+  {
+    // the minimized DFA has the fewest states and matches as the DFA constructed by subset construction
+    struct { const char *regex; size_t states; const char *text; } minimized[] = {
+      { "(?:abc|xbc)", 4, "abc xbc abxbc xabc ab" },
+      { "abc|xbc", 7, "abc xbc abxbc xabc ab" },
+      { "(?:foo|bar|baz)", 6, "foobar baz fo ba bazfoo" },
+      { "(?:[a-z]+ing|[a-z]+ed|[a-z]+)", 2, "going jumped run 12 abc-def" },
+      { "(?:a(b|c)d|e(b|c)d|f(b|c)g)", 6, "abd acd ebd ecd fbg fcg fbd abg" },
+      { "(a|b)*(aa|bb)(a|b)*", 4, "ab abab aab babba abba a" },
+      { "(?:\\d+\\.\\d*|\\.\\d+)", 4, "1. 12.34 .5 . 3 .x 7.a" },
+      { "(?:\\w+|\\d+)\\s", 3, "abc 123 x\ty\nz" },
+      { "(?:x(?=y)|xz)", 4, "xy xz xxy x" },
+    };
+    std::vector<size_t> same;
+    for (size_t i = 0; i < sizeof(minimized) / sizeof(minimized[0]); ++i)
+    {
+      Pattern dfa(minimized[i].regex);
+      Pattern min(minimized[i].regex, "d");
+      std::string found = matches_of(dfa, minimized[i].text, false, same);
+      std::string split = matches_of(dfa, minimized[i].text, true, same);
+      std::cout << minimized[i].regex << ": " << dfa.nodes() << " states, minimized " << min.nodes() << " states" << std::endl << found << std::endl << split << std::endl;
+      if (min.nodes() != minimized[i].states || min.nodes() > dfa.nodes() || min.edges() > dfa.edges())
+        error("option d states");
+      if (matches_of(min, minimized[i].text, false, same) != found || matches_of(min, minimized[i].text, true, same) != split)
+        error("option d matches");
+    }
+  }
+  //
+  banner("TEST FILE ENCODINGS");
+  //
+  {
+    // FILE* input is converted to UTF-8 alike when read in chunks of any size, as read one char at a time
+    std::vector<int> chars;
+    unsigned int seed = 1;
+    for (int i = 0; i < 2000; ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      unsigned int r = (seed >> 16) % 100;
+      if (r < 60)
+        for (unsigned int k = 0; k < r % 40; ++k)
+          chars.push_back(k % 16 == 15 ? '\n' : ' ' + (r + k) % 95);
+      else if (r < 80)
+        chars.push_back(0xA0 + r);
+      else if (r < 90)
+        chars.push_back(0x3B1 + r);
+      else if (r < 95)
+        chars.push_back(0x4E2D + r);
+      else
+        chars.push_back(0x1F600 + r);
+    }
+    std::string utf8, latin, latin_utf8;
+    std::string utf16be, utf16le, utf32be, utf32le;
+    for (size_t i = 0; i < chars.size(); ++i)
+    {
+      int c = chars[i];
+      char buf[8];
+      utf8.append(buf, reflex::utf8(c, buf));
+      if (c < 0x100)
+      {
+        latin.push_back(static_cast<char>(c));
+        latin_utf8.append(buf, reflex::utf8(c, buf));
+      }
+      int units[2] = { c, -1 };
+      if (c >= 0x10000)
+      {
+        units[0] = 0xD800 + ((c - 0x10000) >> 10);
+        units[1] = 0xDC00 + ((c - 0x10000) & 0x3FF);
+      }
+      for (int k = 0; k < 2 && units[k] >= 0; ++k)
+      {
+        utf16be.push_back(static_cast<char>(units[k] >> 8));
+        utf16be.push_back(static_cast<char>(units[k]));
+        utf16le.push_back(static_cast<char>(units[k]));
+        utf16le.push_back(static_cast<char>(units[k] >> 8));
+      }
+      for (int k = 24; k >= 0; k -= 8)
+      {
+        utf32be.push_back(static_cast<char>(c >> k));
+        utf32le.push_back(static_cast<char>(c >> (24 - k)));
+      }
+    }
+    // EBCDIC letters and digits, invalid UTF-16 surrogates, out of range UTF-32, and odd trailing bytes
+    std::string ebcdic("\xC1\xC2\xC3\x40\x81\x82\x83\x40\xF1\xF2\xF3\x25", 12);
+    std::string bad16("\x00" "a\xD8\x00\x00" "b\xDC\x00\x00" "c\xD8\x3D\xDE\x00\xD8\x00", 16);
+    std::string bad32("\x00\x00\x00" "a\x00\x11\x00\x00\x00\x00\xD8\x00\x00\x00\x00" "b\x00\x00", 18);
+    struct { const char *name; Input::file_encoding enc; std::string data; std::string expected; } encoded[] = {
+      { "utf16be", Input::file_encoding::utf16be, utf16be, utf8 },
+      { "utf16le", Input::file_encoding::utf16le, utf16le, utf8 },
+      { "utf32be", Input::file_encoding::utf32be, utf32be, utf8 },
+      { "utf32le", Input::file_encoding::utf32le, utf32le, utf8 },
+      { "utf16be BOM", Input::file_encoding::plain, std::string("\xFE\xFF", 2) + utf16be, utf8 },
+      { "utf16le BOM", Input::file_encoding::plain, std::string("\xFF\xFE", 2) + utf16le, utf8 },
+      { "utf32be BOM", Input::file_encoding::plain, std::string("\x00\x00\xFE\xFF", 4) + utf32be, utf8 },
+      { "utf32le BOM", Input::file_encoding::plain, std::string("\xFF\xFE\x00\x00", 4) + utf32le, utf8 },
+      { "utf16le BOM forced utf16be", Input::file_encoding::utf16be, std::string("\xFF\xFE", 2) + utf16le, utf8 },
+      { "utf32be BOM forced latin", Input::file_encoding::latin, std::string("\x00\x00\xFE\xFF", 4) + utf32be, utf8 },
+      { "utf8 BOM forced cp1252", Input::file_encoding::cp1252, "\xEF\xBB\xBF" + utf8, utf8 },
+      { "latin", Input::file_encoding::latin, latin, latin_utf8 },
+      { "cp1252", Input::file_encoding::cp1252, latin + "\x80\x99", "" },
+      { "ebcdic", Input::file_encoding::ebcdic, ebcdic + ebcdic, "ABC abc 123\nABC abc 123\n" },
+      { "utf16le BOM first", Input::file_encoding::plain, std::string("\xFF\xFE\xE9\x00\x3D\xD8\x00\xDE", 8), "\xC3\xA9\xF0\x9F\x98\x80" },
+      { "utf16le first", Input::file_encoding::utf16le, std::string("\x3D\xD8\x00\xDE" "a", 6), "\xF0\x9F\x98\x80" "a" },
+      { "utf32le first", Input::file_encoding::utf32le, std::string("\xE9\x00\x00\x00" "a\x00\x00\x00", 8), "\xC3\xA9" "a" },
+      { "utf16be invalid", Input::file_encoding::utf16be, bad16 + "\x00", "" },
+      { "utf32be invalid", Input::file_encoding::utf32be, bad32, "" },
+    };
+    FILE *file = tmpfile();
+    if (file == NULL)
+      error("tmpfile");
+    for (size_t i = 0; i < sizeof(encoded) / sizeof(encoded[0]); ++i)
+    {
+      rewind(file);
+      if (ftruncate(fileno(file), 0) != 0 || fwrite(encoded[i].data.data(), 1, encoded[i].data.size(), file) != encoded[i].data.size() || fflush(file) != 0)
+        error("tmpfile write");
+      std::string one;
+      const size_t sizes[] = { 1, 2, 3, 4, 5, 7, 8, 15, 16, 17, 31, 64, 100, 4096, 65536 };
+      for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k)
+      {
+        rewind(file);
+        Input input(file, encoded[i].enc);
+        size_t size = k == 0 ? input.size() : 0;
+        std::string text;
+        std::vector<char> chunk(sizes[k]);
+        size_t n;
+        while ((n = input.get(chunk.data(), chunk.size())) > 0)
+          text.append(chunk.data(), n);
+        if (k == 0)
+        {
+          one = text;
+          // size() counts the UTF-8 bytes converted, including any buffered by the BOM check of the forced encoding
+          if (size != text.size())
+          {
+            std::cout << encoded[i].name << " size " << size << ", expected " << text.size() << std::endl;
+            error("file encoding size");
+          }
+        }
+        if (text != one || (!encoded[i].expected.empty() && text != encoded[i].expected))
+        {
+          std::cout << encoded[i].name << " chunk " << sizes[k] << ": " << text.size() << " bytes, expected " << one.size() << " bytes" << std::endl;
+          error("file encoding");
+        }
+      }
+      std::cout << encoded[i].name << ": " << encoded[i].data.size() << " bytes converted to " << one.size() << " bytes" << std::endl;
+    }
+    fclose(file);
+  }
+  //
+  banner("TEST READ AHEAD");
+  //
+  {
+    // a pipe written in small pieces by another thread is scanned and searched alike when read ahead in blocks of any size
+    Pattern pattern("(\\w+)|(\\s+)|([\\x80-\\xff]+)|(.)");
+    std::string text;
+    for (int i = 0; i < 3000; ++i)
+      text.append(i % 7 == 0 ? "\xCE\xB1\xCE\xB2\xCE\xB3 " : "word").append(std::to_string(i)).append(i % 11 == 0 ? "\n" : " ; ");
+    std::string scanned, found;
+    Matcher matcher(pattern, text);
+    while (matcher.scan())
+      scanned.append(match_record(matcher));
+    matcher.input(text);
+    while (matcher.find())
+      found.append(match_record(matcher));
+    const size_t blocks[] = { 1, 3, 64, 4096, ReadAhead::BLOCK };
+    for (size_t k = 0; k < sizeof(blocks) / sizeof(blocks[0]); ++k)
+    {
+      for (int find = 0; find < 2; ++find)
+      {
+        int fd[2];
+        if (pipe(fd) != 0)
+          error("pipe");
+        std::thread writer([&text, fd]() {
+          size_t piece = 1;
+          for (size_t i = 0; i < text.size(); i += piece, piece = piece % 97 + 1)
+          {
+            size_t n = std::min(piece, text.size() - i);
+            if (write(fd[1], text.data() + i, n) != static_cast<ssize_t>(n))
+              break;
+          }
+          close(fd[1]);
+        });
+        FILE *file = fdopen(fd[0], "rb");
+        if (file == NULL)
+          error("fdopen");
+        std::string matches;
+        {
+          Matcher matcher(pattern, ReadAhead::input(Input(file), blocks[k]));
+          while (find ? matcher.find() : matcher.scan())
+            matches.append(match_record(matcher));
+        }
+        writer.join();
+        fclose(file);
+        if (matches != (find ? found : scanned))
+        {
+          std::cout << (find ? "find" : "scan") << " read ahead in blocks of " << blocks[k] << ": " << matches.size() << " bytes of matches, expected " << (find ? found : scanned).size() << std::endl;
+          error("read ahead");
+        }
+      }
+      std::cout << "read ahead in blocks of " << blocks[k] << ": " << text.size() << " bytes" << std::endl;
+    }
+  }
+  //
   banner("DONE");
   return 0;
 }
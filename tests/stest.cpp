@@ -748,6 +748,68 @@ int main()
     error("match results");
   std::cout << std::endl;
   //
+  banner("TEST FILE ENCODING");
+  //
+  {
+    // FILE* input in a forced encoding is matched alike with and without a BOM, a BOM overrides the forced encoding
+    struct { const char *name; Input::file_encoding enc; std::string data; } files[] = {
+      { "utf16le", Input::file_encoding::utf16le, std::string("\xE9\x00 \x00" "a\x00" "b\x00 \x00\x3D\xD8\x00\xDE" "c\x00", 16) },
+      { "utf16le BOM", Input::file_encoding::utf16le, std::string("\xFF\xFE\xE9\x00 \x00" "a\x00" "b\x00 \x00\x3D\xD8\x00\xDE" "c\x00", 18) },
+      { "utf16be", Input::file_encoding::utf16be, std::string("\x00\xE9\x00 \x00" "a\x00" "b\x00 \xD8\x3D\xDE\x00\x00" "c", 16) },
+      { "utf16le BOM forced utf16be", Input::file_encoding::utf16be, std::string("\xFF\xFE\xE9\x00 \x00" "a\x00" "b\x00 \x00\x3D\xD8\x00\xDE" "c\x00", 18) },
+      { "utf32be", Input::file_encoding::utf32be, std::string("\x00\x00\x00\xE9\x00\x00\x00 \x00\x00\x00" "a\x00\x00\x00" "b\x00\x00\x00 \x00\x01\xF6\x00\x00\x00\x00" "c", 28) },
+      { "utf32be BOM", Input::file_encoding::utf32be, std::string("\x00\x00\xFE\xFF\x00\x00\x00\xE9\x00\x00\x00 \x00\x00\x00" "a\x00\x00\x00" "b\x00\x00\x00 \x00\x01\xF6\x00\x00\x00\x00" "c", 32) },
+      { "latin", Input::file_encoding::latin, std::string("\xE9 ab \xF0\x9F\x98\x80" "c", 10) },
+      { "utf8 BOM forced latin", Input::file_encoding::latin, std::string("\xEF\xBB\xBF\xC3\xA9 ab \xF0\x9F\x98\x80" "c", 14) },
+    };
+    std::string expected[] = {
+      "\xC3\xA9/ab/\xF0\x9F\x98\x80" "c/",
+      "\xC3\xA9/ab/\xF0\x9F\x98\x80" "c/",
+      "\xC3\xA9/ab/\xF0\x9F\x98\x80" "c/",
+      "\xC3\xA9/ab/\xF0\x9F\x98\x80" "c/",
+      "\xC3\xA9/ab/\xF0\x9F\x98\x80" "c/",
+      "\xC3\xA9/ab/\xF0\x9F\x98\x80" "c/",
+      "\xC3\xA9/ab/\xC3\xB0\xC2\x9F\xC2\x98\xC2\x80" "c/",
+      "\xC3\xA9/ab/\xF0\x9F\x98\x80" "c/",
+    };
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); ++i)
+    {
+      FILE *file = tmpfile();
+      if (file == nullptr)
+        error("tmpfile");
+      fwrite(files[i].data.data(), 1, files[i].data.size(), file);
+      rewind(file);
+      StdMatcher matcher("[^ ]+", Input(file, files[i].enc));
+      test = "";
+      while (matcher.find())
+        test.append(matcher.text()).append("/");
+      fclose(file);
+      std::cout << files[i].name << ": " << test << std::endl;
+      if (test != expected[i])
+        error("file encoding");
+    }
+  }
+  //
+  banner("TEST PATTERN POINTER");
+  //
+  {
+    // the ECMA and POSIX matchers accept a shared std::regex of their own syntax
+    std::regex ecma("\\w+", std::regex::ECMAScript);
+    std::regex awk("[[:alpha:]]+", std::regex::awk);
+    StdEcmaMatcher ecma_matcher;
+    ecma_matcher.pattern(&ecma);
+    ecma_matcher.input("an apple");
+    StdPosixMatcher posix_matcher;
+    posix_matcher.pattern(&awk);
+    posix_matcher.input("an apple");
+    test = "";
+    while (ecma_matcher.find() && posix_matcher.find())
+      test.append(ecma_matcher.text()).append(":").append(posix_matcher.text()).append("/");
+    std::cout << test << std::endl;
+    if (test != "an:an/apple:apple/")
+      error("pattern pointer");
+  }
+  //
   banner("DONE");
   //
   return 0;
@@ -23,13 +23,10 @@ struct Pos {
 
 using namespace reflex;
 
-int main()
+// test the range set algebra of ORanges and FlatORanges
+template<typename ints>
+void test_algebra()
 {
-
-  ORanges<Pos> positions(0, 3);
-  
-  typedef ORanges<int> ints;
-
   ints A(0, 3);   // A = 0 - - 3 
   ints B(0, 4);   // B = 0 - - - 4
   ints C(0, 5);   // C = 0 - - - - 5
@@ -97,15 +94,64 @@ int main()
   map[B] = B;
   map[C] = D;
   std::cout << "Map of " << map.size() << " ints to ints:" << std::endl;
-  for (std::map<ints,ints>::iterator i = map.begin(); i != map.end(); ++i)
+  for (typename std::map<ints,ints>::iterator i = map.begin(); i != map.end(); ++i)
   {
-    for (ints::iterator j = i->first.begin(); j != i->first.end(); ++j)
+    for (typename ints::const_iterator j = i->first.begin(); j != i->first.end(); ++j)
       std::cout << "[" << j->first << "," << j->second << ")";
     std::cout << " -> ";
-    for (ints::iterator j = i->second.begin(); j != i->second.end(); ++j)
+    for (typename ints::const_iterator j = i->second.begin(); j != i->second.end(); ++j)
       std::cout << "[" << j->first << "," << j->second << ")";
     std::cout << std::endl;
   }
+}
+
+// compare FlatORanges to ORanges on random range insertions, deletions and set operations
+void test_flat()
+{
+  srand(1);
+  for (int run = 0; run < 1000; ++run)
+  {
+    ORanges<int> o1, o2;
+    FlatORanges<int> f1, f2;
+    for (int i = 0; i < 32; ++i)
+    {
+      int n = rand() % 256;
+      int k = rand() % 8;
+      o1.insert(n, n + k);
+      f1.insert(n, n + k);
+      int m = rand() % 256;
+      o2.insert(m, m + k);
+      f2.insert(m, m + k);
+    }
+    int e = rand() % 256;
+    int w = rand() % 16;
+    o1.erase(e, e + w);
+    f1.erase(e, e + w);
+    assert(std::equal(o1.begin(), o1.end(), f1.begin()) && o1.size() == f1.size());
+    for (ORanges<int>::const_iterator i = o2.begin(); i != o2.end(); ++i)
+      assert(f2.find(i->first) != f2.end() && f2.find(i->second) == f2.end());
+    ORanges<int> ou = o1 | o2, od = o2 - o1, oi = o1 & o2;
+    FlatORanges<int> fu = f1 | f2, fd = f2 - f1, fi = f1 & f2;
+    assert(std::equal(ou.begin(), ou.end(), fu.begin()) && ou.size() == fu.size());
+    assert(std::equal(od.begin(), od.end(), fd.begin()) && od.size() == fd.size());
+    assert(std::equal(oi.begin(), oi.end(), fi.begin()) && oi.size() == fi.size());
+    assert(o1.intersects(o2) == f1.intersects(f2));
+    assert(o2.contains(o1) == f2.contains(f1));
+    assert(fu.contains(f1) && fu.contains(f2));
+    o1 &= o2;
+    f1 &= f2;
+    assert(std::equal(o1.begin(), o1.end(), f1.begin()) && o1.size() == f1.size());
+  }
+}
+
+int main()
+{
+
+  ORanges<Pos> positions(0, 3);
+
+  test_algebra< ORanges<int> >();
+  test_algebra< FlatORanges<int> >();
+  test_flat();
 
   Ranges<char> chars;
   chars.insert('0', '9');
@@ -267,6 +313,27 @@ Set of 1 open-ended ranges:
   dt = timer_elapsed(t);
   fprintf(stderr, "%d+%d ranges, elapsed real time = %g ms\n", len1, len2, dt);
 
+  std::cerr << "Random 256 flat o-range insertions timings" << std::endl;
+  timer_start(t);
+  for (int run = 0; run < 5000; ++run)
+  {
+    FlatORanges<int> ints1, ints2;
+    srand(seed);
+    for (int i = 0; i < 256; ++i)
+    {
+      int n = rand() % 1024;
+      ints1.insert(n, n + 3);
+      int m = rand() % 1024;
+      ints2.insert(m, m + 3);
+      sum += ints1.intersects(ints2);
+      // sum += (ints1 & ints2).size();
+    }
+    len1 = ints1.size();
+    len2 = ints2.size();
+  }
+  dt = timer_elapsed(t);
+  fprintf(stderr, "%d+%d ranges, elapsed real time = %g ms\n", len1, len2, dt);
+
   std::cerr << "Raw 0..255 range insertion timings" << std::endl;
   timer_start(t);
   for (int run = 0; run < 10000; ++run)
@@ -289,6 +356,17 @@ Set of 1 open-ended ranges:
   dt = timer_elapsed(t);
   fprintf(stderr, "elapsed real time = %g ms\n", dt);
 
+  std::cerr << "Raw 0..255 flat o-range insertion timings" << std::endl;
+  timer_start(t);
+  for (int run = 0; run < 10000; ++run)
+  {
+    FlatORanges<int> ints;
+    for (int i = 0; i < 256; ++i)
+      ints.insert(i);
+  }
+  dt = timer_elapsed(t);
+  fprintf(stderr, "elapsed real time = %g ms\n", dt);
+
   std::cerr << "Raw 0..255 bits insertion timings" << std::endl;
   timer_start(t);
   for (int run = 0; run < 10000; ++run)